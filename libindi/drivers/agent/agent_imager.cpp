@@ -17,8 +17,11 @@
  *******************************************************************************/
 
 #include <memory>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "agent_imager.h"
+#include "eventloop.h"
 
 #define DEVICE_NAME       "Imager Agent"
 #define DOWNLOAD_TAB      "Download images"
@@ -62,6 +65,20 @@ Imager::Imager() {
   setVersion(1, 2);
   for (int i = 0; i < MAX_GROUP_COUNT; i++)
     groups[i] = new Group(i);
+  // Images are decoded while they arrive and written by a background thread, see Connect()
+  imageWriter = new INDI::BLOBWriterSink(std::bind(&Imager::imagePath, this, std::placeholders::_1),
+                                         std::bind(&Imager::imageWritten, this, std::placeholders::_1, std::placeholders::_2));
+  imageWriter->setDirect(true);
+  // The batch is advanced from the event loop, imageWritten() only queues the result
+  pthread_mutex_init(&writtenLock, NULL);
+  writtenCallback = -1;
+  if (pipe(writtenPipe) == 0) {
+    fcntl(writtenPipe[0], F_SETFL, O_NONBLOCK);
+    writtenCallback = IEAddCallback(writtenPipe[0], imagesWritten, this);
+  } else {
+    writtenPipe[0] = writtenPipe[1] = -1;
+    IDLog("Imager: can not create the image pipe: %s\n", strerror(errno));
+  }
 }
 
 bool Imager::isRunning() {
@@ -77,6 +94,14 @@ bool Imager::isFilterConnected() {
 }
 
 Imager::~Imager() {
+  delete imageWriter;
+  if (writtenCallback >= 0)
+    IERmCallback(writtenCallback);
+  if (writtenPipe[0] >= 0) {
+    close(writtenPipe[0]);
+    close(writtenPipe[1]);
+  }
+  pthread_mutex_destroy(&writtenLock);
 }
 
 void Imager::initiateNextFilter() {
@@ -145,6 +170,74 @@ void Imager::batchDone() {
   IDSetNumber(&ProgressNP, "Batch done");
 }
 
+void Imager::initiateNextImage() {
+  if (image == maxImage) {
+    if (group == maxGroup) {
+      batchDone();
+    } else {
+      maxImage = (int)groups[group]->GroupSettingsN[0].value;
+      ProgressN[0].value = group = group + 1;
+      ProgressN[1].value = image = 1;
+      IDSetNumber(&ProgressNP, NULL);
+      initiateNextFilter();
+    }
+  } else {
+    ProgressN[1].value = image = image + 1;
+    IDSetNumber(&ProgressNP, NULL);
+    initiateNextFilter();
+  }
+}
+
+std::string Imager::imagePath(IBLOB *bp) {
+  if (!isRunning())
+    return std::string();
+  char name[128];
+  strncpy(format, bp->format, 16);
+  snprintf(name, sizeof(name), IMAGE_NAME, ImageNameT[0].text, ImageNameT[1].text, group, image, format);
+  return name;
+}
+
+// Called on the writer thread once the image is on disk, hands the result over to the event loop
+void Imager::imageWritten(const std::string &path, bool ok) {
+  char done = 0;
+  pthread_mutex_lock(&writtenLock);
+  writtenImages.push_back(std::make_pair(path, ok));
+  pthread_mutex_unlock(&writtenLock);
+  if (write(writtenPipe[1], &done, 1) != 1)
+    IDLog("Imager: can not signal %s: %s\n", path.c_str(), strerror(errno));
+}
+
+// Event loop callback of the image pipe
+void Imager::imagesWritten(int fd, void *arg) {
+  Imager *imager = (Imager *)arg;
+  char done[16];
+  while (read(fd, done, sizeof(done)) > 0)
+    ;
+  while (true) {
+    pthread_mutex_lock(&imager->writtenLock);
+    if (imager->writtenImages.empty()) {
+      pthread_mutex_unlock(&imager->writtenLock);
+      break;
+    }
+    std::pair<std::string, bool> written = imager->writtenImages.front();
+    imager->writtenImages.pop_front();
+    pthread_mutex_unlock(&imager->writtenLock);
+    imager->imageSaved(written.first, written.second);
+  }
+}
+
+void Imager::imageSaved(const std::string &path, bool ok) {
+  if (!isRunning())
+    return;
+  if (!ok) {
+    ProgressNP.s = IPS_ALERT;
+    IDSetNumber(&ProgressNP, "Unable to save %s", path.c_str());
+    return;
+  }
+  DEBUGF(INDI::Logger::DBG_DEBUG, "Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image, maxImage, path.c_str());
+  initiateNextImage();
+}
+
 void Imager::initiateDownload() {
   int group = (int)DownloadN[0].value;
   int image = (int)DownloadN[1].value;
@@ -370,6 +463,7 @@ bool Imager::Connect() {
   setServer("localhost", 7624); // TODO configuration options
   watchDevice(controlledCCD);
   watchDevice(controlledFilterWheel);
+  setBLOBSink(controlledCCD, NULL, imageWriter);
   connectServer();
   setBLOBMode(B_ALSO, controlledCCD, NULL);
 
@@ -380,6 +474,7 @@ bool Imager::Disconnect() {
   if (isRunning())
     abortBatch();
   disconnectServer();
+  setBLOBSink(controlledCCD, NULL, NULL);
   return true;
 }
 
@@ -436,31 +531,7 @@ void Imager::removeDevice(INDI::BaseDevice *dp)
 }
 
 void Imager::newBLOB(IBLOB *bp) {
-  if (ProgressNP.s == IPS_BUSY) {
-    char name[128];
-    strncpy(format, bp->format, 16);
-    sprintf(name, IMAGE_NAME, ImageNameT[0].text, ImageNameT[1].text, group, image, format);
-    ofstream file;
-    file.open (name, ios::out | ios::binary | ios::trunc);
-    file.write(static_cast<char *> (bp->blob), bp->bloblen);
-    file.close();
-    DEBUGF(INDI::Logger::DBG_DEBUG, "Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image, maxImage, name);
-    if (image == maxImage) {
-      if (group == maxGroup) {
-        batchDone();
-      } else {
-        maxImage = (int)groups[group]->GroupSettingsN[0].value;
-        ProgressN[0].value = group = group + 1;
-        ProgressN[1].value = image = 1;
-        IDSetNumber(&ProgressNP, NULL);
-        initiateNextFilter();
-      }
-    } else {
-      ProgressN[1].value = image = image + 1;
-      IDSetNumber(&ProgressNP, NULL);
-      initiateNextFilter();
-    }
-  }
+  // Images of the controlled CCD are streamed to imageWriter, only state changes without data end up here
 }
 
 void Imager::newSwitch(ISwitchVectorProperty *svp) {
@@ -511,21 +582,7 @@ void Imager::newText(ITextVectorProperty *tvp) {
       sprintf(name, IMAGE_NAME, ImageNameT[0].text, ImageNameT[1].text, group, image, format);
       rename(tvp->tp[0].text, name);
       DEBUGF(INDI::Logger::DBG_DEBUG, "Group %d of %d, image %d of %d, saved to %s", group, maxGroup, image, maxImage, name);
-      if (image == maxImage) {
-        if (group == maxGroup) {
-          batchDone();
-        } else {
-          maxImage = (int)groups[group]->GroupSettingsN[0].value;
-          ProgressN[0].value = group = group + 1;
-          ProgressN[1].value = image = 1;
-          IDSetNumber(&ProgressNP, NULL);
-          initiateNextFilter();
-        }
-      } else {
-        ProgressN[1].value = image = image + 1;
-        IDSetNumber(&ProgressNP, NULL);
-        initiateNextFilter();
-      }
+      initiateNextImage();
     }
   }
 }
@@ -21,9 +21,14 @@
 
 #include <fitsio.h>
 #include <string.h>
+#include <pthread.h>
+
+#include <deque>
+#include <utility>
 
 #include "defaultdevice.h"
 #include "baseclient.h"
+#include "blobstream.h"
 
 #define MAX_GROUP_COUNT 16
 
@@ -85,6 +90,11 @@ private:
 
   
   Group *groups[MAX_GROUP_COUNT];
+  INDI::BLOBWriterSink *imageWriter;
+  std::deque<std::pair<std::string, bool> > writtenImages;
+  pthread_mutex_t writtenLock;
+  int writtenPipe[2];
+  int writtenCallback;
   
   bool isRunning();
   bool isCCDConnected();
@@ -96,7 +106,12 @@ private:
   void startBatch();
   void abortBatch();
   void batchDone();
+  void initiateNextImage();
   void initiateDownload();
+  std::string imagePath(IBLOB *bp);
+  void imageWritten(const std::string &path, bool ok);
+  void imageSaved(const std::string &path, bool ok);
+  static void imagesWritten(int fd, void *arg);
 
 protected:
   
@@ -0,0 +1,680 @@
+/*******************************************************************************
+ CCD Replay
+
+ Serves the frames of a SER video or of a FITS cube as exposures or as a
+ live stream at a fixed rate, looped, to load clients and indiserver with
+ real data at exact frame rates.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+#include "ccd_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <memory>
+
+#include <fitsio.h>
+
+#include "eventloop.h"
+#include "webcam/v4l2_record/stream_recorder.h"
+#include "webcam/v4l2_record/ser_recorder.h"
+
+const char *REPLAY_TAB = "Replay";
+
+// We declare an auto pointer to ccdreplay.
+std::unique_ptr<CCDReplay> ccdreplay(new CCDReplay());
+
+void ISGetProperties(const char *dev)
+{
+        ccdreplay->ISGetProperties(dev);
+}
+
+void ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int num)
+{
+        ccdreplay->ISNewSwitch(dev, name, states, names, num);
+}
+
+void ISNewText(	const char *dev, const char *name, char *texts[], char *names[], int num)
+{
+        ccdreplay->ISNewText(dev, name, texts, names, num);
+}
+
+void ISNewNumber(const char *dev, const char *name, double values[], char *names[], int num)
+{
+        ccdreplay->ISNewNumber(dev, name, values, names, num);
+}
+
+void ISNewBLOB (const char *dev, const char *name, int sizes[], int blobsizes[], char *blobs[], char *formats[], char *names[], int n)
+{
+  INDI_UNUSED(dev);
+  INDI_UNUSED(name);
+  INDI_UNUSED(sizes);
+  INDI_UNUSED(blobsizes);
+  INDI_UNUSED(blobs);
+  INDI_UNUSED(formats);
+  INDI_UNUSED(names);
+  INDI_UNUSED(n);
+}
+void ISSnoopDevice (XMLEle *root)
+{
+    ccdreplay->ISSnoopDevice(root);
+}
+
+static uint32_t get_int_le(const uint8_t *c)
+{
+    return c[0] | (c[1] << 8) | (c[2] << 16) | ((uint32_t) c[3] << 24);
+}
+
+static double msSince(const struct timeval *start, const struct timeval *now)
+{
+    return (now->tv_sec - start->tv_sec) * 1000.0 + (now->tv_usec - start->tv_usec) / 1000.0;
+}
+
+CCDReplay::CCDReplay()
+{
+    fd = -1;
+    map = NULL;
+    mapSize = 0;
+    frameCount = width = height = 0;
+    bpp = 8;
+    frameBytes = 0;
+    frame = NULL;
+    frameSize = 0;
+    frameIndex = 0;
+    streamTimer = -1;
+    dropped = 0;
+
+    SetCCDCapability(CCD_CAN_ABORT | CCD_CAN_BIN | CCD_CAN_SUBFRAME | CCD_HAS_STREAMING);
+}
+
+CCDReplay::~CCDReplay()
+{
+    CloseFile();
+    free(frame);
+}
+
+const char * CCDReplay::getDefaultName()
+{
+        return (char *)"CCD Replay";
+}
+
+bool CCDReplay::initProperties()
+{
+    INDI::CCD::initProperties();
+
+    IUFillText(&ReplayFileT[0], "FILE", "File", "");
+    IUFillTextVector(&ReplayFileTP, ReplayFileT, 1, getDeviceName(), "REPLAY_FILE", "Replay File", REPLAY_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillNumber(&ReplayRateN[0], "RATE", "Frames/s", "%7.2f", 0.1, 10000.0, 1.0, 30.0);
+    IUFillNumberVector(&ReplayRateNP, ReplayRateN, 1, getDeviceName(), "REPLAY_RATE", "Stream Rate", REPLAY_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&ReplayLoopS[0], "LOOP_ON", "On", ISS_ON);
+    IUFillSwitch(&ReplayLoopS[1], "LOOP_OFF", "Off", ISS_OFF);
+    IUFillSwitchVector(&ReplayLoopSP, ReplayLoopS, 2, getDeviceName(), "REPLAY_LOOP", "Loop", REPLAY_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillNumber(&ReplayStatusN[REPLAY_FRAME], "FRAME", "Frame", "%9.0f", 0, 1e9, 0, 0);
+    IUFillNumber(&ReplayStatusN[REPLAY_FRAMES], "FRAMES", "Frames", "%9.0f", 0, 1e9, 0, 0);
+    IUFillNumber(&ReplayStatusN[REPLAY_FPS], "FPS", "Achieved fps", "%7.2f", 0, 1e5, 0, 0);
+    IUFillNumber(&ReplayStatusN[REPLAY_DROPPED], "DROPPED", "Dropped", "%9.0f", 0, 1e9, 0, 0);
+    IUFillNumberVector(&ReplayStatusNP, ReplayStatusN, 4, getDeviceName(), "REPLAY_STATUS", "Status", REPLAY_TAB, IP_RO, 60, IPS_IDLE);
+
+    addDebugControl();
+
+    return true;
+}
+
+void CCDReplay::ISGetProperties (const char *dev)
+{
+    INDI::CCD::ISGetProperties(dev);
+
+    // The file is chosen before connecting
+    defineText(&ReplayFileTP);
+    defineNumber(&ReplayRateNP);
+    defineSwitch(&ReplayLoopSP);
+
+    if (isConnected())
+        defineNumber(&ReplayStatusNP);
+}
+
+bool CCDReplay::updateProperties()
+{
+    if (isConnected())
+    {
+        SetCCDParams(width, height, bpp, 5.2, 5.2);
+        PrimaryCCD.setNAxis(2);
+        PrimaryCCD.setFrameBufferSize(frameBytes);
+        streamer->setPixelFormat(fourcc);
+        streamer->setRecorderSize(width, height);
+    }
+
+    INDI::CCD::updateProperties();
+
+    if (isConnected())
+    {
+        ReplayStatusN[REPLAY_FRAMES].value = frameCount;
+        defineNumber(&ReplayStatusNP);
+    }
+    else
+        deleteProperty(ReplayStatusNP.name);
+
+    return true;
+}
+
+bool CCDReplay::Connect()
+{
+    if (!OpenFile(ReplayFileT[0].text))
+        return false;
+
+    DEBUGF(INDI::Logger::DBG_SESSION, "Replaying %u frames of %ux%u, %d bits from %s.", frameCount, width, height, bpp, ReplayFileT[0].text);
+    return true;
+}
+
+bool CCDReplay::Disconnect()
+{
+    if (streamTimer >= 0)
+        IERmTimer(streamTimer);
+    streamTimer = -1;
+    InExposure = false;
+    CloseFile();
+    return true;
+}
+
+/* map the file, a SER video or a FITS image or cube */
+bool CCDReplay::OpenFile(const char *filename)
+{
+    struct stat st;
+    uint8_t magic[14];
+    bool ok;
+
+    CloseFile();
+
+    if (filename == NULL || filename[0] == '\0')
+    {
+        DEBUG(INDI::Logger::DBG_ERROR, "Set the SER or FITS file to replay first.");
+        return false;
+    }
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(magic))
+    {
+        DEBUGF(INDI::Logger::DBG_ERROR, "Can not open %s: %s", filename, fd < 0 ? strerror(errno) : "file is too short");
+        CloseFile();
+        return false;
+    }
+
+    mapSize = st.st_size;
+    map = (uint8_t *) mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        map = NULL;
+        DEBUGF(INDI::Logger::DBG_ERROR, "Can not map %s: %s", filename, strerror(errno));
+        CloseFile();
+        return false;
+    }
+
+    memcpy(magic, map, sizeof(magic));
+    swapBytes = fits = false;
+    bzero = 0;
+    if (!memcmp(magic, "LUCAM-RECORDER", 14))
+        ok = OpenSER();
+    else if (!memcmp(magic, "SIMPLE  =", 9))
+        ok = OpenFITS(filename);
+    else
+    {
+        DEBUGF(INDI::Logger::DBG_ERROR, "%s is neither a SER nor a FITS file.", filename);
+        ok = false;
+    }
+
+    if (!ok || frameCount == 0)
+    {
+        if (ok)
+            DEBUGF(INDI::Logger::DBG_ERROR, "%s has no frames.", filename);
+        CloseFile();
+        return false;
+    }
+
+    frameIndex = 0;
+    return true;
+}
+
+bool CCDReplay::OpenSER()
+{
+    uint32_t colorID, littleEndian, depth;
+    bool hostLittleEndian = (*(const uint16_t *) "\1\0") == 1;
+    const char *cfa = NULL;
+
+    if (mapSize < SER_HEADER_SIZE)
+        return false;
+
+    colorID      = get_int_le(map + 18);
+    littleEndian = get_int_le(map + 22);
+    width        = get_int_le(map + 26);
+    height       = get_int_le(map + 30);
+    depth        = get_int_le(map + 34);
+    frameCount   = get_int_le(map + 38);
+
+    if (colorID >= SER_RGB)
+    {
+        DEBUG(INDI::Logger::DBG_ERROR, "Only mono and Bayer SER files can be replayed.");
+        return false;
+    }
+
+    bpp = (depth <= 8) ? 8 : 16;
+    frameBytes = (size_t) width * height * (bpp / 8);
+    dataOffset = SER_HEADER_SIZE;
+    swapBytes = bpp == 16 && ((littleEndian == SER_LITTLE_ENDIAN) != hostLittleEndian);
+
+    // A record which was not closed has a frame count of 0
+    if (frameBytes > 0 && (frameCount == 0 || dataOffset + frameCount * frameBytes > mapSize))
+        frameCount = (mapSize - dataOffset) / frameBytes;
+
+    switch (colorID)
+    {
+    case SER_BAYER_RGGB: cfa = "RGGB"; fourcc = V4L2_PIX_FMT_SRGGB8; break;
+    case SER_BAYER_GRBG: cfa = "GRBG"; fourcc = V4L2_PIX_FMT_SGRBG8; break;
+    case SER_BAYER_GBRG: cfa = "GBRG"; fourcc = V4L2_PIX_FMT_SGBRG8; break;
+    case SER_BAYER_BGGR: cfa = "BGGR"; fourcc = V4L2_PIX_FMT_SBGGR8; break;
+    default:             fourcc = V4L2_PIX_FMT_GREY; break;
+    }
+    if (bpp == 16)
+        fourcc = V4L2_PIX_FMT_Y16;
+
+    if (cfa != NULL)
+    {
+        SetCCDCapability(GetCCDCapability() | CCD_HAS_BAYER);
+        IUSaveText(&BayerT[0], "0");
+        IUSaveText(&BayerT[1], "0");
+        IUSaveText(&BayerT[2], cfa);
+    }
+    else
+        SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
+
+    return true;
+}
+
+/* cfitsio reads the header, the data is served from the mapping */
+bool CCDReplay::OpenFITS(const char *filename)
+{
+    fitsfile *fptr = NULL;
+    int status = 0, bitpix, naxis, compressed = 0;
+    long naxes[3] = { 0, 0, 1 };
+    LONGLONG headstart, datastart, dataend;
+    double bscale = 1, bz = 0;
+    char errmsg[FLEN_ERRMSG];
+
+    if (fits_open_diskfile(&fptr, filename, READONLY, &status) == 0)
+    {
+        fits_get_img_param(fptr, 3, &bitpix, &naxis, naxes, &status);
+        compressed = fits_is_compressed_image(fptr, &status);
+        if (fits_read_key(fptr, TDOUBLE, "BSCALE", &bscale, NULL, &status) == KEY_NO_EXIST)
+            status = 0;
+        if (fits_read_key(fptr, TDOUBLE, "BZERO", &bz, NULL, &status) == KEY_NO_EXIST)
+            status = 0;
+        fits_get_hduaddrll(fptr, &headstart, &datastart, &dataend, &status);
+    }
+    if (status)
+    {
+        fits_get_errstatus(status, errmsg);
+        DEBUGF(INDI::Logger::DBG_ERROR, "FITS error: %s", errmsg);
+        status = 0;
+        if (fptr)
+            fits_close_file(fptr, &status);
+        return false;
+    }
+    fits_close_file(fptr, &status);
+
+    if (compressed || (naxis != 2 && naxis != 3) || (bitpix != BYTE_IMG && bitpix != SHORT_IMG) || bscale != 1)
+    {
+        DEBUG(INDI::Logger::DBG_ERROR, "Only uncompressed 8 or 16 bits FITS images and cubes can be replayed.");
+        return false;
+    }
+
+    fits = true;
+    width = naxes[0];
+    height = naxes[1];
+    frameCount = (naxis == 3) ? naxes[2] : 1;
+    bpp = (bitpix == BYTE_IMG) ? 8 : 16;
+    bzero = bz;
+    frameBytes = (size_t) width * height * (bpp / 8);
+    dataOffset = datastart;
+    fourcc = (bpp == 16) ? V4L2_PIX_FMT_Y16 : V4L2_PIX_FMT_GREY;
+    SetCCDCapability(GetCCDCapability() & ~CCD_HAS_BAYER);
+
+    if (frameBytes > 0 && dataOffset + frameCount * frameBytes > mapSize)
+        frameCount = (mapSize - dataOffset) / frameBytes;
+
+    return true;
+}
+
+void CCDReplay::CloseFile()
+{
+    if (map != NULL)
+        munmap(map, mapSize);
+    if (fd >= 0)
+        close(fd);
+    map = NULL;
+    mapSize = 0;
+    fd = -1;
+    frameCount = 0;
+}
+
+/* the current subframe of a frame, straight from the mapping when it needs no conversion */
+uint8_t *CCDReplay::GetFrame(uint32_t index)
+{
+    uint8_t *src = map + dataOffset + index * frameBytes;
+    int bytes = bpp / 8;
+    int x = PrimaryCCD.getSubX(), y = PrimaryCCD.getSubY();
+    int w = PrimaryCCD.getSubW(), h = PrimaryCCD.getSubH();
+    size_t rowBytes = (size_t) w * bytes;
+    bool convert = swapBytes || (fits && bpp == 16);
+
+    if (!convert && x == 0 && y == 0 && w == (int) width && h == (int) height)
+        return src;
+
+    if (frameSize < rowBytes * h)
+    {
+        frameSize = rowBytes * h;
+        frame = (uint8_t *) realloc(frame, frameSize);
+    }
+
+    for (int row = 0; row < h; row++)
+    {
+        const uint8_t *s = src + ((size_t)(y + row) * width + x) * bytes;
+        uint8_t *d = frame + row * rowBytes;
+
+        if (!convert)
+            memcpy(d, s, rowBytes);
+        else if (!fits)
+        {
+            for (int i = 0; i < w; i++)
+            {
+                d[2 * i]     = s[2 * i + 1];
+                d[2 * i + 1] = s[2 * i];
+            }
+        }
+        else
+        {
+            uint16_t *d16 = (uint16_t *) d;
+            for (int i = 0; i < w; i++)
+            {
+                int v = (int16_t)((s[2 * i] << 8) | s[2 * i + 1]) + bzero;
+                d16[i] = v < 0 ? 0 : v > 65535 ? 65535 : v;
+            }
+        }
+    }
+
+    return frame;
+}
+
+/* false at the end of the file when not looping */
+bool CCDReplay::NextFrame()
+{
+    if (++frameIndex < frameCount)
+        return true;
+
+    frameIndex = 0;
+    return ReplayLoopS[0].s == ISS_ON;
+}
+
+bool CCDReplay::UpdateCCDFrame(int x, int y, int w, int h)
+{
+    if (streamer->isBusy())
+    {
+        DEBUG(INDI::Logger::DBG_WARNING, "Can not change the frame while streaming or recording.");
+        return false;
+    }
+
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > (int) width || y + h > (int) height)
+    {
+        DEBUGF(INDI::Logger::DBG_ERROR, "Frame %dx%d+%d+%d is outside of the %ux%u frames.", w, h, x, y, width, height);
+        return false;
+    }
+
+    PrimaryCCD.setFrame(x, y, w, h);
+    PrimaryCCD.setFrameBufferSize((size_t) w * h * (bpp / 8));
+    streamer->setRecorderSize(w, h);
+    return true;
+}
+
+bool CCDReplay::UpdateCCDBin(int hor, int ver)
+{
+    if (hor != ver || hor > 4)
+    {
+        DEBUG(INDI::Logger::DBG_ERROR, "Only 1x1 to 4x4 binning is supported.");
+        return false;
+    }
+
+    PrimaryCCD.setBin(hor, ver);
+    return UpdateCCDFrame(PrimaryCCD.getSubX(), PrimaryCCD.getSubY(), PrimaryCCD.getSubW(), PrimaryCCD.getSubH());
+}
+
+bool CCDReplay::StartExposure(float duration)
+{
+    if (streamer->isBusy())
+    {
+        DEBUG(INDI::Logger::DBG_WARNING, "Can not take an exposure while streaming or recording.");
+        return false;
+    }
+
+    ExposureRequest = duration;
+    PrimaryCCD.setExposureDuration(duration);
+    gettimeofday(&ExpStart, NULL);
+    InExposure = true;
+    SetTimer(duration * 1000);
+    return true;
+}
+
+bool CCDReplay::AbortExposure()
+{
+    InExposure = false;
+    return true;
+}
+
+void CCDReplay::TimerHit()
+{
+    struct timeval now;
+    double left;
+
+    if (!isConnected() || !InExposure)
+        return;
+
+    gettimeofday(&now, NULL);
+    left = ExposureRequest * 1000.0 - msSince(&ExpStart, &now);
+    if (left > 0)
+    {
+        PrimaryCCD.setExposureLeft(left / 1000.0);
+        SetTimer(left < 1000 ? left : 1000);
+        return;
+    }
+
+    // Served from the mapping or the staging frame, both outlive the exposure upload
+    PrimaryCCD.attachFrameBuffer(GetFrame(frameIndex));
+    NextFrame();
+    PrimaryCCD.binFrame();
+
+    InExposure = false;
+    ExposureComplete(&PrimaryCCD);
+    PrimaryCCD.releaseFrameBuffer();
+    UpdateStatus(true);
+}
+
+bool CCDReplay::StartStreaming()
+{
+    if (InExposure)
+    {
+        DEBUG(INDI::Logger::DBG_WARNING, "Can not stream during an exposure.");
+        return false;
+    }
+
+    gettimeofday(&streamStart, NULL);
+    windowStart = streamStart;
+    windowFrames = 0;
+    slotsServed = 0;
+    dropped = 0;
+
+    if (streamTimer >= 0)
+        IERmTimer(streamTimer);
+    streamTimer = IEAddTimer(0, StreamTimerCallback, this);
+    return true;
+}
+
+bool CCDReplay::StopStreaming()
+{
+    if (streamTimer >= 0)
+        IERmTimer(streamTimer);
+    streamTimer = -1;
+    UpdateStatus(true);
+    return true;
+}
+
+void CCDReplay::StreamTimerCallback(void *p)
+{
+    ((CCDReplay *) p)->StreamTimerHit();
+}
+
+/*
+ * Frame n of the stream is due at n / rate from its start. The frames due while the
+ * event loop was busy elsewhere are dropped, so the replay keeps time with the file.
+ */
+void CCDReplay::StreamTimerHit()
+{
+    double period = 1000.0 / ReplayRateN[0].value, slot, wait;
+    struct timeval now;
+    bool more = true;
+
+    streamTimer = -1;
+
+    gettimeofday(&now, NULL);
+    slot = floor(msSince(&streamStart, &now) / period);
+    if (slot >= slotsServed)
+    {
+        for (; more && slotsServed < slot; slotsServed++)
+        {
+            dropped++;
+            more = NextFrame();
+        }
+
+        if (more)
+        {
+            streamer->newFrame(GetFrame(frameIndex));
+            windowFrames++;
+            more = NextFrame();
+        }
+        slotsServed = slot + 1;
+        UpdateStatus(false);
+    }
+
+    if (!more)
+    {
+        DEBUG(INDI::Logger::DBG_SESSION, "End of the replay file.");
+        UpdateStatus(true);
+        streamer->setStream(false);
+        return;
+    }
+
+    gettimeofday(&now, NULL);
+    wait = slotsServed * period - msSince(&streamStart, &now);
+    streamTimer = IEAddTimer(wait > 0 ? (int) wait : 0, StreamTimerCallback, this);
+}
+
+/* publish the replay position, and the served rate about once a second */
+void CCDReplay::UpdateStatus(bool force)
+{
+    struct timeval now;
+    double ms;
+
+    gettimeofday(&now, NULL);
+    ms = msSince(&windowStart, &now);
+    if (!force && ms < 1000)
+        return;
+
+    if (ms > 0 && windowFrames > 0)
+        ReplayStatusN[REPLAY_FPS].value = windowFrames * 1000.0 / ms;
+    windowStart = now;
+    windowFrames = 0;
+
+    ReplayStatusN[REPLAY_FRAME].value = frameIndex;
+    ReplayStatusN[REPLAY_FRAMES].value = frameCount;
+    ReplayStatusN[REPLAY_DROPPED].value = dropped;
+    ReplayStatusNP.s = (dropped > 0) ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&ReplayStatusNP, NULL);
+}
+
+bool CCDReplay::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, ReplayFileTP.name))
+    {
+        IUUpdateText(&ReplayFileTP, texts, names, n);
+        ReplayFileTP.s = IPS_OK;
+
+        // The frame geometry and properties follow the file, it is opened on connection
+        if (isConnected())
+            DEBUG(INDI::Logger::DBG_SESSION, "The new file is replayed after reconnecting.");
+
+        IDSetText(&ReplayFileTP, NULL);
+        return true;
+    }
+
+    return INDI::CCD::ISNewText(dev, name, texts, names, n);
+}
+
+bool CCDReplay::ISNewNumber (const char *dev, const char *name, double values[], char *names[], int n)
+{
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, ReplayRateNP.name))
+    {
+        IUUpdateNumber(&ReplayRateNP, values, names, n);
+        ReplayRateNP.s = IPS_OK;
+        IDSetNumber(&ReplayRateNP, NULL);
+
+        // The new rate counts from now
+        gettimeofday(&streamStart, NULL);
+        slotsServed = 0;
+        return true;
+    }
+
+    return INDI::CCD::ISNewNumber(dev, name, values, names, n);
+}
+
+bool CCDReplay::ISNewSwitch (const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, ReplayLoopSP.name))
+    {
+        IUUpdateSwitch(&ReplayLoopSP, states, names, n);
+        ReplayLoopSP.s = IPS_OK;
+        IDSetSwitch(&ReplayLoopSP, NULL);
+        return true;
+    }
+
+    return INDI::CCD::ISNewSwitch(dev, name, states, names, n);
+}
+
+bool CCDReplay::saveConfigItems(FILE *fp)
+{
+    INDI::CCD::saveConfigItems(fp);
+
+    IUSaveConfigText(fp, &ReplayFileTP);
+    IUSaveConfigNumber(fp, &ReplayRateNP);
+    IUSaveConfigSwitch(fp, &ReplayLoopSP);
+
+    return true;
+}
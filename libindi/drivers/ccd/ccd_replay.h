@@ -0,0 +1,131 @@
+/*******************************************************************************
+ CCD Replay
+
+ Serves the frames of a SER video or of a FITS cube as exposures or as a
+ live stream at a fixed rate, looped, to load clients and indiserver with
+ real data at exact frame rates.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#ifndef CCDREPLAY_H
+#define CCDREPLAY_H
+
+#include "indibase/indiccd.h"
+
+#include <stdint.h>
+#include <sys/time.h>
+
+class CCDReplay : public INDI::CCD
+{
+public:
+    CCDReplay();
+    virtual ~CCDReplay();
+
+    const char *getDefaultName();
+
+    bool initProperties();
+    bool updateProperties();
+
+    void ISGetProperties (const char *dev);
+
+    bool Connect();
+    bool Disconnect();
+
+    bool StartExposure(float duration);
+    bool AbortExposure();
+
+    bool StartStreaming();
+    bool StopStreaming();
+
+    bool UpdateCCDFrame(int x, int y, int w, int h);
+    bool UpdateCCDBin(int hor, int ver);
+
+    void TimerHit();
+
+    virtual bool ISNewNumber (const char *dev, const char *name, double values[], char *names[], int n);
+    virtual bool ISNewSwitch (const char *dev, const char *name, ISState *states, char *names[], int n);
+    virtual bool ISNewText(	const char *dev, const char *name, char *texts[], char *names[], int num);
+
+protected:
+
+    virtual bool saveConfigItems(FILE *fp);
+
+private:
+
+    enum { REPLAY_FRAME, REPLAY_FRAMES, REPLAY_FPS, REPLAY_DROPPED };
+
+    /* Memory mapped file */
+    bool OpenFile(const char *filename);
+    bool OpenSER();
+    bool OpenFITS(const char *filename);
+    void CloseFile();
+
+    /* Frames */
+    uint8_t *GetFrame(uint32_t index);
+    bool NextFrame();
+
+    static void StreamTimerCallback(void *p);
+    void StreamTimerHit();
+    void UpdateStatus(bool force);
+
+    int fd;
+    uint8_t *map;
+    size_t mapSize;
+    size_t dataOffset;
+    uint32_t frameCount, width, height;
+    int bpp;                /* 8 or 16 bits per pixel */
+    size_t frameBytes;
+    bool swapBytes;         /* 16 bits data of the other endianness */
+    bool fits;              /* signed big endian FITS data, with offset bzero */
+    int bzero;
+    uint32_t fourcc;        /* pixel format given to the recorder */
+
+    /* Converted or cropped frame when the mapped one can not be served as is */
+    uint8_t *frame;
+    size_t frameSize;
+
+    uint32_t frameIndex;
+
+    /* Exposure */
+    struct timeval ExpStart;
+    float ExposureRequest;
+
+    /* Stream pacing, frame slots are counted from the stream start */
+    int streamTimer;
+    struct timeval streamStart;
+    double slotsServed;
+    uint32_t dropped;
+    uint32_t windowFrames;
+    struct timeval windowStart;
+
+    /* Replayed file */
+    IText ReplayFileT[1];
+    ITextVectorProperty ReplayFileTP;
+
+    /* Frame rate of the stream */
+    INumber ReplayRateN[1];
+    INumberVectorProperty ReplayRateNP;
+
+    /* Loop at the end of the file */
+    ISwitch ReplayLoopS[2];
+    ISwitchVectorProperty ReplayLoopSP;
+
+    /* Frame position, achieved rate, dropped frames */
+    INumber ReplayStatusN[4];
+    INumberVectorProperty ReplayStatusNP;
+};
+
+#endif // CCDREPLAY_H
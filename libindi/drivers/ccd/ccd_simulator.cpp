@@ -206,6 +206,13 @@ bool CCDSim::initProperties()
     IUFillSwitch(&TimeFactorS[2],"100X","100x",ISS_OFF);
     IUFillSwitchVector(TimeFactorSV,TimeFactorS,3,getDeviceName(),"ON_TIME_FACTOR","Time Factor","Simulator Config",IP_RW,ISR_1OFMANY,60,IPS_IDLE);
 
+    IUFillSwitch(&StarSourceS[STAR_SOURCE_CATALOG],"CATALOG","Catalog",ISS_ON);
+    IUFillSwitch(&StarSourceS[STAR_SOURCE_GSC],"GSC","GSC",ISS_OFF);
+    IUFillSwitchVector(&StarSourceSP,StarSourceS,2,getDeviceName(),"SIM_STAR_SOURCE","Star Source","Simulator Config",IP_RW,ISR_1OFMANY,60,IPS_IDLE);
+
+    IUFillText(&CatalogFileT[0],"CATALOG_FILE","File","");
+    IUFillTextVector(&CatalogFileTP,CatalogFileT,1,getDeviceName(),"SIM_CATALOG","Star Catalog","Simulator Config",IP_RW,60,IPS_IDLE);
+
     IUFillNumber(&FWHMN[0],"SIM_FWHM","FWHM (arcseconds)","%4.2f",0,60,0,7.5);
     IUFillNumberVector(&FWHMNP,FWHMN,1,ActiveDeviceT[1].text, "FWHM","FWHM",OPTIONS_TAB,IP_RO,60,IPS_IDLE);
 
@@ -241,6 +248,8 @@ void CCDSim::ISGetProperties (const char *dev)
 
     defineNumber(SimulatorSettingsNV);
     defineSwitch(TimeFactorSV);
+    defineSwitch(&StarSourceSP);
+    defineText(&CatalogFileTP);
 
     return;
 }
@@ -643,91 +652,106 @@ int CCDSim::DrawCcdFrame(CCDChip *targetChip)
         CCDChip::CCD_FRAME ftype = targetChip->getFrameType();
 
         if (ftype==CCDChip::LIGHT_FRAME)
-        {  
-            char *orig = setlocale(LC_NUMERIC,"C");
-            //sprintf(gsccmd,"gsc -c %8.6f %+8.6f -r 120 -m 0 9.1",rad+PEOffset,decPE);
-            sprintf(gsccmd,"gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",rad+PEOffset,cameradec,radius,lookuplimit);
-            DEBUGF(INDI::Logger::DBG_DEBUG, "%s",gsccmd);
-            pp=popen(gsccmd,"r");
-            if(pp != NULL) {
-                char line[256];
-                while(fgets(line,256,pp)!=NULL)
-                {
-                    //fprintf(stderr,"%s",line);
-
-                    //  ok, lets parse this line for specifcs we want
-                    char id[20];
-                    char plate[6];
-                    char ob[6];
-                    float mag;
-                    float mage;
-                    float ra;
-                    float dec;
-                    float pose;
-                    int band;
-                    float dist;
-                    int dir;
-                    int c;
-                    int rc;
-
-                    rc=sscanf(line,"%10s %f %f %f %f %f %d %d %4s %2s %f %d",
-                            id,&ra,&dec,&pose,&mag,&mage,&band,&c,plate,ob,&dist,&dir);
-                    //fprintf(stderr,"Parsed %d items\n",rc);
-                    if(rc==12) {
-                        lines++;
-                        //if(c==0) {
-                        stars++;
-                        //fprintf(stderr,"%s %8.4f %8.4f %5.2f %5.2f %d\n",id,ra,dec,mag,dist,dir);
-
-                        //  Convert the ra/dec to standard co-ordinates
-                        double sx;   //  standard co-ords
-                        double sy;   //
-                        double srar;        //  star ra in radians
-                        double sdecr;       //  star dec in radians;
-                        double ccdx;
-                        double ccdy;
-
-                        //fprintf(stderr,"line %s",line);
-                        //fprintf(stderr,"parsed %6.5f %6.5f\n",ra,dec);
-
-                        srar=ra*0.0174532925;
-                        sdecr=dec*0.0174532925;
-                        //  Handbook of astronomical image processing
-                        //  page 253
-                        //  equations 9.1 and 9.2
-                        //  convert ra/dec to standard co-ordinates
-
-                        sx=cos(decr)*sin(srar-rar)/( cos(decr)*cos(sdecr)*cos(srar-rar)+sin(decr)*sin(sdecr) );
-                        sy=(sin(decr)*cos(sdecr)*cos(srar-rar)-cos(decr)*sin(sdecr))/( cos(decr)*cos(sdecr)*cos(srar-rar)+sin(decr)*sin(sdecr) );
-
-                        //  now convert to pixels
-                        ccdx=pa*sx+pb*sy+pc;
-                        ccdy=pd*sx+pe*sy+pf;
-
-                        // Invert horizontally
-                        ccdx = ccdW - ccdx;
-
-                        rc=DrawImageStar(targetChip, mag,ccdx,ccdy);
-                        drawn+=rc;
-                        if(rc==1)
-                        {
-                            //DEBUGF(INDI::Logger::DBG_DEBUG, "star %s scope %6.4f %6.4f star %6.4f %6.4f ccd %6.2f %6.2f",id,rad,decPE,ra,dec,ccdx,ccdy);
-                            //DEBUGF(INDI::Logger::DBG_DEBUG, "star %s ccd %6.2f %6.2f",id,ccdx,ccdy);
+        {
+            std::vector<CatalogStar> gscStars;
+            const std::vector<CatalogStar> *fieldStars = &gscStars;
+
+            if (StarSourceS[STAR_SOURCE_GSC].s == ISS_ON)
+            {
+                char *orig = setlocale(LC_NUMERIC,"C");
+                //sprintf(gsccmd,"gsc -c %8.6f %+8.6f -r 120 -m 0 9.1",rad+PEOffset,decPE);
+                sprintf(gsccmd,"gsc -c %8.6f %+8.6f -r %4.1f -m 0 %4.2f -n 3000",rad+PEOffset,cameradec,radius,lookuplimit);
+                DEBUGF(INDI::Logger::DBG_DEBUG, "%s",gsccmd);
+                pp=popen(gsccmd,"r");
+                if(pp != NULL) {
+                    char line[256];
+                    while(fgets(line,256,pp)!=NULL)
+                    {
+                        //fprintf(stderr,"%s",line);
+
+                        //  ok, lets parse this line for specifcs we want
+                        char id[20];
+                        char plate[6];
+                        char ob[6];
+                        float mag;
+                        float mage;
+                        float ra;
+                        float dec;
+                        float pose;
+                        int band;
+                        float dist;
+                        int dir;
+                        int c;
+                        int rc;
+
+                        rc=sscanf(line,"%10s %f %f %f %f %f %d %d %4s %2s %f %d",
+                                id,&ra,&dec,&pose,&mag,&mage,&band,&c,plate,ob,&dist,&dir);
+                        //fprintf(stderr,"Parsed %d items\n",rc);
+                        if(rc==12) {
+                            lines++;
+                            CatalogStar star;
+                            star.ra  = ra;
+                            star.dec = dec;
+                            star.mag = mag;
+                            gscStars.push_back(star);
                         }
                     }
+                    pclose(pp);
+                } else
+                {
+                    IDMessage(getDeviceName(),"Error looking up stars, is gsc installed with appropriate environment variables set ??");
+                    //fprintf(stderr,"Error doing gsc lookup\n");
                 }
-                pclose(pp);
-		setlocale(LC_NUMERIC,orig);
-            } else
+                setlocale(LC_NUMERIC,orig);
+            }
+            else
             {
-                IDMessage(getDeviceName(),"Error looking up stars, is gsc installed with appropriate environment variables set ??");
-                //fprintf(stderr,"Error doing gsc lookup\n");
-		setlocale(LC_NUMERIC,orig);
+                //  Back to back frames at the same pointing are served from the catalog field cache
+                fieldStars = &catalog.query(rad+PEOffset, cameradec, radius/60.0, lookuplimit);
+                DEBUGF(INDI::Logger::DBG_DEBUG, "Catalog lookup %8.6f %+8.6f radius %4.1f' mag %4.2f: %d stars (%d cache hits)",
+                       rad+PEOffset, cameradec, radius, lookuplimit, (int) fieldStars->size(), catalog.getCacheHits());
             }
-            if(drawn==0)
+
+            for (std::vector<CatalogStar>::const_iterator it = fieldStars->begin(); it != fieldStars->end(); ++it)
             {
-                IDMessage(getDeviceName(),"Got no stars, is gsc installed with appropriate environment variables set ??");
+                int rc;
+                stars++;
+
+                //  Convert the ra/dec to standard co-ordinates
+                double sx;   //  standard co-ords
+                double sy;   //
+                double srar;        //  star ra in radians
+                double sdecr;       //  star dec in radians;
+                double ccdx;
+                double ccdy;
+
+                srar=it->ra*0.0174532925;
+                sdecr=it->dec*0.0174532925;
+                //  Handbook of astronomical image processing
+                //  page 253
+                //  equations 9.1 and 9.2
+                //  convert ra/dec to standard co-ordinates
+
+                sx=cos(decr)*sin(srar-rar)/( cos(decr)*cos(sdecr)*cos(srar-rar)+sin(decr)*sin(sdecr) );
+                sy=(sin(decr)*cos(sdecr)*cos(srar-rar)-cos(decr)*sin(sdecr))/( cos(decr)*cos(sdecr)*cos(srar-rar)+sin(decr)*sin(sdecr) );
+
+                //  now convert to pixels
+                ccdx=pa*sx+pb*sy+pc;
+                ccdy=pd*sx+pe*sy+pf;
+
+                // Invert horizontally
+                ccdx = ccdW - ccdx;
+
+                rc=DrawImageStar(targetChip, it->mag,ccdx,ccdy);
+                drawn+=rc;
+            }
 
+            if(drawn==0)
+            {
+                if (StarSourceS[STAR_SOURCE_GSC].s == ISS_ON)
+                    IDMessage(getDeviceName(),"Got no stars, is gsc installed with appropriate environment variables set ??");
+                else
+                    DEBUG(INDI::Logger::DBG_DEBUG, "No catalog stars in field.");
             }
         }
         //fprintf(stderr,"Got %d stars from %d lines drew %d\n",stars,lines,drawn);
@@ -1016,6 +1040,14 @@ bool CCDSim::ISNewText(	const char *dev, const char *name, char *texts[], char *
             return true;
         }
 
+        if(strcmp(name,CatalogFileTP.name)==0)
+        {
+            IUUpdateText(&CatalogFileTP, texts, names, n);
+            CatalogFileTP.s = LoadCatalog(CatalogFileT[0].text) ? IPS_OK : IPS_ALERT;
+            IDSetText(&CatalogFileTP, NULL);
+            return true;
+        }
+
     }
 
     return INDI::CCD::ISNewText(dev,name,texts,names,n);
@@ -1089,6 +1121,14 @@ bool CCDSim::ISNewSwitch (const char *dev, const char *name, ISState *states, ch
             return true;
         }
 
+        if(strcmp(name,StarSourceSP.name)==0)
+        {
+            IUUpdateSwitch(&StarSourceSP,states,names,n);
+            StarSourceSP.s=IPS_OK;
+            IDSetSwitch(&StarSourceSP,NULL);
+            return true;
+        }
+
     }
 
     if (!strcmp(name, CoolerSP.name))
@@ -1170,7 +1210,31 @@ bool CCDSim::saveConfigItems(FILE *fp)
 
     IUSaveConfigNumber(fp,SimulatorSettingsNV);
     IUSaveConfigSwitch(fp, TimeFactorSV);
+    IUSaveConfigSwitch(fp, &StarSourceSP);
+    IUSaveConfigText(fp, &CatalogFileTP);
+
+    return true;
+}
+
+bool CCDSim::LoadCatalog(const char *filename)
+{
+    char errmsg[MAXRBUF];
+
+    if (filename == NULL || filename[0] == '\0')
+    {
+        catalog.unload();
+        DEBUG(INDI::Logger::DBG_SESSION, "Using synthetic star field.");
+        return true;
+    }
+
+    if (catalog.load(filename, errmsg) == false)
+    {
+        catalog.unload();
+        DEBUGF(INDI::Logger::DBG_ERROR, "%s Using synthetic star field.", errmsg);
+        return false;
+    }
 
+    DEBUGF(INDI::Logger::DBG_SESSION, "Loaded %u stars from %s.", catalog.size(), filename);
     return true;
 }
 
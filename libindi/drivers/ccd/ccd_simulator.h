@@ -22,6 +22,8 @@
 #include "indibase/indiccd.h"
 #include "indibase/indifilterinterface.h"
 
+#include "star_catalog.h"
+
 /*  Some headers we need */
 #include <math.h>
 #include <sys/time.h>
@@ -130,6 +132,18 @@ public:
         ISwitch TimeFactorS[3];
         ISwitchVectorProperty *TimeFactorSV;
 
+        // Where star fields come from: the in-process catalog or the external gsc tool
+        enum { STAR_SOURCE_CATALOG, STAR_SOURCE_GSC };
+        ISwitch StarSourceS[2];
+        ISwitchVectorProperty StarSourceSP;
+
+        // Optional catalog file, the synthetic sky is used when empty
+        IText CatalogFileT[1];
+        ITextVectorProperty CatalogFileTP;
+
+        StarCatalog catalog;
+        bool LoadCatalog(const char *filename);
+
         bool SetupParms();
 
         //  We are going to snoop these from focuser
@@ -0,0 +1,459 @@
+/*
+    Star Catalog
+
+    In-process star catalog with a declination band index for the CCD simulator.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "star_catalog.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <locale.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "indibase.h"
+
+#define NBANDS          180             /* One degree declination bands */
+#define CACHE_SIZE      4               /* Number of fields kept in the LRU cache */
+#define CACHE_MARGIN    1.25            /* Fields are fetched with this radius factor so nearby frames hit the cache */
+#define MAX_SYNTH_MAG   20.0            /* Faintest magnitude generated for the synthetic sky */
+#define CATALOG_MAGIC   "INDISCAT"
+#define CATALOG_VERSION 1
+
+static const double DEG2RAD = M_PI / 180.0;
+
+namespace
+{
+    int bandOf(double dec)
+    {
+        int band = (int) floor(dec) + 90;
+        if (band < 0)
+            return 0;
+        if (band >= NBANDS)
+            return NBANDS-1;
+        return band;
+    }
+
+    bool compareStars(const CatalogStar & a, const CatalogStar & b)
+    {
+        int ba = bandOf(a.dec), bb = bandOf(b.dec);
+        if (ba != bb)
+            return ba < bb;
+        return a.ra < b.ra;
+    }
+
+    bool compareRA(const CatalogStar & a, double ra)
+    {
+        return a.ra < ra;
+    }
+
+    // SplitMix64 finalizer, used to derive reproducible random numbers for the synthetic sky
+    uint64_t hash64(uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    double unitRandom(uint64_t x)
+    {
+        // 53 random bits in (0,1]
+        return ((hash64(x) >> 11) + 1) * (1.0 / 9007199254740992.0);
+    }
+
+    double rangeRA(double ra)
+    {
+        ra = fmod(ra, 360.0);
+        if (ra < 0)
+            ra += 360.0;
+        return ra;
+    }
+}
+
+StarCatalog::StarCatalog()
+{
+    count            = 0;
+    loaded           = false;
+    cacheHits        = 0;
+    syntheticDensity = 250;
+    bandStart.assign(NBANDS+1, 0);
+}
+
+StarCatalog::~StarCatalog()
+{
+}
+
+int StarCatalog::cellsInBand(int band)
+{
+    // Equal area cells of roughly one square degree, as in iso-latitude pixelizations
+    double center = (band - 90 + 0.5) * DEG2RAD;
+    int cells = (int) lround(360.0 * cos(center));
+    return cells < 1 ? 1 : cells;
+}
+
+double StarCatalog::distance(double ra1, double dec1, double ra2, double dec2)
+{
+    double sdec = sin((dec2-dec1) * DEG2RAD / 2);
+    double sra  = sin((ra2-ra1) * DEG2RAD / 2);
+    double a = sdec*sdec + cos(dec1*DEG2RAD) * cos(dec2*DEG2RAD) * sra*sra;
+    return 2 * asin(sqrt(std::min(1.0, a))) / DEG2RAD;
+}
+
+void StarCatalog::clearCache()
+{
+    cache.clear();
+    cacheHits = 0;
+}
+
+void StarCatalog::setSyntheticDensity(double starsPerSqDeg)
+{
+    syntheticDensity = starsPerSqDeg;
+    if (!loaded)
+        clearCache();
+}
+
+void StarCatalog::unload()
+{
+    stars.clear();
+    bandStart.assign(NBANDS+1, 0);
+    count  = 0;
+    loaded = false;
+    clearCache();
+}
+
+void StarCatalog::buildIndex(std::vector<CatalogStar> & list)
+{
+    for (std::vector<CatalogStar>::iterator it = list.begin(); it != list.end(); ++it)
+        it->ra = rangeRA(it->ra);
+
+    std::sort(list.begin(), list.end(), compareStars);
+
+    stars.swap(list);
+    count = stars.size();
+
+    bandStart.assign(NBANDS+1, count);
+    uint32_t i = 0;
+    for (int band = 0; band < NBANDS; band++)
+    {
+        while (i < count && bandOf(stars[i].dec) < band)
+            i++;
+        bandStart[band] = i;
+    }
+
+    loaded = true;
+    clearCache();
+}
+
+bool StarCatalog::readBinary(FILE *fp, const char *filename, char *errmsg)
+{
+    uint32_t header[2];
+    if (fread(header, sizeof(uint32_t), 2, fp) != 2 || header[0] != CATALOG_VERSION)
+    {
+        snprintf(errmsg, MAXRBUF, "Star catalog %s has an unsupported version.", filename);
+        return false;
+    }
+
+    // Check the star count against the file before allocating for it
+    struct stat st;
+    long start = ftell(fp);
+    if (fstat(fileno(fp), &st) < 0 || start < 0 || (uint64_t) header[1] * sizeof(CatalogStar) > (uint64_t) (st.st_size - start))
+    {
+        snprintf(errmsg, MAXRBUF, "Star catalog %s is truncated.", filename);
+        return false;
+    }
+
+    std::vector<CatalogStar> list(header[1]);
+    if (header[1] > 0 && fread(&list[0], sizeof(CatalogStar), header[1], fp) != header[1])
+    {
+        snprintf(errmsg, MAXRBUF, "Star catalog %s is truncated.", filename);
+        return false;
+    }
+
+    buildIndex(list);
+    return true;
+}
+
+bool StarCatalog::loadCache(const char *filename)
+{
+    std::string binfile = std::string(filename) + ".bin";
+    struct stat src, bin;
+
+    // Only a cache at least as new as its source is used
+    if (stat(filename, &src) < 0 || stat(binfile.c_str(), &bin) < 0 || bin.st_mtime < src.st_mtime)
+        return false;
+
+    FILE *fp = fopen(binfile.c_str(), "rb");
+    if (fp == NULL)
+        return false;
+
+    char magic[8];
+    char errmsg[MAXRBUF];
+    bool rc = fread(magic, 1, 8, fp) == 8 && memcmp(magic, CATALOG_MAGIC, 8) == 0 && readBinary(fp, binfile.c_str(), errmsg);
+
+    fclose(fp);
+    return rc;
+}
+
+bool StarCatalog::load(const char *filename, char *errmsg)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL)
+    {
+        snprintf(errmsg, MAXRBUF, "Unable to open star catalog %s (%s).", filename, strerror(errno));
+        return false;
+    }
+
+    std::vector<CatalogStar> list;
+    char magic[8];
+
+    if (fread(magic, 1, 8, fp) == 8 && memcmp(magic, CATALOG_MAGIC, 8) == 0)
+    {
+        bool rc = readBinary(fp, filename, errmsg);
+        fclose(fp);
+        return rc;
+    }
+
+    // A text catalog parsed earlier is read back from its binary copy
+    if (loadCache(filename))
+    {
+        fclose(fp);
+        return true;
+    }
+
+    rewind(fp);
+
+    char line[MAXRBUF];
+    int lineno=0;
+    char *orig = setlocale(LC_NUMERIC,"C");
+    while (fgets(line, MAXRBUF, fp) != NULL)
+    {
+        CatalogStar star;
+        lineno++;
+
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+
+        if (sscanf(line, "%f %f %f", &star.ra, &star.dec, &star.mag) != 3 || star.dec < -90 || star.dec > 90)
+        {
+            snprintf(errmsg, MAXRBUF, "Star catalog %s: invalid entry on line %d.", filename, lineno);
+            setlocale(LC_NUMERIC,orig);
+            fclose(fp);
+            return false;
+        }
+
+        list.push_back(star);
+    }
+    setlocale(LC_NUMERIC,orig);
+    fclose(fp);
+
+    buildIndex(list);
+
+    // Keep a compact copy around so the next load is a single read
+    std::string binfile = std::string(filename) + ".bin";
+    save(binfile.c_str());
+
+    return true;
+}
+
+bool StarCatalog::save(const char *filename) const
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+        return false;
+
+    uint32_t header[2] = { CATALOG_VERSION, count };
+    bool rc = fwrite(CATALOG_MAGIC, 1, 8, fp) == 8 && fwrite(header, sizeof(uint32_t), 2, fp) == 2;
+
+    if (rc && count > 0)
+        rc = fwrite(&stars[0], sizeof(CatalogStar), count, fp) == count;
+
+    if (fclose(fp) != 0)
+        rc = false;
+
+    if (!rc)
+        remove(filename);
+
+    return rc;
+}
+
+const std::vector<CatalogStar> & StarCatalog::query(double ra, double dec, double radius, double maglimit)
+{
+    ra = rangeRA(ra);
+
+    for (std::list<CachedField>::iterator it = cache.begin(); it != cache.end(); ++it)
+    {
+        if (fabs(it->maglimit - maglimit) < 1e-3 && distance(ra, dec, it->ra, it->dec) + radius <= it->radius)
+        {
+            cacheHits++;
+            if (it != cache.begin())
+                cache.splice(cache.begin(), cache, it);
+            return cache.front().stars;
+        }
+    }
+
+    CachedField field;
+    field.ra       = ra;
+    field.dec      = dec;
+    field.radius   = radius * CACHE_MARGIN;
+    field.maglimit = maglimit;
+
+    cache.push_front(field);
+    if (cache.size() > CACHE_SIZE)
+        cache.pop_back();
+
+    if (loaded)
+        searchBands(ra, dec, field.radius, maglimit, cache.front().stars);
+    else
+        searchSynthetic(ra, dec, field.radius, maglimit, cache.front().stars);
+
+    return cache.front().stars;
+}
+
+/* Half width in RA of a cone, or 180 if the cone contains a pole */
+static double coneHalfWidth(double dec, double radius)
+{
+    if (fabs(dec) + radius >= 90.0)
+        return 180.0;
+
+    double s = sin(radius*DEG2RAD) / cos(dec*DEG2RAD);
+    return s >= 1.0 ? 180.0 : asin(s) / DEG2RAD;
+}
+
+void StarCatalog::searchBands(double ra, double dec, double radius, double maglimit, std::vector<CatalogStar> & out) const
+{
+    double halfWidth = coneHalfWidth(dec, radius);
+
+    // RA ranges to scan, split in two where the cone crosses 0h
+    double ranges[2][2];
+    int nranges=1;
+
+    if (halfWidth >= 180.0)
+    {
+        ranges[0][0] = 0;
+        ranges[0][1] = 360;
+    }
+    else if (ra - halfWidth < 0)
+    {
+        ranges[0][0] = 0;
+        ranges[0][1] = ra + halfWidth;
+        ranges[1][0] = ra - halfWidth + 360;
+        ranges[1][1] = 360;
+        nranges = 2;
+    }
+    else if (ra + halfWidth >= 360)
+    {
+        ranges[0][0] = ra - halfWidth;
+        ranges[0][1] = 360;
+        ranges[1][0] = 0;
+        ranges[1][1] = ra + halfWidth - 360;
+        nranges = 2;
+    }
+    else
+    {
+        ranges[0][0] = ra - halfWidth;
+        ranges[0][1] = ra + halfWidth;
+    }
+
+    for (int band = bandOf(dec-radius); band <= bandOf(dec+radius); band++)
+    {
+        std::vector<CatalogStar>::const_iterator first = stars.begin() + bandStart[band];
+        std::vector<CatalogStar>::const_iterator last  = stars.begin() + bandStart[band+1];
+
+        for (int r=0; r < nranges; r++)
+        {
+            std::vector<CatalogStar>::const_iterator it = std::lower_bound(first, last, ranges[r][0], compareRA);
+            for (; it != last && it->ra <= ranges[r][1]; ++it)
+            {
+                if (it->mag <= maglimit && distance(ra, dec, it->ra, it->dec) <= radius)
+                    out.push_back(*it);
+            }
+        }
+    }
+}
+
+void StarCatalog::generateCell(int band, int cell, int ncells, double maglimit, std::vector<CatalogStar> & out) const
+{
+    double width   = 360.0 / ncells;
+    double sinLow  = sin((band - 90) * DEG2RAD);
+    double sinHigh = sin((band - 89) * DEG2RAD);
+    double area    = width * (sinHigh - sinLow) / DEG2RAD;
+
+    // Cumulative star counts grow roughly as 10^(0.45 m). Stars are generated brightest first with a
+    // reproducible magnitude per index, so the field at a brighter limit is a prefix of a fainter one.
+    double n17 = syntheticDensity * area;
+    int n = (int) ceil(n17 * pow(10, 0.45 * (std::min(maglimit, MAX_SYNTH_MAG) - 17.0)));
+
+    uint64_t seed = ((uint64_t) band << 48) | ((uint64_t) cell << 24);
+
+    for (int i=0; i < n; i++)
+    {
+        uint64_t key = (seed | (uint64_t) i) * 4;
+        CatalogStar star;
+
+        star.mag = 17.0 + log10((i + unitRandom(key)) / n17) / 0.45;
+        if (star.mag > maglimit)
+            break;
+
+        star.ra  = (cell + unitRandom(key+1)) * width;
+        star.dec = asin(sinLow + unitRandom(key+2) * (sinHigh - sinLow)) / DEG2RAD;
+        out.push_back(star);
+    }
+}
+
+void StarCatalog::searchSynthetic(double ra, double dec, double radius, double maglimit, std::vector<CatalogStar> & out) const
+{
+    double halfWidth = coneHalfWidth(dec, radius);
+    std::vector<CatalogStar> cellStars;
+
+    for (int band = bandOf(dec-radius); band <= bandOf(dec+radius); band++)
+    {
+        int ncells = cellsInBand(band);
+        double width = 360.0 / ncells;
+        int first, last;
+
+        if (halfWidth >= 180.0 || 2*halfWidth + 2*width >= 360.0)
+        {
+            first = 0;
+            last  = ncells - 1;
+        }
+        else
+        {
+            first = (int) floor((ra - halfWidth) / width);
+            last  = (int) floor((ra + halfWidth) / width);
+        }
+
+        for (int c = first; c <= last; c++)
+        {
+            int cell = ((c % ncells) + ncells) % ncells;
+
+            cellStars.clear();
+            generateCell(band, cell, ncells, maglimit, cellStars);
+
+            for (std::vector<CatalogStar>::const_iterator it = cellStars.begin(); it != cellStars.end(); ++it)
+            {
+                if (distance(ra, dec, it->ra, it->dec) <= radius)
+                    out.push_back(*it);
+            }
+        }
+    }
+}
@@ -0,0 +1,140 @@
+/*
+    Star Catalog
+
+    In-process star catalog with a declination band index for the CCD simulator.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#ifndef STAR_CATALOG_H
+#define STAR_CATALOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <list>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A single catalog entry. Coordinates are J2000 degrees.
+ */
+typedef struct
+{
+    float ra;
+    float dec;
+    float mag;
+} CatalogStar;
+
+/**
+ * @brief The StarCatalog class provides cone searches over a star list held in memory.
+ *
+ * Stars are stored in one degree declination bands, each sorted by right ascension, so a cone search only
+ * visits the bands and RA ranges that overlap the field. Catalogs are read either from a text file with one
+ * "RA DEC MAG" (degrees) entry per line, or from the compact binary form written by save(). When no catalog
+ * is loaded, a deterministic synthetic sky is generated on demand over equal-area cells of the same bands.
+ *
+ * The last few fields are kept in an LRU cache. Each field is fetched with a margin so that consecutive frames
+ * at the same pointing, including small guiding and periodic error offsets, are served from the cache.
+ */
+class StarCatalog
+{
+public:
+    StarCatalog();
+    ~StarCatalog();
+
+    /**
+     * @brief load Load a catalog file. Binary catalogs are detected by their header, anything else is parsed as text.
+     * When a text catalog is parsed successfully, its binary form is written next to it as filename.bin if possible.
+     * Later loads of the text catalog read filename.bin instead, as long as it is not older than the text file.
+     * @param filename path to the catalog.
+     * @param errmsg buffer of at least MAXRBUF bytes for an error message.
+     * @return True if the catalog was loaded, false otherwise. On failure the synthetic sky remains in use.
+     */
+    bool load(const char *filename, char *errmsg);
+
+    /**
+     * @brief save Write the currently loaded catalog in binary form.
+     * @param filename path of the binary catalog.
+     * @return True if successful, false otherwise.
+     */
+    bool save(const char *filename) const;
+
+    /**
+     * @brief unload Drop the loaded catalog and fall back to the synthetic sky.
+     */
+    void unload();
+
+    /**
+     * @return True if a catalog file is loaded, false if the synthetic sky is used.
+     */
+    bool isLoaded() const { return loaded; }
+
+    /**
+     * @return Number of stars in the loaded catalog.
+     */
+    uint32_t size() const { return count; }
+
+    /**
+     * @brief query Return stars within a cone.
+     * @param ra center right ascension in degrees (J2000).
+     * @param dec center declination in degrees (J2000).
+     * @param radius cone radius in degrees.
+     * @param maglimit faintest magnitude to return.
+     * @return stars inside the cone. The result may also contain stars slightly outside the cone when served from cache.
+     */
+    const std::vector<CatalogStar> & query(double ra, double dec, double radius, double maglimit);
+
+    /**
+     * @return Number of queries served from the field cache since the catalog was last changed.
+     */
+    uint32_t getCacheHits() const { return cacheHits; }
+
+    /**
+     * @brief setSyntheticDensity Set the density of the synthetic sky.
+     * @param starsPerSqDeg number of stars per square degree brighter than magnitude 17.
+     */
+    void setSyntheticDensity(double starsPerSqDeg);
+
+private:
+    typedef struct
+    {
+        double ra, dec, radius, maglimit;
+        std::vector<CatalogStar> stars;
+    } CachedField;
+
+    void clearCache();
+    bool readBinary(FILE *fp, const char *filename, char *errmsg);
+    bool loadCache(const char *filename);
+    void buildIndex(std::vector<CatalogStar> & stars);
+    void searchBands(double ra, double dec, double radius, double maglimit, std::vector<CatalogStar> & out) const;
+    void searchSynthetic(double ra, double dec, double radius, double maglimit, std::vector<CatalogStar> & out) const;
+    void generateCell(int band, int cell, int ncells, double maglimit, std::vector<CatalogStar> & out) const;
+
+    static int cellsInBand(int band);
+    static double distance(double ra1, double dec1, double ra2, double dec2);
+
+    // Stars sorted by band then RA. bandStart[b] is the index of the first star of band b, bandStart[NBANDS] = count.
+    std::vector<CatalogStar> stars;
+    std::vector<uint32_t> bandStart;
+    uint32_t count;
+    bool loaded;
+
+    std::list<CachedField> cache;
+    uint32_t cacheHits;
+    double syntheticDensity;
+};
+
+#endif // STAR_CATALOG_H
@@ -284,7 +284,7 @@ bool LX200Basic::ReadScopeStatus()
         return true;
     }
 
-    if ( getLX200RA(PortFD, &currentRA) < 0 || getLX200DEC(PortFD, &currentDEC) < 0)
+    if ( getLX200EquatorialCoords(PortFD, &currentRA, &currentDEC) < 0)
     {
       EqNP.s = IPS_ALERT;
       IDSetNumber(&EqNP, "Error reading RA/DEC.");
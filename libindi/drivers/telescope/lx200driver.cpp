@@ -65,6 +65,10 @@ int getCommandSexa(int fd, double *value, const char *cmd);
 int getCommandString(int fd, char *data, const char* cmd);
 /* Get Int */
 int getCommandInt(int fd, int *value, const char* cmd);
+/* Pipeline several queries in a single write */
+int getCommandBatch(int fd, LX200Query *queries, int n);
+/* Get RA and DEC in one round-trip */
+int getLX200EquatorialCoords(int fd, double *ra, double *dec);
 /* Get tracking frequency */
 int getTrackFreq(int fd, double * value);
 /* Get site Latitude */
@@ -231,7 +235,7 @@ int getCommandSexa(int fd, double *value, const char * cmd)
   if ( (error_type = tty_write_string(fd, cmd, &nbytes_write)) != TTY_OK)
    return error_type;
   
-  error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+  error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
   tcflush(fd, TCIFLUSH);
   if (error_type != TTY_OK)
     return error_type;
@@ -266,7 +270,7 @@ int getCommandInt(int fd, int *value, const char* cmd)
   if ( (error_type = tty_write_string(fd, cmd, &nbytes_write)) != TTY_OK)
    return error_type;
   
-  error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+  error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
   tcflush(fd, TCIFLUSH);
   if (error_type != TTY_OK)
     return error_type;
@@ -319,6 +323,108 @@ int getCommandString(int fd, char *data, const char* cmd)
     return 0;
 }
 
+int getCommandBatch(int fd, LX200Query *queries, int n)
+{
+    char cmd_string[LX200_MAX_BATCH * 16];
+    char temp_string[64];
+    struct timeval tv_start, tv_now;
+    int error_type;
+    int nbytes_write=0, nbytes_read=0;
+    int i;
+
+    if (n <= 0 || n > LX200_MAX_BATCH)
+        return -1;
+
+    /* Queue all commands into a single write so the mount processes them back-to-back */
+    cmd_string[0] = '\0';
+    for (i=0; i < n; i++)
+    {
+        queries[i].error   = -1;
+        queries[i].latency = 0;
+        strncat(cmd_string, queries[i].cmd, sizeof(cmd_string) - strlen(cmd_string) - 1);
+    }
+
+    tcflush(fd, TCIFLUSH);
+
+    DEBUGFDEVICE(lx200Name, DBG_SCOPE, "CMD <%s>", cmd_string);
+
+    gettimeofday(&tv_start, NULL);
+
+    if ( (error_type = tty_write_string(fd, cmd_string, &nbytes_write)) != TTY_OK)
+        return error_type;
+
+    /* Responses arrive in command order, each terminated by # */
+    for (i=0; i < n; i++)
+    {
+        error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
+        if (error_type != TTY_OK)
+        {
+            for (; i < n; i++)
+                queries[i].error = error_type;
+            tcflush(fd, TCIFLUSH);
+            return error_type;
+        }
+
+        gettimeofday(&tv_now, NULL);
+        queries[i].latency = (tv_now.tv_sec - tv_start.tv_sec) * 1000.0 + (tv_now.tv_usec - tv_start.tv_usec) / 1000.0;
+
+        temp_string[nbytes_read - 1] = '\0';
+
+        DEBUGFDEVICE(lx200Name, DBG_SCOPE, "RES <%s> %s (%.1f ms)", temp_string, queries[i].cmd, queries[i].latency);
+
+        switch (queries[i].type)
+        {
+            case LX200_RESPONSE_SEXA:
+                if (f_scansexa(temp_string, (double *) queries[i].value) == 0)
+                    queries[i].error = 0;
+                break;
+
+            case LX200_RESPONSE_INT:
+            {
+                float temp_number;
+                if (strchr(temp_string, '.'))
+                {
+                    if (sscanf(temp_string, "%f", &temp_number) == 1)
+                    {
+                        *((int *) queries[i].value) = (int) temp_number;
+                        queries[i].error = 0;
+                    }
+                }
+                else if (sscanf(temp_string, "%d", (int *) queries[i].value) == 1)
+                    queries[i].error = 0;
+            }
+                break;
+
+            case LX200_RESPONSE_STRING:
+                strcpy((char *) queries[i].value, temp_string);
+                queries[i].error = 0;
+                break;
+        }
+
+        if (queries[i].error != 0)
+            DEBUGFDEVICE(lx200Name, DBG_SCOPE, "Unable to parse response to %s", queries[i].cmd);
+    }
+
+    tcflush(fd, TCIFLUSH);
+
+    for (i=0; i < n; i++)
+        if (queries[i].error != 0)
+            return -1;
+
+    return 0;
+}
+
+int getLX200EquatorialCoords(int fd, double *ra, double *dec)
+{
+    LX200Query queries[2] =
+    {
+        { "#:GR#", LX200_RESPONSE_SEXA, ra, 0, 0 },
+        { "#:GD#", LX200_RESPONSE_SEXA, dec, 0, 0 }
+    };
+
+    return getCommandBatch(fd, queries, 2);
+}
+
 int isSlewComplete(int fd)
 {
     DEBUGFDEVICE(lx200Name, DBG_SCOPE, "<%s>", __FUNCTION__);
@@ -332,7 +438,7 @@ int isSlewComplete(int fd)
    if ( (error_type = tty_write_string(fd, cmd, &nbytes_write)) != TTY_OK)
     return error_type;
 
-   error_type = tty_read_section(fd, data, '#', LX200_TIMEOUT, &nbytes_read);
+   error_type = tty_nread_section(fd, data, sizeof(data), '#', LX200_TIMEOUT, &nbytes_read);
    tcflush(fd, TCIOFLUSH);
 
     if (error_type != TTY_OK)
@@ -389,7 +495,7 @@ int getTimeFormat(int fd, int *format)
  if ( (error_type = tty_write_string(fd, ":Gc#", &nbytes_write)) != TTY_OK)
     return error_type;
 
-  if ( (error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read)) != TTY_OK)
+  if ( (error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read)) != TTY_OK)
 	return error_type;
 
   tcflush(fd, TCIFLUSH);
@@ -480,7 +586,7 @@ int getSiteLatitude(int fd, int *dd, int *mm)
   if ( (error_type = tty_write_string(fd, ":Gt#", &nbytes_write)) != TTY_OK)
     	return error_type;
 
-  error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+  error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
   tcflush(fd, TCIFLUSH);
   
    if (nbytes_read < 1) 
@@ -513,7 +619,7 @@ int getSiteLongitude(int fd, int *ddd, int *mm)
   if ( (error_type = tty_write_string(fd, ":Gg#", &nbytes_write)) != TTY_OK)
     	return error_type;
 
-  error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+  error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
   
   tcflush(fd, TCIFLUSH);
   
@@ -548,7 +654,7 @@ int getTrackFreq(int fd, double *value)
     if ( (error_type = tty_write_string(fd, ":GT#", &nbytes_write)) != TTY_OK)
     	return error_type;
 
-    error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+    error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
     tcflush(fd, TCIFLUSH);
     
     if (nbytes_read < 1)
@@ -583,7 +689,7 @@ int getHomeSearchStatus(int fd, int *status)
   if ( (error_type = tty_write_string(fd, ":h?#", &nbytes_write)) != TTY_OK)
     	return error_type;
 
-  error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+  error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
   tcflush(fd, TCIFLUSH);
   
   if (nbytes_read < 1)
@@ -619,7 +725,7 @@ int getOTATemp(int fd, double *value)
   if ( (error_type = tty_write_string(fd, ":fT#", &nbytes_write)) != TTY_OK)
     	return error_type;
 
-  error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+  error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
   
   if (nbytes_read < 1)
    return error_type;
@@ -1362,7 +1468,7 @@ int checkLX200Format(int fd)
   if ( (error_type = tty_write_string(fd, ":GR#", &nbytes_write)) != TTY_OK)
     	   return error_type;
 
-  error_type = tty_read_section(fd, temp_string, '#', LX200_TIMEOUT, &nbytes_read);
+  error_type = tty_nread_section(fd, temp_string, sizeof(temp_string), '#', LX200_TIMEOUT, &nbytes_read);
   
   if (nbytes_read < 1)
   {
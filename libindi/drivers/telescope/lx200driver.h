@@ -120,6 +120,22 @@ int LX200readOut(int timeout);
 int Connect(const char* device);
 void Disconnect();*/
 
+/* Maximum number of queries pipelined in a single getCommandBatch call */
+#define LX200_MAX_BATCH     8
+
+enum TLX200ResponseType { LX200_RESPONSE_SEXA, LX200_RESPONSE_INT, LX200_RESPONSE_STRING };
+
+/* A single query in a pipelined batch. value points to a double, int, or char[64] buffer depending on type.
+   error is 0 on success. latency is the time in ms from sending the batch until the response was received. */
+typedef struct
+{
+    const char *cmd;
+    TLX200ResponseType type;
+    void *value;
+    int error;
+    double latency;
+} LX200Query;
+
 /**************************************************************************
  Diagnostics
  **************************************************************************/
@@ -138,6 +154,12 @@ int getCommandSexa(int fd, double *value, const char *cmd);
 int getCommandString(int fd, char *data, const char* cmd);
 /* Get Int */
 int getCommandInt(int fd, int *value, const char* cmd);
+/* Pipeline several queries in a single write. Responses are read back in order and parsed by type.
+   Returns 0 if all queries succeeded, otherwise the error of the first failed query is stored in each LX200Query */
+int getCommandBatch(int fd, LX200Query *queries, int n);
+/* Get RA and DEC in one round-trip. Only the coordinates of a status poll are batched, isSlewComplete and the
+   other status queries still take a round-trip of their own */
+int getLX200EquatorialCoords(int fd, double *ra, double *dec);
 /* Get tracking frequency */
 int getTrackFreq(int fd, double * value);
 /* Get site Latitude */
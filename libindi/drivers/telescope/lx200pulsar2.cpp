@@ -536,7 +536,7 @@ void LX200Pulsar2::getBasicData()
         
         // ---- read RA, Dec ---
         
-        if ( getLX200RA(PortFD, &currentRA) < 0 || getLX200DEC(PortFD, &currentDEC) < 0)
+        if ( getLX200EquatorialCoords(PortFD, &currentRA, &currentDEC) < 0)
         {
             EqNP.s = IPS_ALERT;
             IDSetNumber(&EqNP, "Error reading RA/DEC.");
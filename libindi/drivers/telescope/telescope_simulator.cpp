@@ -41,7 +41,7 @@ std::unique_ptr<ScopeSim> telescope_sim(new ScopeSim());
 #define SLEW_LIMIT      1                               /* Move at SLEW_LIMIT until distance from target is SLEW_LIMIT degrees */
 #define FINE_SLEW_LIMIT 0.5                             /* Move at FINE_SLEW_RATE until distance from target is FINE_SLEW_LIMIT degrees */
 
-#define	POLLMS		250				/* poll period, ms */
+#define	POLLMS		250				/* poll period while slewing or guiding, ms */
 
 #define RA_AXIS         0
 #define DEC_AXIS        1
@@ -154,6 +154,10 @@ bool ScopeSim::initProperties()
     ScopeParametersN[2].value = 120;
     ScopeParametersN[3].value = 900;
 
+    // Poll faster only while slewing, tracking and parked keep the default period of 1000 ms.
+    // Set the periods down to 10 ms to simulate high rate mount traffic.
+    PollingN[POLL_FAST].value   = POLLMS;
+
     TrackState=SCOPE_IDLE;
 
     SetParkDataType(PARK_RA_DEC);
@@ -241,11 +245,20 @@ bool ScopeSim::Connect()
     rc=Connect(PortT[0].text, atoi(IUFindOnSwitch(&BaudRateSP)->name));
 
     if(rc)
-        SetTimer(POLLMS);
+        SetTimer(getPollingPeriod());
 
     return rc;
 }
 
+uint32_t ScopeSim::getPollingPeriod()
+{
+    // Guide pulses are timed in ReadScopeStatus, so poll fast until they complete
+    if (GuideNSNP.s == IPS_BUSY || GuideWENP.s == IPS_BUSY)
+        return PollingN[POLL_FAST].value;
+
+    return INDI::Telescope::getPollingPeriod();
+}
+
 bool ScopeSim::Connect(const char *port, uint32_t baud)
 {
    DEBUGF(INDI::Logger::DBG_SESSION, "Simulating connecting to port %s with speed %d", port, baud);
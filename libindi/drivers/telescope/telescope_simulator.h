@@ -52,6 +52,7 @@ public:
     virtual IPState GuideEast(float ms);
     virtual IPState GuideWest(float ms);
     virtual bool updateLocation(double latitude, double longitude, double elevation);
+    virtual uint32_t getPollingPeriod();
 
     bool Goto(double,double);
     bool Park();
@@ -933,52 +933,57 @@ void V4L2_Driver::newFrame()
 {
     if (streamer->isBusy())
     {
-        int width  = v4l_base->getWidth();
-        int height = v4l_base->getHeight();
-        int bpp = v4l_base->getBpp();
-        int dbpp=8;
+        unsigned int encodedSize = 0;
+        unsigned char *encoded = v4l_base->getEncodedFrame(&encodedSize);
+        unsigned char *buffer = NULL;
 
-        if (ImageColorS[0].s == ISS_ON)
-           V4LFrame->Y      		= v4l_base->getY();
-        else
-           V4LFrame->colorBuffer 	= v4l_base->getColorBuffer();
+        // JPEG frames are only decoded when the stream or the record needs pixels
+        if (encoded == NULL || streamer->needsDecodedFrame())
+        {
+            int width  = v4l_base->getWidth();
+            int height = v4l_base->getHeight();
+            int bpp = v4l_base->getBpp();
+            int dbpp=8;
 
-        int totalBytes  = ImageColorS[0].s == ISS_ON ? width * height * (dbpp / 8) : width * height * (dbpp / 8) * 4;
-        unsigned char *buffer = ImageColorS[0].s == ISS_ON ? V4LFrame->Y : V4LFrame->colorBuffer;
+            if (ImageColorS[0].s == ISS_ON)
+               V4LFrame->Y      		= v4l_base->getY();
+            else
+               V4LFrame->colorBuffer 	= v4l_base->getColorBuffer();
 
-        // downscale Y10 Y12 Y16
-        if (bpp > dbpp)
-        {
-          unsigned int i;
-          unsigned short *src=(unsigned short *)buffer;
-          unsigned char *dest=buffer;
-          unsigned char shift=0;
-          if (bpp < 16)
-          {
-            switch (bpp)
-            {
-            case 10: shift=2; break;
-            case 12: shift=4; break;
-            }
-            for (i = 0; i < totalBytes; i++)
-            {
-                 *dest++ = *(src++) >> shift;
-            }
-          }
-          else
-          {
-            unsigned char *src=(unsigned char *)buffer + 1; // Y16 is little endian
-            for (i = 0; i < totalBytes; i++)
+            int totalBytes  = ImageColorS[0].s == ISS_ON ? width * height * (dbpp / 8) : width * height * (dbpp / 8) * 4;
+            buffer = ImageColorS[0].s == ISS_ON ? V4LFrame->Y : V4LFrame->colorBuffer;
+
+            // downscale Y10 Y12 Y16
+            if (bpp > dbpp)
             {
-                 *dest++ = *src; src+=2;
+              unsigned int i;
+              unsigned short *src=(unsigned short *)buffer;
+              unsigned char *dest=buffer;
+              unsigned char shift=0;
+              if (bpp < 16)
+              {
+                switch (bpp)
+                {
+                case 10: shift=2; break;
+                case 12: shift=4; break;
+                }
+                for (i = 0; i < totalBytes; i++)
+                {
+                     *dest++ = *(src++) >> shift;
+                }
+              }
+              else
+              {
+                unsigned char *src=(unsigned char *)buffer + 1; // Y16 is little endian
+                for (i = 0; i < totalBytes; i++)
+                {
+                     *dest++ = *src; src+=2;
+                }
+              }
             }
-          }
         }
 
-        if (ImageColorS[0].s == ISS_ON)
-            streamer->newFrame(buffer);
-        else
-            streamer->newFrame(buffer);
+        streamer->newFrame(buffer, encoded, encodedSize, v4l_base->getFrameTime());
     }
 
   if (PrimaryCCD.isExposing())
@@ -1002,12 +1007,8 @@ void V4L2_Driver::newFrame()
      {
        if (!stackMode)
        {
-            unsigned char *src, *dest;
-            src = v4l_base->getY();
-            dest = (unsigned char *)PrimaryCCD.getFrameBuffer();
-            for (i=0; i< frameBytes; i++)
-                *(dest++) = *(src++);
-
+            // The decoder output stays valid until the next frame, the chip reads it in place
+            PrimaryCCD.attachFrameBuffer(v4l_base->getY());
             PrimaryCCD.binFrame();
        }
        else
@@ -1127,6 +1128,7 @@ void V4L2_Driver::newFrame()
       ExposureComplete(&PrimaryCCD);
       //PrimaryCCD.setFrameBufferSize(frameBytes);
     }
+    PrimaryCCD.releaseFrameBuffer();
     is_exposing=false;
   }
 }
@@ -235,6 +235,25 @@ extern void IDSetBLOB (const IBLOBVectorProperty *b, const char *msg, ...)
 #endif
 ;
 
+/** \brief Start batching messages sent to the client by the calling thread.
+
+    Until the matching IDEndBatch(), IDDef*, IDSet*, IDMessage and IDDelete calls of this thread are accumulated
+    and then sent together with a single write. Use it when several properties are updated at once, e.g. each poll.
+    Calls may be nested, messages are sent when the outermost batch ends.
+*/
+extern void IDBeginBatch (void);
+
+/** \brief End a batch started by IDBeginBatch() and send the accumulated messages. */
+extern void IDEndBatch (void);
+
+/** \brief Stamp a latency trace hop for the next IDSetBLOB of the calling thread.
+
+    Does nothing unless tracing is enabled with the INDI_TRACE environment variable, see inditrace.h. Stamping a hop
+    again before the BLOB is sent discards the stamps of the previous frame.
+    \param hop short name of the hop, e.g. "exp" when an exposure completes.
+*/
+extern void IDTraceStamp (const char *hop);
+
 /*@}*/
 
 /**
@@ -409,6 +428,14 @@ both prudent and efficient to do so.</P>
 */
 extern IText   *IUFindText  (const ITextVectorProperty *tvp, const char *name);
 
+/** \brief Hash a property or member name.
+*
+* All name lookups on the command path (driver dispatch, IUFind* functions, INDI::BaseDevice) share this hash.
+* \param name the name to hash.
+* \return FNV-1a hash of the name.
+*/
+extern unsigned int IUHashName (const char *name);
+
 /** \brief Find an INumber member in a number text property.
 *
 * \param nvp a pointer to a number vector property.
@@ -26,6 +26,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
 #include <time.h>
 #include <unistd.h>
 #include <locale.h>
@@ -39,21 +40,72 @@
 #include "indidevapi.h"
 #include "indicom.h"
 #include "indidriver.h"
+#include "inditrace.h"
 
 pthread_mutex_t stdout_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 #define MAXRBUF 2048
 
+/* Hash index over roCheck[]: open addressing table of roCheck indices + 1, 0 marks an empty slot */
+static int *roIndex;
+static unsigned int roIndexSize;
+
+static void insertPropIndex(int index)
+{
+    unsigned int slot = IUHashName(roCheck[index].propName) & (roIndexSize - 1);
+
+    while (roIndex[slot])
+        slot = (slot + 1) & (roIndexSize - 1);
+
+    roIndex[slot] = index + 1;
+}
+
+/* Find the sanity check entry of a property, NULL if not defined. Caller holds stdout_mutex. */
+static ROSC * findPropCheck(const char *property_name)
+{
+    unsigned int slot;
+    int index;
+
+    if (roIndexSize == 0)
+        return NULL;
+
+    slot = IUHashName(property_name) & (roIndexSize - 1);
+
+    while ( (index = roIndex[slot]) )
+    {
+        if (!strcmp(property_name, roCheck[index-1].propName))
+            return &roCheck[index-1];
+
+        slot = (slot + 1) & (roIndexSize - 1);
+    }
+
+    return NULL;
+}
+
 /* Return 1 is property is already cached, 0 otherwise */
 int isPropDefined(const char *property_name)
 {
-    int i=0;
+    int defined;
 
-    for (i=0; i < nroCheck; i++)
-        if (!strcmp(property_name, roCheck[i].propName))
-            return 1;
+    pthread_mutex_lock(&stdout_mutex);
+    defined = (findPropCheck(property_name) != NULL);
+    pthread_mutex_unlock(&stdout_mutex);
 
-    return 0;
+    return defined;
+}
+
+/* Return 1 if property is defined and clients may change it, 0 otherwise */
+static int isPropWritable(const char *property_name)
+{
+    ROSC *SC;
+    int writable;
+
+    pthread_mutex_lock(&stdout_mutex);
+    SC = findPropCheck(property_name);
+    writable = (SC != NULL && SC->perm != IP_RO);
+    pthread_mutex_unlock(&stdout_mutex);
+
+    return writable;
 }
 
 /* output a string expanding special characters into xml/html escape sequences */
@@ -98,31 +150,399 @@ char * escapeXML(const char *s, unsigned int MAX_BUF_SIZE)
         return buf;
 }
 
+/* Driver output is formatted by a per-thread message builder into a reusable buffer, and each complete
+ * message is written to stdout with a single write(). Between IDBeginBatch() and IDEndBatch(), messages
+ * of the calling thread are accumulated and written together. */
+
+#define IDMSG_INITIAL_SIZE  4096
+#define IDMSG_MAX_RETAINED  (1024*1024)     /* Release larger buffers after they are written */
+
+typedef struct
+{
+    char *buf;
+    size_t len;
+    size_t size;
+    int batch;
+    time_t ts_time;     /* Second of the cached timestamp */
+    char ts[32];
+    char trace[INDI_TRACE_MAXLEN];  /* Stamps waiting for the next IDSetBLOB */
+} IDMsg;
+
+static pthread_key_t idmsg_key;
+static pthread_once_t idmsg_once = PTHREAD_ONCE_INIT;
+
+static void idmsg_flush(IDMsg *m);
+
+static void idmsg_destroy(void *p)
+{
+    IDMsg *m = (IDMsg *) p;
+
+    idmsg_flush(m);
+    free(m->buf);
+    free(m);
+}
+
+static void idmsg_create_key(void)
+{
+    pthread_key_create(&idmsg_key, idmsg_destroy);
+}
+
+static IDMsg * idmsg_get(void)
+{
+    IDMsg *m;
+
+    pthread_once(&idmsg_once, idmsg_create_key);
+
+    m = (IDMsg *) pthread_getspecific(idmsg_key);
+    if (m == NULL)
+    {
+        m = (IDMsg *) calloc(1, sizeof(IDMsg));
+        pthread_setspecific(idmsg_key, m);
+    }
+
+    return m;
+}
+
+static void idmsg_reserve(IDMsg *m, size_t n)
+{
+    size_t size = m->size ? m->size : IDMSG_INITIAL_SIZE;
+
+    if (m->len + n <= m->size)
+        return;
+
+    while (size < m->len + n)
+        size *= 2;
+
+    m->buf  = (char *) realloc(m->buf, size);
+    m->size = size;
+}
+
+static void idmsg_write(IDMsg *m, const char *s, size_t n)
+{
+    idmsg_reserve(m, n);
+    memcpy(m->buf + m->len, s, n);
+    m->len += n;
+}
+
+static void idmsg_puts(IDMsg *m, const char *s)
+{
+    idmsg_write(m, s, strlen(s));
+}
+
+/* append s expanding special characters into xml escape sequences */
+static void idmsg_putxml(IDMsg *m, const char *s)
+{
+    size_t n;
+
+    for (;;)
+    {
+        n = strcspn(s, "&<>'\"");
+        idmsg_write(m, s, n);
+        s += n;
+
+        switch (*s)
+        {
+            case '\0':
+                return;
+            case '&':
+                idmsg_write(m, "&amp;", 5);
+                break;
+            case '<':
+                idmsg_write(m, "&lt;", 4);
+                break;
+            case '>':
+                idmsg_write(m, "&gt;", 4);
+                break;
+            case '\'':
+                idmsg_write(m, "&apos;", 6);
+                break;
+            case '"':
+                idmsg_write(m, "&quot;", 6);
+                break;
+        }
+
+        s++;
+    }
+}
+
+/* replace the decimal point of the current locale by '.' */
+static void idmsg_fix_point(char *s)
+{
+    char point = localeconv()->decimal_point[0];
+    char *p;
+
+    if (point != '.' && (p = strchr(s, point)) != NULL)
+        *p = '.';
+}
+
+/* append value as the shorter of %.15g or %.17g that reads back to the same double */
+static void idmsg_number(IDMsg *m, double value)
+{
+    char out[32];
+    char *p = out + sizeof(out);
+    unsigned long long i;
+
+    double scale = 1, scaled = value;
+    int decimals = 0;
+
+    /* Values with few decimals, by far the most common, are formatted directly as integer digits.
+     * If value * 10^k is an integer r and r / 10^k == value, then r * 10^-k reads back to value.
+     * Up to 15 significant digits, the first such k gives the shortest representation. */
+    if (fabs(value) < 1e15)
+    {
+        while (decimals < 9 && (scaled != (double) (long long) scaled || scaled / scale != value))
+        {
+            decimals++;
+            scale *= 10;
+            scaled = value * scale;
+            if (fabs(scaled) >= 1e15)
+                break;
+        }
+
+        if (fabs(scaled) < 1e15 && scaled == (double) (long long) scaled && scaled / scale == value)
+        {
+            i = (unsigned long long) fabs(scaled);
+
+            /* value * 10^k may only be exact at a larger k than needed, drop the trailing zeros */
+            while (decimals > 0 && i % 10 == 0)
+            {
+                i /= 10;
+                decimals--;
+            }
+
+            do
+            {
+                *--p = '0' + (i % 10);
+                i /= 10;
+                if (--decimals == 0)
+                    *--p = '.';
+            } while (i || decimals >= 0);
+
+            if (value < 0)
+                *--p = '-';
+
+            idmsg_write(m, p, out + sizeof(out) - p);
+            return;
+        }
+    }
+
+    snprintf(out, sizeof(out), "%.15g", value);
+    if (strtod(out, NULL) != value)
+        snprintf(out, sizeof(out), "%.17g", value);
+
+    idmsg_fix_point(out);
+    idmsg_puts(m, out);
+}
+
+/* append value formatted as %g */
+static void idmsg_g(IDMsg *m, double value)
+{
+    char out[32];
+
+    snprintf(out, sizeof(out), "%g", value);
+    idmsg_fix_point(out);
+    idmsg_puts(m, out);
+}
+
+/* append an attribute on its own line: attr='value' */
+static void idmsg_attr(IDMsg *m, const char *attr, const char *value)
+{
+    idmsg_puts(m, attr);
+    idmsg_puts(m, "='");
+    idmsg_putxml(m, value);
+    idmsg_puts(m, "'\n");
+}
+
+static void idmsg_attr_g(IDMsg *m, const char *attr, double value)
+{
+    idmsg_puts(m, attr);
+    idmsg_puts(m, "='");
+    idmsg_g(m, value);
+    idmsg_puts(m, "'\n");
+}
+
+/* append the timestamp attribute. Formatting is only redone when the second changes. */
+static void idmsg_timestamp(IDMsg *m)
+{
+    time_t t = time(NULL);
+    struct tm tp;
+
+    if (t != m->ts_time)
+    {
+        gmtime_r(&t, &tp);
+        strftime(m->ts, sizeof(m->ts), "%Y-%m-%dT%H:%M:%S", &tp);
+        m->ts_time = t;
+    }
+
+    idmsg_puts(m, "  timestamp='");
+    idmsg_puts(m, m->ts);
+    idmsg_puts(m, "'\n");
+}
+
+/* append a printf style driver message, escaped */
+static void idmsg_vputxml(IDMsg *m, const char *fmt, va_list ap)
+{
+    char stackbuf[MAXRBUF];
+    char *text = stackbuf;
+    char *orig = NULL;
+    va_list aq;
+    int n;
+
+    /* Messages are formatted in the C locale, only switch if another one is active */
+    if (localeconv()->decimal_point[0] != '.')
+        orig = setlocale(LC_NUMERIC, "C");
+
+    va_copy(aq, ap);
+    n = vsnprintf(stackbuf, sizeof(stackbuf), fmt, aq);
+    va_end(aq);
+
+    if (n >= (int) sizeof(stackbuf))
+    {
+        text = (char *) malloc(n+1);
+        vsnprintf(text, n+1, fmt, ap);
+    }
+
+    if (orig)
+        setlocale(LC_NUMERIC, orig);
+
+    if (n > 0)
+        idmsg_putxml(m, text);
+
+    if (text != stackbuf)
+        free(text);
+}
+
+static void idmsg_message(IDMsg *m, const char *fmt, va_list ap)
+{
+    idmsg_puts(m, "  message='");
+    idmsg_vputxml(m, fmt, ap);
+    idmsg_puts(m, "'\n");
+}
+
+/* start a new message with the xml boilerplate */
+static IDMsg * idmsg_begin(void)
+{
+    IDMsg *m = idmsg_get();
+
+    idmsg_puts(m, "<?xml version='1.0'?>\n");
+
+    return m;
+}
+
+/* write everything accumulated so far with a single write() */
+static void idmsg_flush(IDMsg *m)
+{
+    size_t written = 0;
+    ssize_t w;
+
+    if (m->len == 0)
+        return;
+
+    pthread_mutex_lock(&stdout_mutex);
+
+    /* Output still buffered by stdio goes first */
+    fflush(stdout);
+
+    while (written < m->len)
+    {
+        w = write(STDOUT_FILENO, m->buf + written, m->len - written);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        written += w;
+    }
+
+    pthread_mutex_unlock(&stdout_mutex);
+
+    m->len = 0;
+
+    if (m->size > IDMSG_MAX_RETAINED)
+    {
+        free(m->buf);
+        m->buf  = NULL;
+        m->size = 0;
+    }
+}
+
+/* finish a message, and write it unless a batch is open */
+static void idmsg_end(IDMsg *m)
+{
+    if (m->batch == 0)
+        idmsg_flush(m);
+}
+
+void IDBeginBatch(void)
+{
+    idmsg_get()->batch++;
+}
+
+void IDEndBatch(void)
+{
+    IDMsg *m = idmsg_get();
+
+    if (m->batch > 0 && --m->batch == 0)
+        idmsg_flush(m);
+}
+
+/* Add property to the read-only sanity check list if not already there */
+static void addPropCheck(const char *name, IPerm p)
+{
+    ROSC *SC;
+
+    pthread_mutex_lock(&stdout_mutex);
+
+    if (findPropCheck(name) == NULL)
+    {
+        roCheck = roCheck ? (ROSC *) realloc ( roCheck, sizeof(ROSC) * (nroCheck+1))
+                          : (ROSC *) malloc  ( sizeof(ROSC));
+        SC      = &roCheck[nroCheck++];
+
+        strcpy(SC->propName, name);
+        SC->perm = p;
+
+        /* Keep the index at most half full */
+        if (2 * (unsigned int) nroCheck > roIndexSize)
+        {
+            int i;
+
+            roIndexSize = roIndexSize ? roIndexSize * 2 : 64;
+            free(roIndex);
+            roIndex = (int *) calloc(roIndexSize, sizeof(int));
+            for (i = 0; i < nroCheck; i++)
+                insertPropIndex(i);
+        }
+        else
+            insertPropIndex(nroCheck-1);
+    }
+
+    pthread_mutex_unlock(&stdout_mutex);
+}
+
 /* tell Client to delete the property with given name on given device, or
  * entire device if !name
  */
 void
 IDDelete (const char *dev, const char *name, const char *fmt, ...)
 {
-    pthread_mutex_lock(&stdout_mutex);
+    IDMsg *m = idmsg_begin();
 
-	xmlv1();
-	printf ("<delProperty\n  device='%s'\n", dev);
+	idmsg_puts (m, "<delProperty\n");
+	idmsg_attr (m, "  device", dev);
 	if (name)
-	    printf (" name='%s'\n", name);
-	printf ("  timestamp='%s'\n", timestamp());
+	    idmsg_attr (m, " name", name);
+	idmsg_timestamp (m);
 	if (fmt) {
 	    va_list ap;
 	    va_start (ap, fmt);
-	    printf ("  message='");
-	    vprintf (fmt, ap);
-	    printf ("'\n");
+	    idmsg_message (m, fmt, ap);
 	    va_end (ap);
 	}
-	printf ("/>\n");
-	fflush (stdout);
+	idmsg_puts (m, "/>\n");
 
-    pthread_mutex_unlock(&stdout_mutex);
+    idmsg_end(m);
 }
 
 /* tell indiserver we want to snoop on the given device/property.
@@ -131,15 +551,17 @@ IDDelete (const char *dev, const char *name, const char *fmt, ...)
 void
 IDSnoopDevice (const char *snooped_device_name, const char *snooped_property_name)
 {
-    pthread_mutex_lock(&stdout_mutex);
-	xmlv1();
-	if (snooped_property_name && snooped_property_name[0])
-	    printf ("<getProperties device='%s' name='%s'/>\n",
-				    snooped_device_name, snooped_property_name);
-	else
-	    printf ("<getProperties device='%s'/>\n", snooped_device_name);
-	fflush (stdout);
-    pthread_mutex_unlock(&stdout_mutex);
+    IDMsg *m = idmsg_begin();
+
+	idmsg_puts (m, "<getProperties device='");
+	idmsg_putxml (m, snooped_device_name);
+	if (snooped_property_name && snooped_property_name[0]) {
+	    idmsg_puts (m, "' name='");
+	    idmsg_putxml (m, snooped_property_name);
+	}
+	idmsg_puts (m, "'/>\n");
+
+    idmsg_end(m);
 }
 
 /* tell indiserver whether we want BLOBs from the given snooped device.
@@ -149,6 +571,7 @@ void
 IDSnoopBLOBs (const char *snooped_device, BLOBHandling bh)
 {
 	const char *how;
+	IDMsg *m;
 
 	switch (bh) {
 	case B_NEVER: how = "Never"; break;
@@ -157,12 +580,13 @@ IDSnoopBLOBs (const char *snooped_device, BLOBHandling bh)
 	default: return;
 	}
 
-    pthread_mutex_lock(&stdout_mutex);
-	xmlv1();
-	printf ("<enableBLOB device='%s'>%s</enableBLOB>\n",
-						snooped_device, how);
-	fflush (stdout);
-    pthread_mutex_unlock(&stdout_mutex);
+    m = idmsg_begin();
+	idmsg_puts (m, "<enableBLOB device='");
+	idmsg_putxml (m, snooped_device);
+	idmsg_puts (m, "'>");
+	idmsg_puts (m, how);
+	idmsg_puts (m, "</enableBLOB>\n");
+    idmsg_end(m);
 }
 
 /* "INDI" wrappers to the more generic eventloop facility. */
@@ -642,24 +1066,18 @@ IUSnoopNumber (XMLEle *root, INumberVectorProperty *nvp)
 	(void) crackIPState (findXMLAttValu (root,"state"), &nvp->s);
 
 	/* match each INumber with a oneNumber */
-    char *orig = setlocale(LC_NUMERIC,"C");
 	for (i = 0; i < nvp->nnp; i++) {
 	    for (ep = nextXMLEle(root,1); ep; ep = nextXMLEle(root,0)) {
 	      if (!strcmp (tagXMLEle(ep)+3, "Number") &&
 		  !strcmp (nvp->np[i].name, findXMLAttValu(ep, "name"))) {
-		if (f_scansexa (pcdataXMLEle(ep), &nvp->np[i].value) < 0) {
-          setlocale(LC_NUMERIC,orig);
+		if (f_scansexa (pcdataXMLEle(ep), &nvp->np[i].value) < 0)
 		  return (-1);	/* bad number format */
-		}
 		break;
 	      }
 	    }
-	    if (!ep) {
-          setlocale(LC_NUMERIC,orig);
+	    if (!ep)
 	      return (-1);	/* element not found */
-	    }
 	}
-    setlocale(LC_NUMERIC,orig);
 
 	/* ok */
 	return (0);
@@ -810,7 +1228,7 @@ IUSnoopBLOB (XMLEle *root, IBLOBVectorProperty *bvp)
 		    IBLOB *bp = &bvp->bp[i];
 		    if (!strcmp (bp->name, name)) {
 			strcpy (bp->format, findXMLAttValu (ep,"format"));
-			bp->size = atof (findXMLAttValu (ep,"size"));
+			bp->size = f_strtod (findXMLAttValu (ep,"size"), NULL);
 			bp->bloblen = pcdatalenXMLEle(ep)+1;
 			if (bp->blob)
 			    free (bp->blob);
@@ -873,7 +1291,7 @@ dispatch (XMLEle *root, char msg[])
 
         char *rtag = tagXMLEle(root);
         XMLEle *ep;
-        int n,i=0;
+        int n;
 
         if (verbose)
             prXMLEle (stderr, root, 0);
@@ -890,21 +1308,10 @@ dispatch (XMLEle *root, char msg[])
             if (crackDN (root, &dev, &name, msg) < 0)
                 return (-1);
 
-            if (!isPropDefined(name))
+            /* ensure property is defined and not RO */
+            if (!isPropWritable(name))
                 return -1;
 
-            /* ensure property is not RO */
-            for (i=0; i < nroCheck; i++)
-            {
-              if (!strcmp(roCheck[i].propName, name))
-              {
-               if (roCheck[i].perm == IP_RO)
-                 return -1;
-               else
-                   break;
-              }
-            }
-
             /* seed for reallocs */
             if (!doubles) {
                 doubles = (double *) malloc (1);
@@ -912,7 +1319,6 @@ dispatch (XMLEle *root, char msg[])
             }
 
             /* pull out each name/value pair */
-            char *orig = setlocale(LC_NUMERIC,"C");
             for (n = 0, ep = nextXMLEle(root,1); ep; ep = nextXMLEle(root,0)) {
                 if (strcmp (tagXMLEle(ep), "oneNumber") == 0) {
                     XMLAtt *na = findXMLAtt (ep, "name");
@@ -932,7 +1338,6 @@ dispatch (XMLEle *root, char msg[])
                     }
                 }
             }
-            setlocale(LC_NUMERIC,orig);
 
             /* invoke driver if something to do, but not an error if not */
             if (n > 0)
@@ -953,21 +1358,10 @@ dispatch (XMLEle *root, char msg[])
             if (crackDN (root, &dev, &name, msg) < 0)
                 return (-1);
 
-            if (!isPropDefined(name))
+            /* ensure property is defined and not RO */
+            if (!isPropWritable(name))
                 return -1;
 
-            /* ensure property is not RO */
-            for (i=0; i < nroCheck; i++)
-            {
-              if (!strcmp(roCheck[i].propName, name))
-              {
-               if (roCheck[i].perm == IP_RO)
-                 return -1;
-               else
-                   break;
-              }
-            }
-
             /* seed for reallocs */
             if (!states) {
                 states = (ISState *) malloc (1);
@@ -1018,21 +1412,10 @@ dispatch (XMLEle *root, char msg[])
             if (crackDN (root, &dev, &name, msg) < 0)
                 return (-1);
 
-            if (!isPropDefined(name))
+            /* ensure property is defined and not RO */
+            if (!isPropWritable(name))
                 return -1;
 
-            /* ensure property is not RO */
-            for (i=0; i < nroCheck; i++)
-            {
-              if (!strcmp(roCheck[i].propName, name))
-              {
-               if (roCheck[i].perm == IP_RO)
-                 return -1;
-               else
-                   break;
-              }
-            }
-
             /* seed for reallocs */
             if (!texts) {
                 texts = (char **) malloc (1);
@@ -1137,7 +1520,7 @@ dispatch (XMLEle *root, char msg[])
                 fprintf (stderr, "%s: getProperties missing version\n", me);
                 exit(1);
             }
-            v = atof (valuXMLAtt(ap));
+            v = f_strtod (valuXMLAtt(ap), NULL);
             if (v > INDIV) {
                 fprintf (stderr, "%s: client version %g > %g\n", me, v, INDIV);
                 exit(1);
@@ -1295,26 +1678,21 @@ void IUSaveDefaultConfig(const char *source_config, const char *dest_config, con
 void
 IDMessage (const char *dev, const char *fmt, ...)
 {
+        IDMsg *m = idmsg_begin();
 
-    pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        printf ("<message\n");
+        idmsg_puts (m, "<message\n");
         if (dev)
-            printf (" device='%s'\n", dev);
-        printf ("  timestamp='%s'\n", timestamp());
+            idmsg_attr (m, " device", dev);
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf ("/>\n");
-        fflush (stdout);
+        idmsg_puts (m, "/>\n");
 
-     pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 FILE * IUGetConfigFP(const char *filename, const char *dev, char errmsg[])
@@ -1473,57 +1851,41 @@ void
 IDDefText (const ITextVectorProperty *tvp, const char *fmt, ...)
 {
         int i;
-        ROSC *SC;
-
-        pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        char *orig = setlocale(LC_NUMERIC,"C");
-        printf ("<defTextVector\n");
-        printf ("  device='%s'\n", tvp->device);
-        printf ("  name='%s'\n", tvp->name);
-        printf ("  label='%s'\n", tvp->label);
-        printf ("  group='%s'\n", tvp->group);
-        printf ("  state='%s'\n", pstateStr(tvp->s));
-        printf ("  perm='%s'\n", permStr(tvp->p));
-        printf ("  timeout='%g'\n", tvp->timeout);
-        printf ("  timestamp='%s'\n", timestamp());
+        IDMsg *m = idmsg_begin();
+
+        idmsg_puts (m, "<defTextVector\n");
+        idmsg_attr (m, "  device", tvp->device);
+        idmsg_attr (m, "  name", tvp->name);
+        idmsg_attr (m, "  label", tvp->label);
+        idmsg_attr (m, "  group", tvp->group);
+        idmsg_attr (m, "  state", pstateStr(tvp->s));
+        idmsg_attr (m, "  perm", permStr(tvp->p));
+        idmsg_attr_g (m, "  timeout", tvp->timeout);
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
         for (i = 0; i < tvp->ntp; i++) {
             IText *tp = &tvp->tp[i];
-            printf ("  <defText\n");
-            printf ("    name='%s'\n", tp->name);
-            printf ("    label='%s'>\n", tp->label);
-            printf ("      %s\n", tp->text ? tp->text : "");
-            printf ("  </defText>\n");
+            idmsg_puts (m, "  <defText\n");
+            idmsg_attr (m, "    name", tp->name);
+            idmsg_puts (m, "    label='");
+            idmsg_putxml (m, tp->label);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_putxml (m, tp->text ? tp->text : "");
+            idmsg_puts (m, "\n  </defText>\n");
         }
 
-        printf ("</defTextVector>\n");
-
-        if (!isPropDefined(tvp->name))
-        {
-                /* Add this property to insure proper sanity check */
-                roCheck = roCheck ? (ROSC *) realloc ( roCheck, sizeof(ROSC) * (nroCheck+1))
-                                : (ROSC *) malloc  ( sizeof(ROSC));
-                SC      = &roCheck[nroCheck++];
-
-                strcpy(SC->propName, tvp->name);
-                SC->perm = tvp->p;
-        }
+        idmsg_puts (m, "</defTextVector>\n");
 
-        setlocale(LC_NUMERIC,orig);
-        fflush (stdout);
+        addPropCheck(tvp->name, tvp->p);
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to create a new numeric vector property */
@@ -1531,68 +1893,53 @@ void
 IDDefNumber (const INumberVectorProperty *n, const char *fmt, ...)
 {
         int i;
-        ROSC *SC;
-
-        pthread_mutex_lock(&stdout_mutex);
+        IDMsg *m = idmsg_begin();
 
-        xmlv1();
-        char *orig = setlocale(LC_NUMERIC,"C");
-        printf ("<defNumberVector\n");
-        printf ("  device='%s'\n", n->device);
-        printf ("  name='%s'\n", n->name);
-        printf ("  label='%s'\n", n->label);
-        printf ("  group='%s'\n", n->group);
-        printf ("  state='%s'\n", pstateStr(n->s));
-        printf ("  perm='%s'\n", permStr(n->p));
-        printf ("  timeout='%g'\n", n->timeout);
-        printf ("  timestamp='%s'\n", timestamp());
+        idmsg_puts (m, "<defNumberVector\n");
+        idmsg_attr (m, "  device", n->device);
+        idmsg_attr (m, "  name", n->name);
+        idmsg_attr (m, "  label", n->label);
+        idmsg_attr (m, "  group", n->group);
+        idmsg_attr (m, "  state", pstateStr(n->s));
+        idmsg_attr (m, "  perm", permStr(n->p));
+        idmsg_attr_g (m, "  timeout", n->timeout);
+        idmsg_timestamp (m);
 
 
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
 
         for (i = 0; i < n->nnp; i++) {
 
             INumber *np = &n->np[i];
 
-            printf ("  <defNumber\n");
-            printf ("    name='%s'\n", np->name);
-            printf ("    label='%s'\n", np->label);
-            printf ("    format='%s'\n", np->format);
-            printf ("    min='%.20g'\n", np->min);
-            printf ("    max='%.20g'\n", np->max);
-            printf ("    step='%.20g'>\n", np->step);
-            printf ("      %.20g\n", np->value);
-
-            printf ("  </defNumber>\n");
+            idmsg_puts (m, "  <defNumber\n");
+            idmsg_attr (m, "    name", np->name);
+            idmsg_attr (m, "    label", np->label);
+            idmsg_attr (m, "    format", np->format);
+            idmsg_puts (m, "    min='");
+            idmsg_number (m, np->min);
+            idmsg_puts (m, "'\n    max='");
+            idmsg_number (m, np->max);
+            idmsg_puts (m, "'\n    step='");
+            idmsg_number (m, np->step);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_number (m, np->value);
+
+            idmsg_puts (m, "\n  </defNumber>\n");
         }
 
-        printf ("</defNumberVector>\n");
-
-        if (!isPropDefined(n->name))
-        {
-                /* Add this property to insure proper sanity check */
-                roCheck = roCheck ? (ROSC *) realloc ( roCheck, sizeof(ROSC) * (nroCheck+1))
-                                : (ROSC *) malloc  ( sizeof(ROSC));
-                SC      = &roCheck[nroCheck++];
-
-                strcpy(SC->propName, n->name);
-                SC->perm = n->p;
-
-        }
+        idmsg_puts (m, "</defNumberVector>\n");
 
-        setlocale(LC_NUMERIC,orig);
-        fflush (stdout);
+        addPropCheck(n->name, n->p);
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to create a new switch vector property */
@@ -1601,58 +1948,42 @@ IDDefSwitch (const ISwitchVectorProperty *s, const char *fmt, ...)
 
 {
         int i;
-        ROSC *SC;
-
-        pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        char *orig = setlocale(LC_NUMERIC,"C");
-        printf ("<defSwitchVector\n");
-        printf ("  device='%s'\n", s->device);
-        printf ("  name='%s'\n", s->name);
-        printf ("  label='%s'\n", s->label);
-        printf ("  group='%s'\n", s->group);
-        printf ("  state='%s'\n", pstateStr(s->s));
-        printf ("  perm='%s'\n", permStr(s->p));
-        printf ("  rule='%s'\n", ruleStr (s->r));
-        printf ("  timeout='%g'\n", s->timeout);
-        printf ("  timestamp='%s'\n", timestamp());
+        IDMsg *m = idmsg_begin();
+
+        idmsg_puts (m, "<defSwitchVector\n");
+        idmsg_attr (m, "  device", s->device);
+        idmsg_attr (m, "  name", s->name);
+        idmsg_attr (m, "  label", s->label);
+        idmsg_attr (m, "  group", s->group);
+        idmsg_attr (m, "  state", pstateStr(s->s));
+        idmsg_attr (m, "  perm", permStr(s->p));
+        idmsg_attr (m, "  rule", ruleStr (s->r));
+        idmsg_attr_g (m, "  timeout", s->timeout);
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
         for (i = 0; i < s->nsp; i++) {
             ISwitch *sp = &s->sp[i];
-            printf ("  <defSwitch\n");
-            printf ("    name='%s'\n", sp->name);
-            printf ("    label='%s'>\n", sp->label);
-            printf ("      %s\n", sstateStr(sp->s));
-            printf ("  </defSwitch>\n");
+            idmsg_puts (m, "  <defSwitch\n");
+            idmsg_attr (m, "    name", sp->name);
+            idmsg_puts (m, "    label='");
+            idmsg_putxml (m, sp->label);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_puts (m, sstateStr(sp->s));
+            idmsg_puts (m, "\n  </defSwitch>\n");
         }
 
-        printf ("</defSwitchVector>\n");
-
-        if (!isPropDefined(s->name))
-        {
-                /* Add this property to insure proper sanity check */
-                roCheck = roCheck ? (ROSC *) realloc ( roCheck, sizeof(ROSC) * (nroCheck+1))
-                                : (ROSC *) malloc  ( sizeof(ROSC));
-                SC      = &roCheck[nroCheck++];
-
-                strcpy(SC->propName, s->name);
-                SC->perm = s->p;
-        }
+        idmsg_puts (m, "</defSwitchVector>\n");
 
-        setlocale(LC_NUMERIC,orig);
-        fflush (stdout);
+        addPropCheck(s->name, s->p);
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to create a new lights vector property */
@@ -1660,40 +1991,37 @@ void
 IDDefLight (const ILightVectorProperty *lvp, const char *fmt, ...)
 {
         int i;
-
-        pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        printf ("<defLightVector\n");
-        printf ("  device='%s'\n", lvp->device);
-        printf ("  name='%s'\n", lvp->name);
-        printf ("  label='%s'\n", lvp->label);
-        printf ("  group='%s'\n", lvp->group);
-        printf ("  state='%s'\n", pstateStr(lvp->s));
-        printf ("  timestamp='%s'\n", timestamp());
+        IDMsg *m = idmsg_begin();
+
+        idmsg_puts (m, "<defLightVector\n");
+        idmsg_attr (m, "  device", lvp->device);
+        idmsg_attr (m, "  name", lvp->name);
+        idmsg_attr (m, "  label", lvp->label);
+        idmsg_attr (m, "  group", lvp->group);
+        idmsg_attr (m, "  state", pstateStr(lvp->s));
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
         for (i = 0; i < lvp->nlp; i++) {
             ILight *lp = &lvp->lp[i];
-            printf ("  <defLight\n");
-            printf ("    name='%s'\n", lp->name);
-            printf ("    label='%s'>\n", lp->label);
-            printf ("      %s\n", pstateStr(lp->s));
-            printf ("  </defLight>\n");
+            idmsg_puts (m, "  <defLight\n");
+            idmsg_attr (m, "    name", lp->name);
+            idmsg_puts (m, "    label='");
+            idmsg_putxml (m, lp->label);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_puts (m, pstateStr(lp->s));
+            idmsg_puts (m, "\n  </defLight>\n");
         }
 
-        printf ("</defLightVector>\n");
-        fflush (stdout);
+        idmsg_puts (m, "</defLightVector>\n");
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to create a new BLOB vector property */
@@ -1701,56 +2029,38 @@ void
 IDDefBLOB (const IBLOBVectorProperty *b, const char *fmt, ...)
 {
   int i;
-  ROSC *SC;
-
-  pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        char *orig = setlocale(LC_NUMERIC,"C");
-        printf ("<defBLOBVector\n");
-        printf ("  device='%s'\n", b->device);
-        printf ("  name='%s'\n", b->name);
-        printf ("  label='%s'\n", b->label);
-        printf ("  group='%s'\n", b->group);
-        printf ("  state='%s'\n", pstateStr(b->s));
-        printf ("  perm='%s'\n", permStr(b->p));
-        printf ("  timeout='%g'\n", b->timeout);
-        printf ("  timestamp='%s'\n", timestamp());
+  IDMsg *m = idmsg_begin();
+
+        idmsg_puts (m, "<defBLOBVector\n");
+        idmsg_attr (m, "  device", b->device);
+        idmsg_attr (m, "  name", b->name);
+        idmsg_attr (m, "  label", b->label);
+        idmsg_attr (m, "  group", b->group);
+        idmsg_attr (m, "  state", pstateStr(b->s));
+        idmsg_attr (m, "  perm", permStr(b->p));
+        idmsg_attr_g (m, "  timeout", b->timeout);
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
   for (i = 0; i < b->nbp; i++) {
     IBLOB *bp = &b->bp[i];
-    printf ("  <defBLOB\n");
-    printf ("    name='%s'\n", bp->name);
-    printf ("    label='%s'\n", bp->label);
-    printf ("  />\n");
+    idmsg_puts (m, "  <defBLOB\n");
+    idmsg_attr (m, "    name", bp->name);
+    idmsg_attr (m, "    label", bp->label);
+    idmsg_puts (m, "  />\n");
   }
 
-        printf ("</defBLOBVector>\n");
-
-        if (!isPropDefined(b->name))
-        {
-                /* Add this property to insure proper sanity check */
-                roCheck = roCheck ? (ROSC *) realloc ( roCheck, sizeof(ROSC) * (nroCheck+1))
-                                : (ROSC *) malloc  ( sizeof(ROSC));
-                SC      = &roCheck[nroCheck++];
-
-                strcpy(SC->propName, b->name);
-                SC->perm = b->p;
-        }
+        idmsg_puts (m, "</defBLOBVector>\n");
 
-        setlocale(LC_NUMERIC,orig);
-        fflush (stdout);
+        addPropCheck(b->name, b->p);
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to update an existing text vector property */
@@ -1758,39 +2068,34 @@ void
 IDSetText (const ITextVectorProperty *tvp, const char *fmt, ...)
 {
         int i;
-
-        pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        char *orig = setlocale(LC_NUMERIC,"C");
-        printf ("<setTextVector\n");
-        printf ("  device='%s'\n", tvp->device);
-        printf ("  name='%s'\n", tvp->name);
-        printf ("  state='%s'\n", pstateStr(tvp->s));
-        printf ("  timeout='%g'\n", tvp->timeout);
-        printf ("  timestamp='%s'\n", timestamp());
+        IDMsg *m = idmsg_begin();
+
+        idmsg_puts (m, "<setTextVector\n");
+        idmsg_attr (m, "  device", tvp->device);
+        idmsg_attr (m, "  name", tvp->name);
+        idmsg_attr (m, "  state", pstateStr(tvp->s));
+        idmsg_attr_g (m, "  timeout", tvp->timeout);
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
         for (i = 0; i < tvp->ntp; i++) {
             IText *tp = &tvp->tp[i];
-            printf ("  <oneText name='%s'>\n", tp->name);
-            printf ("      %s\n", tp->text ? tp->text : "");
-            printf ("  </oneText>\n");
+            idmsg_puts (m, "  <oneText name='");
+            idmsg_putxml (m, tp->name);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_putxml (m, tp->text ? tp->text : "");
+            idmsg_puts (m, "\n  </oneText>\n");
         }
 
-        printf ("</setTextVector>\n");
-        setlocale(LC_NUMERIC,orig);
-        fflush (stdout);
+        idmsg_puts (m, "</setTextVector>\n");
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to update an existing numeric vector property */
@@ -1798,39 +2103,34 @@ void
 IDSetNumber (const INumberVectorProperty *nvp, const char *fmt, ...)
 {
         int i;
-
-        pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        char *orig = setlocale(LC_NUMERIC,"C");
-        printf ("<setNumberVector\n");
-        printf ("  device='%s'\n", nvp->device);
-        printf ("  name='%s'\n", nvp->name);
-        printf ("  state='%s'\n", pstateStr(nvp->s));
-        printf ("  timeout='%g'\n", nvp->timeout);
-        printf ("  timestamp='%s'\n", timestamp());
+        IDMsg *m = idmsg_begin();
+
+        idmsg_puts (m, "<setNumberVector\n");
+        idmsg_attr (m, "  device", nvp->device);
+        idmsg_attr (m, "  name", nvp->name);
+        idmsg_attr (m, "  state", pstateStr(nvp->s));
+        idmsg_attr_g (m, "  timeout", nvp->timeout);
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
         for (i = 0; i < nvp->nnp; i++) {
             INumber *np = &nvp->np[i];
-            printf ("  <oneNumber name='%s'>\n", np->name);
-            printf ("      %.20g\n", np->value);
-            printf ("  </oneNumber>\n");
+            idmsg_puts (m, "  <oneNumber name='");
+            idmsg_putxml (m, np->name);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_number (m, np->value);
+            idmsg_puts (m, "\n  </oneNumber>\n");
         }
 
-        printf ("</setNumberVector>\n");
-        setlocale(LC_NUMERIC,orig);
-        fflush (stdout);
+        idmsg_puts (m, "</setNumberVector>\n");
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to update an existing switch vector property */
@@ -1838,39 +2138,34 @@ void
 IDSetSwitch (const ISwitchVectorProperty *svp, const char *fmt, ...)
 {
         int i;
-
-        pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        char *orig = setlocale(LC_NUMERIC,"C");
-        printf ("<setSwitchVector\n");
-        printf ("  device='%s'\n", svp->device);
-        printf ("  name='%s'\n", svp->name);
-        printf ("  state='%s'\n", pstateStr(svp->s));
-        printf ("  timeout='%g'\n", svp->timeout);
-        printf ("  timestamp='%s'\n", timestamp());
+        IDMsg *m = idmsg_begin();
+
+        idmsg_puts (m, "<setSwitchVector\n");
+        idmsg_attr (m, "  device", svp->device);
+        idmsg_attr (m, "  name", svp->name);
+        idmsg_attr (m, "  state", pstateStr(svp->s));
+        idmsg_attr_g (m, "  timeout", svp->timeout);
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
         for (i = 0; i < svp->nsp; i++) {
             ISwitch *sp = &svp->sp[i];
-            printf ("  <oneSwitch name='%s'>\n", sp->name);
-            printf ("      %s\n", sstateStr(sp->s));
-            printf ("  </oneSwitch>\n");
+            idmsg_puts (m, "  <oneSwitch name='");
+            idmsg_putxml (m, sp->name);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_puts (m, sstateStr(sp->s));
+            idmsg_puts (m, "\n  </oneSwitch>\n");
         }
 
-        printf ("</setSwitchVector>\n");
-        setlocale(LC_NUMERIC,orig);
-       fflush (stdout);
+        idmsg_puts (m, "</setSwitchVector>\n");
 
-       pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to update an existing lights vector property */
@@ -1878,36 +2173,33 @@ void
 IDSetLight (const ILightVectorProperty *lvp, const char *fmt, ...)
 {
         int i;
+        IDMsg *m = idmsg_begin();
 
-        pthread_mutex_lock(&stdout_mutex);
-
-        xmlv1();
-        printf ("<setLightVector\n");
-        printf ("  device='%s'\n", lvp->device);
-        printf ("  name='%s'\n", lvp->name);
-        printf ("  state='%s'\n", pstateStr(lvp->s));
-        printf ("  timestamp='%s'\n", timestamp());
+        idmsg_puts (m, "<setLightVector\n");
+        idmsg_attr (m, "  device", lvp->device);
+        idmsg_attr (m, "  name", lvp->name);
+        idmsg_attr (m, "  state", pstateStr(lvp->s));
+        idmsg_timestamp (m);
         if (fmt) {
             va_list ap;
             va_start (ap, fmt);
-            printf ("  message='");
-            vprintf (fmt, ap);
-            printf ("'\n");
+            idmsg_message (m, fmt, ap);
             va_end (ap);
         }
-        printf (">\n");
+        idmsg_puts (m, ">\n");
 
         for (i = 0; i < lvp->nlp; i++) {
             ILight *lp = &lvp->lp[i];
-            printf ("  <oneLight name='%s'>\n", lp->name);
-            printf ("      %s\n", pstateStr(lp->s));
-            printf ("  </oneLight>\n");
+            idmsg_puts (m, "  <oneLight name='");
+            idmsg_putxml (m, lp->name);
+            idmsg_puts (m, "'>\n      ");
+            idmsg_puts (m, pstateStr(lp->s));
+            idmsg_puts (m, "\n  </oneLight>\n");
         }
 
-        printf ("</setLightVector>\n");
-        fflush (stdout);
+        idmsg_puts (m, "</setLightVector>\n");
 
-        pthread_mutex_unlock(&stdout_mutex);
+        idmsg_end(m);
 }
 
 /* tell client to update an existing BLOB vector property */
@@ -1915,9 +2207,21 @@ void
 IDSetBLOB (const IBLOBVectorProperty *bvp, const char *fmt, ...)
 {
     int i;
+    IDMsg *m = idmsg_get();
+    int tracing = indi_trace_enabled();
+    unsigned long long encus = 0;
+
+    if (tracing)
+        indi_trace_stamp(m->trace, sizeof(m->trace), "set", indi_trace_now());
+
+    /* Messages batched by this thread go first */
+    idmsg_flush(m);
 
     pthread_mutex_lock(&stdout_mutex);
 
+    if (tracing)
+        indi_trace_stamp(m->trace, sizeof(m->trace), "drv", indi_trace_now());
+
     xmlv1();
     char *orig = setlocale(LC_NUMERIC,"C");
     printf ("<setBLOBVector\n");
@@ -1926,6 +2230,8 @@ IDSetBLOB (const IBLOBVectorProperty *bvp, const char *fmt, ...)
     printf ("  state='%s'\n", pstateStr(bvp->s));
     printf ("  timeout='%g'\n", bvp->timeout);
     printf ("  timestamp='%s'\n", timestamp());
+    if (tracing)
+        printf ("  %s='%s'\n", INDI_TRACE_ATTR, m->trace);
     if (fmt)
     {
         va_list ap;
@@ -1940,7 +2246,7 @@ IDSetBLOB (const IBLOBVectorProperty *bvp, const char *fmt, ...)
     for (i = 0; i < bvp->nbp; i++)
     {
         IBLOB *bp = &bvp->bp[i];
-        unsigned char *encblob;
+        unsigned char *enc;
         int l;
 
         printf ("  <oneBLOB\n");
@@ -1948,8 +2254,12 @@ IDSetBLOB (const IBLOBVectorProperty *bvp, const char *fmt, ...)
         printf ("    size='%d'\n", bp->size);
         //printf ("    format='%s'>\n", bp->format);
 
-        encblob = malloc (4*bp->bloblen/3+4);
-        l = to64frombits(encblob, bp->blob, bp->bloblen);
+        /* Each BLOB is encoded just before it is written, only one encoded copy exists at a time */
+        unsigned long long t0 = tracing ? indi_trace_now() : 0;
+        enc = malloc (4*bp->bloblen/3+4);
+        l   = to64frombits(enc, bp->blob, bp->bloblen);
+        if (tracing)
+            encus += indi_trace_now() - t0;
         printf ("    enclen='%d'\n", l);
         printf ("    format='%s'>\n", bp->format);
         size_t written = 0;
@@ -1957,7 +2267,7 @@ IDSetBLOB (const IBLOBVectorProperty *bvp, const char *fmt, ...)
         while (written < l)
         {
             towrite = ((l - written) > 72) ? 72 : l - written;
-            size_t wr = fwrite(encblob + written, 1, towrite, stdout);
+            size_t wr = fwrite(enc + written, 1, towrite, stdout);
             if (wr > 0) written += wr;
             if ((written % 72) == 0)
                 fputc('\n', stdout);
@@ -1966,7 +2276,7 @@ IDSetBLOB (const IBLOBVectorProperty *bvp, const char *fmt, ...)
         if ((written % 72) != 0)
             fputc('\n', stdout);
 
-        free (encblob);
+        free (enc);
 
         printf ("  </oneBLOB>\n");
     }
@@ -1976,39 +2286,64 @@ IDSetBLOB (const IBLOBVectorProperty *bvp, const char *fmt, ...)
     fflush (stdout);
 
     pthread_mutex_unlock(&stdout_mutex);
+
+    if (tracing)
+    {
+        /* The write blocks while indiserver is behind, driver_write includes the encoding */
+        indi_trace_stamp(m->trace, sizeof(m->trace), "out", indi_trace_now());
+        indi_trace_record_span("driver_prepare", m->trace, "exp", "set");
+        indi_trace_record("driver_encode", encus);
+        indi_trace_record_span("driver_write", m->trace, "drv", "out");
+        m->trace[0] = '\0';
+    }
+}
+
+void IDTraceStamp (const char *hop)
+{
+    IDMsg *m;
+
+    if (!indi_trace_enabled())
+        return;
+
+    m = idmsg_get();
+
+    /* Stamps of a previous frame that was never sent start over */
+    unsigned long long t;
+    if (indi_trace_find(m->trace, hop, &t) == 0)
+        m->trace[0] = '\0';
+
+    indi_trace_stamp(m->trace, sizeof(m->trace), hop, indi_trace_now());
 }
 
 /* tell client to update min/max elements of an existing number vector property */
 void IUUpdateMinMax(const INumberVectorProperty *nvp)
 {
   int i;
+  IDMsg *m = idmsg_begin();
 
-  pthread_mutex_lock(&stdout_mutex);
-  xmlv1();
-  char *orig = setlocale(LC_NUMERIC,"C");
-  printf ("<setNumberVector\n");
-  printf ("  device='%s'\n", nvp->device);
-  printf ("  name='%s'\n", nvp->name);
-  printf ("  state='%s'\n", pstateStr(nvp->s));
-  printf ("  timeout='%g'\n", nvp->timeout);
-  printf ("  timestamp='%s'\n", timestamp());
-  printf (">\n");
+  idmsg_puts (m, "<setNumberVector\n");
+  idmsg_attr (m, "  device", nvp->device);
+  idmsg_attr (m, "  name", nvp->name);
+  idmsg_attr (m, "  state", pstateStr(nvp->s));
+  idmsg_attr_g (m, "  timeout", nvp->timeout);
+  idmsg_timestamp (m);
+  idmsg_puts (m, ">\n");
 
   for (i = 0; i < nvp->nnp; i++) {
     INumber *np = &nvp->np[i];
-    printf ("  <oneNumber name='%s'\n", np->name);
-    printf ("    min='%g'\n", np->min);
-    printf ("    max='%g'\n", np->max);
-    printf ("    step='%g'\n", np->step);
-    printf(">\n");
-    printf ("      %g\n", np->value);
-    printf ("  </oneNumber>\n");
+    idmsg_puts (m, "  <oneNumber name='");
+    idmsg_putxml (m, np->name);
+    idmsg_puts (m, "'\n");
+    idmsg_attr_g (m, "    min", np->min);
+    idmsg_attr_g (m, "    max", np->max);
+    idmsg_attr_g (m, "    step", np->step);
+    idmsg_puts (m, ">\n      ");
+    idmsg_g (m, np->value);
+    idmsg_puts (m, "\n  </oneNumber>\n");
   }
 
-  printf ("</setNumberVector>\n");
-  setlocale(LC_NUMERIC,orig);
-  fflush (stdout);
-  pthread_mutex_unlock(&stdout_mutex);
+  idmsg_puts (m, "</setNumberVector>\n");
+  idmsg_end(m);
 }
 
 int IUFindIndex (const char *needle, char **hay, unsigned int n)
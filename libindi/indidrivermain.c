@@ -46,6 +46,7 @@
 #include "indidevapi.h"
 #include "indicom.h"
 #include "indidriver.h"
+#include "inditrace.h"
 
 #define MAXRBUF 2048
 
@@ -90,6 +91,7 @@ main (int ac, char *av[])
 	    usage();
 
 	/* init */
+	indi_trace_init(me);
 	clixml =  newLilXML();
 	addCallback (0, clientMsgCB, NULL);
 
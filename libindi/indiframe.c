@@ -0,0 +1,432 @@
+/* framed transport between chained INDI servers.
+ * Copyright (C) 2026 INDI Library contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+ * Each frame is
+ *
+ *   magic, type, header length (2 bytes), payload length (4 bytes),
+ *   header: tag NUL device NUL name NUL, payload
+ *
+ * with lengths in network byte order, so messages are routed on the header
+ * without parsing. F_XML payloads are the XML text of the message. F_BLOB
+ * payloads carry setBLOBVector and newBLOBVector with raw bytes instead of
+ * base64: the length and text of the start tag, the number of BLOBs, then for
+ * each the length and text of its attributes and the length and bytes of its
+ * data. F_DEVICES payloads list devices, one per line. See indiserver.c for
+ * how servers agree to use frames.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "lilxml.h"
+#include "base64.h"
+#include "indiframe.h"
+
+#define FRAMERBUF       49152   /* bytes read at once, as MAXRBUF of indiserver */
+
+static void printAttrs (char *s, int *sl, XMLEle *ep, int tag,
+    const char *skip);
+static int attrsLen (XMLEle *ep);
+static int frameBLOBCheck (const unsigned char *p, unsigned long plen);
+
+/* store v at p in network byte order */
+static void
+put32 (unsigned char *p, unsigned long v)
+{
+    p[0] = (v >> 24) & 0xff;
+    p[1] = (v >> 16) & 0xff;
+    p[2] = (v >> 8) & 0xff;
+    p[3] = v & 0xff;
+}
+
+/* return the value stored at p in network byte order */
+static unsigned long
+get32 (const unsigned char *p)
+{
+    return (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+                                ((unsigned long)p[2] << 8) | p[3]);
+}
+
+/* allocate a frame at *fcp of *fcl bytes with room for plen payload bytes
+ * and fill its header. return pointer to the payload.
+ */
+unsigned char *
+newFrame (char **fcp, unsigned long *fcl, int type, const char *tag,
+const char *dev, const char *name, unsigned long plen)
+{
+    unsigned long tl = strlen(tag)+1, dl = strlen(dev)+1, nl = strlen(name)+1;
+    unsigned long hlen = tl + dl + nl;
+    unsigned char *p;
+
+    *fcl = FRAMEHDR + hlen + plen;
+    *fcp = malloc (*fcl);
+
+    p = (unsigned char *) *fcp;
+    p[0] = FRAMEMAGIC;
+    p[1] = type;
+    p[2] = (hlen >> 8) & 0xff;
+    p[3] = hlen & 0xff;
+    put32 (p+4, plen);
+    p += FRAMEHDR;
+    memcpy (p, tag, tl);
+    memcpy (p+tl, dev, dl);
+    memcpy (p+tl+dl, name, nl);
+
+    return (p + hlen);
+}
+
+/* append to s at *sl the start tag of ep, or only its attributes if !tag,
+ * leaving out attribute skip. s must be large enough, see attrsLen().
+ */
+static void
+printAttrs (char *s, int *sl, XMLEle *ep, int tag, const char *skip)
+{
+    XMLAtt *ap;
+
+    if (tag)
+        *sl += sprintf (s + *sl, "<%s", tagXMLEle(ep));
+    for (ap = nextXMLAtt (ep, 1); ap; ap = nextXMLAtt (ep, 0)) {
+        if (skip && !strcmp (nameXMLAtt(ap), skip))
+            continue;
+        *sl += sprintf (s + *sl, " %s=\"%s\"", nameXMLAtt(ap),
+                                            entityXML(valuXMLAtt(ap)));
+    }
+    if (tag)
+        *sl += sprintf (s + *sl, ">");
+}
+
+/* return bytes needed by printAttrs() for ep, sans trailing \0 */
+static int
+attrsLen (XMLEle *ep)
+{
+    XMLAtt *ap;
+    int l = strlen(tagXMLEle(ep)) + 2;
+
+    for (ap = nextXMLAtt (ep, 1); ap; ap = nextXMLAtt (ep, 0))
+        l += strlen(nameXMLAtt(ap)) + 4 + strlen(entityXML(valuXMLAtt(ap)));
+
+    return (l);
+}
+
+/* build at *fcp the F_BLOB frame of *fcl bytes of BLOB vector root.
+ * return 0 if ok, -1 if some BLOB is not valid base64.
+ */
+int
+frameBLOB (XMLEle *root, char **fcp, unsigned long *fcl)
+{
+    const char *dev = findXMLAttValu (root, "device");
+    const char *name = findXMLAttValu (root, "name");
+    unsigned long plen, maxb64 = 0;
+    unsigned char *p, *p0;
+    char *b64;
+    XMLEle *ep;
+    int n = 0, sl;
+
+    /* upper bound of the payload */
+    plen = 8 + attrsLen (root);
+    for (ep = nextXMLEle (root, 1); ep; ep = nextXMLEle (root, 0)) {
+        unsigned long l = pcdatalenXMLEle (ep);
+        plen += 8 + attrsLen (ep) + 3*l/4 + 3;
+        if (l > maxb64)
+            maxb64 = l;
+        n++;
+    }
+
+    p = p0 = newFrame (fcp, fcl, F_BLOB, tagXMLEle(root), dev, name, plen);
+    b64 = malloc (maxb64 + 1);
+
+    sl = 0;
+    printAttrs ((char *)p+4, &sl, root, 1, NULL);
+    put32 (p, sl);
+    p += 4 + sl;
+    put32 (p, n);
+    p += 4;
+
+    for (ep = nextXMLEle (root, 1); ep; ep = nextXMLEle (root, 0)) {
+        const char *pc = pcdataXMLEle (ep);
+        int i, l = 0, nraw;
+
+        sl = 0;
+        printAttrs ((char *)p+4, &sl, ep, 0, "enclen");
+        put32 (p, sl);
+        p += 4 + sl;
+
+        /* drop line breaks, then decode */
+        for (i = 0; pc[i]; i++)
+            if (!isspace ((unsigned char)pc[i]))
+                b64[l++] = pc[i];
+        nraw = (l % 4) != 0 ? -1 : l > 0 ? from64tobits_fast ((char *)p+4, b64, l) : 0;
+        if (nraw < 0) {
+            free (b64);
+            free (*fcp);
+            *fcp = NULL;
+            *fcl = 0;
+            return (-1);
+        }
+        put32 (p, nraw);
+        p += 4 + nraw;
+    }
+
+    free (b64);
+
+    /* actual size */
+    *fcl -= plen - (p - p0);
+    put32 ((unsigned char *)*fcp + 4, p - p0);
+
+    return (0);
+}
+
+/* return the XML text of F_BLOB frame f with its BLOBs in base64, malloced,
+ * and its length at *cl.
+ */
+char *
+frameBLOBXML (Frame *f, unsigned long *cl)
+{
+    const unsigned char *p = f->payload;
+    unsigned long startlen, n, i, sl;
+    char *cp;
+
+    /* base64 grows data by 4/3, allow for markup of each BLOB */
+    startlen = get32 (p);
+    n = get32 (p + 4 + startlen);
+    cp = malloc (f->plen*4/3 + n*64 + strlen(f->tag) + 16);
+
+    sl = 0;
+    memcpy (cp, p+4, startlen);
+    sl += startlen;
+    cp[sl++] = '\n';
+    p += 8 + startlen;
+
+    for (i = 0; i < n; i++) {
+        unsigned long al = get32 (p), rl = get32 (p + 4 + al);
+        int enclen;
+
+        sl += sprintf (cp+sl, "  <oneBLOB");
+        memcpy (cp+sl, p+4, al);
+        sl += al;
+        enclen = 4*((rl+2)/3);
+        sl += sprintf (cp+sl, " enclen=\"%d\">\n", enclen);
+        sl += to64frombits ((unsigned char *)cp+sl, p + 8 + al, rl);
+        sl += sprintf (cp+sl, "\n  </oneBLOB>\n");
+        p += 8 + al + rl;
+    }
+
+    sl += sprintf (cp+sl, "</%s>\n", f->tag);
+    *cl = sl;
+    return (cp);
+}
+
+/* return the element of frame f for local processing: fully parsed if full,
+ * else only its tag with device and name attributes. F_BLOB frames are
+ * parsed without their BLOBs. caller must delXMLEle() the result.
+ */
+XMLEle *
+frameRoot (Frame *f, int full)
+{
+    XMLEle *root = NULL;
+
+    if (full && f->type != F_DEVICES) {
+        char err[1024];
+        LilXML *lp = newLilXML();
+        XMLEle **nodes;
+        char *s;
+        int sl;
+
+        if (f->type == F_BLOB) {
+            unsigned long startlen = get32 (f->payload);
+            s = malloc (startlen + strlen(f->tag) + 4);
+            memcpy (s, f->payload+4, startlen);
+            sl = startlen + sprintf (s+startlen, "</%s>", f->tag);
+        } else {
+            s = malloc (f->plen + 1);
+            memcpy (s, f->payload, f->plen);
+            sl = f->plen;
+        }
+
+        nodes = parseXMLChunk (lp, s, sl, err);
+        if (nodes) {
+            root = nodes[0];
+            if (root && nodes[1])
+                delXMLEle (nodes[1]);
+            free (nodes);
+        }
+        free (s);
+        delLilXML (lp);
+    }
+
+    if (!root) {
+        root = addXMLEle (NULL, f->tag);
+        addXMLAtt (root, "device", f->dev);
+        addXMLAtt (root, "name", f->name);
+    }
+
+    return (root);
+}
+
+/* read more of a framed connection into fb, making room for the whole frame
+ * being received if its payload is at most maxplen. return as read(2).
+ */
+ssize_t
+frameRead (int fd, FrameBuf *fb, unsigned long maxplen)
+{
+    unsigned long need = fb->len + FRAMERBUF;
+
+    if (fb->len >= FRAMEHDR && fb->buf[0] == FRAMEMAGIC &&
+                                        get32 (fb->buf+4) <= maxplen) {
+        unsigned long flen = FRAMEHDR + ((fb->buf[2] << 8) | fb->buf[3]) +
+                                                            get32 (fb->buf+4);
+        if (flen > need)
+            need = flen;
+    }
+
+    if (need > fb->cap) {
+        unsigned char *nb = realloc (fb->buf, need);
+        if (!nb) {
+            errno = ENOMEM;
+            return (-1);
+        }
+        fb->buf = nb;
+        fb->cap = need;
+    }
+
+    return (read (fd, fb->buf + fb->len, fb->cap - fb->len));
+}
+
+/* append n bytes already read to fb. return 0 if ok, -1 if out of memory */
+int
+frameAppend (FrameBuf *fb, const char *buf, unsigned long n)
+{
+    if (fb->len + n > fb->cap) {
+        unsigned char *nb = realloc (fb->buf, fb->len + n + FRAMERBUF);
+        if (!nb)
+            return (-1);
+        fb->buf = nb;
+        fb->cap = fb->len + n + FRAMERBUF;
+    }
+    memcpy (fb->buf + fb->len, buf, n);
+    fb->len += n;
+    return (0);
+}
+
+/* check the BLOB layout of an F_BLOB payload of plen bytes at p stays
+ * within it. return 0 if ok, -1 if any length is out of range.
+ */
+static int
+frameBLOBCheck (const unsigned char *p, unsigned long plen)
+{
+    unsigned long off, startlen, n, i, al, rl;
+
+    if (plen < 8)
+        return (-1);
+    startlen = get32 (p);
+    if (startlen > plen - 8)
+        return (-1);
+    n = get32 (p + 4 + startlen);
+    off = 8 + startlen;
+
+    for (i = 0; i < n; i++) {
+        if (plen - off < 8)
+            return (-1);
+        al = get32 (p + off);
+        if (al > plen - off - 8)
+            return (-1);
+        rl = get32 (p + off + 4 + al);
+        if (rl > plen - off - 8 - al)
+            return (-1);
+        off += 8 + al + rl;
+    }
+
+    return (off == plen ? 0 : -1);
+}
+
+/* find the next complete frame of fb at *off and advance *off past it.
+ * payloads larger than maxplen are refused.
+ * return 1 if found, 0 if more bytes are needed, -1 if the stream is bad.
+ */
+int
+frameNext (FrameBuf *fb, unsigned long *off, Frame *f, unsigned long maxplen)
+{
+    unsigned char *p = fb->buf + *off;
+    unsigned long avail = fb->len - *off, hlen, plen;
+    char *h;
+
+    if (avail < FRAMEHDR)
+        return (0);
+    if (p[0] != FRAMEMAGIC || p[1] < F_XML || p[1] > F_DEVICES)
+        return (-1);
+
+    hlen = (p[2] << 8) | p[3];
+    plen = get32 (p+4);
+    if (plen > maxplen)
+        return (-1);
+    if (avail < FRAMEHDR + hlen + plen)
+        return (0);
+
+    /* header is tag, device and name, each NUL terminated */
+    h = (char *)p + FRAMEHDR;
+    if (hlen < 3 || h[hlen-1] != '\0')
+        return (-1);
+    f->tag = h;
+    f->dev = (char *) memchr (h, '\0', hlen) + 1;
+    if (f->dev >= h + hlen)
+        return (-1);
+    f->name = (char *) memchr (f->dev, '\0', h + hlen - f->dev) + 1;
+    if (f->name >= h + hlen || !f->tag[0])
+        return (-1);
+
+    f->type = p[1];
+    f->data = p;
+    f->len = FRAMEHDR + hlen + plen;
+    f->payload = p + FRAMEHDR + hlen;
+    f->plen = plen;
+
+    /* the BLOB lengths inside are used as they are, check them once here */
+    if (f->type == F_BLOB && frameBLOBCheck (f->payload, plen) < 0)
+        return (-1);
+
+    *off += f->len;
+    return (1);
+}
+
+/* drop the frames of fb before off */
+void
+frameConsume (FrameBuf *fb, unsigned long off)
+{
+    fb->len -= off;
+    memmove (fb->buf, fb->buf + off, fb->len);
+
+    /* do not keep a large BLOB buffer around */
+    if (fb->cap > 4*FRAMERBUF && fb->len < FRAMERBUF) {
+        unsigned char *nb = realloc (fb->buf, FRAMERBUF);
+        if (nb) {
+            fb->buf = nb;
+            fb->cap = FRAMERBUF;
+        }
+    }
+}
+
+/* release fb */
+void
+frameFree (FrameBuf *fb)
+{
+    free (fb->buf);
+    memset (fb, 0, sizeof(*fb));
+}
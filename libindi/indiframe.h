@@ -0,0 +1,70 @@
+/* framed transport between chained INDI servers.
+ * Copyright (C) 2026 INDI Library contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef INDIFRAME_H
+#define INDIFRAME_H
+
+#include <sys/types.h>
+
+#include "lilxml.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAMEMAGIC      0xA5    /* first byte of each frame */
+#define FRAMEHDR        8       /* bytes of fixed frame header */
+#define FRAMEVERSION    1       /* framed transport version we speak */
+
+/* kinds of frames between chained servers */
+enum {F_XML=1, F_BLOB, F_DEVICES};
+
+/* bytes received on a framed connection */
+typedef struct {
+    unsigned char *buf;			/* malloced */
+    unsigned long len;			/* bytes in buf */
+    unsigned long cap;			/* size of buf */
+} FrameBuf;
+
+/* one received frame, pointing into its FrameBuf */
+typedef struct {
+    int type;				/* F_XML, F_BLOB or F_DEVICES */
+    char *tag, *dev, *name;		/* header */
+    unsigned char *data;		/* whole frame */
+    unsigned long len;			/* bytes of whole frame */
+    unsigned char *payload;		/* payload */
+    unsigned long plen;			/* bytes of payload */
+} Frame;
+
+extern unsigned char *newFrame (char **fcp, unsigned long *fcl, int type,
+    const char *tag, const char *dev, const char *name, unsigned long plen);
+extern int frameBLOB (XMLEle *root, char **fcp, unsigned long *fcl);
+extern char *frameBLOBXML (Frame *f, unsigned long *cl);
+extern XMLEle *frameRoot (Frame *f, int full);
+extern ssize_t frameRead (int fd, FrameBuf *fb, unsigned long maxplen);
+extern int frameAppend (FrameBuf *fb, const char *buf, unsigned long n);
+extern int frameNext (FrameBuf *fb, unsigned long *off, Frame *f,
+    unsigned long maxplen);
+extern void frameConsume (FrameBuf *fb, unsigned long off);
+extern void frameFree (FrameBuf *fb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
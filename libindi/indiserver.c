@@ -39,6 +39,15 @@
  * consumer is finished. XMLEle are converted to linear strings before being
  * sent to optimize write system calls and avoid blocking to slow clients.
  * Clients that get more than maxqsiz bytes behind are shut down.
+ *
+ * Chained servers that both support it switch to a framed transport after
+ * the first getProperties, see framedTransport below, so BLOBs travel
+ * between them as raw bytes and messages are routed without parsing them.
+ *
+ * Traffic and queue counters are kept for every client and driver. The
+ * "metrics [file]" FIFO command writes them to file, by default the FIFO path
+ * with .metrics appended, one "kind key=value ..." line per server, client
+ * and driver.
  */
 
 #include "config.h"
@@ -46,6 +55,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <ctype.h>
 #include <signal.h>
 #include <string.h>
 #include <errno.h>
@@ -62,7 +72,10 @@
 
 #include "lilxml.h"
 #include "indiapi.h"
+#include "inditrace.h"
+#include "base64.h"
 #include "fq.h"
+#include "indiframe.h"
 
 #define INDIPORT        7624    /* default TCP/IP port to listen */
 #define	REMOTEDVR       (-1234)	/* invalid PID to flag remote drivers */
@@ -71,6 +84,8 @@
 #define	MAXWSIZ         49152	/* max bytes/write */
 #define	DEFMAXQSIZ      64		/* default max q behind, MB */
 #define DEFMAXRESTART   10      /* default max restarts */
+#define METRICSEXT      ".metrics"  /* default metrics file is FIFO name + this */
+#define MAXFRAME        (32*1024*1024) /* largest frame payload, at least */
 
 #ifdef OSX_EMBEDED_MODE
 #define LOGNAME "/Users/%s/Library/Logs/indiserver.log"
@@ -83,9 +98,33 @@ typedef struct {
     int count;				/* number of consumers left */
     unsigned long cl;			/* content length */
     char *cp;				/* content: buf or malloced */
+    unsigned long long traced;		/* trace stamp when queued, 0 if not traced */
+    double queued;			/* monotonic time when created */
+    int blob;				/* 1 if setBLOBVector */
+    unsigned long fcl;			/* framed content length */
+    char *fcp;				/* framed content, malloced, for chained servers */
+    int nframed;			/* consumers wanting the framed content */
+    int frameswitch;			/* consumer sends frames once this is sent */
     char buf[MAXWSIZ];		/* local buf for most messages */
 } Msg;
 
+/* traffic counters of one client or driver */
+typedef struct {
+    unsigned long nmsgin;		/* messages received */
+    unsigned long long nbytein;		/* bytes received */
+    unsigned long nmsgout;		/* messages sent completely */
+    unsigned long long nbyteout;	/* bytes sent */
+    unsigned long nblobout;		/* setBLOBVectors sent completely */
+    unsigned long ndropped;		/* messages discarded unsent */
+    unsigned long nblobdropped;		/* setBLOBVectors discarded unsent */
+    int maxqbytes;			/* most bytes found queued */
+    double maxqwait;			/* longest a message waited in queue, secs */
+    unsigned long lastmsgin;		/* nmsgin at the last metrics report */
+    unsigned long long lastbytein;	/* nbytein at the last metrics report */
+    unsigned long long lastbyteout;	/* nbyteout at the last metrics report */
+    double lasttime;			/* time of the last metrics report */
+} Stats;
+
 /* BLOB handling, NEVER is the default */
 typedef enum {B_NEVER=0, B_ALSO, B_ONLY} BLOBHandling;
 
@@ -122,6 +161,15 @@ typedef struct {
     LilXML *lp;				/* XML parsing context */
     FQ *msgq;				/* Msg queue */
     unsigned int nsent;				/* bytes of current Msg sent so far */
+    char peer[64];			/* address:port of the client */
+    Stats stats;			/* traffic counters */
+    int rframed;			/* 1 once chained server sends frames */
+    int wframed;			/* 1 once we send frames */
+    int wpending;			/* 1 while our switch to frames is queued */
+    FrameBuf fb;			/* frames received */
+    char **peerdevs;			/* devices served by chained server */
+    int npeerdevs;			/* n entries in peerdevs[] */
+    int havepeerdevs;			/* 1 once chained server sent its list */
 } ClInfo;
 static ClInfo *clinfo;			/*  malloced pool of clients */
 static int nclinfo;			/* n total (not active) */
@@ -147,6 +195,12 @@ typedef struct {
     LilXML *lp;				/* XML parsing context */
     FQ *msgq;				/* Msg queue */
     unsigned int nsent;			/* bytes of current Msg sent so far */
+    Stats stats;			/* traffic counters, kept over restarts */
+    int askframes;			/* 1 if we asked remote server for frames */
+    int rframed;			/* 1 once remote server sends frames */
+    int wframed;			/* 1 once we send frames */
+    int wpending;			/* 1 while our switch to frames is queued */
+    FrameBuf fb;			/* frames received */
 } DvrInfo;
 static DvrInfo *dvrinfo;		/* malloced array of drivers */
 static int ndvrinfo;			/* n total */
@@ -159,6 +213,12 @@ static char *ldir;			/* where to log driver messages */
 static int maxqsiz = (DEFMAXQSIZ*1024*1024); /* kill if these bytes behind */
 static int maxrestarts = DEFMAXRESTART;
 static int terminateddrv = 0;
+static double starttime;		/* monotonic time at startup */
+static unsigned long nslowclients;	/* clients shut down for being behind */
+static char lastslow[64];		/* peer of the last of them */
+static unsigned long ndropped;		/* messages discarded unsent */
+static unsigned long long nbytedropped;	/* their bytes */
+static unsigned long nblobdropped;	/* setBLOBVectors among them */
 
 static void logStartup(int ac, char *av[]);
 static void usage (void);
@@ -168,10 +228,17 @@ static void indiFIFO(void);
 static void indiRun (void);
 static void indiListen (void);
 static void newFIFO(void);
+static void writeMetrics (const char *path);
+static void printStats (FILE *fp, Stats *sp, FQ *q, double now);
+static void sentStats (Stats *sp, Msg *mp, ssize_t nw, int done);
+static void dropStats (Stats *sp, Msg *mp);
+static double monoTime (void);
 static void newClient (void);
 static int newClSocket (void);
 static void shutdownClient (ClInfo *cp);
 static int readFromClient (ClInfo *cp);
+static int clFrames (ClInfo *cp);
+static int clMessage (ClInfo *cp, XMLEle *root, Frame *f);
 static void startDvr (DvrInfo *dp);
 static void startLocalDvr (DvrInfo *dp);
 static void startRemoteDvr (DvrInfo *dp);
@@ -189,17 +256,31 @@ static Property *findSDevice (DvrInfo *dp, const char *dev, const char *name);
 static void addClDevice (ClInfo *cp, const char *dev, const char *name, int isblob);
 static int findClDevice (ClInfo *cp, const char *dev, const char *name);
 static int readFromDriver (DvrInfo *dp);
+static int dvrFrames (DvrInfo *dp);
+static int dvrMessage (DvrInfo *dp, XMLEle *root, Frame *f);
 static int stderrFromDriver (DvrInfo *dp);
 static int msgQSize (FQ *q);
 static void setMsgXMLEle (Msg *mp, XMLEle *root);
 static void setMsgStr (Msg *mp, char *str);
 static void freeMsg (Msg *mp);
+static void frameStr (Msg *mp, const char *tag, const char *dev,
+    const char *name);
+static void frameFromXML (Msg *mp, XMLEle *root);
+static void xmlFromFrame (Msg *mp, Frame *f);
+static void setMsgContent (Msg *mp, XMLEle *root, Frame *f);
+static unsigned long maxFrame (void);
+static void queueFramedTransport (FQ *q);
+static void announceDevices (void);
+static int peerHasDevice (ClInfo *cp, const char *dev);
+static void setPeerDevices (ClInfo *cp, Frame *f);
+static void freePeerDevices (ClInfo *cp);
 static Msg *newMsg (void);
 static int sendClientMsg (ClInfo *cp);
 static int sendDriverMsg (DvrInfo *cp);
 static void crackBLOB (const char *enableBLOB, BLOBHandling *bp);
 static void crackBLOBHandling(const char *dev, const char *name, const char *enableBLOB, ClInfo *cp);
 static void traceMsg (XMLEle *root);
+static void traceBLOB (Msg *mp, XMLEle *root);
 static char *indi_tstamp (char *s);
 static void logDMsg (XMLEle *root, const char *dev);
 static void Bye(void);
@@ -214,6 +295,8 @@ main (int ac, char *av[])
 
     /* save our name */
     me = av[0];
+    indi_trace_init ("indiserver");
+    starttime = monoTime();
 
 #ifdef OSX_EMBEDED_MODE
 
@@ -347,6 +430,7 @@ usage(void)
         fprintf (stderr, " -p p     : alternate IP port, default %d\n", INDIPORT);
         fprintf (stderr, " -r r     : maximum driver restarts on error, default %d\n", DEFMAXRESTART);
         fprintf (stderr, " -f path  : Path to fifo for dynamic startup and shutdown of drivers.\n");
+        fprintf (stderr, "            'metrics [file]' in the fifo writes traffic counters to file, default path%s\n", METRICSEXT);
         fprintf (stderr, " -v       : show key events, no traffic\n");
         fprintf (stderr, " -vv      : -v + key message content\n");
         fprintf (stderr, " -vvv     : -vv + complete xml\n");
@@ -589,11 +673,14 @@ startRemoteDvr (DvrInfo *dp)
 
     /* Sending getProperties with device lets remote server limit its
      * outbound (and our inbound) traffic on this socket to this device.
+     * framed asks it to switch to frames, older servers ignore it.
      */
+    dp->askframes = 1;
+    dp->rframed = dp->wframed = dp->wpending = 0;
     mp = newMsg();
     pushFQ (dp->msgq, mp);
-    sprintf (buf, "<getProperties device='%s' version='%g'/>\n",
-             dp->dev[0], INDIV);
+    sprintf (buf, "<getProperties device='%s' version='%g' framed='%d'/>\n",
+             dp->dev[0], INDIV, FRAMEVERSION);
     setMsgStr (mp, buf);
     mp->count++;
 
@@ -870,6 +957,17 @@ static void newFIFO(void)
      if (verbose)
             fprintf(stderr, "FIFO: %s\n", line);
 
+     /* metrics [file] */
+     if (!strncmp(line, "metrics", 7) && (line[7] == '\0' || line[7] == ' '))
+     {
+         char path[MAXSBUF];
+
+         if (sscanf(line+7, "%511s", path) != 1)
+             snprintf(path, sizeof(path), "%s%s", fifo.name, METRICSEXT);
+         writeMetrics(path);
+         continue;
+     }
+
      char cmd[MAXSBUF], arg[4][1], var[4][MAXSBUF], tDriver[MAXSBUF], tName[MAXSBUF], envDev[MAXSBUF], envConfig[MAXSBUF], envSkel[MAXSBUF], envPrefix[MAXSBUF];
 
      memset(&tDriver[0], 0, sizeof(MAXSBUF));
@@ -1013,6 +1111,90 @@ static void newFIFO(void)
    }
 }
 
+/* write the counters of the server, each client and each driver to path,
+ * replacing it at once so readers never see a partial report.
+ */
+static void
+writeMetrics (const char *path)
+{
+    char tmp[MAXSBUF+16];
+    double now = monoTime();
+    int nclients = 0, ndrivers = 0;
+    FILE *fp;
+    int i;
+
+    snprintf (tmp, sizeof(tmp), "%s.tmp", path);
+    fp = fopen (tmp, "w");
+    if (!fp) {
+        fprintf (stderr, "%s: metrics %s: %s\n", indi_tstamp(NULL), tmp,
+                                                        strerror(errno));
+        return;
+    }
+
+    for (i = 0; i < nclinfo; i++)
+        nclients += clinfo[i].active;
+    for (i = 0; i < ndvrinfo; i++)
+        ndrivers += dvrinfo[i].active;
+
+    fprintf (fp, "server uptime=%.3f clients=%d drivers=%d maxqsiz=%d"
+                " slow_clients=%lu last_slow=%s dropped_msgs=%lu"
+                " dropped_bytes=%llu dropped_blobs=%lu\n",
+                now - starttime, nclients, ndrivers, maxqsiz, nslowclients,
+                lastslow[0] ? lastslow : "-", ndropped, nbytedropped,
+                nblobdropped);
+
+    for (i = 0; i < nclinfo; i++) {
+        ClInfo *cp = &clinfo[i];
+        if (!cp->active)
+            continue;
+        fprintf (fp, "client fd=%d peer=%s blob=%s", cp->s, cp->peer,
+                cp->blob == B_NEVER ? "Never" : cp->blob == B_ALSO ? "Also" : "Only");
+        printStats (fp, &cp->stats, cp->msgq, now);
+    }
+
+    for (i = 0; i < ndvrinfo; i++) {
+        DvrInfo *dp = &dvrinfo[i];
+        fprintf (fp, "driver name=%s pid=%d active=%d restarts=%d", dp->name,
+                        dp->pid, dp->active, dp->restarts);
+        printStats (fp, &dp->stats, dp->active ? dp->msgq : NULL, now);
+    }
+
+    if (fclose (fp) != 0 || rename (tmp, path) < 0) {
+        fprintf (stderr, "%s: metrics %s: %s\n", indi_tstamp(NULL), path,
+                                                        strerror(errno));
+        unlink (tmp);
+    }
+}
+
+/* print the counters in sp and the current state of q, if any, then restart
+ * the rates measured between reports.
+ */
+static void
+printStats (FILE *fp, Stats *sp, FQ *q, double now)
+{
+    double dt = now - (sp->lasttime > 0 ? sp->lasttime : starttime);
+
+    if (dt <= 0)
+        dt = 1e-6;
+
+    fprintf (fp, " msgs_in=%lu bytes_in=%llu msgs_out=%lu bytes_out=%llu"
+                " blobs_out=%lu queue_msgs=%d queue_bytes=%d"
+                " queue_max_bytes=%d queue_max_wait=%.3f"
+                " dropped_msgs=%lu dropped_blobs=%lu"
+                " msgs_in_rate=%.1f bytes_in_rate=%.0f bytes_out_rate=%.0f\n",
+                sp->nmsgin, sp->nbytein, sp->nmsgout, sp->nbyteout,
+                sp->nblobout, q ? nFQ(q) : 0, q ? msgQSize(q) : 0,
+                sp->maxqbytes, sp->maxqwait, sp->ndropped, sp->nblobdropped,
+                (sp->nmsgin - sp->lastmsgin) / dt,
+                (sp->nbytein - sp->lastbytein) / dt,
+                (sp->nbyteout - sp->lastbyteout) / dt);
+
+    sp->lastmsgin = sp->nmsgin;
+    sp->lastbytein = sp->nbytein;
+    sp->lastbyteout = sp->nbyteout;
+    sp->lasttime = now;
+}
+
 /* prepare for new client arriving on lsocket.
  * exit if trouble.
  */
@@ -1047,15 +1229,19 @@ newClient()
     cp->msgq = newFQ(1);
     cp->props = malloc (1);
     cp->nsent = 0;
+    cp->stats.lasttime = monoTime();
 
-    if (verbose > 0) {
+    {
         struct sockaddr_in addr;
         socklen_t len = sizeof(addr);
         getpeername(s, (struct sockaddr*)&addr, &len);
-        fprintf(stderr,"%s: Client %d: new arrival from %s:%d - welcome!\n",
-                indi_tstamp(NULL), cp->s, inet_ntoa(addr.sin_addr),
-                            ntohs(addr.sin_port));
+        snprintf (cp->peer, sizeof(cp->peer), "%s:%d",
+                            inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
     }
+
+    if (verbose > 0)
+        fprintf(stderr,"%s: Client %d: new arrival from %s - welcome!\n",
+                indi_tstamp(NULL), cp->s, cp->peer);
 #ifdef OSX_EMBEDED_MODE
   int active = 0;
   for (int i = 0; i < nclinfo; i++)
@@ -1077,7 +1263,10 @@ readFromClient (ClInfo *cp)
     ssize_t i, nr;
 
     /* read client */
-    nr = read (cp->s, buf, sizeof(buf));
+    if (cp->rframed)
+        nr = frameRead (cp->s, &cp->fb, maxFrame());
+    else
+        nr = read (cp->s, buf, sizeof(buf));
     if (nr <= 0) {
         if (nr < 0)
         fprintf (stderr, "%s: Client %d: read: %s\n", indi_tstamp(NULL),
@@ -1088,68 +1277,34 @@ readFromClient (ClInfo *cp)
         shutdownClient (cp);
         return (-1);
     }
+    cp->stats.nbytein += nr;
+
+    /* chained server sending frames */
+    if (cp->rframed) {
+        cp->fb.len += nr;
+        return (clFrames (cp));
+    }
 
     /* process XML, sending when find closure */
     for (i = 0; i < nr; i++) {
         char err[1024];
         XMLEle *root = readXMLEle (cp->lp, buf[i], err);
         if (root) {
-        char *roottag = tagXMLEle(root);
-        const char *dev = findXMLAttValu (root, "device");
-        const char *name = findXMLAttValu (root, "name");
-        int isblob = !strcmp (tagXMLEle(root), "setBLOBVector");
-        Msg *mp;
-
-        if (verbose > 2) {
-            fprintf (stderr, "%s: Client %d: read ",indi_tstamp(NULL),cp->s);
-            traceMsg (root);
-        } else if (verbose > 1) {
-            fprintf (stderr, "%s: Client %d: read <%s device='%s' name='%s'>\n",
-                    indi_tstamp(NULL), cp->s, tagXMLEle(root),
-                    findXMLAttValu (root, "device"),
-                    findXMLAttValu (root, "name"));
-        }
-
-        /* snag interested properties.
-         * N.B. don't open to alldevs if seen specific dev already, else
-         *   remote client connections start returning too much.
-         */
-        if (dev[0])
-                    addClDevice (cp, dev, name, isblob);
-        else if (!strcmp (roottag, "getProperties") && !cp->nprops)
-            cp->allprops = 1;
-
-        /* snag enableBLOB -- send to remote drivers too */
-        if (!strcmp (roottag, "enableBLOB"))
-                   // crackBLOB (pcdataXMLEle(root), &cp->blob);
-                     crackBLOBHandling (dev, name, pcdataXMLEle(root), cp);
-
-        /* build a new message -- set content iff anyone cares */
-        mp = newMsg();
-
-        /* send message to driver(s) responsible for dev */
-        q2RDrivers (dev, mp, root);
-
-        /* JM 2016-05-18: Upstream client can be a chained INDI server. If any driver locally is snooping
-         * on any remote drivers, we should catch it and forward it to the responsible snooping driver. */
-        /* send to snooping drivers. */
-        // JM 2016-05-26: Only forward setXXX messages
-        if (!strncmp (roottag, "set", 3))
-            q2SDrivers (isblob, dev, name, mp, root);
-
-        /* echo new* commands back to other clients */
-        if (!strncmp (roottag, "new", 3)) {
-                    if (q2Clients (cp, isblob, dev, name, mp, root) < 0)
+        if (clMessage (cp, root, NULL) < 0)
             shutany++;
-        }
-
-        /* set message content if anyone cares else forget it */
-        if (mp->count > 0)
-            setMsgXMLEle (mp, root);
-        else
-            freeMsg (mp);
         delXMLEle (root);
 
+        /* the rest are frames */
+        if (cp->rframed) {
+            if (frameAppend (&cp->fb, buf+i+1, nr-i-1) < 0) {
+                fprintf (stderr, "%s: Client %d: no memory for frames\n",
+                                                    indi_tstamp(NULL), cp->s);
+                shutdownClient (cp);
+                return (-1);
+            }
+            return (clFrames (cp) < 0 || shutany ? -1 : 0);
+        }
+
         } else if (err[0]) {
         char *ts = indi_tstamp(NULL);
         fprintf (stderr, "%s: Client %d: XML error: %s\n", ts,
@@ -1164,6 +1319,132 @@ readFromClient (ClInfo *cp)
     return (shutany ? -1 : 0);
 }
 
+/* process the complete frames received from chained server cp.
+ * return -1 if had to shut down anything, else 0.
+ */
+static int
+clFrames (ClInfo *cp)
+{
+    unsigned long off = 0;
+    int shutany = 0;
+    Frame f;
+    int r;
+
+    while ((r = frameNext (&cp->fb, &off, &f, maxFrame())) > 0) {
+        XMLEle *root = frameRoot (&f, ldir || verbose > 2 ||
+                                            !strcmp (f.tag, "enableBLOB"));
+        if (clMessage (cp, root, &f) < 0)
+            shutany++;
+        delXMLEle (root);
+    }
+
+    if (r < 0) {
+        fprintf (stderr, "%s: Client %d: bad frame\n", indi_tstamp(NULL),
+                                                                    cp->s);
+        shutdownClient (cp);
+        return (-1);
+    }
+
+    frameConsume (&cp->fb, off);
+    return (shutany ? -1 : 0);
+}
+
+/* process one message from client cp. f is its frame if it arrived framed,
+ * in which case root may only hold its tag, device and name.
+ * return -1 if had to shut down anything, else 0.
+ */
+static int
+clMessage (ClInfo *cp, XMLEle *root, Frame *f)
+{
+    char *roottag = tagXMLEle(root);
+    const char *dev = findXMLAttValu (root, "device");
+    const char *name = findXMLAttValu (root, "name");
+    int isblob = !strcmp (tagXMLEle(root), "setBLOBVector");
+    int shutany = 0;
+    Msg *mp;
+
+    cp->stats.nmsgin++;
+
+    /* framed transport handshake and device lists stay here. a client may
+     * only switch to frames once we agreed to send it frames ourselves.
+     */
+    if (!f && !strcmp (roottag, "framedTransport")) {
+        if ((cp->wpending || cp->wframed) &&
+                atoi (findXMLAttValu (root, "version")) == FRAMEVERSION)
+            cp->rframed = 1;
+        else if (verbose > 0)
+            fprintf (stderr, "%s: Client %d: ignoring unrequested framedTransport\n",
+                                                    indi_tstamp(NULL), cp->s);
+        return (0);
+    }
+    if (f && f->type == F_DEVICES) {
+        setPeerDevices (cp, f);
+        return (0);
+    }
+
+    if (verbose > 2) {
+        fprintf (stderr, "%s: Client %d: read ",indi_tstamp(NULL),cp->s);
+        traceMsg (root);
+    } else if (verbose > 1) {
+        fprintf (stderr, "%s: Client %d: read <%s device='%s' name='%s'>\n",
+                indi_tstamp(NULL), cp->s, tagXMLEle(root),
+                findXMLAttValu (root, "device"),
+                findXMLAttValu (root, "name"));
+    }
+
+    /* snag interested properties.
+     * N.B. don't open to alldevs if seen specific dev already, else
+     *   remote client connections start returning too much.
+     */
+    if (dev[0])
+                addClDevice (cp, dev, name, isblob);
+    else if (!strcmp (roottag, "getProperties") && !cp->nprops)
+        cp->allprops = 1;
+
+    /* chained server asking for frames: answer, then send frames */
+    if (!f && !strcmp (roottag, "getProperties") && findXMLAtt (root, "framed")) {
+        if (atoi (findXMLAttValu (root, "framed")) == FRAMEVERSION &&
+                                            !cp->wpending && !cp->wframed) {
+            queueFramedTransport (cp->msgq);
+            cp->wpending = 1;
+        }
+        rmXMLAtt (root, "framed");
+    }
+
+    /* snag enableBLOB -- send to remote drivers too */
+    if (!strcmp (roottag, "enableBLOB"))
+               // crackBLOB (pcdataXMLEle(root), &cp->blob);
+                 crackBLOBHandling (dev, name, pcdataXMLEle(root), cp);
+
+    /* build a new message -- set content iff anyone cares */
+    mp = newMsg();
+    mp->blob = isblob;
+
+    /* send message to driver(s) responsible for dev */
+    q2RDrivers (dev, mp, root);
+
+    /* JM 2016-05-18: Upstream client can be a chained INDI server. If any driver locally is snooping
+     * on any remote drivers, we should catch it and forward it to the responsible snooping driver. */
+    /* send to snooping drivers. */
+    // JM 2016-05-26: Only forward setXXX messages
+    if (!strncmp (roottag, "set", 3))
+        q2SDrivers (isblob, dev, name, mp, root);
+
+    /* echo new* commands back to other clients */
+    if (!strncmp (roottag, "new", 3)) {
+                if (q2Clients (cp, isblob, dev, name, mp, root) < 0)
+        shutany++;
+    }
+
+    /* set message content if anyone cares else forget it */
+    if (mp->count > 0)
+        setMsgContent (mp, root, f);
+    else
+        freeMsg (mp);
+
+    return (shutany ? -1 : 0);
+}
+
 /* read more from the given driver, send to each interested client when see
  * xml closure. if driver dies, try restarting.
  * return 0 if ok else -1 if had to shut down anything.
@@ -1180,7 +1461,10 @@ readFromDriver (DvrInfo *dp)
     int inode=0;
     
     /* read driver */
-    nr = read (dp->rfd, buf, sizeof(buf));
+    if (dp->rframed)
+        nr = frameRead (dp->rfd, &dp->fb, maxFrame());
+    else
+        nr = read (dp->rfd, buf, sizeof(buf));
     if (nr <= 0) {
         if (nr < 0)
         fprintf (stderr, "%s: Driver %s: stdin %s\n", indi_tstamp(NULL),
@@ -1191,6 +1475,46 @@ readFromDriver (DvrInfo *dp)
             shutdownDvr (dp, 1);
         return (-1);
     }
+    dp->stats.nbytein += nr;
+
+    /* chained server sending frames */
+    if (dp->rframed) {
+        dp->fb.len += nr;
+        return (dvrFrames (dp));
+    }
+
+    /* until a chained server switches to frames, read up to the switch */
+    if (dp->askframes) {
+        for (i = 0; i < nr; i++) {
+            root = readXMLEle (dp->lp, buf[i], err);
+            if (root) {
+                if (dvrMessage (dp, root, NULL) < 0)
+                    shutany++;
+                delXMLEle (root);
+
+                /* the rest are frames */
+                if (dp->rframed) {
+                    if (frameAppend (&dp->fb, buf+i+1, nr-i-1) < 0) {
+                        fprintf (stderr, "%s: Driver %s: no memory for frames\n",
+                                                    indi_tstamp(NULL), dp->name);
+                        shutdownDvr (dp, 1);
+                        return (-1);
+                    }
+                    return (dvrFrames (dp) < 0 || shutany ? -1 : 0);
+                }
+            } else if (err[0]) {
+                char *ts = indi_tstamp(NULL);
+                fprintf (stderr, "%s: Driver %s: XML error: %s\n", ts,
+                                        dp->name, err);
+                fprintf (stderr, "%s: Driver %s: XML read: %.*s\n", ts,
+                                        dp->name, (int)nr, buf);
+                shutdownDvr (dp, 1);
+                return (-1);
+            }
+        }
+
+        return (shutany ? -1 : 0);
+    }
 
     /* process XML chunk */
     nodes=parseXMLChunk(dp->lp, buf, nr, err);
@@ -1210,95 +1534,160 @@ readFromDriver (DvrInfo *dp)
     root=nodes[inode];
     while (root)
     {
-      char *roottag = tagXMLEle(root);
-      const char *dev = findXMLAttValu (root, "device");
-      const char *name = findXMLAttValu (root, "name");
-      int isblob = !strcmp (tagXMLEle(root), "setBLOBVector");
-      Msg *mp;
+      if (dvrMessage (dp, root, NULL) < 0)
+	shutany++;
+      delXMLEle (root);
+      inode++; root=nodes[inode];
+    }
 
-      if (verbose > 2)
-        {
-	  fprintf(stderr, "%s: Driver %s: read ", indi_tstamp(0),dp->name);
-	  traceMsg (root);
-        } else
-	if (verbose > 1) {
-	  fprintf (stderr, "%s: Driver %s: read <%s device='%s' name='%s'>\n",
-		   indi_tstamp(NULL), dp->name, tagXMLEle(root),
-		   findXMLAttValu (root, "device"),
-		   findXMLAttValu (root, "name"));
-	}
-      
-
-      /* that's all if driver is just registering a snoop */
-      /* JM 2016-05-18: Send getProperties to upstream chained servers as well.*/
-      if (!strcmp (roottag, "getProperties"))
-        {
-	  addSDevice (dp, dev, name);
-	  mp = newMsg();
-	  /* send to interested chained servers upstream */
-	  if (q2Servers(NULL, mp, root) < 0)
-	    shutany++;
-	  if (mp->count > 0)
-	    setMsgXMLEle (mp, root);
-	  else
-	    freeMsg (mp);
-	  delXMLEle (root);
-	  inode++; root=nodes[inode];
-	  continue;
-        }
+    free(nodes);
 
-      /* that's all if driver is just registering a BLOB mode */
-      if (!strcmp (roottag, "enableBLOB"))
-        {
-	  Property *sp = findSDevice (dp, dev, name);
-	  if (sp)
-            crackBLOB (pcdataXMLEle (root), &sp->blob);
-	  delXMLEle (root);
-	  inode++; root=nodes[inode];
-	  continue;
+    return (shutany ? -1 : 0);
+}
+
+/* process the complete frames received from chained server dp.
+ * return -1 if had to shut down anything, else 0.
+ */
+static int
+dvrFrames (DvrInfo *dp)
+{
+    unsigned long off = 0;
+    int shutany = 0;
+    Frame f;
+    int r;
+
+    while ((r = frameNext (&dp->fb, &off, &f, maxFrame())) > 0) {
+        XMLEle *root = frameRoot (&f, ldir || verbose > 2 ||
+                                            !strcmp (f.tag, "enableBLOB"));
+        if (dvrMessage (dp, root, &f) < 0)
+            shutany++;
+        delXMLEle (root);
+    }
+
+    if (r < 0) {
+        fprintf (stderr, "%s: Driver %s: bad frame\n", indi_tstamp(NULL),
+                                                                dp->name);
+        shutdownDvr (dp, 1);
+        return (-1);
+    }
+
+    frameConsume (&dp->fb, off);
+    return (shutany ? -1 : 0);
+}
+
+/* process one message from driver dp. f is its frame if it arrived framed,
+ * in which case root may only hold its tag, device and name.
+ * return -1 if had to shut down anything, else 0.
+ */
+static int
+dvrMessage (DvrInfo *dp, XMLEle *root, Frame *f)
+{
+    char *roottag = tagXMLEle(root);
+    const char *dev = findXMLAttValu (root, "device");
+    const char *name = findXMLAttValu (root, "name");
+    int isblob = !strcmp (tagXMLEle(root), "setBLOBVector");
+    int shutany = 0;
+    Msg *mp;
+
+    dp->stats.nmsgin++;
+
+    /* chained server agreed to frames: switch, answer and list our devices */
+    if (!f && !strcmp (roottag, "framedTransport")) {
+        if (dp->askframes &&
+                atoi (findXMLAttValu (root, "version")) == FRAMEVERSION) {
+            dp->rframed = 1;
+            queueFramedTransport (dp->msgq);
+            dp->wpending = 1;
+            announceDevices ();
+            if (verbose > 0)
+                fprintf (stderr, "%s: Driver %s: framed transport\n",
+                                            indi_tstamp(NULL), dp->name);
         }
+        return (0);
+    }
 
-      /* Found a new device? Let's add it to driver info */
-      if (dev[0] && isDeviceInDriver(dev, dp) == 0)
-        {
-	  dp->dev = (char **) realloc(dp->dev, (dp->ndev+1) * sizeof(char *));
-	  dp->dev[dp->ndev] = (char *) malloc(MAXINDIDEVICE * sizeof(char));
-	  
-	  strncpy (dp->dev[dp->ndev], dev, MAXINDIDEVICE-1);
-	  dp->dev[dp->ndev][MAXINDIDEVICE-1] = '\0';
-	  
+    if (verbose > 2)
+      {
+	fprintf(stderr, "%s: Driver %s: read ", indi_tstamp(0),dp->name);
+	traceMsg (root);
+      } else
+      if (verbose > 1) {
+	fprintf (stderr, "%s: Driver %s: read <%s device='%s' name='%s'>\n",
+		 indi_tstamp(NULL), dp->name, tagXMLEle(root),
+		 findXMLAttValu (root, "device"),
+		 findXMLAttValu (root, "name"));
+      }
+    
+
+    /* that's all if driver is just registering a snoop */
+    /* JM 2016-05-18: Send getProperties to upstream chained servers as well.*/
+    if (!strcmp (roottag, "getProperties"))
+      {
+	addSDevice (dp, dev, name);
+	mp = newMsg();
+	/* send to interested chained servers upstream */
+	if (q2Servers(NULL, mp, root) < 0)
+	  shutany++;
+	if (mp->count > 0)
+	  setMsgContent (mp, root, f);
+	else
+	  freeMsg (mp);
+	return (shutany ? -1 : 0);
+      }
+
+    /* that's all if driver is just registering a BLOB mode */
+    if (!strcmp (roottag, "enableBLOB"))
+      {
+	Property *sp = findSDevice (dp, dev, name);
+	if (sp)
+          crackBLOB (pcdataXMLEle (root), &sp->blob);
+	return (0);
+      }
+
+    /* Found a new device? Let's add it to driver info */
+    if (dev[0] && isDeviceInDriver(dev, dp) == 0)
+      {
+	dp->dev = (char **) realloc(dp->dev, (dp->ndev+1) * sizeof(char *));
+	dp->dev[dp->ndev] = (char *) malloc(MAXINDIDEVICE * sizeof(char));
+	
+	strncpy (dp->dev[dp->ndev], dev, MAXINDIDEVICE-1);
+	dp->dev[dp->ndev][MAXINDIDEVICE-1] = '\0';
+	
 #ifdef OSX_EMBEDED_MODE
-	  if (!dp->ndev)
-	    fprintf(stderr, "STARTED \"%s\"\n", dp->name); fflush(stderr);
+	if (!dp->ndev)
+	  fprintf(stderr, "STARTED \"%s\"\n", dp->name); fflush(stderr);
 #endif
-	  
-	  dp->ndev++;
-        }
+	
+	dp->ndev++;
 
-      /* log messages if any and wanted */
-      if (ldir)
-	logDMsg (root, dev);
-      
-      /* build a new message -- set content iff anyone cares */
-      mp = newMsg();
-      
-      /* send to interested clients */
-      if (q2Clients (NULL, isblob, dev, name, mp, root) < 0)
-	shutany++;
-      
-      /* send to snooping drivers */
-      q2SDrivers (isblob, dev, name, mp, root);
-      
-      /* set message content if anyone cares else forget it */
-      if (mp->count > 0)
-	setMsgXMLEle (mp, root);
-      else
-	freeMsg (mp);
-      delXMLEle (root);
-      inode++; root=nodes[inode];
-    }
+	/* chained servers may now reach it through us */
+	announceDevices ();
+      }
 
-    free(nodes);
+    /* log messages if any and wanted */
+    if (ldir)
+      logDMsg (root, dev);
+    
+    /* build a new message -- set content iff anyone cares */
+    mp = newMsg();
+    mp->blob = isblob;
+
+    /* stamp traced BLOBs before they are queued */
+    if (!f && isblob && indi_trace_enabled())
+      traceBLOB (mp, root);
+    
+    /* send to interested clients */
+    if (q2Clients (NULL, isblob, dev, name, mp, root) < 0)
+      shutany++;
+    
+    /* send to snooping drivers */
+    q2SDrivers (isblob, dev, name, mp, root);
+    
+    /* set message content if anyone cares else forget it */
+    if (mp->count > 0)
+      setMsgContent (mp, root, f);
+    else
+      freeMsg (mp);
 
     return (shutany ? -1 : 0);
 }
@@ -1355,11 +1744,15 @@ shutdownClient (ClInfo *cp)
     /* free memory */
     delLilXML (cp->lp);
     free (cp->props);
+    frameFree (&cp->fb);
+    freePeerDevices (cp);
 
     /* decrement and possibly free any unsent messages for this client */
-    while ((mp = (Msg*) popFQ(cp->msgq)) != NULL)
+    while ((mp = (Msg*) popFQ(cp->msgq)) != NULL) {
+        dropStats (&cp->stats, mp);
         if (--mp->count == 0)
         freeMsg (mp);
+    }
     delFQ (cp->msgq);
 
     /* ok now to recycle */
@@ -1404,15 +1797,19 @@ shutdownDvr (DvrInfo *dp, int restart)
     free (dp->sprops);
     free(dp->dev);
     delLilXML (dp->lp);
+    frameFree (&dp->fb);
+    dp->askframes = dp->rframed = dp->wframed = dp->wpending = 0;
 
    /* ok now to recycle */
    dp->active = 0;
    dp->ndev = 0;
 
     /* decrement and possibly free any unsent messages for this client */
-    while ((mp = (Msg*) popFQ(dp->msgq)) != NULL)
+    while ((mp = (Msg*) popFQ(dp->msgq)) != NULL) {
+        dropStats (&dp->stats, mp);
         if (--mp->count == 0)
         freeMsg (mp);
+    }
     delFQ (dp->msgq);
 
         if (restart)
@@ -1440,6 +1837,7 @@ static void
 q2RDrivers (const char *dev, Msg *mp, XMLEle *root)
 {
     int sawremote = 0;
+    int ql;
     DvrInfo *dp;
 
     /* queue message to each interested driver.
@@ -1459,7 +1857,12 @@ q2RDrivers (const char *dev, Msg *mp, XMLEle *root)
         sawremote = 1;
 
         /* ok: queue message to this driver */
+        ql = msgQSize(dp->msgq);
+        if (ql > dp->stats.maxqbytes)
+            dp->stats.maxqbytes = ql;
         mp->count++;
+        if (dp->wframed || dp->wpending)
+            mp->nframed++;
         pushFQ (dp->msgq, mp);
         if (verbose > 1)
         fprintf (stderr, "%s: Driver %s: queuing responsible for <%s device='%s' name='%s'>\n",
@@ -1476,6 +1879,7 @@ static void
 q2SDrivers (int isblob, const char *dev, const char *name, Msg *mp, XMLEle *root)
 {
     DvrInfo *dp;
+    int ql;
 
     for (dp = dvrinfo; dp < &dvrinfo[ndvrinfo]; dp++) {
             Property *sp = findSDevice (dp, dev, name);
@@ -1487,7 +1891,12 @@ q2SDrivers (int isblob, const char *dev, const char *name, Msg *mp, XMLEle *root
         continue;
 
         /* ok: queue message to this device */
+        ql = msgQSize(dp->msgq);
+        if (ql > dp->stats.maxqbytes)
+            dp->stats.maxqbytes = ql;
         mp->count++;
+        if (dp->wframed || dp->wpending)
+            mp->nframed++;
         pushFQ (dp->msgq, mp);
         if (verbose > 1) {
         fprintf (stderr, "%s: Driver %s: queuing snooped <%s device='%s' name='%s'>\n",
@@ -1598,10 +2007,14 @@ q2Clients (ClInfo *notme, int isblob, const char *dev, const char *name, Msg *mp
 
         /* shut down this client if its q is already too large */
         ql = msgQSize(cp->msgq);
+        if (ql > cp->stats.maxqbytes)
+            cp->stats.maxqbytes = ql;
         if (ql > maxqsiz) {
         if (verbose)
             fprintf (stderr, "%s: Client %d: %d bytes behind, shutting down\n",
                             indi_tstamp(NULL), cp->s, ql);
+        nslowclients++;
+        strcpy (lastslow, cp->peer);
         shutdownClient (cp);
         shutany++;
         continue;
@@ -1609,6 +2022,8 @@ q2Clients (ClInfo *notme, int isblob, const char *dev, const char *name, Msg *mp
 
         /* ok: queue message to this client */
         mp->count++;
+        if (cp->wframed || cp->wpending)
+            mp->nframed++;
         pushFQ (cp->msgq, mp);
         if (verbose > 1)
         fprintf (stderr, "%s: Client %d: queuing <%s device='%s' name='%s'>\n",
@@ -1626,6 +2041,7 @@ q2Clients (ClInfo *notme, int isblob, const char *dev, const char *name, Msg *mp
 static int
 q2Servers (ClInfo *notme, Msg *mp, XMLEle *root)
 {
+    const char *dev = findXMLAttValu (root, "device");
     int shutany = 0;
     ClInfo *cp;
     int ql=0;
@@ -1637,13 +2053,21 @@ q2Servers (ClInfo *notme, Msg *mp, XMLEle *root)
         if (!cp->active || cp == notme || cp->allprops == 1)
             continue;
 
+        /* framed chained servers list their devices, skip those without dev */
+        if (cp->rframed && cp->havepeerdevs && dev[0] && !peerHasDevice (cp, dev))
+            continue;
+
         /* shut down this client if its q is already too large */
         ql = msgQSize(cp->msgq);
+        if (ql > cp->stats.maxqbytes)
+            cp->stats.maxqbytes = ql;
         if (ql > maxqsiz)
         {
         if (verbose)
             fprintf (stderr, "%s: Client %d: %d bytes behind, shutting down\n",
                             indi_tstamp(NULL), cp->s, ql);
+        nslowclients++;
+        strcpy (lastslow, cp->peer);
         shutdownClient (cp);
         shutany++;
         continue;
@@ -1651,6 +2075,8 @@ q2Servers (ClInfo *notme, Msg *mp, XMLEle *root)
 
         /* ok: queue message to this client */
         mp->count++;
+        if (cp->wframed || cp->wpending)
+            mp->nframed++;
         pushFQ (cp->msgq, mp);
         if (verbose > 1)
         fprintf (stderr, "%s: Client %d: queuing <%s device='%s' name='%s'>\n",
@@ -1662,6 +2088,252 @@ q2Servers (ClInfo *notme, Msg *mp, XMLEle *root)
     return (shutany ? -1 : 0);
 }
 
+/* server to server framed transport.
+ *
+ * A server chaining a remote device asks for it by adding framed='1' to its
+ * first getProperties. A server that supports it queues
+ * <framedTransport version='1'/> to that client and sends frames right after
+ * its closing '>'. The requesting server answers with the same element and does likewise
+ * in the other direction. The frame layout is described in indiframe.c.
+ * Messages are routed on the frame header without parsing, BLOBs travel as
+ * raw bytes and the base64 text is only built again when a message reaches
+ * an XML client. F_DEVICES frames list the devices served through the
+ * requesting server so chained servers only forward the getProperties of
+ * snooping drivers to the peers that may answer them.
+ */
+
+/* add the F_XML framing of the XML content of Msg mp */
+static void
+frameStr (Msg *mp, const char *tag, const char *dev, const char *name)
+{
+    unsigned char *p = newFrame (&mp->fcp, &mp->fcl, F_XML, tag, dev, name,
+                                                                    mp->cl);
+
+    memcpy (p, mp->cp, mp->cl);
+}
+
+/* build the framed content of Msg mp from root */
+static void
+frameFromXML (Msg *mp, XMLEle *root)
+{
+    const char *tag = tagXMLEle (root);
+    unsigned char *p;
+
+    if ((!strcmp (tag, "setBLOBVector") || !strcmp (tag, "newBLOBVector")) &&
+                                        frameBLOB (root, &mp->fcp, &mp->fcl) == 0)
+        return;
+
+    /* anything else travels as XML text */
+    if (!mp->cp)
+        setMsgXMLEle (mp, root);
+    p = newFrame (&mp->fcp, &mp->fcl, F_XML, tag, findXMLAttValu (root, "device"),
+                                findXMLAttValu (root, "name"), mp->cl);
+    memcpy (p, mp->cp, mp->cl);
+}
+
+/* build the XML content of Msg mp from frame f */
+static void
+xmlFromFrame (Msg *mp, Frame *f)
+{
+    if (f->type != F_BLOB) {
+        mp->cl = f->plen;
+        mp->cp = mp->cl < sizeof(mp->buf) ? mp->buf : malloc (mp->cl+1);
+        memcpy (mp->cp, f->payload, f->plen);
+        mp->cp[mp->cl] = '\0';
+        return;
+    }
+
+    mp->cp = frameBLOBXML (f, &mp->cl);
+}
+
+/* set the content of Msg mp for its consumers: XML for those that read XML,
+ * framed for framed peers. root is the message, f its frame if it arrived
+ * framed.
+ */
+static void
+setMsgContent (Msg *mp, XMLEle *root, Frame *f)
+{
+    if (f) {
+        if (mp->nframed > 0) {
+            mp->fcl = f->len;
+            mp->fcp = malloc (f->len);
+            memcpy (mp->fcp, f->data, f->len);
+        }
+        if (mp->count > mp->nframed)
+            xmlFromFrame (mp, f);
+    } else {
+        if (mp->count > mp->nframed)
+            setMsgXMLEle (mp, root);
+        if (mp->nframed > 0)
+            frameFromXML (mp, root);
+    }
+}
+
+/* largest frame payload accepted: no client could queue a larger one */
+static unsigned long
+maxFrame (void)
+{
+    return (maxqsiz > MAXFRAME ? maxqsiz : MAXFRAME);
+}
+
+/* queue the switch to framed transport on q */
+static void
+queueFramedTransport (FQ *q)
+{
+    char buf[MAXSBUF];
+    Msg *mp = newMsg();
+
+    snprintf (buf, sizeof(buf), "<framedTransport version='%d'/>",
+                                                            FRAMEVERSION);
+    setMsgStr (mp, buf);
+    mp->frameswitch = 1;
+    mp->count++;
+    pushFQ (q, mp);
+}
+
+/* tell each framed chained server which devices may be reached through us:
+ * those of all our drivers but the ones it serves itself.
+ */
+static void
+announceDevices (void)
+{
+    DvrInfo *dp, *op;
+    int i;
+
+    for (dp = dvrinfo; dp < &dvrinfo[ndvrinfo]; dp++) {
+        unsigned long plen = 0;
+        unsigned char *p;
+        Msg *mp;
+
+        if (!dp->active || dp->pid != REMOTEDVR || !(dp->wframed || dp->wpending))
+            continue;
+
+        for (op = dvrinfo; op < &dvrinfo[ndvrinfo]; op++)
+            if (op != dp && op->active)
+                for (i = 0; i < op->ndev; i++)
+                    plen += strlen (op->dev[i]) + 1;
+
+        mp = newMsg();
+        p = newFrame (&mp->fcp, &mp->fcl, F_DEVICES, "devices", "", "", plen);
+        for (op = dvrinfo; op < &dvrinfo[ndvrinfo]; op++)
+            if (op != dp && op->active)
+                for (i = 0; i < op->ndev; i++) {
+                    int l = strlen (op->dev[i]);
+                    memcpy (p, op->dev[i], l);
+                    p[l] = '\n';
+                    p += l+1;
+                }
+
+        mp->count++;
+        mp->nframed++;
+        pushFQ (dp->msgq, mp);
+    }
+}
+
+/* return 1 if dev is in the device list of chained server cp, else 0 */
+static int
+peerHasDevice (ClInfo *cp, const char *dev)
+{
+    int i;
+
+    for (i = 0; i < cp->npeerdevs; i++)
+        if (!strcmp (cp->peerdevs[i], dev))
+            return (1);
+
+    return (0);
+}
+
+/* record the device list in F_DEVICES frame f from chained server cp, and
+ * forward to it the snoop requests of our drivers for its new devices.
+ */
+static void
+setPeerDevices (ClInfo *cp, Frame *f)
+{
+    char **old = cp->peerdevs;
+    int nold = cp->npeerdevs;
+    int hadlist = cp->havepeerdevs;
+    const char *s = (const char *)f->payload, *e = s + f->plen;
+    DvrInfo *dp;
+    int i;
+
+    cp->peerdevs = NULL;
+    cp->npeerdevs = 0;
+    cp->havepeerdevs = 1;
+
+    while (s < e) {
+        const char *nl = memchr (s, '\n', e - s);
+        int l = (nl ? nl : e) - s;
+
+        if (l > 0) {
+            cp->peerdevs = (char **) realloc (cp->peerdevs,
+                                        (cp->npeerdevs+1)*sizeof(char *));
+            cp->peerdevs[cp->npeerdevs] = malloc (l+1);
+            memcpy (cp->peerdevs[cp->npeerdevs], s, l);
+            cp->peerdevs[cp->npeerdevs++][l] = '\0';
+        }
+        s += l + 1;
+    }
+
+    if (verbose > 0)
+        fprintf (stderr, "%s: Client %d: chained server has %d devices\n",
+                            indi_tstamp(NULL), cp->s, cp->npeerdevs);
+
+    /* requests held back while the device was not listed. before the first
+     * list everything was forwarded.
+     */
+    for (dp = dvrinfo; hadlist && dp < &dvrinfo[ndvrinfo]; dp++) {
+        if (!dp->active)
+            continue;
+        for (i = 0; i < dp->nsprops; i++) {
+            Property *sp = &dp->sprops[i];
+            int j, known = 0;
+            char buf[MAXSBUF];
+            Msg *mp;
+
+            if (!peerHasDevice (cp, sp->dev))
+                continue;
+            for (j = 0; j < nold; j++)
+                if (!strcmp (old[j], sp->dev))
+                    known = 1;
+            if (known)
+                continue;
+
+            if (sp->name[0])
+                snprintf (buf, sizeof(buf),
+                            "<getProperties version='%g' device='%s' name='%s'/>\n",
+                            INDIV, sp->dev, sp->name);
+            else
+                snprintf (buf, sizeof(buf),
+                            "<getProperties version='%g' device='%s'/>\n",
+                            INDIV, sp->dev);
+            mp = newMsg();
+            setMsgStr (mp, buf);
+            frameStr (mp, "getProperties", sp->dev, sp->name);
+            mp->count++;
+            mp->nframed++;
+            pushFQ (cp->msgq, mp);
+        }
+    }
+
+    for (i = 0; i < nold; i++)
+        free (old[i]);
+    free (old);
+}
+
+/* release the device list of cp */
+static void
+freePeerDevices (ClInfo *cp)
+{
+    int i;
+
+    for (i = 0; i < cp->npeerdevs; i++)
+        free (cp->peerdevs[i]);
+    free (cp->peerdevs);
+    cp->peerdevs = NULL;
+    cp->npeerdevs = 0;
+    cp->havepeerdevs = 0;
+}
+
 /* return size of all Msqs on the given q */
 static int
 msgQSize (FQ *q)
@@ -1670,12 +2342,52 @@ msgQSize (FQ *q)
 
     for (i = 0; i < nFQ(q); i++) {
         Msg *mp = (Msg *) peekiFQ(q,i);
-        l += mp->cl;
+        l += mp->cl > mp->fcl ? mp->cl : mp->fcl;
     }
 
     return (l);
 }
 
+/* count nw more bytes of Msg mp sent, and the message if done */
+static void
+sentStats (Stats *sp, Msg *mp, ssize_t nw, int done)
+{
+    sp->nbyteout += nw;
+    if (!done)
+        return;
+
+    sp->nmsgout++;
+    if (mp->blob)
+        sp->nblobout++;
+
+    double wait = monoTime() - mp->queued;
+    if (wait > sp->maxqwait)
+        sp->maxqwait = wait;
+}
+
+/* count Msg mp discarded from a queue */
+static void
+dropStats (Stats *sp, Msg *mp)
+{
+    sp->ndropped++;
+    ndropped++;
+    nbytedropped += mp->cl > mp->fcl ? mp->cl : mp->fcl;
+    if (mp->blob) {
+        sp->nblobdropped++;
+        nblobdropped++;
+    }
+}
+
+/* return monotonic time in seconds */
+static double
+monoTime (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec/1e9);
+}
+
 /* print root as content in Msg mp.
  */
 static void
@@ -1704,12 +2416,36 @@ setMsgStr (Msg *mp, char *str)
     strcpy (mp->cp, str);
 }
 
+/* add the server stamp to the trace attribute of BLOB root, if any, and
+ * remember when Msg mp was queued.
+ */
+static void
+traceBLOB (Msg *mp, XMLEle *root)
+{
+    XMLAtt *ap = findXMLAtt (root, INDI_TRACE_ATTR);
+    char trace[INDI_TRACE_MAXLEN];
+
+    if (!ap)
+        return;
+
+    strncpy (trace, valuXMLAtt(ap), sizeof(trace)-1);
+    trace[sizeof(trace)-1] = '\0';
+
+    mp->traced = indi_trace_now();
+    indi_trace_stamp (trace, sizeof(trace), "srv", mp->traced);
+    indi_trace_record_span ("server_read", trace, "drv", "srv");
+    editXMLAtt (ap, trace);
+}
+
 /* return pointer to one new nulled Msg
  */
 static Msg *
 newMsg (void)
 {
-    return ((Msg *) calloc (1, sizeof(Msg)));
+    Msg *mp = (Msg *) calloc (1, sizeof(Msg));
+
+    mp->queued = monoTime();
+    return (mp);
 }
 
 /* free Msg mp and everything it contains */
@@ -1718,6 +2454,7 @@ freeMsg (Msg *mp)
 {
     if (mp->cp && mp->cp != mp->buf)
         free (mp->cp);
+    free (mp->fcp);
     free (mp);
 }
 
@@ -1731,16 +2468,20 @@ static int
 sendClientMsg (ClInfo *cp)
 {
     ssize_t nsend, nw;
+    unsigned long cl;
+    char *content;
     Msg *mp;
 
-    /* get current message */
+    /* get current message, framed once we switched to frames */
     mp = (Msg *) peekFQ (cp->msgq);
+    cl = cp->wframed ? mp->fcl : mp->cl;
+    content = cp->wframed ? mp->fcp : mp->cp;
 
     /* send next chunk, never more than MAXWSIZ to reduce blocking */
-    nsend = mp->cl - cp->nsent;
+    nsend = cl - cp->nsent;
     if (nsend > MAXWSIZ)
         nsend = MAXWSIZ;
-    nw = write (cp->s, &mp->cp[cp->nsent], nsend);
+    nw = write (cp->s, &content[cp->nsent], nsend);
 
     /* shut down if trouble */
     if (nw <= 0) {
@@ -1754,8 +2495,11 @@ sendClientMsg (ClInfo *cp)
         return (-1);
     }
 
-    /* trace */
-    if (verbose > 2) {
+    /* trace, frames are binary */
+    if (verbose > 1 && cp->wframed) {
+        fprintf(stderr, "%s: Client %d: sending frame <%s> %ld of %lu bytes\n",
+                indi_tstamp(NULL), cp->s, mp->fcp + FRAMEHDR, (long)nw, cl);
+    } else if (verbose > 2) {
         fprintf(stderr, "%s: Client %d: sending msg copy %d nq %d:\n%.*s\n",
                 indi_tstamp(NULL), cp->s, mp->count, nFQ(cp->msgq),
                 (int)nw, &mp->cp[cp->nsent]);
@@ -1768,7 +2512,14 @@ sendClientMsg (ClInfo *cp)
      * to use it and pop from our queue.
      */
     cp->nsent += nw;
-    if (cp->nsent == mp->cl) {
+    sentStats (&cp->stats, mp, nw, cp->nsent == cl);
+    if (cp->nsent == cl) {
+        if (mp->frameswitch) {
+            cp->wframed = 1;
+            cp->wpending = 0;
+        }
+        if (mp->traced)
+            indi_trace_record ("server_send", indi_trace_now() - mp->traced);
         if (--mp->count == 0)
         freeMsg (mp);
         popFQ (cp->msgq);
@@ -1788,16 +2539,20 @@ static int
 sendDriverMsg (DvrInfo *dp)
 {
     ssize_t nsend, nw;
+    unsigned long cl;
+    char *content;
     Msg *mp;
 
-    /* get current message */
+    /* get current message, framed once we switched to frames */
     mp = (Msg *) peekFQ (dp->msgq);
+    cl = dp->wframed ? mp->fcl : mp->cl;
+    content = dp->wframed ? mp->fcp : mp->cp;
 
     /* send next chunk, never more than MAXWSIZ to reduce blocking */
-    nsend = mp->cl - dp->nsent;
+    nsend = cl - dp->nsent;
     if (nsend > MAXWSIZ)
         nsend = MAXWSIZ;
-    nw = write (dp->wfd, &mp->cp[dp->nsent], nsend);
+    nw = write (dp->wfd, &content[dp->nsent], nsend);
 
     /* restart if trouble */
     if (nw <= 0) {
@@ -1811,8 +2566,11 @@ sendDriverMsg (DvrInfo *dp)
         return (-1);
     }
 
-    /* trace */
-    if (verbose > 2) {
+    /* trace, frames are binary */
+    if (verbose > 1 && dp->wframed) {
+        fprintf(stderr, "%s: Driver %s: sending frame <%s> %ld of %lu bytes\n",
+                indi_tstamp(NULL), dp->name, mp->fcp + FRAMEHDR, (long)nw, cl);
+    } else if (verbose > 2) {
         fprintf(stderr, "%s: Driver %s: sending msg copy %d nq %d:\n%.*s\n",
                 indi_tstamp(NULL), dp->name, mp->count, nFQ(dp->msgq),
                 (int)nw, &mp->cp[dp->nsent]);
@@ -1825,7 +2583,12 @@ sendDriverMsg (DvrInfo *dp)
      * to use it and pop from our queue.
      */
     dp->nsent += nw;
-    if (dp->nsent == mp->cl) {
+    sentStats (&dp->stats, mp, nw, dp->nsent == cl);
+    if (dp->nsent == cl) {
+        if (mp->frameswitch) {
+            dp->wframed = 1;
+            dp->wpending = 0;
+        }
         if (--mp->count == 0)
         freeMsg (mp);
         popFQ (dp->msgq);
@@ -25,24 +25,103 @@
 #include <netinet/in.h>
 #include <netdb.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <locale.h>
 #include <pthread.h>
 
 #include "baseclient.h"
 #include "basedevice.h"
+#include "clientreactor.h"
+#include "blobstream.h"
 #include "indicom.h"
+#include "inditrace.h"
 
 #include <errno.h>
 
 #define MAXINDIBUF 49152
+#define MAXREADS   4            /* reads per readiness notification before yielding to other connections */
+#define CLOSEFLUSH_MS 1000      /* longest wait for queued commands to be written when disconnecting */
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* append str to out with XML entities escaped */
+static void appendXML(std::string & out, const char *str)
+{
+    for (const char *s = str; *s; s++)
+    {
+        switch (*s)
+        {
+        case '&':  out += "&amp;"; break;
+        case '<':  out += "&lt;"; break;
+        case '>':  out += "&gt;"; break;
+        case '\'': out += "&apos;"; break;
+        case '"':  out += "&quot;"; break;
+        default:   out += *s; break;
+        }
+    }
+}
+
+/* append value formatted as %g, always with a '.' decimal point whatever the locale */
+static void appendNumber(std::string & out, double value)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%g", value);
+
+    const char *dp = localeconv()->decimal_point;
+    if (dp[0] != '.' || dp[1] != '\0')
+    {
+        char *p = strstr(buf, dp);
+        if (p)
+        {
+            *p = '.';
+            memmove(p+1, p+strlen(dp), strlen(p+strlen(dp))+1);
+        }
+    }
+
+    out += buf;
+}
+
+/* opening tag of a new*Vector command */
+static void appendVectorTag(std::string & out, const char *tag, const char *device, const char *name)
+{
+    out += "<";
+    out += tag;
+    out += "\n  device='";
+    appendXML(out, device);
+    out += "'\n  name='";
+    appendXML(out, name);
+    out += "'\n>";
+}
+
+static std::string callbackKey(const char *device, const char *name)
+{
+    std::string key(device);
+    key += '\n';
+    key += name;
+    return key;
+}
 
 INDI::BaseClient::BaseClient()
 {
     cServer = "localhost";
     cPort   = 7624;
-    svrwfp = NULL;
     sConnected = false;
     verbose = false;
+    reactor = NULL;
+    sockfd = -1;
+    wOffset = 0;
+    lillp = NULL;
+
+    pthread_mutex_init(&wLock, NULL);
+    pthread_mutex_init(&pLock, NULL);
+    pthread_mutex_init(&sLock, NULL);
+
+    blobParser = new INDI::BLOBStreamParser(
+                std::bind(&INDI::BaseClient::findBLOBSink, this, std::placeholders::_1, std::placeholders::_2,
+                          std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6),
+                std::bind(&INDI::BaseClient::newBLOB, this, std::placeholders::_1));
 
     timeout_sec=3;
     timeout_us=0;
@@ -52,8 +131,15 @@ INDI::BaseClient::BaseClient()
 
 INDI::BaseClient::~BaseClient()
 {
-    // close(m_sendFd);
-    // close(m_receiveFd);
+    // The reactor must not call into a destroyed client
+    if (closeSocket())
+        completeCallbacks(NULL, NULL, IPS_ALERT);
+
+    delete blobParser;
+
+    pthread_mutex_destroy(&sLock);
+    pthread_mutex_destroy(&pLock);
+    pthread_mutex_destroy(&wLock);
 }
 
 
@@ -77,7 +163,6 @@ bool INDI::BaseClient::connectServer()
 
     struct sockaddr_in serv_addr;
     struct hostent *hp;
-    int pipefd[2];
     int ret = 0;
 
     /* lookup host address */
@@ -163,39 +248,58 @@ bool INDI::BaseClient::connectServer()
         return false;
     }
 
-    /* prepare for line-oriented i/o with client */
-    svrwfp = fdopen (sockfd, "w");
+    lillp = newLilXML();
 
-    if (svrwfp == NULL)
-    {
-        perror("fdopen");
-        return false;
-    }
+    pthread_mutex_lock(&wLock);
+    wBuf.clear();
+    wOffset = 0;
+    sConnected = true;
+    pthread_mutex_unlock(&wLock);
 
-    ret = socketpair(PF_UNIX,SOCK_STREAM,0,pipefd);
+    if (reactor == NULL)
+        reactor = INDI::ClientReactor::getDefault();
 
-    if (ret < 0)
+    // Watch the socket before anything is sent so the rest of a partial write gets flushed
+    if (reactor->addFD(sockfd, &INDI::BaseClient::ioHelper, this) == false)
     {
-        IDLog("notify pipe: %s\n", strerror(errno));
+        pthread_mutex_lock(&wLock);
+        sConnected = false;
+        pthread_mutex_unlock(&wLock);
+        close(sockfd);
+        sockfd = -1;
+        delLilXML(lillp);
+        lillp = NULL;
         return false;
     }
 
-    m_receiveFd = pipefd[0];
-    m_sendFd = pipefd[1];
-
-    sConnected = true;
-
-    int result = pthread_create( &listen_thread, NULL, &INDI::BaseClient::listenHelper, this);
+    // Notify before asking for properties, so serverConnected() comes before any newDevice()
+    serverConnected();
 
-    if (result != 0)
+    /* ask for properties */
+    std::string msg;
+    if (cDeviceNames.empty())
     {
-        sConnected = false;
-        perror("thread");
-        return false;
+        msg += "<getProperties version='";
+        appendNumber(msg, INDIV);
+        msg += "'/>\n";
+    }
+    else
+    {
+        vector<string>::const_iterator stri;
+        for ( stri = cDeviceNames.begin(); stri != cDeviceNames.end(); stri++)
+        {
+            msg += "<getProperties version='";
+            appendNumber(msg, INDIV);
+            msg += "' device='";
+            appendXML(msg, (*stri).c_str());
+            msg += "'/>\n";
+        }
     }
 
+    if (verbose)
+        fputs(msg.c_str(), stderr);
 
-    serverConnected();
+    sendMessage(msg);
 
     return true;
 }
@@ -203,23 +307,84 @@ bool INDI::BaseClient::connectServer()
 bool INDI::BaseClient::disconnectServer()
 {
     //IDLog("Server disconnected called\n");
-    if (sConnected == false)
+    if (closeSocket() == false)
         return true;
 
+    cDevices.clear();
+    cDeviceNames.clear();
+
+    completeCallbacks(NULL, NULL, IPS_ALERT);
+
+    serverDisconnected(0);
+
+    return true;
+}
+
+void * INDI::BaseClient::listenHelper(void *context)
+{
+    INDI::BaseClient *client = static_cast<INDI::BaseClient *> (context);
+
+    // The reactor reads from the server, only wait for the connection to close as the listener thread did
+    for (;;)
+    {
+        pthread_mutex_lock(&client->wLock);
+        bool connected = client->sConnected;
+        pthread_mutex_unlock(&client->wLock);
+
+        if (connected == false)
+            break;
+
+        usleep(100000);
+    }
+
+    return NULL;
+}
+
+bool INDI::BaseClient::closeSocket()
+{
+    pthread_mutex_lock(&wLock);
+    if (sConnected == false)
+    {
+        pthread_mutex_unlock(&wLock);
+        return false;
+    }
     sConnected = false;
+    pthread_mutex_unlock(&wLock);
 
-    shutdown(sockfd, SHUT_RDWR);
+    // Returns once a running readINDI/writeINDI of this client is done, unless called from within one
+    reactor->removeFD(sockfd);
 
-    while (write(m_sendFd,"1",1) <= 0)
+    pthread_mutex_lock(&wLock);
 
-        if (svrwfp != NULL)
-            fclose(svrwfp);
-    svrwfp = NULL;
+    // Give commands queued just before disconnecting a bounded time to reach the server
+    for (int waited=0; wOffset < wBuf.size() && waited < CLOSEFLUSH_MS; waited += 10)
+    {
+        if (flushLocked() == false)
+            break;
+        if (wOffset < wBuf.size())
+        {
+            struct pollfd pfd;
+            pfd.fd = sockfd;
+            pfd.events = POLLOUT;
+            poll(&pfd, 1, 10);
+        }
+    }
 
-    cDevices.clear();
-    cDeviceNames.clear();
+    if (wOffset < wBuf.size())
+        IDLog("INDI::BaseClient: %lu bytes of commands to %s/%d were dropped on disconnect.\n",
+              (unsigned long) (wBuf.size() - wOffset), cServer.c_str(), cPort);
 
-    pthread_join(listen_thread, NULL);
+    close(sockfd);
+    sockfd = -1;
+    wBuf.clear();
+    wOffset = 0;
+    pthread_mutex_unlock(&wLock);
+
+    delLilXML(lillp);
+    lillp = NULL;
+
+    // Abort a BLOB in progress, the next connection starts with a new stream
+    blobParser->reset();
 
     return true;
 }
@@ -292,140 +457,247 @@ INDI::BaseDevice * INDI::BaseClient::getDevice(const char * deviceName)
     return NULL;
 }
 
-void * INDI::BaseClient::listenHelper(void *context)
+void INDI::BaseClient::ioHelper(int fd, int events, void *context)
 {
-    (static_cast<INDI::BaseClient *> (context))->listenINDI();
-    return NULL;
+    INDI::BaseClient *client = static_cast<INDI::BaseClient *> (context);
+
+    if (events & INDI::ClientReactor::REACTOR_WRITE)
+        client->writeINDI();
+
+    if (events & INDI::ClientReactor::REACTOR_READ)
+        client->readINDI();
 }
 
-void INDI::BaseClient::listenINDI()
+void INDI::BaseClient::readINDI()
 {
     char buffer[MAXINDIBUF];
+    int n=0;
+
+    // Level triggered, data left after MAXREADS reads is picked up on the next round
+    for (int reads=0; reads < MAXREADS; reads++)
+    {
+        if (sConnected == false)
+            return;
+
+        n = recv(sockfd, buffer, MAXINDIBUF, MSG_DONTWAIT);
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return;
+
+        if (n <= 0)
+        {
+            fprintf (stderr,"INDI server %s/%d disconnected.\n", cServer.c_str(), cPort);
+            break;
+        }
+
+        pthread_mutex_lock(&sLock);
+        bool streaming = !blobSinks.empty();
+        pthread_mutex_unlock(&sLock);
+
+        bool ok = true;
+
+        // Keep feeding the parser after the last sink is removed until the streamed element is complete
+        if (streaming || blobParser->isIdle() == false)
+        {
+            for (int offset=0; ok && offset < n && sConnected; )
+            {
+                blobXML.clear();
+                offset += blobParser->process(buffer + offset, n - offset, blobXML);
+                if (!blobXML.empty())
+                    ok = parseINDI(blobXML.data(), blobXML.size());
+            }
+        }
+        else
+        {
+            blobParser->reset();
+            ok = parseINDI(buffer, n);
+        }
+
+        if (!ok)
+            break;
+
+        // Short read, the socket is drained
+        if (n < MAXINDIBUF || reads == MAXREADS-1)
+            return;
+    }
+
+    if (closeSocket() == false)
+        return;
+
+    completeCallbacks(NULL, NULL, IPS_ALERT);
+
+    serverDisconnected(-1);
+}
+
+bool INDI::BaseClient::parseINDI(const char *buf, int len)
+{
     char msg[MAXRBUF];
+    int err_code=0;
 
-    int n=0, err_code=0;
-    int maxfd=0;
-    fd_set rs;
-    
     XMLEle **nodes;
     XMLEle *root;
-    int inode=0;
-    
-    char *orig = setlocale(LC_NUMERIC,"C");
-    if (cDeviceNames.empty())
+
+    // A notification may have disconnected the client
+    if (sConnected == false)
+        return true;
+
+    nodes=parseXMLChunk(lillp, const_cast<char *> (buf), len, msg);
+
+    if (!nodes)
     {
-        fprintf(svrwfp, "<getProperties version='%g'/>\n", INDIV);
-        if (verbose)
-            fprintf(stderr, "<getProperties version='%g'/>\n", INDIV);
+        if (msg[0])
+            fprintf (stderr, "Bad XML from %s/%d: %s\n%.*s\n", cServer.c_str(), cPort, msg, len, buf);
+        return false;
     }
-    else
+
+    for (int inode=0; (root = nodes[inode]) != NULL; inode++)
     {
-        vector<string>::const_iterator stri;
-        for ( stri = cDeviceNames.begin(); stri != cDeviceNames.end(); stri++)
+        // A notification may have disconnected the client, discard the rest of the chunk
+        if (sConnected)
         {
-            fprintf(svrwfp, "<getProperties version='%g' device='%s'/>\n", INDIV, (*stri).c_str());
             if (verbose)
-                fprintf(stderr, "<getProperties version='%g' device='%s'/>\n", INDIV, (*stri).c_str());
-        }
-    }
-    setlocale(LC_NUMERIC,orig);
+                prXMLEle(stderr, root, 0);
 
-    fflush (svrwfp);
+            if ( (err_code = dispatchCommand(root, msg)) < 0)
+            {
+                // Silenty ignore property duplication errors
+                if (err_code != INDI_PROPERTY_DUPLICATED)
+                {
+                    IDLog("Dispatch command error(%d): %s\n", err_code, msg);
+                    prXMLEle (stderr, root, 0);
+                }
+            }
+        }
 
-    FD_ZERO(&rs);
+        delXMLEle (root);
+    }
+    free(nodes);
 
-    FD_SET(sockfd, &rs);
-    if (sockfd > maxfd)
-        maxfd = sockfd;
+    return true;
+}
 
-    FD_SET(m_receiveFd, &rs);
-    if (m_receiveFd > maxfd)
-        maxfd = m_receiveFd;
+void INDI::BaseClient::writeINDI()
+{
+    pthread_mutex_lock(&wLock);
 
+    if (sConnected && flushLocked() && wOffset == wBuf.size())
+        reactor->setWritable(sockfd, false);
 
-    lillp = newLilXML();
+    pthread_mutex_unlock(&wLock);
+}
 
-    /* read from server, exit if find all requested properties */
-    while (sConnected)
+bool INDI::BaseClient::flushLocked()
+{
+    while (wOffset < wBuf.size())
     {
-
-        n = select (maxfd+1, &rs, NULL, NULL, NULL);
+        ssize_t n = send(sockfd, wBuf.data() + wOffset, wBuf.size() - wOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
 
         if (n < 0)
         {
-            fprintf (stderr,"INDI server %s/%d disconnected.\n", cServer.c_str(), cPort);
-            close(sockfd);
-            break;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == EINTR)
+                continue;
+
+            // Let the reactor see the failure as end of stream and tear the connection down
+            IDLog("INDI::BaseClient: write to %s/%d failed: %s\n", cServer.c_str(), cPort, strerror(errno));
+            shutdown(sockfd, SHUT_RDWR);
+            return false;
         }
 
-        // Received terminiation string from main thread
-        if (n > 0 && FD_ISSET(m_receiveFd, &rs))
-        {
-            sConnected = false;
-            break;
-        }
+        wOffset += n;
+    }
 
+    if (wOffset == wBuf.size())
+    {
+        wBuf.clear();
+        wOffset = 0;
+    }
+    // Do not let a slow server grow the buffer by its already written head
+    else if (wOffset > MAXINDIBUF && wOffset > wBuf.size() / 2)
+    {
+        wBuf.erase(0, wOffset);
+        wOffset = 0;
+    }
 
-        if (n > 0 && FD_ISSET(sockfd, &rs))
-        {
-            n = recv(sockfd, buffer, MAXINDIBUF, MSG_DONTWAIT);
-            if (n<=0)
-            {
+    return true;
+}
 
-                if (n==0)
-                {
-                    fprintf (stderr,"INDI server %s/%d disconnected.\n", cServer.c_str(), cPort);
-                    close(sockfd);
-                    break;
-                }
-                else
-                    continue;
-            }
+bool INDI::BaseClient::sendMessage(const std::string & msg, const char *device, const char *name, SendCallback callback)
+{
+    pthread_mutex_lock(&wLock);
+
+    if (sConnected == false)
+    {
+        pthread_mutex_unlock(&wLock);
+        if (callback)
+            callback(IPS_ALERT);
+        return false;
+    }
 
+    // Register the callback before the command can reach the driver
+    if (callback)
+    {
+        pthread_mutex_lock(&pLock);
+        pendingCallbacks.insert(std::make_pair(callbackKey(device, name), callback));
+        pthread_mutex_unlock(&pLock);
+    }
 
-            nodes=parseXMLChunk(lillp, buffer, n, msg);
+    bool idle = (wOffset == wBuf.size());
+    wBuf += msg;
 
-            if (!nodes) {
-                if (msg[0])
-                {
-                    fprintf (stderr, "Bad XML from %s/%d: %s\n%s\n", cServer.c_str(), cPort, msg, buffer);
-                    return;
-                }
-                return;
-            }
-            root=nodes[inode];
-            while (root)
-            {
-                if (verbose)
-                    prXMLEle(stderr, root, 0);
+    // Write directly if nothing is queued, otherwise keep the order and let the reactor write it
+    if (idle && flushLocked() && wOffset < wBuf.size())
+        reactor->setWritable(sockfd, true);
 
-                if ( (err_code = dispatchCommand(root, msg)) < 0)
-                {
-                    // Silenty ignore property duplication errors
-                    if (err_code != INDI_PROPERTY_DUPLICATED)
-                    {
-                        IDLog("Dispatch command error(%d): %s\n", err_code, msg);
-                        prXMLEle (stderr, root, 0);
-                    }
-                }
+    pthread_mutex_unlock(&wLock);
 
+    return true;
+}
 
-                delXMLEle (root);	// not yet, delete and continue
-                inode++; root=nodes[inode];
-            }
-            free(nodes);
-            inode=0;
-        }
+size_t INDI::BaseClient::getPendingBytes()
+{
+    pthread_mutex_lock(&wLock);
+    size_t pending = wBuf.size() - wOffset;
+    pthread_mutex_unlock(&wLock);
+    return pending;
+}
 
-    }
+void INDI::BaseClient::completeCallbacks(const char *device, const char *name, IPState state)
+{
+    std::vector<SendCallback> ready;
 
-    delLilXML(lillp);
+    pthread_mutex_lock(&pLock);
 
-    serverDisconnected( (sConnected == false) ? 0 : -1);
-    sConnected = false;
+    if (pendingCallbacks.empty())
+    {
+        pthread_mutex_unlock(&pLock);
+        return;
+    }
 
-    pthread_exit(0);
+    if (device == NULL)
+    {
+        for (std::multimap<std::string, SendCallback>::iterator it = pendingCallbacks.begin(); it != pendingCallbacks.end(); ++it)
+            ready.push_back(it->second);
+        pendingCallbacks.clear();
+    }
+    else
+    {
+        // Requests of one property are answered in order, each reply completes the oldest one
+        std::string key = callbackKey(device, name);
+        std::multimap<std::string, SendCallback>::iterator it = pendingCallbacks.lower_bound(key);
+        if (it != pendingCallbacks.end() && it->first == key)
+        {
+            ready.push_back(it->second);
+            pendingCallbacks.erase(it);
+        }
+    }
 
+    pthread_mutex_unlock(&pLock);
+
+    // Callbacks may send new commands, so they are invoked without the lock held
+    for (size_t i=0; i < ready.size(); i++)
+        ready[i](state);
 }
 
 int INDI::BaseClient::dispatchCommand(XMLEle *root, char * errmsg)
@@ -463,7 +735,40 @@ int INDI::BaseClient::dispatchCommand(XMLEle *root, char * errmsg)
              !strcmp (tagXMLEle(root), "setSwitchVector") ||
              !strcmp (tagXMLEle(root), "setLightVector") ||
              !strcmp (tagXMLEle(root), "setBLOBVector"))
-        return dp->setValue(root, errmsg);
+    {
+        XMLAtt *trace = indi_trace_enabled() ? findXMLAtt(root, INDI_TRACE_ATTR) : NULL;
+        char stamps[INDI_TRACE_MAXLEN];
+
+        // The whole element is parsed, so the BLOB has been received
+        if (trace)
+        {
+            strncpy(stamps, valuXMLAtt(trace), sizeof(stamps)-1);
+            stamps[sizeof(stamps)-1] = '\0';
+            indi_trace_stamp(stamps, sizeof(stamps), "cli", indi_trace_now());
+        }
+
+        int rc = dp->setValue(root, errmsg);
+
+        if (trace)
+        {
+            indi_trace_stamp(stamps, sizeof(stamps), "done", indi_trace_now());
+            indi_trace_record_span("client_receive", stamps, "srv", "cli");
+            indi_trace_record_span("client_decode", stamps, "cli", "done");
+            indi_trace_record_span("total", stamps, "exp", "done");
+            indi_trace_log(dp->getDeviceName(), findXMLAttValu(root, "name"), stamps);
+        }
+
+        if (rc == 0)
+        {
+            const char *name = findXMLAttValu(root, "name");
+            IPState state = dp->getPropertyState(name);
+
+            if (state != IPS_BUSY)
+                completeCallbacks(dp->getDeviceName(), name, state);
+        }
+
+        return rc;
+    }
 
     return INDI_DISPATCH_ERROR;
 }
@@ -619,22 +924,28 @@ int INDI::BaseClient::messageCmd (XMLEle *root, char * errmsg)
 
 void INDI::BaseClient::sendNewText (ITextVectorProperty *tvp)
 {
+    sendNewText(tvp, SendCallback());
+}
+
+void INDI::BaseClient::sendNewText (ITextVectorProperty *tvp, SendCallback callback)
+{
+    std::string msg;
+
     tvp->s = IPS_BUSY;
 
-    fprintf(svrwfp, "<newTextVector\n");
-    fprintf(svrwfp, "  device='%s'\n", tvp->device);
-    fprintf(svrwfp, "  name='%s'\n>", tvp->name);
+    appendVectorTag(msg, "newTextVector", tvp->device, tvp->name);
 
     for (int i=0; i < tvp->ntp; i++)
     {
-        fprintf(svrwfp, "  <oneText\n");
-        fprintf(svrwfp, "    name='%s'>\n", tvp->tp[i].name);
-        fprintf(svrwfp, "      %s\n", tvp->tp[i].text);
-        fprintf(svrwfp, "  </oneText>\n");
+        msg += "  <oneText\n    name='";
+        appendXML(msg, tvp->tp[i].name);
+        msg += "'>\n      ";
+        appendXML(msg, tvp->tp[i].text ? tvp->tp[i].text : "");
+        msg += "\n  </oneText>\n";
     }
-    fprintf(svrwfp, "</newTextVector>\n");
+    msg += "</newTextVector>\n";
 
-    fflush(svrwfp);
+    sendMessage(msg, tvp->device, tvp->name, callback);
 }
 
 void INDI::BaseClient::sendNewText (const char * deviceName, const char * propertyName, const char* elementName, const char *text)
@@ -662,26 +973,28 @@ void INDI::BaseClient::sendNewText (const char * deviceName, const char * proper
 
 void INDI::BaseClient::sendNewNumber (INumberVectorProperty *nvp)
 {
-    char *orig = setlocale(LC_NUMERIC,"C");
+    sendNewNumber(nvp, SendCallback());
+}
+
+void INDI::BaseClient::sendNewNumber (INumberVectorProperty *nvp, SendCallback callback)
+{
+    std::string msg;
 
     nvp->s = IPS_BUSY;
 
-    fprintf(svrwfp, "<newNumberVector\n");
-    fprintf(svrwfp, "  device='%s'\n", nvp->device);
-    fprintf(svrwfp, "  name='%s'\n>", nvp->name);
+    appendVectorTag(msg, "newNumberVector", nvp->device, nvp->name);
 
     for (int i=0; i < nvp->nnp; i++)
     {
-        fprintf(svrwfp, "  <oneNumber\n");
-        fprintf(svrwfp, "    name='%s'>\n", nvp->np[i].name);
-        fprintf(svrwfp, "      %g\n", nvp->np[i].value);
-        fprintf(svrwfp, "  </oneNumber>\n");
+        msg += "  <oneNumber\n    name='";
+        appendXML(msg, nvp->np[i].name);
+        msg += "'>\n      ";
+        appendNumber(msg, nvp->np[i].value);
+        msg += "\n  </oneNumber>\n";
     }
-    fprintf(svrwfp, "</newNumberVector>\n");
-
-    fflush(svrwfp);
+    msg += "</newNumberVector>\n";
 
-    setlocale(LC_NUMERIC,orig);
+    sendMessage(msg, nvp->device, nvp->name, callback);
 }
 
 void INDI::BaseClient::sendNewNumber (const char *deviceName, const char *propertyName, const char* elementName, double value)
@@ -709,36 +1022,33 @@ void INDI::BaseClient::sendNewNumber (const char *deviceName, const char *proper
 
 void INDI::BaseClient::sendNewSwitch (ISwitchVectorProperty *svp)
 {
+    sendNewSwitch(svp, SendCallback());
+}
+
+void INDI::BaseClient::sendNewSwitch (ISwitchVectorProperty *svp, SendCallback callback)
+{
+    std::string msg;
+
     svp->s = IPS_BUSY;
     ISwitch *onSwitch = IUFindOnSwitch(svp);
 
-    fprintf(svrwfp, "<newSwitchVector\n");
-
-    fprintf(svrwfp, "  device='%s'\n", svp->device);
-    fprintf(svrwfp, "  name='%s'>\n", svp->name);
+    appendVectorTag(msg, "newSwitchVector", svp->device, svp->name);
 
-    if (svp->r == ISR_1OFMANY && onSwitch)
+    for (int i=0; i < svp->nsp; i++)
     {
-        fprintf(svrwfp, "  <oneSwitch\n");
-        fprintf(svrwfp, "    name='%s'>\n", onSwitch->name);
-        fprintf(svrwfp, "      %s\n", (onSwitch->s == ISS_ON) ? "On" : "Off");
-        fprintf(svrwfp, "  </oneSwitch>\n");
-    }
-    else
-    {
-        for (int i=0; i < svp->nsp; i++)
-        {
-            fprintf(svrwfp, "  <oneSwitch\n");
-            fprintf(svrwfp, "    name='%s'>\n", svp->sp[i].name);
-            fprintf(svrwfp, "      %s\n", (svp->sp[i].s == ISS_ON) ? "On" : "Off");
-            fprintf(svrwfp, "  </oneSwitch>\n");
+        ISwitch *sp = &svp->sp[i];
 
-        }
+        if (svp->r == ISR_1OFMANY && onSwitch && sp != onSwitch)
+            continue;
+
+        msg += "  <oneSwitch\n    name='";
+        appendXML(msg, sp->name);
+        msg += (sp->s == ISS_ON) ? "'>\n      On\n  </oneSwitch>\n" : "'>\n      Off\n  </oneSwitch>\n";
     }
 
-    fprintf(svrwfp, "</newSwitchVector>\n");
+    msg += "</newSwitchVector>\n";
 
-    fflush(svrwfp);
+    sendMessage(msg, svp->device, svp->name, callback);
 }
 
 void INDI::BaseClient::sendNewSwitch (const char *deviceName, const char *propertyName, const char *elementName)
@@ -766,59 +1076,137 @@ void INDI::BaseClient::sendNewSwitch (const char *deviceName, const char *proper
 
 void INDI::BaseClient::startBlob( const char *devName, const char *propName, const char *timestamp)
 {
-    fprintf(svrwfp, "<newBLOBVector\n");
-    fprintf(svrwfp, "  device='%s'\n", devName);
-    fprintf(svrwfp, "  name='%s'\n", propName);
-    fprintf(svrwfp, "  timestamp='%s'>\n",  timestamp);
+    blobMsg.clear();
+    appendVectorTag(blobMsg, "newBLOBVector", devName, propName);
+    // Insert the timestamp attribute before the closing '>'
+    blobMsg.erase(blobMsg.size()-1);
+    blobMsg += "  timestamp='";
+    appendXML(blobMsg, timestamp);
+    blobMsg += "'>\n";
 }
 
 void INDI::BaseClient::sendOneBlob( const char *blobName, unsigned int blobSize, const char *blobFormat, void * blobBuffer)
 {
-    fprintf(svrwfp, "  <oneBLOB\n");
-    fprintf(svrwfp, "    name='%s'\n", blobName);
-    fprintf(svrwfp, "    size='%ud'\n", blobSize);
-    fprintf(svrwfp, "    format='%s'>\n", blobFormat);
+    char size[32];
+    snprintf(size, sizeof(size), "%u", blobSize);
+
+    blobMsg.reserve(blobMsg.size() + blobSize + blobSize/72*5 + MAXRBUF);
+
+    blobMsg += "  <oneBLOB\n    name='";
+    appendXML(blobMsg, blobName);
+    blobMsg += "'\n    size='";
+    blobMsg += size;
+    blobMsg += "'\n    format='";
+    appendXML(blobMsg, blobFormat);
+    blobMsg += "'>\n";
 
     for (unsigned i = 0; i < blobSize; i += 72)
-        fprintf(svrwfp, "    %.72s\n", ((char *) blobBuffer+i));
+    {
+        blobMsg += "    ";
+        blobMsg.append((char *) blobBuffer+i, (blobSize - i < 72) ? blobSize - i : 72);
+        blobMsg += "\n";
+    }
 
-    fprintf(svrwfp, "   </oneBLOB>\n");
+    blobMsg += "   </oneBLOB>\n";
 }
 
 void INDI::BaseClient::finishBlob()
 {
-    fprintf(svrwfp, "</newBLOBVector>\n");
-    fflush(svrwfp);
+    blobMsg += "</newBLOBVector>\n";
 
+    sendMessage(blobMsg);
+
+    blobMsg.clear();
+}
+
+void INDI::BaseClient::setBLOBSink(const char *dev, const char *prop, INDI::BLOBSink *sink, BLOBCallback callback)
+{
+    std::string key = callbackKey(dev, prop ? prop : "");
+
+    pthread_mutex_lock(&sLock);
+
+    if (sink == NULL)
+        blobSinks.erase(key);
+    else
+    {
+        BLOBTarget target;
+        target.sink     = sink;
+        target.callback = callback;
+        blobSinks[key]  = target;
+    }
+
+    pthread_mutex_unlock(&sLock);
+}
+
+bool INDI::BaseClient::findBLOBSink(const char *device, const char *property, const char *name, IBLOB **bp,
+                                    INDI::BLOBSink **sink, BLOBCallback *callback)
+{
+    BLOBTarget target;
+
+    pthread_mutex_lock(&sLock);
+
+    std::map<std::string, BLOBTarget>::const_iterator it = blobSinks.find(callbackKey(device, property));
+    if (it == blobSinks.end())
+        it = blobSinks.find(callbackKey(device, ""));
+    if (it == blobSinks.end())
+    {
+        pthread_mutex_unlock(&sLock);
+        return false;
+    }
+    target = it->second;
+
+    pthread_mutex_unlock(&sLock);
+
+    // Undefined properties are left to the XML parser, which reports them
+    INDI::BaseDevice *dp = getDevice(device);
+    IBLOBVectorProperty *bvp = dp ? dp->getBLOB(property) : NULL;
+    if (bvp == NULL)
+        return false;
+
+    if (name == NULL)
+        return true;
+
+    IBLOB *blob = IUFindBLOB(bvp, name);
+    if (blob == NULL)
+        return false;
+
+    *bp = blob;
+    if (sink)
+        *sink = target.sink;
+    if (callback)
+        *callback = target.callback;
+
+    return true;
 }
 
 void INDI::BaseClient::setBLOBMode(BLOBHandling blobH, const char *dev, const char *prop)
 {
-    char blobOpenTag[MAXRBUF];
+    std::string msg;
 
     if (!dev[0])
         return;
 
+    msg = "<enableBLOB device='";
+    appendXML(msg, dev);
     if (prop != NULL)
-        snprintf(blobOpenTag, MAXRBUF, "<enableBLOB device='%s' name='%s'>", dev, prop);
-    else
-        snprintf(blobOpenTag, MAXRBUF, "<enableBLOB device='%s'>", dev);
+    {
+        msg += "' name='";
+        appendXML(msg, prop);
+    }
+    msg += "'>";
 
     switch (blobH)
     {
     case B_NEVER:
-        fprintf(svrwfp, "%sNever</enableBLOB>\n", blobOpenTag);
+        msg += "Never</enableBLOB>\n";
         break;
     case B_ALSO:
-        fprintf(svrwfp, "%sAlso</enableBLOB>\n", blobOpenTag);
+        msg += "Also</enableBLOB>\n";
         break;
     case B_ONLY:
-        fprintf(svrwfp, "%sOnly</enableBLOB>\n", blobOpenTag);
+        msg += "Only</enableBLOB>\n";
         break;
     }
 
-    fflush(svrwfp);
+    sendMessage(msg);
 }
-
-
-
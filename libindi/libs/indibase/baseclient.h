@@ -22,6 +22,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <functional>
 
 #include <pthread.h>
 
@@ -42,6 +43,10 @@ using namespace std;
    a set of INDI::BaseDevice devices, and read and write properties seamlessly. Event driven programming is possible due to
    notifications upon reception of new devices or properties.
 
+   Socket I/O is handled by an INDI::ClientReactor shared by all clients of the process, so notifications are delivered
+   on the reactor thread rather than on a thread per connection. Commands sent to the server are buffered per connection
+   and may be sent from any thread.
+
    \attention All notifications functions defined in INDI::BaseMediator must be implemented in the client class even if
    they are not used because these are pure virtual functions.
 
@@ -53,6 +58,20 @@ class INDI::BaseClient : public INDI::BaseMediator
 {
 
 public:
+
+    /** \brief Signature of callbacks completing an asynchronous sendNew* command.
+        \param state State of the property in the first reply of the driver that is not IPS_BUSY, or IPS_ALERT if
+        the command could not be sent or the connection was closed before the reply arrived.
+    */
+    typedef std::function<void (IPState state)> SendCallback;
+
+    /** \brief Signature of progress callbacks of streamed BLOBs.
+        \param bp BLOB being received.
+        \param received Number of decoded bytes handed to the sink so far.
+        \param state IPS_BUSY while the BLOB is received, IPS_OK once it is complete, IPS_ALERT if it was aborted.
+    */
+    typedef std::function<void (IBLOB *bp, size_t received, IPState state)> BLOBCallback;
+
     BaseClient();
     virtual ~BaseClient();
 
@@ -82,6 +101,8 @@ public:
     /** \brief Disconnect from INDI server.
 
         Disconnects from INDI servers. Any devices previously created will be deleted and memory cleared.
+        Commands waiting for a reply complete with IPS_ALERT, then serverDisconnected(0) is invoked on the calling
+        thread before this function returns. It was invoked from the listener thread before.
         \return True if disconnection is successful, false otherwise.
     */
     bool disconnectServer();
@@ -123,9 +144,45 @@ public:
     */
     void setBLOBMode(BLOBHandling blobH, const char *dev, const char *prop = NULL);
 
-    // Update
+    /** \brief Wait until the client \e context is disconnected from the server.
+        \deprecated The connection is serviced by the client reactor, there is no listener thread to start any more.
+        Kept for code that ran the listener itself, it returns once the connection is closed.
+    */
     static void * listenHelper(void *context);
 
+    /** \brief Stream the BLOBs of a property to a sink while they arrive.
+
+      By default, a BLOB is decoded once the whole setBLOBVector message is received and delivered with newBLOB(),
+      which requires memory for the encoded, decoded and uncompressed copies of the BLOB. Once a sink is set, the
+      BLOBs of the property are base64 decoded and inflated in small blocks as they are received and written to
+      \e sink, and \e callback reports the progress. newBLOB() is not called for streamed BLOBs, except for state
+      only updates without data. After a BLOB is streamed, its IBLOB has \e size set to the decoded size and no
+      \e blob buffer.
+
+      The property must be defined by the driver before its BLOBs are streamed, and BLOBs must be enabled with
+      setBLOBMode().
+
+      \param dev name of device, required.
+      \param prop name of property, or NULL for every BLOB property of the device.
+      \param sink sink receiving the BLOBs, or NULL to stop streaming.
+      \param callback optional progress callback, invoked on the reactor thread.
+      \note The sink is used on the reactor thread and must remain valid until it is removed and the BLOB in
+      progress, if any, was reported complete or aborted.
+    */
+    void setBLOBSink(const char *dev, const char *prop, INDI::BLOBSink *sink, BLOBCallback callback = BLOBCallback());
+
+    /** \brief Set the reactor handling the connection of this client.
+        \param clientReactor reactor to use, or NULL for the process wide default reactor.
+        \note Must be called while disconnected. Notifications are delivered on the thread driving the reactor.
+    */
+    void setReactor(INDI::ClientReactor *clientReactor) { reactor = clientReactor; }
+
+    /** \returns The reactor handling the connection, or NULL if none was set and the client never connected. */
+    INDI::ClientReactor * getReactor() const { return reactor; }
+
+    /** \returns Number of bytes queued for the server and not yet written to the socket. */
+    size_t getPendingBytes();
+
     const char * getHost() { return cServer.c_str();}
     int getPort() { return cPort; }
 
@@ -142,6 +199,18 @@ public:
     /** \brief Send new Switch command to server */
     void sendNewSwitch (const char * deviceName, const char *propertyName, const char *elementName);
 
+    /** \brief Send new Text command to server and invoke \e callback once the driver completes it.
+        \note The callback is invoked on the reactor thread. It must not wait for another reply of the same client.
+        Several commands of one property complete in the order they were sent, one per reply of the driver.
+    */
+    void sendNewText (ITextVectorProperty *pp, SendCallback callback);
+
+    /** \brief Send new Number command to server and invoke \e callback once the driver completes it. */
+    void sendNewNumber (INumberVectorProperty *pp, SendCallback callback);
+
+    /** \brief Send new Switch command to server and invoke \e callback once the driver completes it. */
+    void sendNewSwitch (ISwitchVectorProperty *pp, SendCallback callback);
+
     /** \brief Send opening tag for BLOB command to server */
     void startBlob( const char *devName, const char *propName, const char *timestamp);
     /** \brief Send ONE blob content to server */
@@ -199,16 +268,61 @@ private:
     */
     void setDriverConnection(bool status, const char *deviceName);    
 
-    pthread_t listen_thread;
+    // Reactor entry point, dispatches to readINDI and writeINDI
+    static void ioHelper(int fd, int events, void *context);
 
-    FILE *svrwfp;			/* FILE * to talk to server */
-    int sockfd;
+    // Read from INDI server and process incoming messages
+    void readINDI();
+
+    // Parse a chunk of XML and dispatch the complete messages. Returns false on bad XML.
+    bool parseINDI(const char *buf, int len);
 
-    int m_receiveFd;
-    int m_sendFd;
+    // Find the sink streaming a BLOB of device/property, see INDI::BLOBStreamParser::Resolver
+    bool findBLOBSink(const char *device, const char *property, const char *name, IBLOB **bp,
+                      INDI::BLOBSink **sink, BLOBCallback *callback);
+
+    // Write queued commands to INDI server
+    void writeINDI();
+
+    // Write as much of the buffer as the socket accepts. Called with wLock held.
+    bool flushLocked();
+
+    // Queue a complete message for the server. The callback, if any, waits for a reply to device/name.
+    bool sendMessage(const std::string & msg, const char *device = NULL, const char *name = NULL,
+                     SendCallback callback = SendCallback());
+
+    // Stop watching and close the socket. Returns false if the client was not connected.
+    bool closeSocket();
+
+    // Complete callbacks waiting for a property, or all callbacks if device is NULL
+    void completeCallbacks(const char *device, const char *name, IPState state);
+
+    INDI::ClientReactor *reactor;
+    int sockfd;
 
-    // Listen to INDI server and process incoming messages
-    void listenINDI();
+    // Commands not yet accepted by the socket start at wOffset
+    std::string wBuf;
+    size_t wOffset;
+    pthread_mutex_t wLock;
+
+    // BLOB vector assembled by startBlob, sendOneBlob and finishBlob
+    std::string blobMsg;
+
+    // Callbacks of asynchronous commands keyed by device and property name, in the order they were sent
+    std::multimap<std::string, SendCallback> pendingCallbacks;
+    pthread_mutex_t pLock;
+
+    // Sinks of streamed BLOBs keyed by device and property name, empty for all properties of the device
+    typedef struct
+    {
+        INDI::BLOBSink *sink;
+        BLOBCallback callback;
+    } BLOBTarget;
+    std::map<std::string, BLOBTarget> blobSinks;
+    pthread_mutex_t sLock;
+
+    INDI::BLOBStreamParser *blobParser;
+    std::string blobXML;
 
     vector<INDI::BaseDevice *> cDevices;
     vector<string> cDeviceNames;
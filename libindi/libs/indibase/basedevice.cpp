@@ -46,6 +46,14 @@ using namespace std;
 INDI::BaseDevice::BaseDevice()
 {
     mediator = NULL;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&pLock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    messageLogCapacity = 1024;
     lp = newLilXML();
     deviceID = new char[MAXINDIDEVICE];
     memset(deviceID, 0, MAXINDIDEVICE);
@@ -63,10 +71,13 @@ INDI::BaseDevice::BaseDevice()
 INDI::BaseDevice::~BaseDevice()
 {
     delLilXML (lp);
+    pIndex.clear();
     while(!pAll.empty()) { delete pAll.back(), pAll.pop_back(); }
     messageLog.clear();
 
     delete[] deviceID;
+
+    pthread_mutex_destroy(&pLock);
 }
 
 INumberVectorProperty * INDI::BaseDevice::getNumber(const char *name)
@@ -114,273 +125,175 @@ IBLOBVectorProperty * INDI::BaseDevice::getBLOB(const char *name)
   return bvp;
 }
 
-IPState INDI::BaseDevice::getPropertyState(const char *name)
+INDI::Property * INDI::BaseDevice::findProperty(const char *name)
 {
-    IPState state = IPS_IDLE;
-    INDI_PROPERTY_TYPE pType;
-    void *pPtr;
+    INDI::Property *pContainer = NULL;
 
-    INumberVectorProperty *nvp;
-    ITextVectorProperty *tvp;
-    ISwitchVectorProperty *svp;
-    ILightVectorProperty *lvp;
-    IBLOBVectorProperty *bvp;
+    pthread_mutex_lock(&pLock);
 
-    std::vector<INDI::Property *>::iterator orderi = pAll.begin();
+    std::unordered_map<const char *, INDI::Property *, NameHash, NameEqual>::const_iterator it = pIndex.find(name);
 
-    for (; orderi != pAll.end(); ++orderi)
-    {
-        pType       = (*orderi)->getType();
-        pPtr        = (*orderi)->getProperty();
+    if (it != pIndex.end())
+        pContainer = it->second;
 
-        switch (pType)
-        {
-        case INDI_NUMBER:
-            nvp = static_cast<INumberVectorProperty *>(pPtr);
-            if (nvp == NULL)
-                continue;
-            if (!strcmp(name, nvp->name))
-                return nvp->s;
-            break;
-        case INDI_SWITCH:
-            svp = static_cast<ISwitchVectorProperty *>(pPtr);
-            if (svp == NULL)
-                continue;
-            if (!strcmp(name, svp->name))
-                return svp->s;
-            break;
-        case INDI_TEXT:
-            tvp = static_cast<ITextVectorProperty *>(pPtr);
-            if (tvp == NULL)
-                continue;
-            if (!strcmp(name, tvp->name))
-                return tvp->s;
-            break;
-        case INDI_LIGHT:
-            lvp = static_cast<ILightVectorProperty *>(pPtr);
-            if (lvp == NULL)
-                continue;
-            if (!strcmp(name, lvp->name))
-                return lvp->s;
-            break;
-        case INDI_BLOB:
-            bvp = static_cast<IBLOBVectorProperty *>(pPtr);
-            if (bvp == NULL)
-                continue;
-            if (!strcmp(name, bvp->name))
-                return bvp->s;
-            break;
-         default:
-            break;
-        }
-    }
+    pthread_mutex_unlock(&pLock);
 
-    return state;
+    return pContainer;
+}
 
+void INDI::BaseDevice::appendProperty(INDI::Property *pContainer)
+{
+    pthread_mutex_lock(&pLock);
+    pAll.push_back(pContainer);
+    indexProperty(pContainer);
+    pthread_mutex_unlock(&pLock);
 }
 
-IPerm INDI::BaseDevice::getPropertyPermission(const char *name)
+// Called with pLock held
+void INDI::BaseDevice::indexProperty(INDI::Property *pContainer)
 {
-    IPerm perm = IP_RO;
+    const char *name = pContainer->getName();
 
-    INDI_PROPERTY_TYPE pType;
-    void *pPtr;
+    if (name == NULL)
+        return;
 
-    INumberVectorProperty *nvp;
-    ITextVectorProperty *tvp;
-    ISwitchVectorProperty *svp;
-    IBLOBVectorProperty *bvp;
+    // The first property of a name wins, as with a scan of pAll
+    pIndex.insert(std::make_pair(name, pContainer));
+}
 
-    std::vector<INDI::Property *>::iterator orderi = pAll.begin();
+// Called with pLock held, before pContainer leaves pAll
+void INDI::BaseDevice::unindexProperty(INDI::Property *pContainer)
+{
+    const char *name = pContainer->getName();
 
-    for (; orderi != pAll.end(); ++orderi)
-    {
-        pType       = (*orderi)->getType();
-        pPtr        = (*orderi)->getProperty();
+    if (name == NULL)
+        return;
 
-        switch (pType)
+    std::unordered_map<const char *, INDI::Property *, NameHash, NameEqual>::iterator it = pIndex.find(name);
+
+    if (it == pIndex.end() || it->second != pContainer)
+        return;
+
+    pIndex.erase(it);
+
+    // The next property of the same name takes its place, the key must point to its own name
+    for (std::vector<INDI::Property *>::const_iterator orderi = pAll.begin(); orderi != pAll.end(); ++orderi)
+    {
+        const char *other = (*orderi)->getName();
+        if (*orderi != pContainer && other != NULL && !strcmp(other, name))
         {
-        case INDI_NUMBER:
-            nvp = static_cast<INumberVectorProperty *>(pPtr);
-            if (nvp == NULL)
-                continue;
-            if (!strcmp(name, nvp->name))
-                return nvp->p;
-            break;
-        case INDI_SWITCH:
-            svp = static_cast<ISwitchVectorProperty *>(pPtr);
-            if (svp == NULL)
-                continue;
-            if (!strcmp(name, svp->name))
-                return svp->p;
-            break;
-        case INDI_TEXT:
-            tvp = static_cast<ITextVectorProperty *>(pPtr);
-            if (tvp == NULL)
-                continue;
-            if (!strcmp(name, tvp->name))
-                return tvp->p;
-            break;
-        case INDI_BLOB:
-            bvp = static_cast<IBLOBVectorProperty *>(pPtr);
-            if (bvp == NULL)
-                continue;
-            if (!strcmp(name, bvp->name))
-                return bvp->p;
-            break;
-         default:
+            pIndex.insert(std::make_pair(other, *orderi));
             break;
         }
     }
-
-    return perm;
-
 }
 
-void * INDI::BaseDevice::getRawProperty(const char *name, INDI_PROPERTY_TYPE type)
+IPState INDI::BaseDevice::getPropertyState(const char *name)
 {
-    INDI_PROPERTY_TYPE pType;
+    INDI::Property *pContainer = findProperty(name);
     void *pPtr;
-    bool pRegistered = false;
 
-    std::vector<INDI::Property *>::iterator orderi = pAll.begin();
-
-    INumberVectorProperty *nvp;
-    ITextVectorProperty *tvp;
-    ISwitchVectorProperty *svp;
-    ILightVectorProperty *lvp;
-    IBLOBVectorProperty *bvp;
+    if (pContainer == NULL || (pPtr = pContainer->getProperty()) == NULL)
+        return IPS_IDLE;
 
-    for (; orderi != pAll.end(); ++orderi)
+    switch (pContainer->getType())
     {
-        pType       = (*orderi)->getType();
-        pPtr        = (*orderi)->getProperty();
-        pRegistered = (*orderi)->getRegistered();
-
-        if (type != INDI_UNKNOWN && pType != type)
-            continue;
-
-        switch (pType)
-        {
-        case INDI_NUMBER:
-            nvp = static_cast<INumberVectorProperty *>(pPtr);
-            if (nvp == NULL)
-                continue;
+    case INDI_NUMBER:
+        return static_cast<INumberVectorProperty *>(pPtr)->s;
+    case INDI_SWITCH:
+        return static_cast<ISwitchVectorProperty *>(pPtr)->s;
+    case INDI_TEXT:
+        return static_cast<ITextVectorProperty *>(pPtr)->s;
+    case INDI_LIGHT:
+        return static_cast<ILightVectorProperty *>(pPtr)->s;
+    case INDI_BLOB:
+        return static_cast<IBLOBVectorProperty *>(pPtr)->s;
+     default:
+        break;
+    }
 
-            if (!strcmp(name, nvp->name) && pRegistered)
-                return pPtr;
-             break;
-        case INDI_TEXT:
-             tvp = static_cast<ITextVectorProperty *>(pPtr);
-             if (tvp == NULL)
-                 continue;
+    return IPS_IDLE;
+}
 
-             if (!strcmp(name, tvp->name)  && pRegistered)
-                return pPtr;
-             break;
-        case INDI_SWITCH:
-             svp = static_cast<ISwitchVectorProperty *>(pPtr);
-             if (svp == NULL)
-                 continue;
+IPerm INDI::BaseDevice::getPropertyPermission(const char *name)
+{
+    INDI::Property *pContainer = findProperty(name);
 
-             //IDLog("Switch %s and aux value is now %d\n", svp->name, regStatus );
-             if (!strcmp(name, svp->name) && pRegistered)
-                 return pPtr;
-             break;
-        case INDI_LIGHT:
-             lvp = static_cast<ILightVectorProperty *>(pPtr);
-             if (lvp == NULL)
-                 continue;
+    // Lights have no permission, a later property of the same name may
+    if (pContainer != NULL && pContainer->getType() == INDI_LIGHT)
+        pContainer = scanProperty(name, INDI_UNKNOWN, false, true);
 
-             if (!strcmp(name, lvp->name)  && pRegistered)
-                 return pPtr;
-             break;
-        case INDI_BLOB:
-             bvp = static_cast<IBLOBVectorProperty *>(pPtr);
-             if (bvp == NULL)
-                 continue;
+    void *pPtr;
 
-             if (!strcmp(name, bvp->name) && pRegistered)
-                 return pPtr;
-             break;
-        }
+    if (pContainer == NULL || (pPtr = pContainer->getProperty()) == NULL)
+        return IP_RO;
 
+    switch (pContainer->getType())
+    {
+    case INDI_NUMBER:
+        return static_cast<INumberVectorProperty *>(pPtr)->p;
+    case INDI_SWITCH:
+        return static_cast<ISwitchVectorProperty *>(pPtr)->p;
+    case INDI_TEXT:
+        return static_cast<ITextVectorProperty *>(pPtr)->p;
+    case INDI_BLOB:
+        return static_cast<IBLOBVectorProperty *>(pPtr)->p;
+     default:
+        break;
     }
 
-    return NULL;
+    return IP_RO;
 }
 
-INDI::Property * INDI::BaseDevice::getProperty(const char *name, INDI_PROPERTY_TYPE type)
+void * INDI::BaseDevice::getRawProperty(const char *name, INDI_PROPERTY_TYPE type)
 {
-    INDI_PROPERTY_TYPE pType;
-    void *pPtr;
-    bool pRegistered = false;
+    INDI::Property *pContainer = getProperty(name, type);
 
-    std::vector<INDI::Property *>::iterator orderi;
-
-    INumberVectorProperty *nvp;
-    ITextVectorProperty *tvp;
-    ISwitchVectorProperty *svp;
-    ILightVectorProperty *lvp;
-    IBLOBVectorProperty *bvp;
+    return pContainer ? pContainer->getProperty() : NULL;
+}
 
-    for (orderi = pAll.begin(); orderi != pAll.end(); ++orderi)
-    {
-        pType       = (*orderi)->getType();
-        pPtr        = (*orderi)->getProperty();
-        pRegistered = (*orderi)->getRegistered();
+INDI::Property * INDI::BaseDevice::getProperty(const char *name, INDI_PROPERTY_TYPE type)
+{
+    INDI::Property *pContainer = findProperty(name);
 
-        if (type != INDI_UNKNOWN && pType != type)
-            continue;
+    if (pContainer == NULL)
+        return NULL;
 
-        switch (pType)
-        {
-        case INDI_NUMBER:
-            nvp = static_cast<INumberVectorProperty *>(pPtr);
-            if (nvp == NULL)
-                continue;
+    if (pContainer->getRegistered() && (type == INDI_UNKNOWN || pContainer->getType() == type))
+        return pContainer;
 
-            if (!strcmp(name, nvp->name) && pRegistered)
-                return *orderi;
-             break;
-        case INDI_TEXT:
-             tvp = static_cast<ITextVectorProperty *>(pPtr);
-             if (tvp == NULL)
-                 continue;
+    // The first property of this name does not qualify, look for a later one in order
+    return scanProperty(name, type, true, false);
+}
 
-             if (!strcmp(name, tvp->name)  && pRegistered)
-                return *orderi;
-             break;
-        case INDI_SWITCH:
-             svp = static_cast<ISwitchVectorProperty *>(pPtr);
-             if (svp == NULL)
-                 continue;
+// First property of pAll with the given name, type (unless INDI_UNKNOWN) and registration
+INDI::Property * INDI::BaseDevice::scanProperty(const char *name, INDI_PROPERTY_TYPE type, bool registered, bool skipLights)
+{
+    INDI::Property *pContainer = NULL;
 
-             //IDLog("Switch %s and aux value is now %d\n", svp->name, regStatus );
-             if (!strcmp(name, svp->name) && pRegistered)
-                 return *orderi;
-             break;
-        case INDI_LIGHT:
-             lvp = static_cast<ILightVectorProperty *>(pPtr);
-             if (lvp == NULL)
-                 continue;
+    pthread_mutex_lock(&pLock);
 
-             if (!strcmp(name, lvp->name)  && pRegistered)
-                 return *orderi;
-             break;
-        case INDI_BLOB:
-             bvp = static_cast<IBLOBVectorProperty *>(pPtr);
-             if (bvp == NULL)
-                 continue;
+    for (std::vector<INDI::Property *>::const_iterator orderi = pAll.begin(); orderi != pAll.end(); ++orderi)
+    {
+        const char *pName = (*orderi)->getName();
+        INDI_PROPERTY_TYPE pType = (*orderi)->getType();
 
-             if (!strcmp(name, bvp->name) && pRegistered)
-                 return *orderi;
-             break;
-        }
+        if (pName == NULL || strcmp(name, pName))
+            continue;
+        if (type != INDI_UNKNOWN && pType != type)
+            continue;
+        if (registered && (*orderi)->getRegistered() == false)
+            continue;
+        if (skipLights && pType == INDI_LIGHT)
+            continue;
 
+        pContainer = *orderi;
+        break;
     }
 
-    return NULL;
+    pthread_mutex_unlock(&pLock);
+
+    return pContainer;
 }
 
 int INDI::BaseDevice::removeProperty(const char *name, char *errmsg)
@@ -396,6 +309,8 @@ int INDI::BaseDevice::removeProperty(const char *name, char *errmsg)
     ILightVectorProperty *lvp;
     IBLOBVectorProperty *bvp;
 
+    pthread_mutex_lock(&pLock);
+
     for (orderi = pAll.begin(); orderi != pAll.end(); ++orderi)
     {
         pType       = (*orderi)->getType();
@@ -408,9 +323,11 @@ int INDI::BaseDevice::removeProperty(const char *name, char *errmsg)
             if (!strcmp(name, nvp->name))
             {
                 (*orderi)->setRegistered(false);
+                unindexProperty(*orderi);
                 delete *orderi;
                 orderi = pAll.erase(orderi);
 
+                 pthread_mutex_unlock(&pLock);
                  return 0;
              }
              break;
@@ -419,9 +336,11 @@ int INDI::BaseDevice::removeProperty(const char *name, char *errmsg)
              if (!strcmp(name, tvp->name))
              {
                   (*orderi)->setRegistered(false);
+                  unindexProperty(*orderi);
                  delete *orderi;
                  orderi = pAll.erase(orderi);
 
+                  pthread_mutex_unlock(&pLock);
                   return 0;
               }
              break;
@@ -430,8 +349,10 @@ int INDI::BaseDevice::removeProperty(const char *name, char *errmsg)
              if (!strcmp(name, svp->name))
              {
                  (*orderi)->setRegistered(false);
+                 unindexProperty(*orderi);
                  delete *orderi;
                  orderi = pAll.erase(orderi);
+                  pthread_mutex_unlock(&pLock);
                   return 0;
               }
              break;
@@ -440,8 +361,10 @@ int INDI::BaseDevice::removeProperty(const char *name, char *errmsg)
              if (!strcmp(name, lvp->name))
              {
                  (*orderi)->setRegistered(false);
+                 unindexProperty(*orderi);
                  delete *orderi;
                  orderi = pAll.erase(orderi);
+                 pthread_mutex_unlock(&pLock);
                  return 0;
               }
              break;
@@ -450,14 +373,18 @@ int INDI::BaseDevice::removeProperty(const char *name, char *errmsg)
              if (!strcmp(name, bvp->name))
              {
                  (*orderi)->setRegistered(false);
+                 unindexProperty(*orderi);
                  delete *orderi;
                  orderi = pAll.erase(orderi);
+                 pthread_mutex_unlock(&pLock);
                  return 0;
               }
              break;
         }
     }
 
+    pthread_mutex_unlock(&pLock);
+
     snprintf(errmsg, MAXRBUF, "Error: Property %s not found in device %s.", name, deviceID);
     return INDI_PROPERTY_INVALID;
 }
@@ -561,8 +488,6 @@ int INDI::BaseDevice::buildProp(XMLEle *root, char *errmsg)
 
     if (!strcmp (rtag, "defNumberVector"))
     {
-        char *orig = setlocale(LC_NUMERIC,"C");
-        
         INDI::Property *indiProp = new INDI::Property();
         INumberVectorProperty *nvp = new INumberVectorProperty;
 
@@ -607,13 +532,13 @@ int INDI::BaseDevice::buildProp(XMLEle *root, char *errmsg)
 
                    na = findXMLAtt (ep, "min");
                    if (na)
-                       np[n].min = atof(valuXMLAtt(na));
+                       np[n].min = f_strtod(valuXMLAtt(na), NULL);
                    na = findXMLAtt (ep, "max");
                    if (na)
-                       np[n].max = atof(valuXMLAtt(na));
+                       np[n].max = f_strtod(valuXMLAtt(na), NULL);
                    na = findXMLAtt (ep, "step");
                    if (na)
-                       np[n].step = atof(valuXMLAtt(na));
+                       np[n].step = f_strtod(valuXMLAtt(na), NULL);
 
                 }
             }
@@ -630,7 +555,7 @@ int INDI::BaseDevice::buildProp(XMLEle *root, char *errmsg)
         indiProp->setDynamic(true);
         indiProp->setType(INDI_NUMBER);
 
-        pAll.push_back(indiProp);
+        appendProperty(indiProp);
 
         //IDLog("Adding number property %s to list.\n", nvp->name);
         if (mediator)
@@ -638,8 +563,6 @@ int INDI::BaseDevice::buildProp(XMLEle *root, char *errmsg)
     }
     else
         IDLog("%s: newNumberVector with no valid members\n",rname);
-
-    setlocale(LC_NUMERIC,orig);
   }
   else if (!strcmp (rtag, "defSwitchVector"))
   {
@@ -695,7 +618,7 @@ int INDI::BaseDevice::buildProp(XMLEle *root, char *errmsg)
             indiProp->setDynamic(true);
             indiProp->setType(INDI_SWITCH);
 
-            pAll.push_back(indiProp);
+            appendProperty(indiProp);
             //IDLog("Adding Switch property %s to list.\n", svp->name);
             if (mediator)
                 mediator->newProperty(indiProp);
@@ -756,7 +679,7 @@ else if (!strcmp (rtag, "defTextVector"))
         indiProp->setDynamic(true);
         indiProp->setType(INDI_TEXT);
 
-        pAll.push_back(indiProp);
+        appendProperty(indiProp);
 
         //IDLog("Adding Text property %s to list with initial value of %s.\n", tvp->name, tvp->tp[0].text);
         if (mediator)
@@ -814,7 +737,7 @@ else if (!strcmp (rtag, "defLightVector"))
         indiProp->setDynamic(true);
         indiProp->setType(INDI_LIGHT);
 
-        pAll.push_back(indiProp);
+        appendProperty(indiProp);
 
         //IDLog("Adding Light property %s to list.\n", lvp->name);
         if (mediator)
@@ -881,7 +804,7 @@ else if (!strcmp (rtag, "defBLOBVector"))
         indiProp->setDynamic(true);
         indiProp->setType(INDI_BLOB);
 
-        pAll.push_back(indiProp);
+        appendProperty(indiProp);
         //IDLog("Adding BLOB property %s to list.\n", bvp->name);
         if (mediator)
             mediator->newProperty(indiProp);
@@ -953,12 +876,8 @@ int INDI::BaseDevice::setValue (XMLEle *root, char * errmsg)
     ap = findXMLAtt (root, "timeout");
     if (ap)
     {
-        char *orig = setlocale(LC_NUMERIC,"C");
-        
-        timeout = atof(valuXMLAtt(ap));
+        timeout = f_strtod(valuXMLAtt(ap), NULL);
         timeoutSet = true;
-
-        setlocale(LC_NUMERIC,orig);
     }
 
     checkMessage (root);
@@ -978,25 +897,22 @@ int INDI::BaseDevice::setValue (XMLEle *root, char * errmsg)
         if (timeoutSet)
             nvp->timeout = timeout;
 
-        char *orig = setlocale(LC_NUMERIC,"C");
-        
        for (ep = nextXMLEle (root, 1); ep != NULL; ep = nextXMLEle (root, 0))
         {
            INumber *np =  IUFindNumber(nvp, findXMLAttValu(ep, "name"));
            if (!np)
                continue;
 
-          np->value = atof(pcdataXMLEle(ep));
+          if (f_scansexa(pcdataXMLEle(ep), &np->value) < 0)
+              np->value = 0;
 
           // Permit changing of min/max
           if (findXMLAtt(ep, "min"))
-              np->min = atof(findXMLAttValu(ep, "min"));
+              np->min = f_strtod(findXMLAttValu(ep, "min"), NULL);
           if (findXMLAtt(ep, "max"))
-              np->max = atof(findXMLAttValu(ep, "max"));
+              np->max = f_strtod(findXMLAttValu(ep, "max"), NULL);
        }
 
-       setlocale(LC_NUMERIC,orig);
-
        if (mediator)
            mediator->newNumber(nvp);
 
@@ -1235,6 +1151,9 @@ void INDI::BaseDevice::doMessage (XMLEle *msg)
 
 void INDI::BaseDevice::addMessage(string msg)
 {
+    while (messageLog.size() >= messageLogCapacity)
+        messageLog.pop_front();
+
     messageLog.push_back(msg);
 
     if (mediator)
@@ -1243,8 +1162,8 @@ void INDI::BaseDevice::addMessage(string msg)
 
 string INDI::BaseDevice::messageQueue(int index) const
 {
-    if (index >= messageLog.size())
-        return NULL;
+    if (index < 0 || index >= (int) messageLog.size())
+        return string();
 
     return messageLog.at(index);
 
@@ -1252,9 +1171,20 @@ string INDI::BaseDevice::messageQueue(int index) const
 
 string INDI::BaseDevice::lastMessage()
 {
+    if (messageLog.empty())
+        return string();
+
     return messageLog.back();
 }
 
+void INDI::BaseDevice::setMessageLogCapacity(size_t capacity)
+{
+    messageLogCapacity = (capacity > 0) ? capacity : 1;
+
+    while (messageLog.size() > messageLogCapacity)
+        messageLog.pop_front();
+}
+
 void INDI::BaseDevice::registerProperty(void *p, INDI_PROPERTY_TYPE type)
 {
     INDI::Property *pContainer;
@@ -1272,7 +1202,7 @@ void INDI::BaseDevice::registerProperty(void *p, INDI_PROPERTY_TYPE type)
         pContainer->setProperty(p);
         pContainer->setType(type);
 
-        pAll.push_back(pContainer);
+        appendProperty(pContainer);
 
     }
     else if (type == INDI_TEXT)
@@ -1289,7 +1219,7 @@ void INDI::BaseDevice::registerProperty(void *p, INDI_PROPERTY_TYPE type)
        pContainer->setProperty(p);
        pContainer->setType(type);
 
-       pAll.push_back(pContainer);
+       appendProperty(pContainer);
 
 
    }
@@ -1307,7 +1237,7 @@ void INDI::BaseDevice::registerProperty(void *p, INDI_PROPERTY_TYPE type)
        pContainer->setProperty(p);
        pContainer->setType(type);
 
-       pAll.push_back(pContainer);
+       appendProperty(pContainer);
 
     }
     else if (type == INDI_LIGHT)
@@ -1324,7 +1254,7 @@ void INDI::BaseDevice::registerProperty(void *p, INDI_PROPERTY_TYPE type)
        pContainer->setProperty(p);
        pContainer->setType(type);
 
-       pAll.push_back(pContainer);
+       appendProperty(pContainer);
    }
     else if (type == INDI_BLOB)
     {
@@ -1340,7 +1270,7 @@ void INDI::BaseDevice::registerProperty(void *p, INDI_PROPERTY_TYPE type)
        pContainer->setProperty(p);
        pContainer->setType(type);
 
-       pAll.push_back(pContainer);
+       appendProperty(pContainer);
 
     }
 
@@ -20,7 +20,11 @@
 #define INDIBASEDRIVER_H
 
 #include <vector>
+#include <deque>
 #include <string>
+#include <unordered_map>
+#include <pthread.h>
+#include <string.h>
 
 #include <locale.h>
 
@@ -156,12 +160,22 @@ public:
     void checkMessage (XMLEle *root);
     void doMessage (XMLEle *msg);
 
-    /** \return Returns a specific message. */
+    /** \return Returns a specific message, or an empty string if \e index is out of range.
+        \note Index 0 is the oldest message kept. Once the log is full, indexes shift as old messages are dropped.
+    */
     std::string messageQueue(int index) const;
 
-    /** \return Returns last message message. */
+    /** \return Returns last message message, or an empty string if there is none. */
     std::string lastMessage();
 
+    /** \brief Set the number of messages kept in the message log. The oldest messages are dropped first.
+        \param capacity maximum number of messages, at least 1.
+    */
+    void setMessageLogCapacity(size_t capacity);
+
+    /** \return Maximum number of messages kept in the message log. */
+    size_t getMessageLogCapacity() const { return messageLogCapacity; }
+
     /** \brief Set the driver's mediator to receive notification of news devices and updated property values. */
     void setMediator(INDI::BaseMediator *med) { mediator = med; }
 
@@ -203,13 +217,38 @@ protected:
 
 private:
 
+    /** \brief Find a property by name in the hash index, regardless of its type or registration. */
+    INDI::Property * findProperty(const char *name);
+    /** \brief Find a property by a linear scan of pAll, for the cases the index alone cannot answer. */
+    INDI::Property * scanProperty(const char *name, INDI_PROPERTY_TYPE type, bool registered, bool skipLights);
+    /** \brief Add a property to pAll and the name index. */
+    void appendProperty(INDI::Property *pContainer);
+    void indexProperty(INDI::Property *pContainer);
+    void unindexProperty(INDI::Property *pContainer);
+
+    struct NameHash
+    {
+        size_t operator()(const char *name) const { return IUHashName(name); }
+    };
+
+    struct NameEqual
+    {
+        bool operator()(const char *a, const char *b) const { return !strcmp(a, b); }
+    };
+
     char *deviceID;
 
     std::vector<INDI::Property *> pAll;
 
+    // Name index over pAll, to the first property of each name. Keys point to the name stored in each property.
+    // pAll and pIndex change together under pLock, lookups only read the index.
+    std::unordered_map<const char *, INDI::Property *, NameHash, NameEqual> pIndex;
+    pthread_mutex_t pLock;
+
     LilXML *lp;
 
-    std::vector<std::string> messageLog;
+    std::deque<std::string> messageLog;
+    size_t messageLogCapacity;
 
     INDI::BaseMediator *mediator;
 
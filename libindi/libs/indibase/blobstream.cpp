@@ -0,0 +1,1036 @@
+/*******************************************************************************
+  Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "blobstream.h"
+#include "indidevapi.h"
+#include "base64.h"
+
+#define BLOB_STREAM_BLOCK   65536       /* base64 characters decoded at once, multiple of 4 */
+#define BLOB_MAX_TAG        4096        /* longest tag accepted inside a streamed element */
+#define BLOB_WRITER_ALIGN   4096        /* alignment of direct I/O buffers, offsets and sizes */
+
+/********************************************************************************************
+ * BLOBFileSink
+ ********************************************************************************************/
+
+INDI::BLOBFileSink::BLOBFileSink(const char *dir, const char *pref) : directory(dir), prefix(pref)
+{
+    sequence = 0;
+    mapped   = false;
+    fd       = -1;
+    map      = NULL;
+    mapSize  = 0;
+    written  = 0;
+}
+
+INDI::BLOBFileSink::~BLOBFileSink()
+{
+    if (fd >= 0)
+        close(false);
+}
+
+bool INDI::BLOBFileSink::open(IBLOB *bp, size_t size)
+{
+    char name[MAXRBUF];
+    snprintf(name, MAXRBUF, "%s/%s_%s_%u%s", directory.c_str(), prefix.c_str(), bp->name, ++sequence, bp->format);
+
+    lastFile.clear();
+    path    = name;
+    written = 0;
+
+    std::string part = path + ".part";
+    fd = ::open(part.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        IDLog("BLOBFileSink: %s: %s\n", part.c_str(), strerror(errno));
+        return false;
+    }
+
+    if (mapped && size > 0)
+    {
+        if (ftruncate(fd, size) == 0)
+        {
+            void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                map     = static_cast<unsigned char *> (addr);
+                mapSize = size;
+            }
+        }
+
+        // Fall back to write() if the file can not be mapped
+        if (map == NULL)
+            IDLog("BLOBFileSink: unable to map %s: %s\n", part.c_str(), strerror(errno));
+    }
+
+    return true;
+}
+
+bool INDI::BLOBFileSink::write(const unsigned char *data, size_t len)
+{
+    if (map)
+    {
+        // The announced size is only a hint, switch to write() if the BLOB turns out larger
+        if (written + len <= mapSize)
+        {
+            memcpy(map + written, data, len);
+            written += len;
+            return true;
+        }
+
+        munmap(map, mapSize);
+        map = NULL;
+        if (lseek(fd, written, SEEK_SET) < 0)
+            return false;
+    }
+
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            IDLog("BLOBFileSink: %s.part: %s\n", path.c_str(), strerror(errno));
+            return false;
+        }
+        data    += n;
+        len     -= n;
+        written += n;
+    }
+
+    return true;
+}
+
+bool INDI::BLOBFileSink::close(bool complete)
+{
+    std::string part = path + ".part";
+    bool rc = complete;
+
+    if (map)
+    {
+        munmap(map, mapSize);
+        map = NULL;
+    }
+
+    if (fd < 0)
+        return false;
+
+    // A mapped file may be shorter than announced
+    if (rc && ftruncate(fd, written) < 0)
+        rc = false;
+
+    if (::close(fd) < 0)
+        rc = false;
+    fd = -1;
+
+    if (rc && rename(part.c_str(), path.c_str()) < 0)
+    {
+        IDLog("BLOBFileSink: %s: %s\n", path.c_str(), strerror(errno));
+        rc = false;
+    }
+
+    if (rc)
+        lastFile = path;
+    else
+        unlink(part.c_str());
+
+    return rc;
+}
+
+/********************************************************************************************
+ * BLOBBufferSink
+ ********************************************************************************************/
+
+INDI::BLOBBufferSink::BLOBBufferSink()
+{
+    buffer   = NULL;
+    capacity = 0;
+    length   = 0;
+    owned    = true;
+}
+
+INDI::BLOBBufferSink::BLOBBufferSink(void *buf, size_t cap)
+{
+    buffer   = static_cast<unsigned char *> (buf);
+    capacity = cap;
+    length   = 0;
+    owned    = false;
+}
+
+INDI::BLOBBufferSink::~BLOBBufferSink()
+{
+    if (owned)
+        free(buffer);
+}
+
+bool INDI::BLOBBufferSink::open(IBLOB *bp, size_t size)
+{
+    INDI_UNUSED(bp);
+
+    length = 0;
+
+    if (owned && size > capacity)
+    {
+        unsigned char *nbuf = (unsigned char *) realloc(buffer, size);
+        if (nbuf == NULL)
+            return false;
+        buffer   = nbuf;
+        capacity = size;
+    }
+
+    return true;
+}
+
+bool INDI::BLOBBufferSink::write(const unsigned char *data, size_t len)
+{
+    if (length + len > capacity)
+    {
+        // The announced size is only a hint
+        if (owned == false)
+            return false;
+
+        size_t ncap = (length + len) * 3 / 2;
+        unsigned char *nbuf = (unsigned char *) realloc(buffer, ncap);
+        if (nbuf == NULL)
+            return false;
+        buffer   = nbuf;
+        capacity = ncap;
+    }
+
+    memcpy(buffer + length, data, len);
+    length += len;
+    return true;
+}
+
+bool INDI::BLOBBufferSink::close(bool complete)
+{
+    return complete;
+}
+
+/********************************************************************************************
+ * BLOBWriterSink
+ ********************************************************************************************/
+
+INDI::BLOBWriterSink::BLOBWriterSink(PathCallback pathCb, DoneCallback doneCb, size_t size, int count)
+    : pathCallback(pathCb), doneCallback(doneCb)
+{
+    // Whole blocks keep every write but the last one aligned for O_DIRECT
+    bufferSize = (size + BLOB_WRITER_ALIGN - 1) / BLOB_WRITER_ALIGN * BLOB_WRITER_ALIGN;
+    direct     = false;
+    sync       = true;
+    stopping   = false;
+    busy       = false;
+    current    = NULL;
+    currentLen = 0;
+    fd         = -1;
+    fileDirect = false;
+    fileFailed = false;
+    offset     = 0;
+
+    for (int i=0; i < count; i++)
+    {
+        void *buf = NULL;
+        if (posix_memalign(&buf, BLOB_WRITER_ALIGN, bufferSize) == 0)
+            buffers.push_back(static_cast<unsigned char *> (buf));
+    }
+    freeBuffers = buffers;
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&jobCond, NULL);
+    pthread_cond_init(&freeCond, NULL);
+    pthread_cond_init(&idleCond, NULL);
+
+    writerStarted = (pthread_create(&writerThread, NULL, &INDI::BLOBWriterSink::writerHelper, this) == 0);
+    if (writerStarted == false)
+        IDLog("BLOBWriterSink: unable to start writer thread.\n");
+}
+
+INDI::BLOBWriterSink::~BLOBWriterSink()
+{
+    if (current)
+        close(false);
+
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_signal(&jobCond);
+    pthread_mutex_unlock(&lock);
+
+    if (writerStarted)
+        pthread_join(writerThread, NULL);
+
+    for (size_t i=0; i < buffers.size(); i++)
+        free(buffers[i]);
+
+    pthread_cond_destroy(&idleCond);
+    pthread_cond_destroy(&freeCond);
+    pthread_cond_destroy(&jobCond);
+    pthread_mutex_destroy(&lock);
+}
+
+bool INDI::BLOBWriterSink::open(IBLOB *bp, size_t size)
+{
+    if (writerStarted == false || buffers.empty())
+        return false;
+
+    Job job;
+    job.op   = JOB_OPEN;
+    job.path = pathCallback(bp, size);
+    job.size = size;
+    if (job.path.empty())
+        return false;
+
+    current    = takeBuffer();
+    currentLen = 0;
+
+    queue(job);
+    return true;
+}
+
+bool INDI::BLOBWriterSink::write(const unsigned char *data, size_t len)
+{
+    while (len > 0)
+    {
+        size_t n = bufferSize - currentLen < len ? bufferSize - currentLen : len;
+        memcpy(current + currentLen, data, n);
+        currentLen += n;
+        data       += n;
+        len        -= n;
+
+        if (currentLen == bufferSize)
+        {
+            Job job;
+            job.op  = JOB_DATA;
+            job.buf = current;
+            job.len = currentLen;
+            queue(job);
+
+            // Waits here only if the disk is behind by all buffers
+            current    = takeBuffer();
+            currentLen = 0;
+        }
+    }
+
+    return true;
+}
+
+bool INDI::BLOBWriterSink::close(bool complete)
+{
+    Job job;
+
+    if (current == NULL)
+        return false;
+
+    if (currentLen > 0)
+    {
+        job.op  = JOB_DATA;
+        job.buf = current;
+        job.len = currentLen;
+        queue(job);
+    }
+    else
+    {
+        pthread_mutex_lock(&lock);
+        freeBuffers.push_back(current);
+        pthread_cond_signal(&freeCond);
+        pthread_mutex_unlock(&lock);
+    }
+
+    current    = NULL;
+    currentLen = 0;
+
+    job.op       = JOB_CLOSE;
+    job.complete = complete;
+    queue(job);
+
+    // The outcome is reported by the done callback once the file is written
+    return complete;
+}
+
+void INDI::BLOBWriterSink::flush()
+{
+    pthread_mutex_lock(&lock);
+    while (writerStarted && (!jobs.empty() || busy))
+        pthread_cond_wait(&idleCond, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+void INDI::BLOBWriterSink::queue(const Job & job)
+{
+    pthread_mutex_lock(&lock);
+    jobs.push_back(job);
+    pthread_cond_signal(&jobCond);
+    pthread_mutex_unlock(&lock);
+}
+
+unsigned char * INDI::BLOBWriterSink::takeBuffer()
+{
+    pthread_mutex_lock(&lock);
+    while (freeBuffers.empty())
+        pthread_cond_wait(&freeCond, &lock);
+    unsigned char *buf = freeBuffers.back();
+    freeBuffers.pop_back();
+    pthread_mutex_unlock(&lock);
+
+    return buf;
+}
+
+void * INDI::BLOBWriterSink::writerHelper(void *context)
+{
+    (static_cast<INDI::BLOBWriterSink *> (context))->writerLoop();
+    return NULL;
+}
+
+void INDI::BLOBWriterSink::writerLoop()
+{
+    pthread_mutex_lock(&lock);
+
+    for (;;)
+    {
+        while (jobs.empty() && !stopping)
+        {
+            busy = false;
+            pthread_cond_broadcast(&idleCond);
+            pthread_cond_wait(&jobCond, &lock);
+        }
+
+        if (jobs.empty())
+            break;
+
+        Job job = jobs.front();
+        jobs.pop_front();
+        busy = true;
+        pthread_mutex_unlock(&lock);
+
+        switch (job.op)
+        {
+        case JOB_OPEN:
+            openFile(job.path, job.size);
+            break;
+
+        case JOB_DATA:
+            if (fd >= 0 && !fileFailed && writeBuffer(job.buf, job.len) == false)
+                fileFailed = true;
+
+            pthread_mutex_lock(&lock);
+            freeBuffers.push_back(job.buf);
+            pthread_cond_signal(&freeCond);
+            pthread_mutex_unlock(&lock);
+            break;
+
+        case JOB_CLOSE:
+            finishFile(job.complete);
+            break;
+        }
+
+        pthread_mutex_lock(&lock);
+    }
+
+    busy = false;
+    pthread_cond_broadcast(&idleCond);
+    pthread_mutex_unlock(&lock);
+}
+
+void INDI::BLOBWriterSink::openFile(const std::string & filePath, size_t size)
+{
+    std::string part = filePath + ".part";
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+    path       = filePath;
+    offset     = 0;
+    fileFailed = false;
+    fileDirect = false;
+
+#ifdef O_DIRECT
+    if (direct)
+    {
+        fd = ::open(part.c_str(), flags | O_DIRECT, 0644);
+        fileDirect = (fd >= 0);
+    }
+    else
+        fd = -1;
+
+    // Not every file system supports direct I/O
+    if (fd < 0)
+#endif
+        fd = ::open(part.c_str(), flags, 0644);
+
+    if (fd < 0)
+    {
+        IDLog("BLOBWriterSink: %s: %s\n", part.c_str(), strerror(errno));
+        return;
+    }
+
+    // Reserve the blocks up front so the file is laid out contiguously and a full disk fails early
+    if (size > 0)
+    {
+        int rc = posix_fallocate(fd, 0, size);
+        if (rc == ENOSPC)
+        {
+            IDLog("BLOBWriterSink: %s: %s\n", part.c_str(), strerror(rc));
+            fileFailed = true;
+        }
+    }
+}
+
+bool INDI::BLOBWriterSink::writeBuffer(unsigned char *buf, size_t len)
+{
+    size_t wlen = len;
+
+    // Direct I/O needs whole blocks, the padding of the last one is truncated when the file is finished
+    if (fileDirect && wlen % BLOB_WRITER_ALIGN)
+    {
+        wlen = (len + BLOB_WRITER_ALIGN - 1) / BLOB_WRITER_ALIGN * BLOB_WRITER_ALIGN;
+        memset(buf + len, 0, wlen - len);
+    }
+
+    for (size_t done=0; done < wlen; )
+    {
+        ssize_t n = pwrite(fd, buf + done, wlen - done, offset + done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+#ifdef O_DIRECT
+            if (errno == EINVAL && fileDirect)
+            {
+                // The file system refused the alignment, continue through the page cache
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+                fileDirect = false;
+                wlen = len;
+                continue;
+            }
+#endif
+
+            IDLog("BLOBWriterSink: %s.part: %s\n", path.c_str(), strerror(errno));
+            return false;
+        }
+        done += n;
+    }
+
+    offset += len;
+    return true;
+}
+
+void INDI::BLOBWriterSink::finishFile(bool complete)
+{
+    std::string part = path + ".part";
+    bool ok = complete && !fileFailed && fd >= 0;
+    int err = 0;
+
+    if (fd >= 0)
+    {
+        // Drop the preallocated space beyond the data and the direct I/O padding
+        if (ok && ftruncate(fd, offset) < 0)
+        {
+            ok  = false;
+            err = errno;
+        }
+
+        if (ok && sync && fdatasync(fd) < 0)
+        {
+            ok  = false;
+            err = errno;
+        }
+
+        if (::close(fd) < 0 && ok)
+        {
+            ok  = false;
+            err = errno;
+        }
+        fd = -1;
+    }
+
+    if (ok && rename(part.c_str(), path.c_str()) < 0)
+    {
+        ok  = false;
+        err = errno;
+    }
+
+    if (ok && sync)
+    {
+        // Make the rename itself durable
+        std::string dir = path.substr(0, path.find_last_of('/') + 1);
+        int dfd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_CLOEXEC);
+        if (dfd >= 0)
+        {
+            fsync(dfd);
+            ::close(dfd);
+        }
+    }
+
+    if (ok == false)
+    {
+        // Open and write errors were logged when they happened
+        if (complete && err)
+            IDLog("BLOBWriterSink: unable to write %s: %s\n", path.c_str(), strerror(err));
+        unlink(part.c_str());
+    }
+
+    if (doneCallback)
+        doneCallback(path, ok);
+}
+
+/********************************************************************************************
+ * BLOBStreamParser
+ ********************************************************************************************/
+
+INDI::BLOBStreamParser::BLOBStreamParser(Resolver res, EmptyCallback emp) : resolver(res), empty(emp)
+{
+    state      = PASS;
+    quoted     = false;
+    quote      = 0;
+    bp         = NULL;
+    sink       = NULL;
+    received   = 0;
+    reported   = 0;
+    failed     = false;
+    b64        = NULL;
+    b64Len     = 0;
+    raw        = NULL;
+    inflated   = NULL;
+    compressed = false;
+    zsInit     = false;
+    zsEnded    = false;
+    memset(&zs, 0, sizeof(zs));
+}
+
+INDI::BLOBStreamParser::~BLOBStreamParser()
+{
+    reset();
+
+    if (zsInit)
+        inflateEnd(&zs);
+
+    free(b64);
+    free(raw);
+    free(inflated);
+}
+
+void INDI::BLOBStreamParser::reset()
+{
+    if (sink)
+        closeBLOB(false);
+
+    state = PASS;
+    tag.clear();
+}
+
+size_t INDI::BLOBStreamParser::process(const char *buf, size_t len, std::string & xml)
+{
+    size_t i = 0, passStart = 0;
+    const char *lt;
+
+    while (i < len)
+    {
+        switch (state)
+        {
+        case PASS:
+            // Text content can not contain '<', every '<' starts a tag
+            lt = static_cast<const char *> (memchr(buf+i, '<', len-i));
+            if (lt == NULL)
+            {
+                i = len;
+                break;
+            }
+            i = lt - buf + 1;
+            tag.clear();
+            state = TAG_NAME;
+            break;
+
+        case TAG_NAME:
+            if ((isalnum(buf[i]) || buf[i] == '/') && tag.size() < 16)
+                tag += buf[i++];
+            else if (tag == "setBLOBVector" && isspace(buf[i]))
+            {
+                tag    = "<setBLOBVector";
+                quoted = false;
+                state  = START_TAG;
+            }
+            else
+                state = PASS;
+            break;
+
+        case START_TAG:
+        case CHILD_TAG:
+        {
+            char c = buf[i++];
+            tag += c;
+
+            if (quoted)
+            {
+                if (c == quote)
+                    quoted = false;
+            }
+            else if (c == '"' || c == '\'')
+            {
+                quoted = true;
+                quote  = c;
+            }
+            else if (c == '>')
+            {
+                if (state == CHILD_TAG)
+                {
+                    if (childTag())
+                    {
+                        // End of the streamed vector, hand the closing tag to the XML parser
+                        xml += "</setBLOBVector>\n";
+                        passStart = i;
+                    }
+                }
+                else if (tag[tag.size()-2] != '/' && startVector())
+                {
+                    // Let the caller dispatch everything up to here before the BLOB callbacks run
+                    xml.append(buf+passStart, i-passStart);
+                    state = VECTOR_BODY;
+                    return i;
+                }
+                else
+                    state = PASS;
+            }
+            else if (tag.size() > BLOB_MAX_TAG)
+            {
+                IDLog("BLOBStreamParser: tag too long, ignoring %.32s...\n", tag.c_str());
+                if (state == START_TAG)
+                    state = PASS;
+                else
+                {
+                    quoted = false;
+                    tag = "<";
+                }
+            }
+            break;
+        }
+
+        case VECTOR_BODY:
+            lt = static_cast<const char *> (memchr(buf+i, '<', len-i));
+            if (lt == NULL)
+            {
+                i = len;
+                break;
+            }
+            i = lt - buf + 1;
+            tag    = "<";
+            quoted = false;
+            state  = CHILD_TAG;
+            break;
+
+        case BLOB_DATA:
+        {
+            lt = static_cast<const char *> (memchr(buf+i, '<', len-i));
+            size_t end = lt ? lt - buf : len;
+
+            if (sink && !failed && decode(buf+i, end-i) == false)
+                failed = true;
+
+            i = end;
+            if (lt)
+            {
+                closeBLOB(true);
+                i++;
+                tag    = "<";
+                quoted = false;
+                state  = CHILD_TAG;
+            }
+            break;
+        }
+        }
+    }
+
+    if (state <= START_TAG)
+        xml.append(buf+passStart, len-passStart);
+
+    if (state == BLOB_DATA && sink && !failed && progress && received != reported)
+    {
+        reported = received;
+        progress(bp, received, IPS_BUSY);
+    }
+
+    return len;
+}
+
+bool INDI::BLOBStreamParser::startVector()
+{
+    device   = attribute(tag, "device");
+    property = attribute(tag, "name");
+
+    return resolver(device.c_str(), property.c_str(), NULL, NULL, NULL, NULL);
+}
+
+bool INDI::BLOBStreamParser::childTag()
+{
+    if (tag.compare(0, 15, "</setBLOBVector") == 0)
+    {
+        state = PASS;
+        return true;
+    }
+
+    state = VECTOR_BODY;
+
+    if (tag.compare(0, 8, "<oneBLOB") != 0 || isspace(tag[8]) == 0)
+        return false;
+
+    std::string name   = attribute(tag, "name");
+    std::string format = attribute(tag, "format");
+    size_t size        = strtoul(attribute(tag, "size").c_str(), NULL, 10);
+
+    // An empty element or a size of 0 only carries a state change
+    if (size == 0 || tag[tag.size()-2] == '/')
+    {
+        IBLOB *ebp = NULL;
+        if (resolver(device.c_str(), property.c_str(), name.c_str(), &ebp, NULL, NULL))
+        {
+            ebp->size = 0;
+            if (empty)
+                empty(ebp);
+        }
+        return false;
+    }
+
+    openBLOB(name.c_str(), format.c_str(), size);
+    state = BLOB_DATA;
+    return false;
+}
+
+void INDI::BLOBStreamParser::openBLOB(const char *name, const char *format, size_t size)
+{
+    failed   = false;
+    received = 0;
+    reported = 0;
+    b64Len   = 0;
+
+    if (resolver(device.c_str(), property.c_str(), name, &bp, &sink, &progress) == false)
+    {
+        IDLog("BLOBStreamParser: %s.%s.%s not found, discarding BLOB.\n", device.c_str(), property.c_str(), name);
+        bp   = NULL;
+        sink = NULL;
+        return;
+    }
+
+    strncpy(bp->format, format, MAXINDIFORMAT);
+    bp->format[MAXINDIFORMAT-1] = '\0';
+
+    size_t flen = strlen(bp->format);
+    compressed = (flen > 2 && strcmp(bp->format + flen - 2, ".z") == 0);
+    if (compressed)
+        bp->format[flen-2] = '\0';
+
+    if (b64 == NULL)
+    {
+        b64      = (char *) malloc(BLOB_STREAM_BLOCK);
+        raw      = (unsigned char *) malloc(BLOB_STREAM_BLOCK/4*3);
+        inflated = (unsigned char *) malloc(BLOB_STREAM_BLOCK);
+    }
+
+    if (b64 == NULL || raw == NULL || inflated == NULL)
+    {
+        IDLog("BLOBStreamParser: unable to allocate decoding buffers.\n");
+        failed = true;
+    }
+    else if (compressed)
+    {
+        zsEnded = false;
+        int r = zsInit ? inflateReset(&zs) : inflateInit(&zs);
+        zsInit = zsInit || (r == Z_OK);
+        if (r != Z_OK)
+        {
+            IDLog("BLOBStreamParser: %s.%s.%s inflateInit error: %d\n", device.c_str(), property.c_str(), name, r);
+            failed = true;
+        }
+    }
+
+    // The BLOB is discarded if it can not be decoded or the sink refuses it
+    if (failed || sink->open(bp, size) == false)
+    {
+        bp   = NULL;
+        sink = NULL;
+        progress = ProgressCallback();
+    }
+}
+
+bool INDI::BLOBStreamParser::decode(const char *data, size_t len)
+{
+    for (size_t k = 0; k < len; k++)
+    {
+        // Drop the line breaks and indentation between base64 lines
+        if (data[k] > ' ')
+            b64[b64Len++] = data[k];
+
+        if (b64Len == BLOB_STREAM_BLOCK && flushBase64(false) == false)
+            return false;
+    }
+
+    return true;
+}
+
+bool INDI::BLOBStreamParser::flushBase64(bool last)
+{
+    size_t n = b64Len & ~((size_t) 3);
+
+    if (last && n != b64Len)
+    {
+        IDLog("BLOBStreamParser: %s.%s.%s truncated base64 data.\n", device.c_str(), property.c_str(), bp->name);
+        return false;
+    }
+
+    if (n == 0)
+        return true;
+
+    int rawLen = from64tobits_fast((char *) raw, b64, n);
+
+    b64Len -= n;
+    memmove(b64, b64 + n, b64Len);
+
+    if (compressed)
+        return inflateBlock(raw, rawLen);
+
+    received += rawLen;
+    return sink->write(raw, rawLen);
+}
+
+bool INDI::BLOBStreamParser::inflateBlock(const unsigned char *data, size_t len)
+{
+    zs.next_in  = const_cast<Bytef *> (data);
+    zs.avail_in = len;
+
+    do
+    {
+        if (zsEnded)
+        {
+            IDLog("BLOBStreamParser: %s.%s.%s data after end of compressed stream.\n", device.c_str(), property.c_str(), bp->name);
+            return false;
+        }
+
+        zs.next_out  = inflated;
+        zs.avail_out = BLOB_STREAM_BLOCK;
+
+        int r = inflate(&zs, Z_NO_FLUSH);
+        if (r == Z_STREAM_END)
+            zsEnded = true;
+        else if (r != Z_OK && r != Z_BUF_ERROR)
+        {
+            IDLog("BLOBStreamParser: %s.%s.%s compression error: %d\n", device.c_str(), property.c_str(), bp->name, r);
+            return false;
+        }
+
+        size_t produced = BLOB_STREAM_BLOCK - zs.avail_out;
+        received += produced;
+        if (produced > 0 && sink->write(inflated, produced) == false)
+            return false;
+
+    } while (zs.avail_in > 0 || zs.avail_out == 0);
+
+    return true;
+}
+
+void INDI::BLOBStreamParser::closeBLOB(bool complete)
+{
+    if (sink == NULL)
+        return;
+
+    bool ok = complete && !failed && flushBase64(true);
+
+    if (ok && compressed && zsEnded == false)
+    {
+        IDLog("BLOBStreamParser: %s.%s.%s truncated compressed data.\n", device.c_str(), property.c_str(), bp->name);
+        ok = false;
+    }
+
+    ok = sink->close(ok) && ok;
+
+    // The data went to the sink, do not leave the previous BLOB behind
+    free(bp->blob);
+    bp->blob    = NULL;
+    bp->bloblen = 0;
+    bp->size    = received;
+
+    IBLOB *done = bp;
+    ProgressCallback cb = progress;
+
+    bp       = NULL;
+    sink     = NULL;
+    progress = ProgressCallback();
+
+    if (cb)
+        cb(done, received, ok ? IPS_OK : IPS_ALERT);
+}
+
+std::string INDI::BLOBStreamParser::attribute(const std::string & tag, const char *name)
+{
+    size_t nlen = strlen(name);
+    size_t pos  = tag.find_first_of(" \t\r\n");
+
+    while (pos != std::string::npos && pos < tag.size())
+    {
+        pos = tag.find_first_not_of(" \t\r\n", pos);
+        if (pos == std::string::npos)
+            break;
+
+        size_t eq = tag.find('=', pos);
+        if (eq == std::string::npos)
+            break;
+
+        size_t nend = tag.find_last_not_of(" \t\r\n", eq-1) + 1;
+        size_t q = tag.find_first_of("'\"", eq);
+        if (q == std::string::npos)
+            break;
+        size_t qend = tag.find(tag[q], q+1);
+        if (qend == std::string::npos)
+            break;
+
+        if (nend - pos == nlen && tag.compare(pos, nlen, name) == 0)
+        {
+            std::string value;
+            for (size_t k = q+1; k < qend; k++)
+            {
+                static const char *entities[][2] = { {"&amp;", "&"}, {"&lt;", "<"}, {"&gt;", ">"},
+                                                     {"&apos;", "'"}, {"&quot;", "\""} };
+                bool replaced = false;
+                if (tag[k] == '&')
+                {
+                    for (int e = 0; e < 5 && !replaced; e++)
+                    {
+                        size_t elen = strlen(entities[e][0]);
+                        if (tag.compare(k, elen, entities[e][0]) == 0)
+                        {
+                            value += entities[e][1];
+                            k += elen - 1;
+                            replaced = true;
+                        }
+                    }
+                }
+                if (!replaced)
+                    value += tag[k];
+            }
+            return value;
+        }
+
+        pos = qend + 1;
+    }
+
+    return std::string();
+}
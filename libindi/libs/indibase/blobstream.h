@@ -0,0 +1,314 @@
+/*******************************************************************************
+  Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#ifndef INDIBLOBSTREAM_H
+#define INDIBLOBSTREAM_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+
+#include <pthread.h>
+#include <zlib.h>
+
+#include "indiapi.h"
+#include "indibase.h"
+
+/**
+ * \class INDI::BLOBSink
+   \brief Destination of BLOBs decoded incrementally by INDI::BaseClient.
+
+   A sink registered with INDI::BaseClient::setBLOBSink() receives the decoded, and if needed inflated, content of every
+   BLOB of the watched property while it arrives from the server, so the client never holds a whole BLOB in memory.
+   For each BLOB, open() is called once, followed by any number of write() calls and exactly one close().
+
+   All functions are called on the thread driving the reactor of the client.
+ */
+class INDI::BLOBSink
+{
+public:
+    virtual ~BLOBSink() {}
+
+    /** \brief Start receiving a BLOB.
+        \param bp BLOB element being received. Its format is already set, without the compression suffix.
+        \param size Size of the decoded BLOB announced by the driver.
+        \return True to receive the BLOB, false to discard it.
+    */
+    virtual bool open(IBLOB *bp, size_t size) = 0;
+
+    /** \brief Append decoded bytes to the current BLOB.
+        \return True if successful, false to abort the BLOB.
+    */
+    virtual bool write(const unsigned char *data, size_t len) = 0;
+
+    /** \brief Finish the current BLOB.
+        \param complete True if the BLOB was received and decoded completely, false if it was aborted.
+        \return True if successful, false otherwise.
+    */
+    virtual bool close(bool complete) = 0;
+};
+
+/**
+ * \class INDI::BLOBFileSink
+   \brief Writes each BLOB to its own file.
+
+   Files are named <em>directory/prefix_NAME_SEQ.FORMAT</em> where NAME is the BLOB element name and SEQ a counter
+   starting at 1. The file is written as <em>.part</em> and renamed when the BLOB is complete, so readers never see a
+   partial frame. In mapped mode, the file is sized to the announced BLOB size up front and filled through a shared
+   memory mapping instead of write() calls.
+ */
+class INDI::BLOBFileSink : public INDI::BLOBSink
+{
+public:
+    BLOBFileSink(const char *directory, const char *prefix = "blob");
+    virtual ~BLOBFileSink();
+
+    /** \brief Fill files through a memory mapping, must be set before the first BLOB is opened. */
+    void setMapped(bool enable) { mapped = enable; }
+
+    /** \returns Path of the last completed file, empty if none. */
+    const std::string & getLastFile() const { return lastFile; }
+
+    virtual bool open(IBLOB *bp, size_t size);
+    virtual bool write(const unsigned char *data, size_t len);
+    virtual bool close(bool complete);
+
+private:
+    std::string directory, prefix;
+    std::string path, lastFile;
+    unsigned int sequence;
+    bool mapped;
+
+    int fd;
+    unsigned char *map;
+    size_t mapSize, written;
+};
+
+/**
+ * \class INDI::BLOBBufferSink
+   \brief Stores the last BLOB in memory.
+
+   The sink either fills a fixed buffer supplied by the caller, aborting BLOBs that do not fit, or a buffer it
+   allocates once with the announced BLOB size and reuses for every following BLOB of the same or smaller size.
+ */
+class INDI::BLOBBufferSink : public INDI::BLOBSink
+{
+public:
+    /** \brief Sink using its own buffer */
+    BLOBBufferSink();
+    /** \brief Sink filling \e buffer, which must remain valid while the sink is registered */
+    BLOBBufferSink(void *buffer, size_t capacity);
+    virtual ~BLOBBufferSink();
+
+    /** \returns Buffer holding the BLOB */
+    unsigned char * getBuffer() const { return buffer; }
+    /** \returns Number of bytes of the BLOB, which is complete only if the last close() reported so. */
+    size_t getLength() const { return length; }
+
+    virtual bool open(IBLOB *bp, size_t size);
+    virtual bool write(const unsigned char *data, size_t len);
+    virtual bool close(bool complete);
+
+private:
+    unsigned char *buffer;
+    size_t capacity, length;
+    bool owned;
+};
+
+#define BLOB_WRITER_BUFFER  (4*1024*1024)    /* size of each buffer of INDI::BLOBWriterSink */
+#define BLOB_WRITER_BUFFERS 4                  /* buffers queued before the receiving thread waits for the disk */
+
+/**
+ * \class INDI::BLOBWriterSink
+   \brief Writes each BLOB to its own file from a background thread.
+
+   Decoded data is copied into a few large buffers aligned for direct I/O and written by a dedicated thread, so the
+   thread receiving BLOBs only waits for the disk when all buffers are queued. Each file is preallocated with the
+   announced BLOB size, written as <em>.part</em> and renamed once complete. With synchronous mode, which is the
+   default, the data and the rename are flushed to the device before the done callback reports the file durable.
+
+   The destination of each BLOB is chosen by the path callback when the BLOB starts. The done callback is invoked
+   on the writer thread, in the order the BLOBs were received.
+ */
+class INDI::BLOBWriterSink : public INDI::BLOBSink
+{
+public:
+
+    /** \brief Return the path of the file receiving \e bp, or an empty string to discard the BLOB. */
+    typedef std::function<std::string (IBLOB *bp, size_t size)> PathCallback;
+
+    /** \brief Notification that the file at \e path is written, or failed if \e ok is false. */
+    typedef std::function<void (const std::string & path, bool ok)> DoneCallback;
+
+    BLOBWriterSink(PathCallback path, DoneCallback done, size_t bufferSize = BLOB_WRITER_BUFFER,
+                   int bufferCount = BLOB_WRITER_BUFFERS);
+    virtual ~BLOBWriterSink();
+
+    /** \brief Bypass the page cache with O_DIRECT where the file system supports it. Disabled by default. */
+    void setDirect(bool enable) { direct = enable; }
+
+    /** \brief Flush each file to the device before it is reported done. Enabled by default. */
+    void setSync(bool enable) { sync = enable; }
+
+    /** \brief Wait until every queued file is written and reported. */
+    void flush();
+
+    virtual bool open(IBLOB *bp, size_t size);
+    virtual bool write(const unsigned char *data, size_t len);
+    virtual bool close(bool complete);
+
+private:
+
+    enum { JOB_OPEN, JOB_DATA, JOB_CLOSE };
+
+    typedef struct
+    {
+        int op;
+        std::string path;       /* JOB_OPEN */
+        size_t size;            /* JOB_OPEN, announced size */
+        unsigned char *buf;     /* JOB_DATA */
+        size_t len;             /* JOB_DATA */
+        bool complete;          /* JOB_CLOSE */
+    } Job;
+
+    static void * writerHelper(void *context);
+    void writerLoop();
+    void queue(const Job & job);
+    unsigned char * takeBuffer();
+
+    // Writer thread
+    void openFile(const std::string & path, size_t size);
+    bool writeBuffer(unsigned char *buf, size_t len);
+    void finishFile(bool complete);
+
+    PathCallback pathCallback;
+    DoneCallback doneCallback;
+    size_t bufferSize;
+    bool direct, sync;
+
+    std::vector<unsigned char *> buffers, freeBuffers;
+    std::deque<Job> jobs;
+    pthread_mutex_t lock;
+    pthread_cond_t jobCond, freeCond, idleCond;
+    pthread_t writerThread;
+    bool writerStarted, stopping, busy;
+
+    // Receiving thread
+    unsigned char *current;
+    size_t currentLen;
+
+    // Writer thread
+    int fd;
+    bool fileDirect, fileFailed;
+    std::string path;
+    size_t offset;
+};
+
+/**
+ * \class INDI::BLOBStreamParser
+   \brief Splits the incoming XML stream of INDI::BaseClient and decodes the BLOBs of watched properties.
+
+   The parser scans the bytes received from the server for setBLOBVector elements. Elements of properties with a
+   registered sink are reduced to their opening and closing tags before reaching the XML parser, so the property
+   state and message are processed as usual, while the content of their oneBLOB elements is base64 decoded and
+   inflated in small blocks and handed to the sink. Everything else is passed through unchanged.
+
+   This class is used internally by INDI::BaseClient.
+ */
+class INDI::BLOBStreamParser
+{
+public:
+
+    /** \brief Progress callback, see INDI::BaseClient::setBLOBSink() */
+    typedef std::function<void (IBLOB *bp, size_t received, IPState state)> ProgressCallback;
+
+    /** \brief Find the sink of a BLOB.
+        \return True if \e bp of \e device and \e property is streamed, in which case \e bp, \e sink and \e progress are set.
+    */
+    typedef std::function<bool (const char *device, const char *property, const char *name, IBLOB **bp,
+                                INDI::BLOBSink **sink, ProgressCallback *progress)> Resolver;
+
+    /** \brief Notification of state only BLOBs, with an announced size of 0 */
+    typedef std::function<void (IBLOB *bp)> EmptyCallback;
+
+    BLOBStreamParser(Resolver resolver, EmptyCallback empty);
+    ~BLOBStreamParser();
+
+    /** \brief Process received bytes.
+        \param buf bytes received from the server.
+        \param len number of bytes.
+        \param xml receives the bytes to pass on to the XML parser.
+        \return Number of bytes consumed. The parser stops after the opening tag of a streamed setBLOBVector so the
+        caller can dispatch the preceding messages first, and must be called again with the remaining bytes.
+    */
+    size_t process(const char *buf, size_t len, std::string & xml);
+
+    /** \brief Abort a BLOB in progress and forget any partial element, e.g. when the connection is closed. */
+    void reset();
+
+    /** \returns True if the parser is not inside a streamed element, so the stream may bypass it. */
+    bool isIdle() const { return state <= START_TAG; }
+
+private:
+
+    enum
+    {
+        PASS,           /* outside of streamed elements */
+        TAG_NAME,       /* reading the name of an element of the stream */
+        START_TAG,      /* reading the attributes of a setBLOBVector start tag */
+        VECTOR_BODY,    /* between the children of a streamed setBLOBVector */
+        CHILD_TAG,      /* reading a tag inside a streamed setBLOBVector */
+        BLOB_DATA       /* reading the base64 content of a oneBLOB */
+    };
+
+    bool startVector();
+    bool childTag();
+    void openBLOB(const char *name, const char *format, size_t size);
+    bool decode(const char *data, size_t len);
+    bool flushBase64(bool last);
+    bool inflateBlock(const unsigned char *data, size_t len);
+    void closeBLOB(bool complete);
+
+    static std::string attribute(const std::string & tag, const char *name);
+
+    Resolver resolver;
+    EmptyCallback empty;
+
+    int state;
+    bool quoted;
+    char quote;
+    std::string tag;                /* tag being read */
+    std::string device, property;   /* streamed setBLOBVector */
+
+    IBLOB *bp;
+    INDI::BLOBSink *sink;
+    ProgressCallback progress;
+    size_t received, reported;      /* decoded bytes, and bytes last passed to the progress callback */
+    bool failed;
+
+    char *b64;                      /* base64 characters not decoded yet, whitespace removed */
+    size_t b64Len;
+    unsigned char *raw;             /* decoded block */
+    unsigned char *inflated;        /* inflated block */
+    bool compressed;
+    z_stream zs;
+    bool zsInit, zsEnded;
+};
+
+#endif // INDIBLOBSTREAM_H
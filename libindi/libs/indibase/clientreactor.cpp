@@ -0,0 +1,393 @@
+/*******************************************************************************
+  Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <vector>
+
+#ifdef __linux__
+#define REACTOR_USE_EPOLL
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#include "clientreactor.h"
+#include "indidevapi.h"
+
+#define REACTOR_MAX_EVENTS  64
+
+static pthread_once_t defaultOnce = PTHREAD_ONCE_INIT;
+static INDI::ClientReactor *defaultReactor = NULL;
+
+static void createDefaultReactor()
+{
+    defaultReactor = new INDI::ClientReactor();
+    defaultReactor->start();
+}
+
+INDI::ClientReactor::ClientReactor()
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&dispatchDone, NULL);
+
+    threadStarted = false;
+    dispatching   = false;
+    stopRequested = false;
+    currentFD     = -1;
+
+    wakeFD[0] = wakeFD[1] = -1;
+    if (pipe(wakeFD) < 0)
+        IDLog("ClientReactor: wakeup pipe: %s\n", strerror(errno));
+    else
+    {
+        for (int i=0; i < 2; i++)
+        {
+            fcntl(wakeFD[i], F_SETFL, fcntl(wakeFD[i], F_GETFL, 0) | O_NONBLOCK);
+            fcntl(wakeFD[i], F_SETFD, FD_CLOEXEC);
+        }
+    }
+
+#ifdef REACTOR_USE_EPOLL
+    pollFD = epoll_create(REACTOR_MAX_EVENTS);
+    if (pollFD < 0)
+        IDLog("ClientReactor: epoll_create: %s\n", strerror(errno));
+    else
+    {
+        fcntl(pollFD, F_SETFD, FD_CLOEXEC);
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events  = EPOLLIN;
+        ev.data.fd = wakeFD[0];
+        if (wakeFD[0] >= 0)
+            epoll_ctl(pollFD, EPOLL_CTL_ADD, wakeFD[0], &ev);
+    }
+#else
+    pollFD = -1;
+#endif
+}
+
+INDI::ClientReactor::~ClientReactor()
+{
+    stop();
+
+    if (pollFD >= 0)
+        close(pollFD);
+    if (wakeFD[0] >= 0)
+        close(wakeFD[0]);
+    if (wakeFD[1] >= 0)
+        close(wakeFD[1]);
+
+    pthread_cond_destroy(&dispatchDone);
+    pthread_mutex_destroy(&lock);
+}
+
+INDI::ClientReactor * INDI::ClientReactor::getDefault()
+{
+    pthread_once(&defaultOnce, createDefaultReactor);
+    return defaultReactor;
+}
+
+bool INDI::ClientReactor::addFD(int fd, ReactorCallback *callback, void *userdata)
+{
+    pthread_mutex_lock(&lock);
+
+    if (fds.find(fd) != fds.end())
+    {
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+
+#ifdef REACTOR_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(pollFD, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        IDLog("ClientReactor: unable to watch fd %d: %s\n", fd, strerror(errno));
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+#endif
+
+    Registration reg;
+    reg.callback = callback;
+    reg.userdata = userdata;
+    reg.writable = false;
+    fds[fd] = reg;
+
+    pthread_mutex_unlock(&lock);
+
+#ifndef REACTOR_USE_EPOLL
+    wakeup();
+#endif
+
+    return true;
+}
+
+void INDI::ClientReactor::removeFD(int fd)
+{
+    bool self = isReactorThread();
+
+    pthread_mutex_lock(&lock);
+
+    if (fds.erase(fd) > 0)
+    {
+#ifdef REACTOR_USE_EPOLL
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        epoll_ctl(pollFD, EPOLL_CTL_DEL, fd, &ev);
+#endif
+    }
+
+    // Callbacks run without the lock held, wait for a running callback of this descriptor to return.
+    while (!self && currentFD == fd)
+        pthread_cond_wait(&dispatchDone, &lock);
+
+    pthread_mutex_unlock(&lock);
+}
+
+void INDI::ClientReactor::setWritable(int fd, bool enable)
+{
+    pthread_mutex_lock(&lock);
+
+    std::map<int, Registration>::iterator it = fds.find(fd);
+    if (it == fds.end() || it->second.writable == enable)
+    {
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    it->second.writable = enable;
+
+#ifdef REACTOR_USE_EPOLL
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN | (enable ? EPOLLOUT : 0);
+    ev.data.fd = fd;
+    epoll_ctl(pollFD, EPOLL_CTL_MOD, fd, &ev);
+#endif
+
+    pthread_mutex_unlock(&lock);
+
+#ifndef REACTOR_USE_EPOLL
+    if (!isReactorThread())
+        wakeup();
+#endif
+}
+
+int INDI::ClientReactor::process(int timeout_ms)
+{
+    std::vector<int> readyFD, readyEvents;
+    int n=0;
+
+    pthread_mutex_lock(&lock);
+    dispatching    = true;
+    dispatchThread = pthread_self();
+
+#ifdef REACTOR_USE_EPOLL
+    pthread_mutex_unlock(&lock);
+
+    struct epoll_event ev[REACTOR_MAX_EVENTS];
+    n = epoll_wait(pollFD, ev, REACTOR_MAX_EVENTS, timeout_ms);
+
+    for (int i=0; i < n; i++)
+    {
+        int events = 0;
+        if (ev[i].events & EPOLLIN)
+            events |= REACTOR_READ;
+        if (ev[i].events & EPOLLOUT)
+            events |= REACTOR_WRITE;
+        if (ev[i].events & (EPOLLERR | EPOLLHUP))
+            events |= REACTOR_ERROR | REACTOR_READ;
+
+        readyFD.push_back(ev[i].data.fd);
+        readyEvents.push_back(events);
+    }
+#else
+    std::vector<struct pollfd> pfds;
+    struct pollfd pfd;
+
+    pfd.fd      = wakeFD[0];
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+    pfds.push_back(pfd);
+
+    for (std::map<int, Registration>::const_iterator it = fds.begin(); it != fds.end(); ++it)
+    {
+        pfd.fd     = it->first;
+        pfd.events = POLLIN | (it->second.writable ? POLLOUT : 0);
+        pfds.push_back(pfd);
+    }
+    pthread_mutex_unlock(&lock);
+
+    n = poll(&pfds[0], pfds.size(), timeout_ms);
+
+    for (size_t i=0; n > 0 && i < pfds.size(); i++)
+    {
+        int events = 0;
+        if (pfds[i].revents == 0)
+            continue;
+        if (pfds[i].revents & POLLIN)
+            events |= REACTOR_READ;
+        if (pfds[i].revents & POLLOUT)
+            events |= REACTOR_WRITE;
+        if (pfds[i].revents & (POLLERR | POLLHUP | POLLNVAL))
+            events |= REACTOR_ERROR | REACTOR_READ;
+
+        readyFD.push_back(pfds[i].fd);
+        readyEvents.push_back(events);
+    }
+#endif
+
+    if (n < 0 && errno != EINTR)
+    {
+        IDLog("ClientReactor: wait failed: %s\n", strerror(errno));
+        pthread_mutex_lock(&lock);
+        dispatching = false;
+        pthread_mutex_unlock(&lock);
+        return -1;
+    }
+
+    int dispatched=0;
+    for (size_t i=0; i < readyFD.size(); i++)
+    {
+        int fd = readyFD[i];
+
+        if (fd == wakeFD[0])
+        {
+            drainWakeup();
+            continue;
+        }
+
+        // Look the descriptor up again, an earlier callback of this round may have removed it.
+        pthread_mutex_lock(&lock);
+        std::map<int, Registration>::const_iterator it = fds.find(fd);
+        if (it == fds.end())
+        {
+            pthread_mutex_unlock(&lock);
+            continue;
+        }
+
+        ReactorCallback *callback = it->second.callback;
+        void *userdata = it->second.userdata;
+        currentFD = fd;
+        pthread_mutex_unlock(&lock);
+
+        callback(fd, readyEvents[i], userdata);
+        dispatched++;
+
+        pthread_mutex_lock(&lock);
+        currentFD = -1;
+        pthread_cond_broadcast(&dispatchDone);
+        pthread_mutex_unlock(&lock);
+    }
+
+    pthread_mutex_lock(&lock);
+    dispatching = false;
+    pthread_mutex_unlock(&lock);
+
+    return dispatched;
+}
+
+void INDI::ClientReactor::run()
+{
+    while (!stopRequested)
+    {
+        if (process(-1) < 0)
+            break;
+    }
+
+    stopRequested = false;
+}
+
+bool INDI::ClientReactor::start()
+{
+    pthread_mutex_lock(&lock);
+
+    if (threadStarted)
+    {
+        pthread_mutex_unlock(&lock);
+        return true;
+    }
+
+    if (pthread_create(&reactorThread, NULL, &INDI::ClientReactor::runHelper, this) != 0)
+    {
+        pthread_mutex_unlock(&lock);
+        perror("thread");
+        return false;
+    }
+
+    threadStarted = true;
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+void INDI::ClientReactor::stop()
+{
+    stopRequested = true;
+    wakeup();
+
+    pthread_mutex_lock(&lock);
+    bool join = threadStarted && !pthread_equal(reactorThread, pthread_self());
+    threadStarted = false;
+    pthread_mutex_unlock(&lock);
+
+    if (join)
+        pthread_join(reactorThread, NULL);
+}
+
+void * INDI::ClientReactor::runHelper(void *context)
+{
+    (static_cast<INDI::ClientReactor *> (context))->run();
+    return NULL;
+}
+
+bool INDI::ClientReactor::isReactorThread()
+{
+    pthread_mutex_lock(&lock);
+    bool rc = dispatching && pthread_equal(dispatchThread, pthread_self());
+    pthread_mutex_unlock(&lock);
+    return rc;
+}
+
+int INDI::ClientReactor::getFDCount()
+{
+    pthread_mutex_lock(&lock);
+    int n = fds.size();
+    pthread_mutex_unlock(&lock);
+    return n;
+}
+
+void INDI::ClientReactor::wakeup()
+{
+    if (wakeFD[1] >= 0 && write(wakeFD[1], "w", 1) < 0 && errno != EAGAIN)
+        IDLog("ClientReactor: wakeup: %s\n", strerror(errno));
+}
+
+void INDI::ClientReactor::drainWakeup()
+{
+    char buf[64];
+    while (read(wakeFD[0], buf, sizeof(buf)) > 0)
+        ;
+}
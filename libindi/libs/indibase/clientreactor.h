@@ -0,0 +1,132 @@
+/*******************************************************************************
+  Copyright(c) 2026 INDI Library contributors. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#ifndef INDICLIENTREACTOR_H
+#define INDICLIENTREACTOR_H
+
+#include <map>
+#include <pthread.h>
+
+#include "indibase.h"
+
+/**
+ * \class INDI::ClientReactor
+   \brief Multiplexes socket I/O of many INDI::BaseClient connections over a single thread.
+
+   The reactor waits on all registered file descriptors with epoll (poll on systems without epoll) and invokes
+   the registered callback of each descriptor that becomes ready. All INDI::BaseClient objects that share a reactor
+   receive their notifications on the reactor thread, one at a time, so a process supervising many INDI servers
+   needs one thread per reactor instead of one thread per server.
+
+   By default every client uses the shared reactor returned by getDefault(), which runs on its own thread. A client
+   may be assigned another reactor with INDI::BaseClient::setReactor() before connecting. Such a reactor is driven either
+   by start(), which spawns a thread, or by calling run() or process() from a thread owned by the application.
+
+   \note Callbacks must not block, as they delay every other connection served by the same reactor.
+ */
+class INDI::ClientReactor
+{
+public:
+
+    /** \brief Readiness flags passed to a ReactorCallback */
+    enum
+    {
+        REACTOR_READ  = 1 << 0,
+        REACTOR_WRITE = 1 << 1,
+        REACTOR_ERROR = 1 << 2
+    };
+
+    /** \brief Signature of callbacks invoked when a file descriptor is ready.
+        \param fd file descriptor that is ready.
+        \param events bitmask of REACTOR_READ, REACTOR_WRITE and REACTOR_ERROR.
+        \param userdata pointer supplied to addFD().
+    */
+    typedef void (ReactorCallback)(int fd, int events, void *userdata);
+
+    ClientReactor();
+    ~ClientReactor();
+
+    /** \brief Register a file descriptor. The descriptor is watched for reading, and for writing when enabled by setWritable().
+        \return True if successful, false if the descriptor could not be watched or is already registered.
+    */
+    bool addFD(int fd, ReactorCallback *callback, void *userdata);
+
+    /** \brief Stop watching a file descriptor.
+        \note When called from a thread other than the reactor thread, the function returns once any callback
+        currently running for \e fd has returned. The callback is never invoked for \e fd after removeFD() returns.
+    */
+    void removeFD(int fd);
+
+    /** \brief Enable or disable write readiness notifications of a registered file descriptor. */
+    void setWritable(int fd, bool enable);
+
+    /** \brief Start a thread that runs the reactor until stop() is called.
+        \return True if the reactor is running, false if the thread could not be created.
+    */
+    bool start();
+
+    /** \brief Ask run() to return and join the reactor thread if it was created by start(). */
+    void stop();
+
+    /** \brief Dispatch events on the calling thread until stop() is called. */
+    void run();
+
+    /** \brief Wait once for events and dispatch them on the calling thread.
+        \param timeout_ms maximum time to wait in milliseconds, or -1 to wait indefinitely.
+        \return Number of descriptors dispatched, or -1 on error.
+    */
+    int process(int timeout_ms);
+
+    /** \return True if the caller is running on the thread currently dispatching events. */
+    bool isReactorThread();
+
+    /** \return Number of registered file descriptors. */
+    int getFDCount();
+
+    /** \return The process wide reactor, started on first use. */
+    static ClientReactor * getDefault();
+
+private:
+
+    typedef struct
+    {
+        ReactorCallback *callback;
+        void *userdata;
+        bool writable;
+    } Registration;
+
+    static void * runHelper(void *context);
+    void wakeup();
+    void drainWakeup();
+
+    std::map<int, Registration> fds;
+    pthread_mutex_t lock;
+    pthread_cond_t dispatchDone;
+
+    int pollFD;             /* epoll instance, -1 when poll() is used */
+    int wakeFD[2];          /* self pipe interrupting a pending wait */
+
+    pthread_t reactorThread;
+    pthread_t dispatchThread;
+    bool threadStarted;
+    bool dispatching;
+    volatile bool stopRequested;
+    int currentFD;          /* descriptor whose callback is running, or -1 */
+};
+
+#endif // INDICLIENTREACTOR_H
@@ -19,6 +19,8 @@
    <li>BaseClient: Base class for INDI clients. By subclassing BaseClient, client can easily connect to INDI server and handle device communication, command, and notifcation.</li>
    <li>BaseClientQt: Qt5 based class for INDI clients. By subclassing BaseClientQt, client can easily connect to INDI server
    and handle device communication, command, and notifcation.</li>
+   <li>ClientReactor: Event loop multiplexing the socket I/O of many BaseClient connections over a single thread.</li>
+   <li>BLOBSink: Destination of BLOBs decoded incrementally by BaseClient, implemented by BLOBFileSink, BLOBWriterSink and BLOBBufferSink.</li>
    <li>BaseMediator: Abstract class to provide interface for event notifications in INDI::BaseClient.</li>
    <li>BaseDriver: Base class for all INDI virtual driver as handled and stored in INDI::BaseClient.</li>
    <li>DefaultDriver: INDI::BaseDriver with extended functionality such as debug, simulation, and configuration support.
@@ -46,6 +48,12 @@ namespace INDI
     class BaseMediator;
     class BaseClient;
     class BaseClientQt;
+    class ClientReactor;
+    class BLOBSink;
+    class BLOBFileSink;
+    class BLOBBufferSink;
+    class BLOBWriterSink;
+    class BLOBStreamParser;
     class BaseDevice;
     class DefaultDevice;
     class FilterInterface;
@@ -137,6 +145,7 @@ public:
 
     /** \brief Emmited when the server gets disconnected.
         \param exit_code 0 if client was requested to disconnect from server. -1 if connection to server is terminated due to remote server disconnection.
+        \note With \e exit_code 0 it is invoked on the thread calling disconnectServer(), with -1 on the reactor thread.
     */
     virtual void serverDisconnected(int exit_code) =0;
 
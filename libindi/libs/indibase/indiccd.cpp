@@ -210,6 +210,8 @@ void CCDChip::setFrameBufferSize(int nbuf, bool allocMem)
     if (nbuf == RawFrameSize)
         return;
 
+    releaseFrameBuffer();
+
     RawFrameSize = nbuf;
 
     if (allocMem == false)
@@ -221,6 +223,27 @@ void CCDChip::setFrameBufferSize(int nbuf, bool allocMem)
         BinFrame = (uint8_t *) realloc(BinFrame, nbuf * sizeof(uint8_t));
 }
 
+uint8_t * CCDChip::getFrameBuffer()
+{
+    // Copy on write, the attached frame belongs to someone else
+    if (ExternalFrame)
+    {
+        memcpy(RawFrame, ExternalFrame.get(), RawFrameSize);
+        ExternalFrame.reset();
+    }
+
+    return RawFrame;
+}
+
+static void keepFrame(uint8_t *)
+{
+}
+
+void CCDChip::attachFrameBuffer(uint8_t *frame)
+{
+    ExternalFrame = std::shared_ptr<uint8_t>(frame, keepFrame);
+}
+
 void CCDChip::setExposureLeft(double duration)
 {
     ImageExposureN[0].value = duration;
@@ -285,6 +308,8 @@ void CCDChip::binFrame()
     if (BinX == 1)
         return;
 
+    const uint8_t *frame = getFrameData();
+
     // Jasem: Keep full frame shadow in memory to enhance performance and just swap frame pointers after operation is complete
     if (BinFrame == NULL)
         BinFrame = (uint8_t*) malloc(RawFrameSize);
@@ -304,7 +329,7 @@ void CCDChip::binFrame()
                 {
                     for (int l=0; l < BinX; l++)
                     {
-                        val = *(RawFrame + j + (i+k) * SubW + l);
+                        val = *(frame + j + (i+k) * SubW + l);
                         if (val + *bin_buf > UINT8_MAX)
                             *bin_buf = UINT8_MAX;
                         else
@@ -319,7 +344,7 @@ void CCDChip::binFrame()
     case 16:
     {
         uint16_t *bin_buf = (uint16_t*) BinFrame;
-        uint16_t *RawFrame16 = (uint16_t*) RawFrame;
+        const uint16_t *RawFrame16 = (const uint16_t*) frame;
         uint16_t val;
         for (int i=0; i < SubH; i+= BinX)
             for (int j=0; j < SubW; j+= BinX)
@@ -345,7 +370,9 @@ void CCDChip::binFrame()
 
     }
 
-    // Swap frame pointers
+    // Swap frame pointers, the binned frame is ours
+    if (ExternalFrame)
+        ExternalFrame.reset();
     uint8_t *rawFramePointer = RawFrame;
     RawFrame = BinFrame;
     // We just memset it next time we use it
@@ -1777,6 +1804,8 @@ void INDI::CCD::fits_update_key_s(fitsfile* fptr, int type, std::string name, vo
 
 bool INDI::CCD::ExposureComplete(CCDChip *targetChip)
 {
+    IDTraceStamp("exp");
+
     bool sendImage = (UploadS[0].s == ISS_ON || UploadS[2].s == ISS_ON);
     bool saveImage = (UploadS[1].s == ISS_ON || UploadS[2].s == ISS_ON);
     bool useSolver = (SolverS[0].s == ISS_ON);
@@ -1808,7 +1837,7 @@ bool INDI::CCD::ExposureComplete(CCDChip *targetChip)
       targetChip->RapidGuideDataNP.s=IPS_BUSY;
       int width = targetChip->getSubW() / targetChip->getBinX();
       int height = targetChip->getSubH() / targetChip->getBinY();
-      void *src = (unsigned short *) targetChip->getFrameBuffer();
+      const void *src = targetChip->getFrameData();
       int i0, i1, i2, i3, i4, i5, i6, i7, i8;
       int ix = 0, iy = 0;
       int xM4;
@@ -1955,6 +1984,8 @@ bool INDI::CCD::ExposureComplete(CCDChip *targetChip)
 
       if (showMarker)
       {
+        // The marker is drawn into the frame
+        src = targetChip->getFrameBuffer();
         int xmin = std::max(ix - 10, 0);
         int xmax = std::min(ix + 10, width - 1);
         int ymin = std::max(iy - 10, 0);
@@ -2110,7 +2141,7 @@ bool INDI::CCD::ExposureComplete(CCDChip *targetChip)
 
           addFITSKeywords(fptr, targetChip);
 
-          fits_write_img(fptr,byte_type,1,nelements,targetChip->getFrameBuffer(),&status);
+          fits_write_img(fptr,byte_type,1,nelements,(void *) targetChip->getFrameData(),&status);
 
           if (status)
           {
@@ -2126,7 +2157,7 @@ bool INDI::CCD::ExposureComplete(CCDChip *targetChip)
       }
       else
       {
-          uploadFile(targetChip, targetChip->getFrameBuffer(), targetChip->getFrameBufferSize(), sendImage, saveImage);
+          uploadFile(targetChip, targetChip->getFrameData(), targetChip->getFrameBufferSize(), sendImage, saveImage);
       }
 
 
@@ -2381,7 +2412,7 @@ void INDI::CCD::getMinMax(double *min, double *max, CCDChip *targetChip)
     {
         case 8:
         {
-            unsigned char *imageBuffer = (unsigned char *) targetChip->getFrameBuffer();
+            const unsigned char *imageBuffer = targetChip->getFrameData();
             lmin = lmax = imageBuffer[0];
 
 
@@ -2398,7 +2429,7 @@ void INDI::CCD::getMinMax(double *min, double *max, CCDChip *targetChip)
 
         case 16:
         {
-            unsigned short *imageBuffer = (unsigned short* ) targetChip->getFrameBuffer();
+            const unsigned short *imageBuffer = (const unsigned short* ) targetChip->getFrameData();
             lmin = lmax = imageBuffer[0];
 
             for (i= 0; i < imageHeight ; i++)
@@ -2414,7 +2445,7 @@ void INDI::CCD::getMinMax(double *min, double *max, CCDChip *targetChip)
 
         case 32:
         {
-            unsigned int *imageBuffer = (unsigned int* ) targetChip->getFrameBuffer();
+            const unsigned int *imageBuffer = (const unsigned int* ) targetChip->getFrameData();
             lmin = lmax = imageBuffer[0];
 
             for (i= 0; i < imageHeight ; i++)
@@ -29,6 +29,8 @@
 #include <fitsio.h>
 #include <string.h>
 
+#include <memory>
+
 #include "defaultdevice.h"
 #include "indiguiderinterface.h"
 
@@ -149,7 +151,13 @@ public:
      * @brief getFrameBuffer Get raw frame buffer of the CCD chip.
      * @return raw frame buffer of the CCD chip.
      */
-    inline uint8_t * getFrameBuffer() { return RawFrame; }
+    uint8_t * getFrameBuffer();
+
+    /**
+     * @brief getFrameData Get the frame for reading only. Unlike getFrameBuffer(), it never copies an attached frame.
+     * @return the attached frame if any, the raw frame buffer of the CCD chip otherwise.
+     */
+    inline const uint8_t * getFrameData() { return ExternalFrame ? ExternalFrame.get() : RawFrame; }
 
     /**
      * @brief setFrameBuffer Set raw frame buffer pointer.
@@ -157,7 +165,26 @@ public:
      * /note CCD Chip allocates the frame buffer internally once SetFrameBufferSize is called with allocMem set to true which is the default behavior.
      *       If you allocated the memory yourself (i.e. allocMem is false), then you must call this function to set the pointer to the raw frame buffer.
      */
-    void setFrameBuffer(uint8_t *buffer) { RawFrame = buffer; }
+    void setFrameBuffer(uint8_t *buffer) { releaseFrameBuffer(); RawFrame = buffer; }
+
+    /**
+     * @brief attachFrameBuffer Use a frame owned elsewhere (decoder output, mapped file...) as the chip frame without copying it.
+     * The chip holds a reference until the frame is replaced or released. It is copied into the chip frame buffer only when
+     * written to through getFrameBuffer(), binFrame() reads it in place.
+     * @param frame frame of getFrameBufferSize() bytes, shared with its owner.
+     */
+    void attachFrameBuffer(const std::shared_ptr<uint8_t> &frame) { ExternalFrame = frame; }
+
+    /**
+     * @brief attachFrameBuffer Use a frame that is not reference counted as the chip frame without copying it.
+     * @param frame frame of getFrameBufferSize() bytes which must stay valid until releaseFrameBuffer() is called.
+     */
+    void attachFrameBuffer(uint8_t *frame);
+
+    /**
+     * @brief releaseFrameBuffer Drop the reference to an attached frame, the chip frame buffer is used again.
+     */
+    void releaseFrameBuffer() { ExternalFrame.reset(); }
 
     /**
      * @brief isCompressed
@@ -310,6 +337,7 @@ public:
 
     /**
      * @brief binFrame Perform softwre binning on the CCD frame. Only use this function if hardware binning is not supported.
+     * An attached frame is binned into the chip frame buffer and released.
      */
     void binFrame();
 
@@ -330,6 +358,7 @@ private:
     bool Interlaced;
     uint8_t *RawFrame;
     uint8_t *BinFrame;
+    std::shared_ptr<uint8_t> ExternalFrame; // Frame owned elsewhere, used in place of RawFrame until written
     int RawFrameSize;
     bool SendCompressed;
     CCD_FRAME FrameType;
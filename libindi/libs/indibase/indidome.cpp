@@ -24,11 +24,15 @@
 #include <math.h>
 #include <string.h>
 
+#include <algorithm>
+
 #include "indidome.h"
 #include "indicom.h"
 
 #define DOME_SLAVING_TAB   "Slaving"
 #define DOME_COORD_THRESHOLD    0.1             /* Only send debug messages if the differences between old and new values of Az/Alt excceds this value */
+#define DOME_TABLE_STEP         1               /* Hour angle and declination step of the dome geometry table in degrees */
+#define DOME_TABLE_MAX_SPREAD   5               /* Largest azimuth difference between the corners of a table cell that is interpolated, in degrees */
 
 INDI::Dome::Dome()
 {
@@ -856,44 +860,142 @@ To do that we need to calculate the optical axis line taking the centre of the d
 // maxAz: Maximum azimuth in order to avoid any dome interference to the full aperture of the telescope
 bool INDI::Dome::GetTargetAz(double & Az, double & Alt, double & minAz, double & maxAz)
 {
-    point3D MountCenter, OptCenter, OptAxis, DomeCenter, DomeIntersect;
     double hourAngle;
-    double mu1, mu2;
-    double yx;
-    double HalfApertureChordAngle;
-    double RadiusAtAlt;
-    int OTASide = 1; /* Side of the telescope with respect of the mount, 1: east, -1: west*/
 
     double JD  = ln_get_julian_from_sys();
     double MSD = ln_get_mean_sidereal_time(JD);
-    
+
     DEBUGF(INDI::Logger::DBG_DEBUG, "JD: %g - MSD: %g", JD, MSD);
 
+    // Get hour angle in hours
+    hourAngle = MSD + observer.lng/15.0 - mountEquatorialCoords.ra/15.0;
+
+    DEBUGF(INDI::Logger::DBG_DEBUG, "HA: %g  Lng: %g RA: %g", hourAngle, observer.lng, mountEquatorialCoords.ra);
+
+    return GetTargetAz(hourAngle, mountEquatorialCoords.dec, Az, Alt, minAz, maxAz);
+}
+
+bool INDI::Dome::GetTargetAz(double hourAngle, double dec, double & Az, double & Alt, double & minAz, double & maxAz)
+{
+    double HalfApertureChordAngle;
+
+    if (GeometryTableValid() == false)
+        BuildGeometryTable();
+
+    // Table coordinates: hour angle -180..180 degrees along x, declination -90..90 degrees along y
+    double x = (range360(hourAngle * 15.0 + 180.0)) / DOME_TABLE_STEP;
+    double y = (std::max(-90.0, std::min(90.0, dec)) + 90.0) / DOME_TABLE_STEP;
+    int cols = 360 / DOME_TABLE_STEP + 1;
+    int rows = 180 / DOME_TABLE_STEP + 1;
+    int i = std::min((int) x, cols - 2);
+    int j = std::min((int) y, rows - 2);
+    double fx = x - i, fy = y - j;
+
+    const DomeGeometryEntry & e00 = geometryTable[j*cols + i];
+    const DomeGeometryEntry & e10 = geometryTable[j*cols + i + 1];
+    const DomeGeometryEntry & e01 = geometryTable[(j+1)*cols + i];
+    const DomeGeometryEntry & e11 = geometryTable[(j+1)*cols + i + 1];
+
+    bool exact = isnan(e00.alt) || isnan(e10.alt) || isnan(e01.alt) || isnan(e11.alt);
+
+    // Near the dome zenith the azimuth swings across a single cell and its average is meaningless
+    if (exact == false)
+    {
+        const DomeGeometryEntry *corners[4] = { &e00, &e10, &e01, &e11 };
+        double minCos = cos(DOME_TABLE_MAX_SPREAD * M_PI / 180.0);
+
+        for (int a=0; a < 4 && exact == false; a++)
+            for (int b=a+1; b < 4 && exact == false; b++)
+                if (corners[a]->cosAz*corners[b]->cosAz + corners[a]->sinAz*corners[b]->sinAz < minCos)
+                    exact = true;
+    }
+
+    if (exact)
+    {
+        // Close to a geometry the table cannot represent, solve it exactly
+        if (SolveTargetAz(hourAngle, dec, Az, Alt, HalfApertureChordAngle) == false)
+            return false;
+    }
+    else
+    {
+        double w00 = (1-fx)*(1-fy), w10 = fx*(1-fy), w01 = (1-fx)*fy, w11 = fx*fy;
+
+        // Azimuth is interpolated as a unit vector so it wraps around north correctly, the corners
+        // are within DOME_TABLE_MAX_SPREAD of each other so the sum can not cancel out
+        double c = w00*e00.cosAz + w10*e10.cosAz + w01*e01.cosAz + w11*e11.cosAz;
+        double s = w00*e00.sinAz + w10*e10.sinAz + w01*e01.sinAz + w11*e11.sinAz;
+        Az  = range360(atan2(s, c) * 180.0 / M_PI);
+        Alt = w00*e00.alt + w10*e10.alt + w01*e01.alt + w11*e11.alt;
+
+        if (e00.halfChord >= 180 || e10.halfChord >= 180 || e01.halfChord >= 180 || e11.halfChord >= 180)
+            HalfApertureChordAngle = 180;
+        else
+            HalfApertureChordAngle = w00*e00.halfChord + w10*e10.halfChord + w01*e01.halfChord + w11*e11.halfChord;
+    }
+
+    if (HalfApertureChordAngle < 180)
+    {
+        minAz = Az - HalfApertureChordAngle;
+        if (minAz < 0)
+            minAz = minAz + 360;
+        maxAz = Az + HalfApertureChordAngle;
+        if (maxAz >= 360)
+            maxAz = maxAz - 360;
+    }
+    else
+    {
+        minAz = 0;
+        maxAz = 360;
+    }
+
+    return true;
+}
+
+int INDI::Dome::GetTargetAzBatch(const double *hourAngle, const double *dec, int n, double *Az, double *minAz, double *maxAz)
+{
+    int solved=0;
+    double Alt;
+
+    for (int i=0; i < n; i++)
+    {
+        if (GetTargetAz(hourAngle[i], dec[i], Az[i], Alt, minAz[i], maxAz[i]))
+            solved++;
+        else
+            Az[i] = minAz[i] = maxAz[i] = -1;
+    }
+
+    return solved;
+}
+
+bool INDI::Dome::SolveTargetAz(double hourAngle, double dec, double & Az, double & Alt, double & HalfApertureChordAngle)
+{
+    point3D MountCenter, OptCenter, OptAxis, DomeCenter, DomeIntersect;
+    double mu1, mu2;
+    double yx;
+    double RadiusAtAlt;
+    double mountAz, mountAlt;
+    int OTASide = 1; /* Side of the telescope with respect of the mount, 1: east, -1: west*/
+
     MountCenter.x = DomeMeasurementsN[DM_NORTH_DISPLACEMENT].value;    // Positive to North
     MountCenter.y = DomeMeasurementsN[DM_EAST_DISPLACEMENT].value;     // Positive to East
     MountCenter.z = DomeMeasurementsN[DM_UP_DISPLACEMENT].value;       // Positive Up
-    
-    DEBUGF(INDI::Logger::DBG_DEBUG, "MC.x: %g - MC.y: %g MC.z: %g", MountCenter.x, MountCenter.y, MountCenter.z);
 
-    // Get hour angle in hours
-    hourAngle = MSD + observer.lng/15.0 - mountEquatorialCoords.ra/15.0;
-    
-    DEBUGF(INDI::Logger::DBG_DEBUG, "HA: %g  Lng: %g RA: %g", hourAngle, observer.lng, mountEquatorialCoords.ra);
+    // Mount horizontal coordinates, azimuth measured from north through east
+    double ha  = hourAngle * 15.0 * M_PI / 180.0;
+    double de  = dec * M_PI / 180.0;
+    double lat = observer.lat * M_PI / 180.0;
+
+    mountAlt = asin(sin(lat)*sin(de) + cos(lat)*cos(de)*cos(ha)) * 180.0 / M_PI;
+    mountAz  = range360(atan2(-cos(de)*sin(ha), sin(de)*cos(lat) - cos(de)*cos(ha)*sin(lat)) * 180.0 / M_PI);
 
     // Get optical center point
     if (OTASideS[0].s != ISS_ON)
         OTASide = -1;
-    
+
     OpticalCenter(MountCenter, OTASide * DomeMeasurementsN[DM_OTA_OFFSET].value, observer.lat, hourAngle, OptCenter);
-    
-    DEBUGF(INDI::Logger::DBG_DEBUG, "OTA_SIDE: %d", OTASide);
-    DEBUGF(INDI::Logger::DBG_DEBUG, "OTA_OFFSET: %g  Lat: %g", DomeMeasurementsN[DM_OTA_OFFSET].value, observer.lat);
-    DEBUGF(INDI::Logger::DBG_DEBUG, "OC.x: %g - OC.y: %g OC.z: %g", OptCenter.x, OptCenter.y, OptCenter.z);
 
     // Get optical axis point. This and the previous form the optical axis line
-    OpticalVector(OptCenter, mountHoriztonalCoords.az, mountHoriztonalCoords.alt, OptAxis);
-    DEBUGF(INDI::Logger::DBG_DEBUG, "Mount Az: %g  Alt: %g", mountHoriztonalCoords.az, mountHoriztonalCoords.alt);
-    DEBUGF(INDI::Logger::DBG_DEBUG, "OA.x: %g - OA.y: %g OA.z: %g", OptAxis.x, OptAxis.y, OptAxis.z);
+    OpticalVector(OptCenter, mountAz, mountAlt, OptAxis);
 
     DomeCenter.x = 0; DomeCenter.y = 0; DomeCenter.z = 0;
 
@@ -934,26 +1036,66 @@ bool INDI::Dome::GetTargetAz(double & Az, double & Alt, double & minAz, double &
         RadiusAtAlt = DomeMeasurementsN[DM_DOME_RADIUS].value * cos(M_PI * Alt/180); // Radius alt the given altitude
 
         if (DomeMeasurementsN[DM_SHUTTER_WIDTH].value < (2 * RadiusAtAlt))
-        {
             HalfApertureChordAngle = 180 * asin(DomeMeasurementsN[DM_SHUTTER_WIDTH].value/(2 * RadiusAtAlt)) / M_PI; // Angle of a chord of half aperture length
-            minAz = Az - HalfApertureChordAngle;
-            if (minAz < 0)
-                minAz = minAz + 360;
-            maxAz = Az + HalfApertureChordAngle;
-            if (maxAz >= 360)
-                maxAz = maxAz - 360;
-        }
         else
-        {
-            minAz = 0;
-            maxAz = 360;
-        }
+            HalfApertureChordAngle = 180;
+
         return true;
     }
 
     return false;
 }
 
+bool INDI::Dome::GeometryTableValid()
+{
+    if (geometryTable.empty())
+        return false;
+
+    for (int i=0; i < 6; i++)
+    {
+        if (geometryParams[i] != DomeMeasurementsN[i].value)
+            return false;
+    }
+
+    return (geometryParams[6] == (OTASideS[0].s == ISS_ON ? 1 : -1) && geometryParams[7] == observer.lat);
+}
+
+void INDI::Dome::BuildGeometryTable()
+{
+    int cols = 360 / DOME_TABLE_STEP + 1;
+    int rows = 180 / DOME_TABLE_STEP + 1;
+
+    for (int i=0; i < 6; i++)
+        geometryParams[i] = DomeMeasurementsN[i].value;
+    geometryParams[6] = (OTASideS[0].s == ISS_ON ? 1 : -1);
+    geometryParams[7] = observer.lat;
+
+    geometryTable.resize(rows * cols);
+
+    for (int j=0; j < rows; j++)
+    {
+        double dec = j * DOME_TABLE_STEP - 90.0;
+
+        for (int i=0; i < cols; i++)
+        {
+            double hourAngle = (i * DOME_TABLE_STEP - 180.0) / 15.0;
+            double Az, Alt, HalfApertureChordAngle;
+            DomeGeometryEntry & entry = geometryTable[j*cols + i];
+
+            if (SolveTargetAz(hourAngle, dec, Az, Alt, HalfApertureChordAngle))
+            {
+                entry.cosAz     = cos(Az * M_PI / 180.0);
+                entry.sinAz     = sin(Az * M_PI / 180.0);
+                entry.alt       = Alt;
+                entry.halfChord = HalfApertureChordAngle;
+            }
+            else
+                entry.alt = NAN;
+        }
+    }
+
+    DEBUGF(INDI::Logger::DBG_DEBUG, "Rebuilt dome geometry table (%dx%d) for latitude %g.", cols, rows, observer.lat);
+}
 
 bool INDI::Dome::Intersection(point3D p1, point3D p2, point3D sc, double r, double & mu1, double & mu2)
 {
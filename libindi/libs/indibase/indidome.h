@@ -25,6 +25,8 @@
 
 #include <libnova.h>
 
+#include <vector>
+
 #include "defaultdevice.h"
 #include "indicontroller.h"
 
@@ -336,6 +338,31 @@ protected:
      */
     bool GetTargetAz(double & Az, double & Alt, double & minAz, double & maxAz);
 
+    /**
+     * @brief GetTargetAz Calculate the dome target for a given mount position. Results are interpolated from a table of
+     * precomputed solutions that is rebuilt whenever the dome measurements, OTA side or observer latitude change.
+     * @param hourAngle Hour angle of the mount in hours
+     * @param dec Declination of the mount in degrees
+     * @param Az Returns Azimuth required to the dome in order to center the shutter aperture with telescope
+     * @param Alt Returns Altitude of the optical axis intersection with the dome
+     * @param minAz Returns Minimum azimuth in order to avoid any dome interference to the full aperture of the telescope
+     * @param maxAz Returns Maximum azimuth in order to avoid any dome interference to the full aperture of the telescope
+     * @return Returns false if it can't solve it due bad geometry of the observatory
+     */
+    bool GetTargetAz(double hourAngle, double dec, double & Az, double & Alt, double & minAz, double & maxAz);
+
+    /**
+     * @brief GetTargetAzBatch Calculate dome targets for a list of mount positions, e.g. for planning a whole night.
+     * @param hourAngle Array of n hour angles in hours
+     * @param dec Array of n declinations in degrees
+     * @param n Number of positions
+     * @param Az Array of n azimuths to fill. Positions that cannot be solved are set to -1.
+     * @param minAz Array of n minimum azimuths to fill
+     * @param maxAz Array of n maximum azimuths to fill
+     * @return Number of positions solved.
+     */
+    int GetTargetAzBatch(const double *hourAngle, const double *dec, int n, double *Az, double *minAz, double *maxAz);
+
     /**
      * @brief Intersection Calculate the intersection of a ray and a sphere. The line segment is defined from p1 to p2.  The sphere is of radius r and centered at sc.
      * From http://local.wasp.uwa.edu.au/~pbourke/geometry/sphereline/
@@ -463,6 +490,21 @@ private:
 
         void processButton(const char * button_n, ISState state);
 
+        typedef struct
+        {
+            float cosAz, sinAz;         // Dome azimuth as a unit vector
+            float alt;                  // NAN if there is no solution
+            float halfChord;            // Half shutter aperture angle, 180 if the whole dome is open
+        } DomeGeometryEntry;
+
+        bool SolveTargetAz(double hourAngle, double dec, double & Az, double & Alt, double & HalfApertureChordAngle);
+        bool GeometryTableValid();
+        void BuildGeometryTable();
+
+        // Dome solutions over hour angle and declination, and the measurements, OTA side and latitude they were built for
+        std::vector<DomeGeometryEntry> geometryTable;
+        double geometryParams[8];
+
         INDI::Controller *controller;
 
         DomeState domeState;
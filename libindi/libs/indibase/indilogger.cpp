@@ -21,6 +21,8 @@
 #include "indilogger.h"
 #include <indicom.h>
 #include <cstdio>
+#include <cstdlib>
+#include <cerrno>
 
 #include <iostream>
 
@@ -73,6 +75,8 @@ Logger::loggerConf Logger::configuration_= Logger::screen_on | Logger::file_off;
 std::string Logger::logFile_;
 unsigned int Logger::nDevices=0;
 unsigned int Logger::customLevel=4;
+size_t Logger::maxLogSize_=0;
+unsigned int Logger::maxLogFiles_=0;
 
 int Logger::addDebugLevel(const char *debugLevelName, const char * loggingLevelName)
 {
@@ -273,12 +277,29 @@ void Logger::unlock(){}
  * It is a private constructor, called only by getInstance() and only the
  * first time. It is called inside a lock, so lock inside this method
  * is not required.
- * It only initializes the initial time. All configuration is done inside the
- * configure() method.
+ * It initializes the initial time and the ring buffer. All configuration is done inside the
+ * configure() method, which also starts the writer thread.
  */
 Logger::Logger(): configured_(false)
 {
   gettimeofday(&initialTime_, NULL);
+
+  ring_ = new LogRecord[LOGGER_RING_SIZE];
+  for (unsigned int i=0; i < LOGGER_RING_SIZE; i++)
+      ring_[i].seq.store(i, std::memory_order_relaxed);
+  ringHead_.store(0);
+  ringTail_.store(0);
+  dropped_.store(0);
+
+  writerRunning_ = false;
+  writerStop_ = false;
+  writerIdle_.store(false);
+  pthread_mutex_init(&writerLock_, NULL);
+  pthread_cond_init(&writerCond_, NULL);
+  pthread_cond_init(&drainedCond_, NULL);
+
+  pthread_mutex_init(&fileLock_, NULL);
+  fileSize_ = 0;
 }
 
 /**
@@ -296,6 +317,12 @@ void Logger::configure (const std::string&	outputFile,
 {
 		Logger::lock();
 
+		// Messages printed with the previous configuration go to the previous file
+		if (writerRunning_)
+			flush();
+
+		pthread_mutex_lock(&fileLock_);
+
 		fileVerbosityLevel_ = fileVerbosityLevel;
 		screenVerbosityLevel_ = screenVerbosityLevel;
 		rememberscreenlevel_= screenVerbosityLevel_;
@@ -313,9 +340,16 @@ void Logger::configure (const std::string&	outputFile,
 
 		// Open a new stream, if needed
         if (configuration&file_on)
+        {
 			out_.open(logFile_.c_str(), std::ios::app);
+			fileSize_ = out_.is_open() ? (size_t) out_.tellp() : 0;
+        }
 
 		configuration_ = configuration;
+
+		pthread_mutex_unlock(&fileLock_);
+
+		startWriter();
 		configured_ = true;
 
 		Logger::unlock();
@@ -323,15 +357,26 @@ void Logger::configure (const std::string&	outputFile,
 
 /**
  * \brief Destructor.
- * It only closes the file, if open, and cleans memory.
+ * It stops the writer thread once all messages are written, closes the file, if open, and cleans memory.
+ * Called through destroyAtExit() when the driver exits.
  */
 
 Logger::~Logger()
 {
 	Logger::lock();
+	if (writerRunning_)
+	{
+		pthread_mutex_lock(&writerLock_);
+		writerStop_ = true;
+		pthread_cond_signal(&writerCond_);
+		pthread_mutex_unlock(&writerLock_);
+		pthread_join(writerThread_, NULL);
+		writerRunning_ = false;
+	}
 	if (configuration_&file_on)
 		out_.close();
-	delete m_;
+	delete [] ring_;
+	m_ = 0;
 	Logger::unlock();
 
 }
@@ -350,6 +395,208 @@ Logger& Logger::getInstance()
 	return *m_;
 }
 
+void Logger::setRotation(size_t maxBytes, unsigned int maxFiles)
+{
+    maxLogSize_  = maxBytes;
+    maxLogFiles_ = maxFiles;
+}
+
+void Logger::startWriter()
+{
+    if (writerRunning_)
+        return;
+
+    if (pthread_create(&writerThread_, NULL, &Logger::writerHelper, this) != 0)
+    {
+        std::cerr << "Logger: unable to start writer thread: " << strerror(errno) << std::endl;
+        return;
+    }
+
+    writerRunning_ = true;
+
+    // Messages still in the ring when the driver exits are written when the instance is destroyed
+    static bool registered = false;
+    if (!registered)
+    {
+        atexit(&Logger::destroyAtExit);
+        registered = true;
+    }
+}
+
+void * Logger::writerHelper(void *context)
+{
+    (static_cast<Logger *> (context))->writerLoop();
+    return NULL;
+}
+
+void Logger::destroyAtExit()
+{
+    Logger::lock();
+    Logger *logger = m_;
+    Logger::unlock();
+
+    delete logger;
+}
+
+void Logger::writerLoop()
+{
+    pthread_mutex_lock(&writerLock_);
+
+    while (true)
+    {
+        pthread_mutex_unlock(&writerLock_);
+        bool busy = drainRing();
+        pthread_mutex_lock(&writerLock_);
+
+        pthread_cond_broadcast(&drainedCond_);
+
+        if (writerStop_ && !busy)
+            break;
+
+        if (busy)
+            continue;
+
+        // Announce the wait before checking the ring a last time, print() signals only idle writers
+        writerIdle_.store(true);
+        unsigned int tail = ringTail_.load(std::memory_order_relaxed);
+        if (ring_[tail & (LOGGER_RING_SIZE-1)].seq.load(std::memory_order_acquire) != tail+1 && !writerStop_)
+        {
+            struct timespec ts;
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            ts.tv_sec = tv.tv_sec + 1;
+            ts.tv_nsec = tv.tv_usec * 1000;
+            pthread_cond_timedwait(&writerCond_, &writerLock_, &ts);
+        }
+        writerIdle_.store(false);
+    }
+
+    pthread_mutex_unlock(&writerLock_);
+}
+
+/**
+ * \brief Write all published records to the file and clients.
+ * @return True if any record was written.
+ */
+bool Logger::drainRing()
+{
+    char line[LOGGER_MSG_SIZE + MAXINDIDEVICE + 64];
+    unsigned int tail = ringTail_.load(std::memory_order_relaxed);
+    bool busy = false;
+    int len;
+
+    unsigned int dropped = dropped_.exchange(0);
+    if (dropped > 0 && (configuration_&file_on))
+    {
+        len = snprintf(line, sizeof(line), "%s\t: Logger: %u message(s) dropped, writer could not keep up\n", Tags[rank(DBG_WARNING)], dropped);
+        writeFile(line, len);
+    }
+
+    while (true)
+    {
+        LogRecord *r = &ring_[tail & (LOGGER_RING_SIZE-1)];
+        if (r->seq.load(std::memory_order_acquire) != tail+1)
+            break;
+
+        if (configuration_&file_on)
+        {
+            struct timeval resTime;
+            timersub(&r->time, &initialTime_, &resTime);
+
+            if (nDevices == 1)
+                len = snprintf(line, sizeof(line), "%s\t%ld.%06ld sec\t: %s\n", Tags[rank(r->verbosityLevel)],
+                               (long) resTime.tv_sec, (long) resTime.tv_usec, r->msg);
+            else
+                len = snprintf(line, sizeof(line), "%s\t%ld.%06ld sec\t: [%s] %s\n", Tags[rank(r->verbosityLevel)],
+                               (long) resTime.tv_sec, (long) resTime.tv_usec, r->device, r->msg);
+
+            writeFile(line, len < (int) sizeof(line) ? len : (int) sizeof(line) - 1);
+        }
+
+        r->seq.store(tail + LOGGER_RING_SIZE, std::memory_order_release);
+        ringTail_.store(++tail, std::memory_order_release);
+        busy = true;
+    }
+
+    if (busy)
+    {
+        pthread_mutex_lock(&fileLock_);
+        if (out_.is_open())
+            out_.flush();
+        pthread_mutex_unlock(&fileLock_);
+    }
+
+    return busy;
+}
+
+void Logger::writeFile(const char *line, int len)
+{
+    pthread_mutex_lock(&fileLock_);
+
+    if (out_.is_open())
+    {
+        out_.write(line, len);
+        fileSize_ += len;
+
+        if (maxLogSize_ > 0 && fileSize_ >= maxLogSize_)
+            rotateFile();
+    }
+
+    pthread_mutex_unlock(&fileLock_);
+}
+
+/**
+ * \brief Rename log to log.1, log.1 to log.2... and reopen an empty log. Called with fileLock_ held.
+ */
+void Logger::rotateFile()
+{
+    char from[512], to[512];
+
+    out_.close();
+
+    if (maxLogFiles_ == 0)
+        remove(logFile_.c_str());
+    else
+    {
+        for (unsigned int i = maxLogFiles_; i > 1; i--)
+        {
+            snprintf(from, sizeof(from), "%s.%u", logFile_.c_str(), i-1);
+            snprintf(to, sizeof(to), "%s.%u", logFile_.c_str(), i);
+            rename(from, to);
+        }
+        snprintf(to, sizeof(to), "%s.1", logFile_.c_str());
+        rename(logFile_.c_str(), to);
+    }
+
+    out_.open(logFile_.c_str(), std::ios::app);
+    fileSize_ = 0;
+}
+
+void Logger::flush()
+{
+    if (!writerRunning_ || pthread_equal(pthread_self(), writerThread_))
+        return;
+
+    unsigned int head = ringHead_.load();
+
+    pthread_mutex_lock(&writerLock_);
+    pthread_cond_signal(&writerCond_);
+
+    // Records reserved before this call are written once the tail passes head
+    while ((int) (ringTail_.load(std::memory_order_acquire) - head) < 0)
+    {
+        struct timespec ts;
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        ts.tv_sec = tv.tv_sec + 1;
+        ts.tv_nsec = tv.tv_usec * 1000;
+        if (pthread_cond_timedwait(&drainedCond_, &writerLock_, &ts) == ETIMEDOUT)
+            break;
+        pthread_cond_signal(&writerCond_);
+    }
+
+    pthread_mutex_unlock(&writerLock_);
+}
 
 /**
  * \brief Method used to print message called by the DEBUG() macro.
@@ -388,43 +635,99 @@ void Logger::print(const char *devicename,
 		   const char *message,
 		   ...)
 {
-  bool filelog = (verbosityLevel & fileVerbosityLevel_) != 0;
-  bool screenlog = (verbosityLevel & screenVerbosityLevel_) != 0;
+  bool filelog = (verbosityLevel & fileVerbosityLevel_) != 0 && (configuration_&file_on);
+  bool screenlog = (verbosityLevel & screenVerbosityLevel_) != 0 && (configuration_&screen_on);
 
   va_list ap;
-  char msg[257];
-  char usec[7];
+  char msg[LOGGER_MSG_SIZE];
 
-  msg[256]='\0';
-  va_start(ap, message);
-  vsnprintf(msg, 257, message, ap);
-  va_end(ap);
-
-    if (!configured_)
+    if (!configured_ || !writerRunning_)
     {
+            va_start(ap, message);
+            formatMessage(msg, message, ap);
+            va_end(ap);
             //std::cerr << "Warning! Logger not configured!" << std::endl;
             std::cerr << msg << std::endl;
 			return;
 	}
-	struct timeval currentTime, resTime;
-	usec[6]='\0';
-	gettimeofday(&currentTime, NULL);
-	timersub(&currentTime, &initialTime_, &resTime);
-	snprintf(usec, 7, "%06ld", resTime.tv_usec);
-	Logger::lock();
 
-    if ((configuration_&file_on) && filelog)
+    if (!filelog && !screenlog)
+        return;
+
+    va_start(ap, message);
+    size_t len = formatMessage(msg, message, ap);
+    va_end(ap);
+
+    // Sent right away so clients see messages in order with the driver's property updates
+    if (screenlog)
+        IDMessage(devicename, "%s", msg);
+
+    if (!filelog)
+        return;
+
+    // Reserve a slot, or drop the message if the writer is LOGGER_RING_SIZE messages behind
+    unsigned int pos = ringHead_.load(std::memory_order_relaxed);
+    LogRecord *r;
+    while (true)
     {
-       if (nDevices == 1)
-            out_ << Tags[rank(verbosityLevel)] << "\t" << (resTime.tv_sec) <<"."<<(usec) << " sec"<< "\t: " << msg << std::endl;
-       else
-            out_ << Tags[rank(verbosityLevel)] << "\t" << (resTime.tv_sec) <<"."<<(usec) << " sec"<< "\t: [" << devicename << "] " << msg << std::endl;
+        r = &ring_[pos & (LOGGER_RING_SIZE-1)];
+        int diff = (int) (r->seq.load(std::memory_order_acquire) - pos);
+
+        if (diff == 0)
+        {
+            if (ringHead_.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+            pos = ringHead_.load(std::memory_order_relaxed);
     }
 
-	if ((configuration_&screen_on) && screenlog)
-	  IDMessage(devicename, "%s", msg);
+    r->verbosityLevel = verbosityLevel;
+    gettimeofday(&r->time, NULL);
+    strncpy(r->device, devicename, MAXINDIDEVICE);
+    r->device[MAXINDIDEVICE-1] = '\0';
+    memcpy(r->msg, msg, len + 1);
 
-	Logger::unlock();
+    r->seq.store(pos+1, std::memory_order_release);
+
+    if (writerIdle_.load())
+    {
+        pthread_mutex_lock(&writerLock_);
+        pthread_cond_signal(&writerCond_);
+        pthread_mutex_unlock(&writerLock_);
+    }
+}
+
+/**
+ * \brief Format a message into msg, LOGGER_MSG_SIZE bytes. The arguments cannot outlive print(), so this runs on
+ * the calling thread. Messages without conversions are copied as they are.
+ * @return length of the message in msg.
+ */
+size_t Logger::formatMessage(char *msg, const char *message, va_list ap)
+{
+    if (strchr(message, '%') == NULL)
+    {
+        size_t len = strlen(message);
+        if (len > LOGGER_MSG_SIZE - 1)
+            len = LOGGER_MSG_SIZE - 1;
+        memcpy(msg, message, len);
+        msg[len] = '\0';
+        return len;
+    }
+
+    int len = vsnprintf(msg, LOGGER_MSG_SIZE, message, ap);
+    if (len < 0)
+    {
+        msg[0] = '\0';
+        return 0;
+    }
+
+    return (size_t) len < LOGGER_MSG_SIZE ? (size_t) len : LOGGER_MSG_SIZE - 1;
 }
 
 }
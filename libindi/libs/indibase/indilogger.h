@@ -22,6 +22,8 @@
 #define LOGGER_H
 
 #include <stdarg.h>
+#include <pthread.h>
+#include <atomic>
 #include <fstream>
 #include <ostream>
 #include <string>
@@ -64,6 +66,12 @@
 #define DEBUGDEVICE(device, priority, msg) INDI::Logger::getInstance().print(device, priority, __FILE__, __LINE__, msg)
 #define DEBUGFDEVICE(device, priority, msg, ...) INDI::Logger::getInstance().print(device, priority, __FILE__, __LINE__,  msg, __VA_ARGS__)
 
+/** \brief Number of messages the logger can hold before the writer thread catches up. Must be a power of two. */
+#define LOGGER_RING_SIZE    4096
+
+/** \brief Maximum length of a single log message, longer messages are truncated. */
+#define LOGGER_MSG_SIZE     512
+
 namespace  INDI
 {
 
@@ -88,6 +96,13 @@ namespace  INDI
  *
  * To add a new debug level, call addDebugLevel(). You can add an additional 4 custom debug/logging levels.
  *
+ * The log file is written asynchronously. print() copies the message into a slot of a lock-free ring buffer and a
+ * background thread writes the slots to the file. If the ring is full, the message is dropped from the file and the
+ * number of dropped messages is reported there. Messages to clients are still sent with IDMessage from print(), so
+ * they keep their order with the property updates the driver sends. The message text is formatted on the calling
+ * thread, as printf arguments cannot be kept for later; messages without conversions are copied without formatting.
+ * Log files are only rotated if enabled with setRotation().
+ *
  * Check INDI Tutorial two for an example simple implementation.
  */
 class Logger
@@ -166,6 +181,51 @@ class Logger
 
         static INDI::DefaultDevice *parentDevice;
 
+        /**
+         * \brief A message waiting in the ring buffer to be written to the log file. seq tells producers and the writer who owns the slot.
+         */
+        struct LogRecord
+        {
+            std::atomic<unsigned int> seq;
+            unsigned int verbosityLevel;
+            struct timeval time;
+            char device[MAXINDIDEVICE];
+            char msg[LOGGER_MSG_SIZE];
+        };
+
+        LogRecord *ring_;
+        std::atomic<unsigned int> ringHead_;
+        std::atomic<unsigned int> ringTail_;
+        std::atomic<unsigned int> dropped_;
+
+        /**
+         * \brief Background writer. writerIdle_ is set while it waits for writerCond_.
+         */
+        pthread_t writerThread_;
+        bool writerRunning_;
+        bool writerStop_;
+        std::atomic<bool> writerIdle_;
+        pthread_mutex_t writerLock_;
+        pthread_cond_t writerCond_;
+        pthread_cond_t drainedCond_;
+
+        /**
+         * \brief Protects out_ and fileSize_ between configure() and the writer thread
+         */
+        pthread_mutex_t fileLock_;
+        size_t fileSize_;
+        static size_t maxLogSize_;
+        static unsigned int maxLogFiles_;
+
+        void startWriter();
+        static void * writerHelper(void *context);
+        static void destroyAtExit();
+        static size_t formatMessage(char *msg, const char *message, va_list ap);
+        void writerLoop();
+        bool drainRing();
+        void writeFile(const char *line, int len);
+        void rotateFile();
+
  public:
   enum VerbosityLevel
   {DBG_ERROR=0x1, DBG_WARNING=0x2, DBG_SESSION=0x4, DBG_DEBUG=0x8, DBG_EXTRA_1=0x10,
@@ -210,6 +270,19 @@ class Logger
 
     void configure (const std::string&	outputFile,  const loggerConf configuration,  const int fileVerbosityLevel, const int	screenVerbosityLevel);
 
+    /**
+     * @brief flush Wait until all messages printed so far are written to the log file and sent to clients.
+     */
+    void flush();
+
+    /**
+     * @brief setRotation Rotate the log file once it grows beyond a given size.
+     * Rotation is off by default.
+     * @param maxBytes size at which the log file is rotated, 0 to never rotate.
+     * @param maxFiles number of rotated files to keep, named after the log file with .1, .2... appended.
+     */
+    static void setRotation(size_t maxBytes, unsigned int maxFiles);
+
     static struct switchinit DebugLevelSInit[nlevels];
     static ISwitch DebugLevelS[nlevels];
     static ISwitchVectorProperty DebugLevelSP;
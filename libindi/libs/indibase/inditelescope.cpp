@@ -17,6 +17,7 @@
 *******************************************************************************/
 #include <stdlib.h>
 #include <wordexp.h>
+#include <math.h>
 
 #include "inditelescope.h"
 #include "indicom.h"
@@ -57,6 +58,7 @@ bool INDI::Telescope::initProperties()
     IUFillNumber(&EqN[AXIS_DE],"DEC","DEC (dd:mm:ss)","%010.6m",-90,90,0,0);
     IUFillNumberVector(&EqNP,EqN,2,getDeviceName(),"EQUATORIAL_EOD_COORD","Eq. Coordinates",MAIN_CONTROL_TAB,IP_RW,60,IPS_IDLE);
     lastEqState = IPS_IDLE;
+    lastEqRA = lastEqDE = 0;
 
     IUFillNumber(&TargetN[AXIS_RA],"RA","RA (hh:mm:ss)","%010.6m",0,24,0,0);
     IUFillNumber(&TargetN[AXIS_DE],"DEC","DEC (dd:mm:ss)","%010.6m",-90,90,0,0);
@@ -107,6 +109,12 @@ bool INDI::Telescope::initProperties()
     IUFillSwitch(&BaudRateS[5], "230400", "", ISS_OFF);
     IUFillSwitchVector(&BaudRateSP, BaudRateS, 6, getDeviceName(),"TELESCOPE_BAUD_RATE", "Baud Rate", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
 
+    IUFillNumber(&PollingN[POLL_FAST], "FAST_MS", "Slewing (ms)", "%.f", 10, 60000, 10, POLLMS);
+    IUFillNumber(&PollingN[POLL_TRACK], "TRACK_MS", "Tracking (ms)", "%.f", 10, 60000, 10, POLLMS);
+    IUFillNumber(&PollingN[POLL_PARKED], "PARKED_MS", "Parked (ms)", "%.f", 10, 60000, 10, POLLMS);
+    IUFillNumber(&PollingN[POLL_THRESHOLD], "COORD_THRESHOLD", "Threshold (arcsec)", "%.2f", 0, 3600, 0.1, 0);
+    IUFillNumberVector(&PollingNP, PollingN, 4, getDeviceName(), "TELESCOPE_POLLING", "Polling", OPTIONS_TAB, IP_RW, 60, IPS_IDLE);
+
     IUFillSwitch(&MovementNSS[DIRECTION_NORTH], "MOTION_NORTH", "North", ISS_OFF);
     IUFillSwitch(&MovementNSS[DIRECTION_SOUTH], "MOTION_SOUTH", "South", ISS_OFF);
     IUFillSwitchVector(&MovementNSSP, MovementNSS, 2, getDeviceName(),"TELESCOPE_MOTION_NS", "Motion N/S", MOTION_TAB, IP_RW, ISR_ATMOST1, 60, IPS_IDLE);
@@ -142,6 +150,8 @@ void INDI::Telescope::ISGetProperties (const char *dev)
     loadConfig(true, "DEVICE_PORT");
     defineSwitch(&BaudRateSP);
     loadConfig(true, "TELESCOPE_BAUD_RATE");
+    defineNumber(&PollingNP);
+    loadConfig(true, "TELESCOPE_POLLING");
     if (HasTime() && HasLocation())
     {
         defineText(&ActiveDeviceTP);
@@ -327,6 +337,7 @@ bool INDI::Telescope::saveConfigItems(FILE *fp)
     IUSaveConfigText(fp, &ActiveDeviceTP);
     IUSaveConfigText(fp, &PortTP);
     IUSaveConfigSwitch(fp, &BaudRateSP);
+    IUSaveConfigNumber(fp, &PollingNP);
     if (HasLocation())
         IUSaveConfigNumber(fp,&LocationNP);
     IUSaveConfigNumber(fp, &ScopeParametersNP);
@@ -357,10 +368,28 @@ void INDI::Telescope::NewRaDec(double ra,double dec)
         break;
     }
 
-    if (EqN[AXIS_RA].value != ra || EqN[AXIS_DE].value != dec || EqNP.s != lastEqState)
+    // Always keep the current position, only the client update is throttled
+    EqN[AXIS_RA].value=ra;
+    EqN[AXIS_DE].value=dec;
+
+    bool changed = (lastEqRA != ra || lastEqDE != dec);
+
+    // Suppress updates that moved less than the threshold since the last one sent
+    if (changed && PollingN[POLL_THRESHOLD].value > 0)
     {
-        EqN[AXIS_RA].value=ra;
-        EqN[AXIS_DE].value=dec;
+        double dRA  = fabs(lastEqRA - ra);
+        if (dRA > 12)
+            dRA = 24 - dRA;
+        dRA *= 15 * 3600 * cos(dec * M_PI / 180.0);
+        double dDE = fabs(lastEqDE - dec) * 3600;
+
+        changed = (dRA >= PollingN[POLL_THRESHOLD].value || dDE >= PollingN[POLL_THRESHOLD].value);
+    }
+
+    if (changed || EqNP.s != lastEqState)
+    {
+        lastEqRA = ra;
+        lastEqDE = dec;
         lastEqState = EqNP.s;
         IDSetNumber(&EqNP, NULL);
     }
@@ -541,6 +570,14 @@ bool INDI::Telescope::ISNewNumber (const char *dev, const char *name, double val
 
         }
 
+        if(strcmp(name,PollingNP.name)==0)
+        {
+            IUUpdateNumber(&PollingNP,values,names,n);
+            PollingNP.s = IPS_OK;
+            IDSetNumber(&PollingNP,NULL);
+            return true;
+        }
+
         if(strcmp(name,"TELESCOPE_INFO")==0)
         {
             ScopeParametersNP.s = IPS_OK;
@@ -889,7 +926,7 @@ bool INDI::Telescope::Connect()
     rc=Connect(PortT[0].text, atoi(IUFindOnSwitch(&BaudRateSP)->name));
 
     if(rc)
-        SetTimer(POLLMS);
+        SetTimer(getPollingPeriod());
     return rc;
 }
 
@@ -949,6 +986,9 @@ void INDI::Telescope::TimerHit()
     {
         bool rc;
 
+        // Send all updates of this poll together
+        IDBeginBatch();
+
         rc=ReadScopeStatus();
 
         if(rc == false)
@@ -958,7 +998,28 @@ void INDI::Telescope::TimerHit()
             IDSetNumber(&EqNP, NULL);
         }
 
-        SetTimer(POLLMS);
+        IDEndBatch();
+
+        SetTimer(getPollingPeriod());
+    }
+}
+
+uint32_t INDI::Telescope::getPollingPeriod()
+{
+    if (MovementNSSP.s == IPS_BUSY || MovementWESP.s == IPS_BUSY)
+        return PollingN[POLL_FAST].value;
+
+    switch (TrackState)
+    {
+        case SCOPE_SLEWING:
+        case SCOPE_PARKING:
+            return PollingN[POLL_FAST].value;
+
+        case SCOPE_PARKED:
+            return PollingN[POLL_PARKED].value;
+
+        default:
+            return PollingN[POLL_TRACK].value;
     }
 }
 
@@ -55,6 +55,7 @@ class INDI::Telescope : public INDI::DefaultDevice
         enum TelescopeTrackMode  { TRACK_SIDEREAL, TRACK_SOLAR, TRACK_LUNAR, TRACK_CUSTOM };
         enum TelescopeParkData  { PARK_NONE, PARK_RA_DEC, PARK_AZ_ALT, PARK_RA_DEC_ENCODER, PARK_AZ_ALT_ENCODER };
         enum TelescopeLocation { LOCATION_LATITUDE, LOCATION_LONGITUDE, LOCATION_ELEVATION };
+        enum TelescopePolling { POLL_FAST, POLL_TRACK, POLL_PARKED, POLL_THRESHOLD };
 
         /** \struct TelescopeCapability
             \brief Holds the capabilities of a telescope.
@@ -223,9 +224,20 @@ class INDI::Telescope : public INDI::DefaultDevice
 
         virtual bool saveConfigItems(FILE *fp);
 
-        /** \brief The child class calls this function when it has updates */
+        /** \brief The child class calls this function when it has updates.
+         *  \note EQUATORIAL_EOD_COORD is only sent to the client if the state changed or the coordinates moved by more
+         *  than the COORD_THRESHOLD value of TELESCOPE_POLLING since the last update. EqN always holds the latest coordinates.
+         */
         void NewRaDec(double ra,double dec);
 
+        /**
+         * @brief getPollingPeriod Return the delay until the next ReadScopeStatus() call. The fast period of TELESCOPE_POLLING
+         * is used while the mount is slewing, parking or moving, the parked period while parked, and the track period otherwise.
+         * @return Polling period in milliseconds.
+         * \note Override to select the fast period in other driver specific states, e.g. while guiding.
+         */
+        virtual uint32_t getPollingPeriod();
+
         /** \brief Read telescope status.
          This function checks the following:
          <ol>
@@ -403,6 +415,10 @@ class INDI::Telescope : public INDI::DefaultDevice
         ISwitch BaudRateS[6];
         ISwitchVectorProperty BaudRateSP;
 
+        // Adaptive polling periods and coordinate change threshold
+        INumber PollingN[4];
+        INumberVectorProperty PollingNP;
+
         uint32_t capability;
         int last_we_motion, last_ns_motion;
 
@@ -429,6 +445,8 @@ private:
         uint8_t nSlewRate;
 
         IPState lastEqState;
+        // Coordinates of the last EQUATORIAL_EOD_COORD update sent to clients
+        double lastEqRA, lastEqDE;
 
         INDI::Controller *controller;
 
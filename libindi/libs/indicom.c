@@ -33,6 +33,7 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <limits.h>
 #include <locale.h>
 
 #ifdef  __APPLE__
@@ -59,6 +60,7 @@
 #include <unistd.h>
 #include <termios.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 #define PARITY_NONE    0
 #define PARITY_EVEN    1
 #define PARITY_ODD     2
@@ -166,6 +168,128 @@ fs_sexa (char *out, double a, int w, int fracbase)
 	return (out - out0);
 }
 
+/* exact powers of ten for the fast path of f_strtod */
+static const double f_pow10[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* strtod for strings using '.' whatever the current locale. Used for inputs the fast path does not handle exactly. */
+static double f_strtod_slow (const char *str, char **endptr)
+{
+    const char *dp = localeconv()->decimal_point;
+    char stackbuf[128];
+    char *buf = stackbuf, *end;
+    size_t len;
+    double value;
+    int i;
+
+    if ((dp[0] == '.' && dp[1] == '\0') || dp[1] != '\0')
+        return strtod(str, endptr);
+
+    /* swap the decimal point characters in a copy so that strtod reads '.' and stops at the locale one */
+    len = strlen(str);
+    if (len >= sizeof(stackbuf))
+        buf = (char *) malloc(len+1);
+    for (i = 0; i <= (int) len; i++)
+        buf[i] = (str[i] == '.') ? dp[0] : (str[i] == dp[0]) ? '.' : str[i];
+
+    value = strtod(buf, &end);
+
+    if (endptr)
+        *endptr = (char *) str + (end - buf);
+    if (buf != stackbuf)
+        free(buf);
+
+    return value;
+}
+
+/* convert a decimal number to double independently of the locale.
+ * up to 19 significant digits with a power of ten within the exact range are converted with a single
+ * correctly rounded multiplication or division, anything else goes through strtod.
+ */
+double
+f_strtod (const char *str, char **endptr)
+{
+    const char *s = str;
+    uint64_t mant = 0;
+    int ndigits = 0, exp10 = 0, neg = 0, any = 0, exact = 1;
+
+    while (*s == ' ' || *s == '\t' || *s == '\n' || *s == '\r' || *s == '\f' || *s == '\v')
+        s++;
+
+    if (*s == '-' || *s == '+')
+        neg = (*s++ == '-');
+
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+        return f_strtod_slow(str, endptr);
+
+    for (; *s >= '0' && *s <= '9'; s++, any = 1)
+    {
+        if (ndigits < 19)
+        {
+            mant = mant*10 + (*s - '0');
+            if (mant)
+                ndigits++;
+        }
+        else
+        {
+            exp10++;
+            exact &= (*s == '0');
+        }
+    }
+
+    if (*s == '.')
+    {
+        for (s++; *s >= '0' && *s <= '9'; s++, any = 1)
+        {
+            if (ndigits < 19)
+            {
+                mant = mant*10 + (*s - '0');
+                if (mant)
+                    ndigits++;
+                exp10--;
+            }
+            else
+                exact &= (*s == '0');
+        }
+    }
+
+    /* inf, nan, hexadecimal or no number at all */
+    if (!any)
+        return f_strtod_slow(str, endptr);
+
+    if (*s == 'e' || *s == 'E')
+    {
+        const char *e = s+1;
+        int eneg = 0, ev = 0;
+
+        if (*e == '-' || *e == '+')
+            eneg = (*e++ == '-');
+
+        if (*e >= '0' && *e <= '9')
+        {
+            for (; *e >= '0' && *e <= '9'; e++)
+                if (ev < 100000)
+                    ev = ev*10 + (*e - '0');
+            exp10 += eneg ? -ev : ev;
+            s = e;
+        }
+    }
+
+    if (!exact || mant > ((uint64_t) 1 << 53) || exp10 < -22 || exp10 > 22)
+        return f_strtod_slow(str, endptr);
+
+    if (endptr)
+        *endptr = (char *) s;
+
+    if (exp10 < 0)
+        return (neg ? -(double) mant : (double) mant) / f_pow10[-exp10];
+
+    return (neg ? -(double) mant : (double) mant) * f_pow10[exp10];
+}
+
 /* convert sexagesimal string str AxBxC to double.
  *   x can be anything non-numeric. Any missing A, B or C will be assumed 0.
  *   optional - and + can be anywhere.
@@ -176,28 +300,36 @@ f_scansexa (
 const char *str0,	/* input string */
 double *dp)		/* cracked value, if return 0 */
 {
-    char *orig = setlocale(LC_NUMERIC,"C");
-
-	double a = 0, b = 0, c = 0;
-	char str[128];
-	char *neg;
-	int r;
-
-	/* copy str0 so we can play with it */
-	strncpy (str, str0, sizeof(str)-1);
-	str[sizeof(str)-1] = '\0';
+	double v[3] = {0, 0, 0};
+	const char *s, *sep;
+	char *end;
+	int neg = 0;
+	int i;
+
+	/* a minus anywhere but in an exponent negates the whole value */
+	for (s = str0; *s; s++)
+	    if (*s == '-' && !(s > str0 && (s[-1] == 'e' || s[-1] == 'E'))) {
+		neg = 1;
+		break;
+	    }
 
-	neg = strchr(str, '-');
-	if (neg)
-	    *neg = ' ';
+	for (s = str0; *s == '-' || *s == '+' || *s == ' ' || *s == '\t' || *s == '\n' || *s == '\r'; s++)
+	    ;
 
-    r = sscanf (str, "%lf%*[^0-9]%lf%*[^0-9]%lf", &a, &b, &c);
+	v[0] = f_strtod (s, &end);
+	if (end == s)
+	    return (-1);
 
-    setlocale(LC_NUMERIC,orig);
+	/* each further component follows at least one non-digit separator */
+	for (i = 1, s = end; i < 3; i++, s = end) {
+	    for (sep = s; *s && (*s < '0' || *s > '9'); s++)
+		;
+	    if (s == sep || *s == '\0')
+		break;
+	    v[i] = f_strtod (s, &end);
+	}
 
-	if (r < 1)
-	    return (-1);
-	*dp = a + b/60 + c/3600;
+	*dp = v[0] + v[1]/60 + v[2]/3600;
 	if (neg)
 	    *dp *= -1;
 	return (0);
@@ -306,6 +438,226 @@ int tty_timeout(int fd, int timeout)
 #endif
 }
 
+#if !defined(_WIN32)
+/* Per-fd readahead buffers. Data is read from the port in as large chunks as available and kept in a ring
+   until consumed by tty_read, tty_read_section, or delivered as frames by tty_frame_handler. Each ring belongs
+   to the file open on fd when it was created, and is dropped on any input flush. */
+
+#define TTY_RING_SIZE   4096        /* Must be a power of two */
+#define TTY_RING_MASK   (TTY_RING_SIZE - 1)
+
+typedef struct
+{
+    uint32_t head;                  /* Total bytes consumed */
+    uint32_t tail;                  /* Total bytes stored */
+    uint8_t data[TTY_RING_SIZE];
+    char frame_stop;
+    tty_frame_cb *frame_cb;
+    void *frame_ud;
+    dev_t dev;                      /* Identity of the file the ring belongs to */
+    ino_t ino;
+    dev_t rdev;
+} tty_buffer;
+
+static tty_buffer *tty_buffers[FD_SETSIZE];
+
+static tty_buffer * tty_get_buffer(int fd)
+{
+    struct stat st;
+
+    if (fd < 0 || fd >= FD_SETSIZE || fstat(fd, &st) != 0)
+        return NULL;
+
+    /* fd was closed without tty_disconnect() and now refers to another file */
+    if (tty_buffers[fd] && (tty_buffers[fd]->dev != st.st_dev || tty_buffers[fd]->ino != st.st_ino ||
+                            tty_buffers[fd]->rdev != st.st_rdev))
+    {
+        free(tty_buffers[fd]);
+        tty_buffers[fd] = NULL;
+    }
+
+    if (tty_buffers[fd] == NULL)
+    {
+        if ( (tty_buffers[fd] = (tty_buffer *) calloc(1, sizeof(tty_buffer))) == NULL)
+            return NULL;
+
+        tty_buffers[fd]->dev  = st.st_dev;
+        tty_buffers[fd]->ino  = st.st_ino;
+        tty_buffers[fd]->rdev = st.st_rdev;
+    }
+
+    return tty_buffers[fd];
+}
+
+static void tty_reset_buffer(int fd)
+{
+    if (fd < 0 || fd >= FD_SETSIZE || tty_buffers[fd] == NULL)
+        return;
+
+    free(tty_buffers[fd]);
+    tty_buffers[fd] = NULL;
+}
+
+/* Drop any readahead data, the input it came from has been discarded */
+static void tty_drop_readahead(int fd)
+{
+    if (fd < 0 || fd >= FD_SETSIZE || tty_buffers[fd] == NULL)
+        return;
+
+    tty_buffers[fd]->head = tty_buffers[fd]->tail;
+}
+
+/* Read as much as is available into the ring with a single read(). The caller ensures the fd is readable. */
+static int tty_fill_buffer(int fd, tty_buffer *rb)
+{
+    uint32_t used  = rb->tail - rb->head;
+    uint32_t start = rb->tail & TTY_RING_MASK;
+    uint32_t space = TTY_RING_SIZE - used;
+    int bytesRead  = 0;
+
+    if (space == 0)
+        return TTY_OK;
+
+    /* Only read the contiguous part of the free space */
+    if (space > TTY_RING_SIZE - start)
+        space = TTY_RING_SIZE - start;
+
+    bytesRead = read(fd, rb->data + start, space);
+
+    if (bytesRead <= 0)
+        return TTY_READ_ERROR;
+
+    if (tty_debug)
+        IDLog("%s: %d bytes read ahead for fd %d\n", __FUNCTION__, bytesRead, fd);
+
+    rb->tail += bytesRead;
+
+    return TTY_OK;
+}
+
+/* Return the number of bytes up to and including stop_char, or 0 if the ring does not contain it yet. */
+static uint32_t tty_scan_buffer(tty_buffer *rb, char stop_char)
+{
+    uint32_t used  = rb->tail - rb->head;
+    uint32_t start = rb->head & TTY_RING_MASK;
+    uint32_t first = used < TTY_RING_SIZE - start ? used : TTY_RING_SIZE - start;
+    uint8_t *match = NULL;
+
+    match = (uint8_t *) memchr(rb->data + start, stop_char, first);
+    if (match)
+        return match - (rb->data + start) + 1;
+
+    if (used > first)
+    {
+        match = (uint8_t *) memchr(rb->data, stop_char, used - first);
+        if (match)
+            return first + (match - rb->data) + 1;
+    }
+
+    return 0;
+}
+
+/* Copy and consume nbytes from the ring */
+static void tty_consume_buffer(tty_buffer *rb, uint8_t *buf, uint32_t nbytes)
+{
+    uint32_t start = rb->head & TTY_RING_MASK;
+    uint32_t first = nbytes < TTY_RING_SIZE - start ? nbytes : TTY_RING_SIZE - start;
+
+    memcpy(buf, rb->data + start, first);
+    if (nbytes > first)
+        memcpy(buf + first, rb->data, nbytes - first);
+
+    rb->head += nbytes;
+}
+#endif
+
+int tty_flush(int fd)
+{
+    #ifdef _WIN32
+    return TTY_ERRNO;
+    #else
+
+    if (fd == -1)
+           return TTY_ERRNO;
+
+    if (tcflush(fd, TCIFLUSH) != 0)
+        return TTY_ERRNO;
+
+    return TTY_OK;
+
+    #endif
+}
+
+#if !defined(_WIN32)
+int tty_tcflush(int fd, int queue_selector)
+{
+    /* Readahead is input the kernel has already handed over, discard it as well */
+    if (queue_selector == TCIFLUSH || queue_selector == TCIOFLUSH)
+        tty_drop_readahead(fd);
+
+    return (tcflush)(fd, queue_selector);
+}
+#endif
+
+int tty_set_frame_callback(int fd, char stop_char, tty_frame_cb *callback, void *userdata)
+{
+    #ifdef _WIN32
+    return TTY_ERRNO;
+    #else
+
+    tty_buffer *rb = tty_get_buffer(fd);
+
+    if (rb == NULL)
+        return TTY_PARAM_ERROR;
+
+    rb->frame_stop = stop_char;
+    rb->frame_cb   = callback;
+    rb->frame_ud   = userdata;
+
+    return TTY_OK;
+
+    #endif
+}
+
+void tty_frame_handler(int fd, void *userdata)
+{
+    #ifndef _WIN32
+    char frame[TTY_RING_SIZE+1];
+    uint32_t len = 0;
+    int err = TTY_OK;
+    tty_buffer *rb = tty_get_buffer(fd);
+
+    (void) userdata;
+
+    if (rb == NULL || rb->frame_cb == NULL)
+        return;
+
+    if ( (err = tty_fill_buffer(fd, rb)) != TTY_OK)
+    {
+        rb->frame_cb(fd, NULL, err, rb->frame_ud);
+        return;
+    }
+
+    while ( (len = tty_scan_buffer(rb, rb->frame_stop)) > 0)
+    {
+        tty_consume_buffer(rb, (uint8_t *) frame, len);
+        frame[len] = '\0';
+        rb->frame_cb(fd, frame, len, rb->frame_ud);
+
+        /* The callback may have disabled frame mode */
+        if (tty_buffers[fd] != rb || rb->frame_cb == NULL)
+            return;
+    }
+
+    /* A full ring without a delimiter can never complete a frame */
+    if (rb->tail - rb->head == TTY_RING_SIZE)
+    {
+        IDLog("%s: no stop char in %d bytes for fd %d, discarding.\n", __FUNCTION__, TTY_RING_SIZE, fd);
+        rb->head = rb->tail;
+    }
+    #endif
+}
+
 int tty_write(int fd, const char * buf, int nbytes, int *nbytes_written)
 {
     #ifdef _WIN32
@@ -392,36 +744,47 @@ int tty_read(int fd, char *buf, int nbytes, int timeout, int *nbytes_read)
     if (fd == -1)
            return TTY_ERRNO;
 
- int bytesRead = 0;
+ uint32_t available = 0;
  int err = 0;
+ tty_buffer *rb = NULL;
  *nbytes_read =0;
 
   if (nbytes <=0)
 	return TTY_PARAM_ERROR;
 
+  if ( (rb = tty_get_buffer(fd)) == NULL)
+      return TTY_ERRNO;
+
   if (tty_debug)
       IDLog("%s: Request to read %d bytes with %d timeout for fd %d\n", __FUNCTION__, nbytes, timeout, fd);
 
   while (nbytes > 0)
   {
-     if ( (err = tty_timeout(fd, timeout)) )
-      return err;
+     if (rb->tail == rb->head)
+     {
+         if ( (err = tty_timeout(fd, timeout)) )
+             return err;
+
+         if ( (err = tty_fill_buffer(fd, rb)) )
+             return err;
+     }
 
-     bytesRead = read(fd, buf+(*nbytes_read), ((uint32_t) nbytes));
+     available = rb->tail - rb->head;
+     if (available > (uint32_t) nbytes)
+         available = nbytes;
 
-     if (bytesRead < 0 )
-      return TTY_READ_ERROR;
+     tty_consume_buffer(rb, (uint8_t *) buf + *nbytes_read, available);
 
      if (tty_debug)
      {
-         IDLog("%d bytes read and %d bytes remaining...\n", bytesRead, nbytes-bytesRead);
+         IDLog("%d bytes read and %d bytes remaining...\n", available, nbytes-available);
          int i=0;
-         for (i=*nbytes_read; i < (*nbytes_read+bytesRead); i++)
+         for (i=*nbytes_read; i < (*nbytes_read+available); i++)
             IDLog("%s: buffer[%d]=%#X (%c)\n", __FUNCTION__, i, (unsigned char) buf[i], buf[i]);
      }
 
-     *nbytes_read += bytesRead;
-     nbytes -= bytesRead;
+     *nbytes_read += available;
+     nbytes -= available;
 
   }
 
@@ -431,6 +794,11 @@ int tty_read(int fd, char *buf, int nbytes, int timeout, int *nbytes_read)
 }
 
 int tty_read_section(int fd, char *buf, char stop_char, int timeout, int *nbytes_read)
+{
+    return tty_nread_section(fd, buf, INT_MAX, stop_char, timeout, nbytes_read);
+}
+
+int tty_nread_section(int fd, char *buf, int nsize, char stop_char, int timeout, int *nbytes_read)
 {
     #ifdef _WIN32
     return TTY_ERRNO;
@@ -439,36 +807,63 @@ int tty_read_section(int fd, char *buf, char stop_char, int timeout, int *nbytes
     if (fd == -1)
            return TTY_ERRNO;
 
- int bytesRead = 0;
+ uint32_t len = 0;
+ uint32_t room = 0;
  int err = TTY_OK;
+ tty_buffer *rb = NULL;
  *nbytes_read = 0;
 
- uint8_t *read_char = 0;
+ if (nsize <= 0)
+     return TTY_PARAM_ERROR;
+
+ if ( (rb = tty_get_buffer(fd)) == NULL)
+     return TTY_ERRNO;
 
  if (tty_debug)
      IDLog("%s: Request to read until stop char '%c' with %d timeout for fd %d\n", __FUNCTION__, stop_char, timeout, fd);
 
  for (;;)
  {
-         if ( (err = tty_timeout(fd, timeout)) )
-	   return err;
-
-         read_char = buf+*nbytes_read;
-         bytesRead = read(fd, read_char, 1);
+        room = nsize - *nbytes_read;
+
+        /* Scan only for the delimiter, read ahead as much as the port has available otherwise */
+        if ( (len = tty_scan_buffer(rb, stop_char)) > 0 && len <= room)
+        {
+            tty_consume_buffer(rb, (uint8_t *) buf + *nbytes_read, len);
+            *nbytes_read += len;
+            break;
+        }
 
-         if (bytesRead < 0 )
-            return TTY_READ_ERROR;
+        /* No delimiter within the space left in buf, hand over what fits and leave the rest in the ring */
+        if (len > 0 || rb->tail - rb->head >= room)
+        {
+            tty_consume_buffer(rb, (uint8_t *) buf + *nbytes_read, room);
+            *nbytes_read += room;
+            return TTY_OVERFLOW;
+        }
 
-         if (tty_debug)
-                IDLog("%s: buffer[%d]=%#X (%c)\n", __FUNCTION__, (*nbytes_read), *read_char, *read_char);
+        /* Ring is full without a delimiter, hand the data over to make room */
+        if (rb->tail - rb->head == TTY_RING_SIZE)
+        {
+            tty_consume_buffer(rb, (uint8_t *) buf + *nbytes_read, TTY_RING_SIZE);
+            *nbytes_read += TTY_RING_SIZE;
+        }
 
-          (*nbytes_read)++;
+        if ( (err = tty_timeout(fd, timeout)) )
+            return err;
 
-        if (*read_char == stop_char)
-         return TTY_OK;
+        if ( (err = tty_fill_buffer(fd, rb)) )
+            return err;
   }
 
-  return TTY_TIME_OUT;
+ if (tty_debug)
+ {
+     int i=0;
+     for (i=0; i < *nbytes_read; i++)
+         IDLog("%s: buffer[%d]=%#X (%c)\n", __FUNCTION__, i, (unsigned char) buf[i], buf[i]);
+ }
+
+ return TTY_OK;
 
  #endif
 }
@@ -739,7 +1134,8 @@ int tty_connect(const char *device, int bit_rate, int word_size, int parity, int
        }
 #endif
 
-   *fd = t_fd;
+  tty_reset_buffer(t_fd);
+  *fd = t_fd;
   /* return success */
   return TTY_OK;
 
@@ -943,6 +1339,7 @@ int tty_connect(const char *device, int bit_rate, int word_size, int parity, int
     return TTY_PORT_FAILURE;
   }
   
+  tty_reset_buffer(t_fd);
   *fd = t_fd;
   /* return success */
   return TTY_OK;
@@ -962,6 +1359,7 @@ int tty_disconnect(int fd)
 	return TTY_ERRNO;
 #else
 	int err;
+	tty_reset_buffer(fd);
 	tcflush(fd, TCIOFLUSH);
 	err = close(fd);
 
@@ -1019,6 +1417,10 @@ void tty_error_msg(int err_code, char *err_msg, int err_msg_len)
 		strncpy(err_msg, error_string, err_msg_len);
 		break;
 
+	case TTY_OVERFLOW:
+		strncpy(err_msg, "Read overflow", err_msg_len);
+		break;
+
 	default:
 		strncpy(err_msg, "Error: unrecognized error code", err_msg_len);
 		break;
@@ -1160,15 +1562,82 @@ crackDN (XMLEle *root, char **dev, char **name, char msg[])
         return (0);
 }
 
+/* FNV-1a hash of a property or member name */
+unsigned int
+IUHashName (const char *name)
+{
+        unsigned int hash = 2166136261u;
+
+        while (*name)
+            hash = (hash ^ (unsigned char) *name++) * 16777619u;
+
+        return hash;
+}
+
+/* Member lookups are served from a direct mapped cache keyed by vector address and member name hash.
+ * Each thread has its own cache. An entry is only used while the vector still has the same member
+ * array and count, and is verified against the member name, so a hit is the first match of a scan.
+ */
+#define IUFIND_CACHE_SIZE   256         /* Must be a power of two */
+
+#if defined(_MSC_VER)
+#define IUFIND_THREAD   __declspec(thread)
+#else
+#define IUFIND_THREAD   __thread
+#endif
+
+typedef struct
+{
+        const void *vp;
+        const char *first;
+        unsigned int hash;
+        int n;
+        int index;
+} IUFindEntry;
+
+static IUFIND_THREAD IUFindEntry iuFindCache[IUFIND_CACHE_SIZE];
+
+/* return index of the member called name in an array of n members of size stride, else -1 */
+static int
+IUFindMemberIndex (const void *vp, const char *first, size_t stride, int n, const char *name)
+{
+        unsigned int hash;
+        IUFindEntry *entry;
+        int i;
+
+        if (n <= 0)
+            return (-1);
+
+        hash  = IUHashName(name);
+        entry = &iuFindCache[(hash ^ (unsigned int) (((uintptr_t) vp) >> 4)) & (IUFIND_CACHE_SIZE - 1)];
+
+        i = entry->index;
+        if (entry->vp == vp && entry->first == first && entry->n == n && entry->hash == hash &&
+            strcmp (first + i*stride, name) == 0)
+            return (i);
+
+        for (i = 0; i < n; i++)
+            if (strcmp (first + i*stride, name) == 0)
+            {
+                entry->vp    = vp;
+                entry->first = first;
+                entry->hash  = hash;
+                entry->n     = n;
+                entry->index = i;
+                return (i);
+            }
+
+        return (-1);
+}
+
 /* find a member of an IText vector, else NULL */
 IText *
 IUFindText  (const ITextVectorProperty *tvp, const char *name)
 {
-        int i;
+        int i = IUFindMemberIndex (tvp, tvp->tp ? tvp->tp[0].name : NULL, sizeof(IText), tvp->ntp, name);
 
-        for (i = 0; i < tvp->ntp; i++)
-            if (strcmp (tvp->tp[i].name, name) == 0)
-                return (&tvp->tp[i]);
+        if (i >= 0)
+            return (&tvp->tp[i]);
         fprintf (stderr, "No IText '%s' in %s.%s\n",name,tvp->device,tvp->name);
         return (NULL);
 }
@@ -1177,11 +1646,10 @@ IUFindText  (const ITextVectorProperty *tvp, const char *name)
 INumber *
 IUFindNumber(const INumberVectorProperty *nvp, const char *name)
 {
-        int i;
+        int i = IUFindMemberIndex (nvp, nvp->np ? nvp->np[0].name : NULL, sizeof(INumber), nvp->nnp, name);
 
-        for (i = 0; i < nvp->nnp; i++)
-            if (strcmp (nvp->np[i].name, name) == 0)
-                return (&nvp->np[i]);
+        if (i >= 0)
+            return (&nvp->np[i]);
         fprintf(stderr,"No INumber '%s' in %s.%s\n",name,nvp->device,nvp->name);
         return (NULL);
 }
@@ -1190,11 +1658,10 @@ IUFindNumber(const INumberVectorProperty *nvp, const char *name)
 ISwitch *
 IUFindSwitch(const ISwitchVectorProperty *svp, const char *name)
 {
-        int i;
+        int i = IUFindMemberIndex (svp, svp->sp ? svp->sp[0].name : NULL, sizeof(ISwitch), svp->nsp, name);
 
-        for (i = 0; i < svp->nsp; i++)
-            if (strcmp (svp->sp[i].name, name) == 0)
-                return (&svp->sp[i]);
+        if (i >= 0)
+            return (&svp->sp[i]);
         fprintf(stderr,"No ISwitch '%s' in %s.%s\n",name,svp->device,svp->name);
         return (NULL);
 }
@@ -1203,11 +1670,10 @@ IUFindSwitch(const ISwitchVectorProperty *svp, const char *name)
 ILight *
 IUFindLight(const ILightVectorProperty *lvp, const char *name)
 {
-        int i;
+        int i = IUFindMemberIndex (lvp, lvp->lp ? lvp->lp[0].name : NULL, sizeof(ILight), lvp->nlp, name);
 
-        for (i = 0; i < lvp->nlp; i++)
-            if (strcmp (lvp->lp[i].name, name) == 0)
-                return (&lvp->lp[i]);
+        if (i >= 0)
+            return (&lvp->lp[i]);
         fprintf(stderr,"No ILight '%s' in %s.%s\n",name,lvp->device,lvp->name);
         return (NULL);
 }
@@ -1216,11 +1682,10 @@ IUFindLight(const ILightVectorProperty *lvp, const char *name)
 IBLOB *
 IUFindBLOB(const IBLOBVectorProperty *bvp, const char *name)
 {
-        int i;
+        int i = IUFindMemberIndex (bvp, bvp->bp ? bvp->bp[0].name : NULL, sizeof(IBLOB), bvp->nbp, name);
 
-        for (i = 0; i < bvp->nbp; i++)
-            if (strcmp (bvp->bp[i].name, name) == 0)
-                return (&bvp->bp[i]);
+        if (i >= 0)
+            return (&bvp->bp[i]);
         fprintf(stderr,"No IBLOB '%s' in %s.%s\n",name,bvp->device,bvp->name);
         return (NULL);
 }
@@ -42,6 +42,10 @@
 #ifndef INDICOM_H
 #define INDICOM_H
 
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
 #define J2000 2451545.0
 #define ERRMSG_SIZE 1024
 #define INDI_DEBUG
@@ -52,7 +56,7 @@ extern const char * SolarSystem[];
 struct ln_date;
 
 /* TTY Error Codes */
-enum TTY_ERROR { TTY_OK=0, TTY_READ_ERROR=-1, TTY_WRITE_ERROR=-2, TTY_SELECT_ERROR=-3, TTY_TIME_OUT=-4, TTY_PORT_FAILURE=-5, TTY_PARAM_ERROR=-6, TTY_ERRNO = -7};
+enum TTY_ERROR { TTY_OK=0, TTY_READ_ERROR=-1, TTY_WRITE_ERROR=-2, TTY_SELECT_ERROR=-3, TTY_TIME_OUT=-4, TTY_PORT_FAILURE=-5, TTY_PARAM_ERROR=-6, TTY_ERRNO = -7, TTY_OVERFLOW = -8};
 
 #ifdef __cplusplus
 extern "C" {
@@ -85,6 +89,18 @@ int tty_read(int fd, char *buf, int nbytes, int timeout, int *nbytes_read);
 
 int tty_read_section(int fd, char *buf, char stop_char, int timeout, int *nbytes_read);
 
+/** \brief read buffer from terminal with a delimiter, without writing past the end of buf
+    \param fd file descriptor
+    \param buf pointer to store data.
+    \param nsize size of \e buf in bytes.
+    \param stop_char if the function encounters \e stop_char then it stops reading and returns the buffer.
+    \param timeout number of seconds to wait for terminal before a timeout error is issued.
+    \param nbytes_read the number of bytes read.
+    \return On success, it returns TTY_OK. If \e nsize bytes arrive without \e stop_char, buf is filled and TTY_OVERFLOW
+    is returned, the rest of the input is kept for the next read. Otherwise, a TTY_ERROR code.
+*/
+int tty_nread_section(int fd, char *buf, int nsize, char stop_char, int timeout, int *nbytes_read);
+
 
 /** \brief Writes a buffer to fd.
     \param fd file descriptor
@@ -137,6 +153,49 @@ void tty_error_msg(int err_code, char *err_msg, int err_msg_len);
 void tty_set_debug(int debug);
 
 int tty_timeout(int fd, int timeout);
+
+/** \typedef tty_frame_cb
+    \brief Signature of a frame callback. \e frame is null-terminated and includes the stop char, \e len is its length in bytes.
+    On a read error \e frame is NULL and \e len is the TTY_ERROR code.
+*/
+typedef void (tty_frame_cb) (int fd, const char *frame, int len, void *userdata);
+
+/** \brief Discard any buffered and pending input on fd.
+
+    All reads are buffered per file descriptor: data is read ahead from the port in as large chunks as are available
+    and kept until consumed, across writes. Readahead is dropped by tty_flush(), by tcflush() of the input queue (see
+    tty_tcflush()) and when fd is closed with tty_disconnect() or reopened on another file.
+    \param fd file descriptor
+    \return On success, it returns TTY_OK, otherwise, a TTY_ERROR code.
+*/
+int tty_flush(int fd);
+
+/** \brief Deliver complete frames from fd to a callback.
+
+    Once set, call tty_frame_handler() whenever fd is readable. Typically this is done by registering it with the
+    driver event loop: IEAddCallback(fd, tty_frame_handler, NULL).
+    \param fd file descriptor
+    \param stop_char delimiter terminating each frame.
+    \param callback function to receive frames, or NULL to leave frame mode.
+    \param userdata pointer passed to callback.
+    \return On success, it returns TTY_OK, otherwise, a TTY_ERROR code.
+*/
+int tty_set_frame_callback(int fd, char stop_char, tty_frame_cb *callback, void *userdata);
+
+/** \brief Read what is available on fd without blocking and deliver all complete frames to the callback set by tty_set_frame_callback().
+    \param fd file descriptor, must be readable.
+    \param userdata unused, present to match the event loop callback signature.
+*/
+void tty_frame_handler(int fd, void *userdata);
+
+#ifndef _WIN32
+/** \brief tcflush() that also drops the readahead of fd when the input queue is flushed.
+
+    Including indicom.h maps tcflush() to this function, so drivers flushing the port directly never read stale
+    buffered input afterwards.
+*/
+int tty_tcflush(int fd, int queue_selector);
+#endif
 /*@}*/
 
 /**
@@ -162,6 +221,17 @@ int tty_timeout(int fd, int timeout);
  */
 int fs_sexa (char *out, double a, int w, int fracbase);
 
+/** \brief Convert a decimal number to double regardless of the current locale.
+
+    The decimal point is always '.', as in INDI XML. Unlike strtod, the function never depends on or changes LC_NUMERIC,
+    so it is safe to call from any thread.
+
+    \param str string containing the number, optionally preceded by white space.
+    \param endptr if not NULL, receives a pointer to the first character after the number, or str if none was found.
+    \return the converted value, or 0 if no number was found.
+ */
+double f_strtod (const char *str, char **endptr);
+
 /** \brief convert sexagesimal string str AxBxC to double.
 
     x can be anything non-numeric. Any missing A, B or C will be assumed 0. Optional - and + can be anywhere.
@@ -247,5 +317,8 @@ double get_local_hour_angle(double local_sideral_time, double ra);
 }
 #endif
 
+#ifndef _WIN32
+#define tcflush(fd, queue_selector) tty_tcflush(fd, queue_selector)
+#endif
 
 #endif
@@ -0,0 +1,264 @@
+#if 0
+    INDI
+    Copyright (C) 2026 INDI Library contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "inditrace.h"
+
+#define TRACE_MAXHIST       16      /* hops recorded per process */
+#define TRACE_DUMP_PERIOD   2       /* seconds between histogram files updates */
+
+typedef struct
+{
+    char hop[32];
+    unsigned long count;
+    unsigned long long sum;
+    unsigned long long max;
+    unsigned long bucket[INDI_TRACE_BUCKETS];
+} TraceHist;
+
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TraceHist trace_hist[TRACE_MAXHIST];
+static int trace_nhist;
+static char trace_name[64] = "client";
+static const char *trace_dir;
+static int trace_state = -1;        /* -1 unknown, 0 disabled, 1 enabled */
+static int trace_dirty;             /* histograms changed since the last dump */
+static int trace_started;           /* dump thread running */
+
+void indi_trace_init(const char *name)
+{
+    pthread_mutex_lock(&trace_mutex);
+    strncpy(trace_name, name, sizeof(trace_name)-1);
+    trace_name[sizeof(trace_name)-1] = '\0';
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+int indi_trace_enabled(void)
+{
+    if (trace_state < 0)
+    {
+        trace_dir = getenv(INDI_TRACE_ENV);
+        trace_state = (trace_dir != NULL && trace_dir[0] != '\0');
+    }
+
+    return trace_state;
+}
+
+unsigned long long indi_trace_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+int indi_trace_stamp(char *trace, size_t size, const char *hop, unsigned long long t)
+{
+    size_t len = strlen(trace);
+    int n = snprintf(trace + len, size - len, "%s%s=%llu", len ? " " : "", hop, t);
+
+    if (n < 0 || (size_t) n >= size - len)
+    {
+        trace[len] = '\0';
+        return -1;
+    }
+
+    return 0;
+}
+
+int indi_trace_find(const char *trace, const char *hop, unsigned long long *t)
+{
+    size_t hlen = strlen(hop);
+    const char *p = trace;
+
+    while (p && *p)
+    {
+        while (*p == ' ')
+            p++;
+
+        if (strncmp(p, hop, hlen) == 0 && p[hlen] == '=')
+        {
+            *t = strtoull(p + hlen + 1, NULL, 10);
+            return 0;
+        }
+
+        p = strchr(p, ' ');
+    }
+
+    return -1;
+}
+
+/* write all histograms to DIR/NAME.PID.hist. call with trace_mutex held. */
+static void trace_dump_locked(void)
+{
+    char path[1024], tmp[1040];
+    FILE *fp;
+    int i, j;
+
+    if (trace_nhist == 0)
+        return;
+
+    snprintf(path, sizeof(path), "%s/%s.%d.hist", trace_dir, trace_name, (int) getpid());
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    fp = fopen(tmp, "w");
+    if (fp == NULL)
+        return;
+
+    fprintf(fp, "# INDI latency trace of %s, pid %d\n", trace_name, (int) getpid());
+    fprintf(fp, "# hop count sum_us max_us buckets(<1us <2us <4us ...)\n");
+
+    for (i = 0; i < trace_nhist; i++)
+    {
+        TraceHist *h = &trace_hist[i];
+        fprintf(fp, "%s %lu %llu %llu", h->hop, h->count, h->sum, h->max);
+        for (j = 0; j < INDI_TRACE_BUCKETS; j++)
+            fprintf(fp, " %lu", h->bucket[j]);
+        fputc('\n', fp);
+    }
+
+    /* readers never see a partial file */
+    if (fclose(fp) == 0)
+        rename(tmp, path);
+    else
+        unlink(tmp);
+
+    trace_dirty = 0;
+}
+
+/* keep the histogram files current, even if the process is killed */
+static void *trace_dump_thread(void *arg)
+{
+    (void) arg;
+
+    for (;;)
+    {
+        sleep(TRACE_DUMP_PERIOD);
+
+        pthread_mutex_lock(&trace_mutex);
+        if (trace_dirty)
+            trace_dump_locked();
+        pthread_mutex_unlock(&trace_mutex);
+    }
+
+    return NULL;
+}
+
+void indi_trace_dump(void)
+{
+    if (!indi_trace_enabled())
+        return;
+
+    pthread_mutex_lock(&trace_mutex);
+    trace_dump_locked();
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+void indi_trace_record(const char *hop, unsigned long long us)
+{
+    TraceHist *h = NULL;
+    int i, b;
+
+    if (!indi_trace_enabled())
+        return;
+
+    pthread_mutex_lock(&trace_mutex);
+
+    for (i = 0; i < trace_nhist; i++)
+        if (!strcmp(trace_hist[i].hop, hop))
+        {
+            h = &trace_hist[i];
+            break;
+        }
+
+    if (h == NULL && trace_nhist < TRACE_MAXHIST)
+    {
+        h = &trace_hist[trace_nhist++];
+        strncpy(h->hop, hop, sizeof(h->hop)-1);
+    }
+
+    if (h)
+    {
+        /* smallest bucket whose bound 2^b exceeds the latency */
+        for (b = 0; b < INDI_TRACE_BUCKETS-1 && (1ULL << b) <= us; b++)
+            ;
+
+        h->bucket[b]++;
+        h->count++;
+        h->sum += us;
+        if (us > h->max)
+            h->max = us;
+    }
+
+    trace_dirty = 1;
+
+    if (!trace_started)
+    {
+        pthread_t thread;
+        pthread_attr_t attr;
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_create(&thread, &attr, trace_dump_thread, NULL);
+        pthread_attr_destroy(&attr);
+
+        atexit(indi_trace_dump);
+        trace_started = 1;
+    }
+
+    pthread_mutex_unlock(&trace_mutex);
+}
+
+void indi_trace_record_span(const char *hop, const char *trace, const char *from, const char *to)
+{
+    unsigned long long t0, t1;
+
+    if (indi_trace_find(trace, from, &t0) == 0 && indi_trace_find(trace, to, &t1) == 0 && t1 >= t0)
+        indi_trace_record(hop, t1 - t0);
+}
+
+void indi_trace_log(const char *device, const char *name, const char *trace)
+{
+    char path[1024];
+    FILE *fp;
+
+    if (!indi_trace_enabled())
+        return;
+
+    pthread_mutex_lock(&trace_mutex);
+
+    snprintf(path, sizeof(path), "%s/%s.%d.log", trace_dir, trace_name, (int) getpid());
+
+    fp = fopen(path, "a");
+    if (fp)
+    {
+        /* device and property names may contain spaces, keep them as separate fields */
+        fprintf(fp, "%s\t%s\t%s\n", device, name, trace);
+        fclose(fp);
+    }
+
+    pthread_mutex_unlock(&trace_mutex);
+}
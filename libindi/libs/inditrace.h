@@ -0,0 +1,108 @@
+#if 0
+    INDI
+    Copyright (C) 2026 INDI Library contributors
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+#endif
+
+/** \file inditrace.h
+    \brief Latency tracing of BLOBs from the driver to the client.
+
+    Tracing is enabled by setting the INDI_TRACE environment variable to a directory, for example with
+    <em>INDI_TRACE=/tmp/trace indiserver indi_simulator_ccd</em>. Drivers started by the server inherit the setting.
+
+    While tracing, every setBLOBVector carries a \e trace attribute holding stamps of the monotonic clock in
+    microseconds, one per hop, for example <em>trace='exp=10 set=52000 drv=52010'</em>. The driver stamps
+    the end of the exposure (exp), the call to IDSetBLOB (set) and the start of the write to the server (drv), once the
+    pending messages of the driver are written. BLOBs are base64 encoded while they are written, so the encoding time
+    is only recorded in the driver_encode histogram and is part of the drv to srv hop. indiserver adds the time the message was parsed (srv) and the client the time it was
+    received (cli) and decoded (done). Stamps of different hosts are not comparable, so hops crossing hosts are only meaningful when the
+    server and the client run on the same machine.
+
+    Each process accumulates per-hop latency histograms and writes them to <em>NAME.PID.hist</em> in the trace
+    directory every few seconds from a background thread and at exit. Clients also append one line per traced BLOB to
+    <em>NAME.PID.log</em>. The indi_trace tool merges these files into a report.
+
+    \author INDI Library contributors
+*/
+
+#ifndef INDITRACE_H
+#define INDITRACE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INDI_TRACE_ENV      "INDI_TRACE"    /* environment variable holding the trace directory */
+#define INDI_TRACE_ATTR     "trace"         /* attribute carrying the stamps */
+#define INDI_TRACE_BUCKETS  32              /* bucket i counts latencies below 2^i microseconds */
+#define INDI_TRACE_MAXLEN   256             /* longest trace attribute */
+
+/**
+ * \defgroup traceFunctions Trace Functions: Functions to stamp messages and record latency histograms.
+ */
+/*@{*/
+
+/** \brief Set the name used for the trace files of the process. Defaults to "client", drivers and indiserver set their own name.
+    \param name process name, e.g. the driver executable name.
+*/
+extern void indi_trace_init(const char *name);
+
+/** \return 1 if tracing is enabled with the INDI_TRACE environment variable, 0 otherwise. */
+extern int indi_trace_enabled(void);
+
+/** \return the monotonic clock in microseconds. */
+extern unsigned long long indi_trace_now(void);
+
+/** \brief Append a stamp to a trace attribute value.
+    \param trace attribute value, NUL terminated, may be empty.
+    \param size size of the trace buffer.
+    \param hop name of the hop.
+    \param t stamp in microseconds as returned by indi_trace_now().
+    \return 0 on success, -1 if the buffer is full.
+*/
+extern int indi_trace_stamp(char *trace, size_t size, const char *hop, unsigned long long t);
+
+/** \brief Find the stamp of a hop in a trace attribute value.
+    \return 0 and the stamp in \e t if found, -1 otherwise.
+*/
+extern int indi_trace_find(const char *trace, const char *hop, unsigned long long *t);
+
+/** \brief Add a latency to the histogram of a hop of this process.
+    \param hop name of the histogram.
+    \param us latency in microseconds.
+    \note Thread safe. The histograms are written to the trace directory every few seconds while they change.
+*/
+extern void indi_trace_record(const char *hop, unsigned long long us);
+
+/** \brief Add the latency between two stamps of a trace attribute to the histogram \e hop, if both are present. */
+extern void indi_trace_record_span(const char *hop, const char *trace, const char *from, const char *to);
+
+/** \brief Append a line, typically the trace attribute of a completed BLOB, to the trace log of this process. */
+extern void indi_trace_log(const char *device, const char *name, const char *trace);
+
+/** \brief Write the histograms of this process to the trace directory now. */
+extern void indi_trace_dump(void);
+
+/*@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -180,6 +180,85 @@ void bayer_rggb_2rgb24(unsigned char *dst, unsigned char *srcc, long int WIDTH,
 
 /*@}*/
 
+/**
+ * \defgroup colorSpaceSIMD Strided color space conversion functions
+    Conversions between buffers whose rows are \e stride bytes apart. A crop is converted by passing the address of
+    its first pixel with the stride of the whole frame, and an image is flipped vertically by passing the address of
+    its last row with a negative stride. Rows are converted by SSE4.1, AVX2 or NEON kernels, the best one supported by
+    the CPU being chosen at run time, and give the same results as the plain C functions above.
+ */
+
+/*@{*/
+
+/** Byte order of packed 4:2:2 formats */
+enum ccvt_order { CCVT_YUYV = 0, CCVT_UYVY, CCVT_YVYU, CCVT_VYUY };
+
+/** Layout of converted RGB pixels */
+enum ccvt_layout {
+      CCVT_BGR32 = 0,   /*!< Blue Green Red 0 */
+      CCVT_RGB24        /*!< Red Green Blue */
+};
+
+/** \return name of the instruction set in use: "avx2", "sse4.1", "neon" or "c" */
+const char *ccvt_simd_name(void);
+/** Use SIMD kernels when enable is 1 (the default), plain C when 0 */
+void ccvt_simd_enable(int enable);
+
+/** 4:2:0 YUV planar to BGR32 or RGB24, U and V planes sharing uvstride */
+void ccvt_420p_to(int width, int height, const unsigned char *y, int ystride, const unsigned char *u, const unsigned char *v,
+                  int uvstride, void *dst, int dststride, int layout);
+/** 4:2:2 packed YUV in any ccvt_order to BGR32 or RGB24 */
+void ccvt_422_to(int width, int height, const unsigned char *src, int srcstride, int order, void *dst, int dststride, int layout);
+/** 4:2:2 packed YUV in any ccvt_order to YUYV */
+void ccvt_422_yuyv(int width, int height, const unsigned char *src, int srcstride, int order, unsigned char *dst, int dststride);
+/** Interleaved chroma of NV12/NV21, width pairs per row, to separate U and V planes */
+void ccvt_uv_split(int width, int height, const unsigned char *src, int srcstride, unsigned char *u, unsigned char *v, int dststride);
+/** RGB24 to BGR32 or RGB24 */
+void ccvt_rgb24_to(int width, int height, const unsigned char *src, int srcstride, void *dst, int dststride, int layout);
+/** Little endian RGB565, or RGB555 if rgb555 is 1, to RGB24 */
+void ccvt_rgb16_rgb24(int width, int height, const unsigned char *src, int srcstride, unsigned char *dst, int dststride, int rgb555);
+/** 16 bits grey to 16 bits per channel Blue Green Red 0 */
+void ccvt_y16_bgra64(int width, int height, const unsigned short *src, int srcstride, unsigned short *dst, int dststride);
+/** 16 bits per channel Red Green Blue to 16 bits per channel Blue Green Red 0 */
+void ccvt_rgb48_bgra64(int width, int height, const unsigned short *src, int srcstride, unsigned short *dst, int dststride);
+
+/*@}*/
+
+/**
+ * \defgroup colorSpaceDemosaic Demosaicing of colour filter array images
+    Raw frames of one colour per pixel are interpolated to BGR32 or RGB24, with 8 bits channels for 8 bits frames and
+    16 bits channels for 16 bits frames. The frame is split in bands of rows converted in parallel, and bilinear rows
+    use the SIMD kernels enabled by ccvt_simd_enable(). Strides are in bytes as for the strided conversions.
+ */
+
+/*@{*/
+
+/** Colours of the top left 2x2 cell of the filter array */
+enum ccvt_cfa { CCVT_CFA_RGGB = 0, CCVT_CFA_GRBG, CCVT_CFA_GBRG, CCVT_CFA_BGGR };
+
+/** Interpolation methods */
+enum ccvt_demosaic {
+      CCVT_DEMOSAIC_BILINEAR = 0,   /*!< Average of the nearest pixels of each colour, fastest full size method */
+      CCVT_DEMOSAIC_EDGE,           /*!< Edge directed, gradient corrected interpolation (Hamilton-Adams) */
+      CCVT_DEMOSAIC_SUPERPIXEL      /*!< One pixel per 2x2 cell, the output is half the width and height */
+};
+
+/** \return ccvt_cfa of a pattern name such as "RGGB" (the CCD_CFA property), -1 if unknown */
+int ccvt_cfa_parse(const char *pattern);
+/** \return ccvt_cfa of the frame starting xoffset columns and yoffset rows into a cfa frame, e.g. a crop */
+int ccvt_cfa_offset(int cfa, int xoffset, int yoffset);
+/** Threads used by the demosaic functions, 0 (the default) for one per processor */
+void ccvt_demosaic_threads(int n);
+
+/** 8 bits raw frame to BGR32 or RGB24 */
+void ccvt_demosaic8(int width, int height, const unsigned char *src, int srcstride, int cfa, int method, void *dst,
+                    int dststride, int layout);
+/** 16 bits raw frame to 16 bits per channel BGR32 or RGB24 */
+void ccvt_demosaic16(int width, int height, const unsigned short *src, int srcstride, int cfa, int method, void *dst,
+                     int dststride, int layout);
+
+/*@}*/
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,641 @@
+/*  CCVT: ColourConVerT: demosaicing of colour filter array images
+    Copyright (C) 2026 INDI Library contributors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   The image is cut in horizontal bands, one per thread. Each band is copied
+   to a 16 bits tile with a border of HALO pixels mirrored from the image, or
+   from the rows of the neighbour bands, so the interpolations never test for
+   edges and 8 and 16 bits frames share the same code. Mirroring by an even
+   distance keeps the colour of every pixel, so the border reads like the
+   inside of the sensor.
+
+   Bilinear rows are computed as four averages over the whole row, which the
+   SIMD kernels do 8 pixels at a time, and each channel then picks one of them
+   depending on the colour of the pixel:
+
+     h2 = (W + E) / 2           v2 = (N + S) / 2
+     p4 = (W + E + N + S) / 4   x4 = (NW + NE + SW + SE) / 4
+
+   Edge directed mode is Hamilton and Adams' gradient corrected interpolation:
+   green is interpolated along the direction of the smallest gradient, red and
+   blue from the colour differences with that green, along the diagonal of
+   the smallest gradient at red and blue pixels.
+
+   Superpixel mode turns every 2x2 cell into a single pixel, halving the size.
+*/
+
+#include "ccvt.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CCVT_X86 1
+#include <immintrin.h>
+#define SSE41 __attribute__((target("sse4.1")))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CCVT_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define HALO        3       /* border of the tiles, edge directed green reads 2 pixels around 1 pixel outside */
+#define MIN_ROWS    32      /* fewest rows worth a thread */
+#define MAX_THREADS 64
+
+enum { R = 0, G, B };
+
+/* colours of the top left 2x2 cell, by ccvt_cfa */
+static const int cfa_colors[4][4] = {
+    { R, G, G, B },     /* CCVT_CFA_RGGB */
+    { G, R, B, G },     /* CCVT_CFA_GRBG */
+    { G, B, R, G },     /* CCVT_CFA_GBRG */
+    { B, G, G, R },     /* CCVT_CFA_BGGR */
+};
+
+static const char *cfa_names[4] = { "RGGB", "GRBG", "GBRG", "BGGR" };
+
+/* bilinear sources picked by the channels */
+enum { SRC_P = 0, SRC_H2, SRC_V2, SRC_P4, SRC_X4 };
+
+typedef struct
+{
+    int width, height;          /* of the input */
+    const void *src;
+    int srcstride;
+    int depth;                  /* 8 or 16 */
+    int cfa, method;
+    unsigned char *dst;
+    int dststride, layout;
+    int y0, y1;                 /* rows of the band, in output rows for superpixel */
+} Band;
+
+static int demosaic_threads;
+
+/* bilinear kernels fill the r, g and b rows for the pixels they return */
+typedef int (*bilinear_t)(const unsigned short *n, const unsigned short *s, const unsigned short *c, int width,
+                          const int sel[3][2], unsigned short *out[3]);
+
+int ccvt_cfa_parse(const char *pattern)
+{
+    int i;
+
+    if (pattern == NULL)
+        return -1;
+
+    for (i = 0; i < 4; i++)
+        if (!strncasecmp(pattern, cfa_names[i], 4))
+            return i;
+
+    return -1;
+}
+
+int ccvt_cfa_offset(int cfa, int xoffset, int yoffset)
+{
+    int cell[4], i, j;
+
+    for (j = 0; j < 2; j++)
+        for (i = 0; i < 2; i++)
+            cell[j * 2 + i] = cfa_colors[cfa][((j + yoffset) & 1) * 2 + ((i + xoffset) & 1)];
+
+    for (i = 0; i < 4; i++)
+        if (!memcmp(cell, cfa_colors[i], sizeof(cell)))
+            return i;
+
+    return cfa;
+}
+
+void ccvt_demosaic_threads(int n)
+{
+    demosaic_threads = n;
+}
+
+/* reflect i into [0, n) without changing its parity */
+static int mirror(int i, int n)
+{
+    if (n < 2)
+        return 0;
+
+    while (i < 0 || i >= n)
+    {
+        if (i < 0)
+            i = -i;
+        if (i >= n)
+            i = 2 * (n - 1) - i;
+    }
+
+    return i;
+}
+
+/* copy rows y0 - HALO to y1 + HALO of the frame to a tile, mirroring the edges */
+static void fillTile(const Band *b, unsigned short *tile, int tstride)
+{
+    int x, y;
+
+    for (y = b->y0 - HALO; y < b->y1 + HALO; y++)
+    {
+        int sy = mirror(y, b->height);
+        unsigned short *t = tile + (y - b->y0 + HALO) * tstride + HALO;
+
+        if (b->depth == 8)
+        {
+            const unsigned char *s = (const unsigned char *) b->src + sy * b->srcstride;
+            for (x = 0; x < b->width; x++)
+                t[x] = s[x];
+        }
+        else
+        {
+            const unsigned short *s = (const unsigned short *)((const unsigned char *) b->src + sy * b->srcstride);
+            memcpy(t, s, b->width * sizeof(*t));
+        }
+
+        for (x = 1; x <= HALO; x++)
+        {
+            t[-x]                = t[mirror(-x, b->width)];
+            t[b->width - 1 + x]  = t[mirror(b->width - 1 + x, b->width)];
+        }
+    }
+}
+
+/* write r, g and b rows in the layout and depth of the output */
+static void storeRow(const Band *b, const unsigned short *r, const unsigned short *g, const unsigned short *bl, int width,
+                     unsigned char *d)
+{
+    int x;
+
+    if (b->depth == 8)
+    {
+        if (b->layout == CCVT_BGR32)
+            for (x = 0; x < width; x++, d += 4)
+            {
+                d[0] = bl[x];
+                d[1] = g[x];
+                d[2] = r[x];
+                d[3] = 0;
+            }
+        else
+            for (x = 0; x < width; x++, d += 3)
+            {
+                d[0] = r[x];
+                d[1] = g[x];
+                d[2] = bl[x];
+            }
+    }
+    else
+    {
+        unsigned short *d16 = (unsigned short *) d;
+
+        if (b->layout == CCVT_BGR32)
+            for (x = 0; x < width; x++, d16 += 4)
+            {
+                d16[0] = bl[x];
+                d16[1] = g[x];
+                d16[2] = r[x];
+                d16[3] = 0;
+            }
+        else
+            for (x = 0; x < width; x++, d16 += 3)
+            {
+                d16[0] = r[x];
+                d16[1] = g[x];
+                d16[2] = bl[x];
+            }
+    }
+}
+
+/* bilinear */
+
+static void bilinearRowC(const unsigned short *n, const unsigned short *s, const unsigned short *c, int width,
+                         const int sel[3][2], unsigned short *out[3])
+{
+    int x, k;
+
+    for (x = 0; x < width; x++)
+    {
+        unsigned int v[5];
+
+        v[SRC_P]  = c[x];
+        v[SRC_H2] = (c[x - 1] + c[x + 1]) >> 1;
+        v[SRC_V2] = (n[x] + s[x]) >> 1;
+        v[SRC_P4] = (c[x - 1] + c[x + 1] + n[x] + s[x]) >> 2;
+        v[SRC_X4] = (n[x - 1] + n[x + 1] + s[x - 1] + s[x + 1]) >> 2;
+
+        for (k = 0; k < 3; k++)
+            out[k][x] = v[sel[k][x & 1]];
+    }
+}
+
+#ifdef CCVT_X86
+
+/*
+   16 bits lanes would overflow on the sums, so the averages are built from
+   halving adds: (a + b) >> 1 = (a & b) + ((a ^ b) >> 1). The quarter of four
+   values is the halving add of two halves, plus one when both halves dropped
+   a bit and their sum is odd.
+*/
+
+SSE41 static inline __m128i avg2SSE41(__m128i a, __m128i b)
+{
+    return _mm_add_epi16(_mm_and_si128(a, b), _mm_srli_epi16(_mm_xor_si128(a, b), 1));
+}
+
+SSE41 static inline __m128i avg4SSE41(__m128i a, __m128i b, __m128i c, __m128i d)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i f1 = avg2SSE41(a, b), f2 = avg2SSE41(c, d);
+    __m128i carry = _mm_and_si128(_mm_and_si128(_mm_xor_si128(a, b), _mm_xor_si128(c, d)), _mm_xor_si128(f1, f2));
+
+    return _mm_add_epi16(avg2SSE41(f1, f2), _mm_and_si128(carry, one));
+}
+
+SSE41 static int bilinearRowSSE41(const unsigned short *n, const unsigned short *s, const unsigned short *c, int width,
+                                  const int sel[3][2], unsigned short *out[3])
+{
+    const __m128i odd = _mm_set1_epi32(0xFFFF0000);
+    int x, k;
+
+    for (x = 0; x + 8 <= width; x += 8)
+    {
+        __m128i cw = _mm_loadu_si128((const __m128i *)(c + x - 1)), ce = _mm_loadu_si128((const __m128i *)(c + x + 1));
+        __m128i nn = _mm_loadu_si128((const __m128i *)(n + x)), ss = _mm_loadu_si128((const __m128i *)(s + x));
+        __m128i v[5];
+
+        v[SRC_P]  = _mm_loadu_si128((const __m128i *)(c + x));
+        v[SRC_H2] = avg2SSE41(cw, ce);
+        v[SRC_V2] = avg2SSE41(nn, ss);
+        v[SRC_P4] = avg4SSE41(cw, ce, nn, ss);
+        v[SRC_X4] = avg4SSE41(_mm_loadu_si128((const __m128i *)(n + x - 1)), _mm_loadu_si128((const __m128i *)(n + x + 1)),
+                              _mm_loadu_si128((const __m128i *)(s + x - 1)), _mm_loadu_si128((const __m128i *)(s + x + 1)));
+
+        for (k = 0; k < 3; k++)
+            _mm_storeu_si128((__m128i *)(out[k] + x), _mm_blendv_epi8(v[sel[k][0]], v[sel[k][1]], odd));
+    }
+
+    return x;
+}
+
+#endif /* CCVT_X86 */
+
+#ifdef CCVT_NEON
+
+/* vhaddq_u16 is the truncating halving add, the quarter is built as on x86 */
+static inline uint16x8_t avg4NEON(uint16x8_t a, uint16x8_t b, uint16x8_t c, uint16x8_t d)
+{
+    uint16x8_t f1 = vhaddq_u16(a, b), f2 = vhaddq_u16(c, d);
+    uint16x8_t carry = vandq_u16(vandq_u16(veorq_u16(a, b), veorq_u16(c, d)), veorq_u16(f1, f2));
+
+    return vaddq_u16(vhaddq_u16(f1, f2), vandq_u16(carry, vdupq_n_u16(1)));
+}
+
+static int bilinearRowNEON(const unsigned short *n, const unsigned short *s, const unsigned short *c, int width,
+                           const int sel[3][2], unsigned short *out[3])
+{
+    static const uint16_t oddlanes[8] = { 0, 0xFFFF, 0, 0xFFFF, 0, 0xFFFF, 0, 0xFFFF };
+    const uint16x8_t odd = vld1q_u16(oddlanes);
+    int x, k;
+
+    for (x = 0; x + 8 <= width; x += 8)
+    {
+        uint16x8_t cw = vld1q_u16(c + x - 1), ce = vld1q_u16(c + x + 1);
+        uint16x8_t nn = vld1q_u16(n + x), ss = vld1q_u16(s + x);
+        uint16x8_t v[5];
+
+        v[SRC_P]  = vld1q_u16(c + x);
+        v[SRC_H2] = vhaddq_u16(cw, ce);
+        v[SRC_V2] = vhaddq_u16(nn, ss);
+        v[SRC_P4] = avg4NEON(cw, ce, nn, ss);
+        v[SRC_X4] = avg4NEON(vld1q_u16(n + x - 1), vld1q_u16(n + x + 1), vld1q_u16(s + x - 1), vld1q_u16(s + x + 1));
+
+        for (k = 0; k < 3; k++)
+            vst1q_u16(out[k] + x, vbslq_u16(odd, v[sel[k][1]], v[sel[k][0]]));
+    }
+
+    return x;
+}
+
+#endif /* CCVT_NEON */
+
+/* SIMD kernel following ccvt_simd_enable and the kernels of ccvt_simd.c */
+static bilinear_t bilinearKernel(void)
+{
+    const char *name = ccvt_simd_name();
+
+    (void) name;
+#ifdef CCVT_X86
+    if (!strcmp(name, "sse4.1") || !strcmp(name, "avx2"))
+        return bilinearRowSSE41;
+#endif
+#ifdef CCVT_NEON
+    if (!strcmp(name, "neon"))
+        return bilinearRowNEON;
+#endif
+
+    return NULL;
+}
+
+/* source of each channel at even and odd columns of a row of colours row[] */
+static void bilinearSelect(const int *row, int sel[3][2])
+{
+    int k, px;
+
+    for (px = 0; px < 2; px++)
+    {
+        int c = row[px], h = row[px ^ 1];
+
+        for (k = 0; k < 3; k++)
+        {
+            if (k == c)
+                sel[k][px] = SRC_P;
+            else if (c == G)
+                sel[k][px] = (k == h) ? SRC_H2 : SRC_V2;
+            else
+                sel[k][px] = (k == G) ? SRC_P4 : SRC_X4;
+        }
+    }
+}
+
+static void bilinearBand(const Band *b, const unsigned short *tile, int tstride, unsigned short *rows)
+{
+    bilinear_t kernel = bilinearKernel();
+    unsigned short *out[3] = { rows, rows + b->width, rows + 2 * b->width };
+    int y, k, done;
+
+    for (y = b->y0; y < b->y1; y++)
+    {
+        const unsigned short *c = tile + (y - b->y0 + HALO) * tstride + HALO;
+        int sel[3][2];
+
+        bilinearSelect(&cfa_colors[b->cfa][(y & 1) * 2], sel);
+
+        done = kernel ? kernel(c - tstride, c + tstride, c, b->width, sel, out) : 0;
+        if (done < b->width)
+        {
+            unsigned short *rest[3];
+            for (k = 0; k < 3; k++)
+                rest[k] = out[k] + done;
+            bilinearRowC(c - tstride + done, c + tstride + done, c + done, b->width - done, sel, rest);
+        }
+
+        storeRow(b, out[R], out[G], out[B], b->width, b->dst + y * b->dststride);
+    }
+}
+
+/* edge directed */
+
+#define ABS(a) ((a) < 0 ? -(a) : (a))
+
+static int clampTo(int v, int max)
+{
+    return v < 0 ? 0 : (v > max ? max : v);
+}
+
+/* green of rows y0 - 1 to y1 and columns -1 to width, gstride apart */
+static void edgeGreen(const Band *b, const unsigned short *tile, int tstride, int *green, int gstride, int max)
+{
+    int x, y;
+
+    for (y = b->y0 - 1; y <= b->y1; y++)
+    {
+        const int *colors = &cfa_colors[b->cfa][(y & 1) * 2];
+        const unsigned short *p = tile + (y - b->y0 + HALO) * tstride + HALO;
+        int *g = green + (y - b->y0 + 1) * gstride + 1;
+
+        for (x = -1; x <= b->width; x++)
+        {
+            int c = p[x], gh, gv, dh, dv, est;
+
+            if (colors[x & 1] == G)
+            {
+                g[x] = c;
+                continue;
+            }
+
+            /* four times the estimates, corrected by the second derivative of the colour */
+            gh = 2 * (p[x - 1] + p[x + 1]) + 2 * c - p[x - 2] - p[x + 2];
+            gv = 2 * (p[x - tstride] + p[x + tstride]) + 2 * c - p[x - 2 * tstride] - p[x + 2 * tstride];
+            dh = ABS(p[x - 1] - p[x + 1]) + ABS(2 * c - p[x - 2] - p[x + 2]);
+            dv = ABS(p[x - tstride] - p[x + tstride]) + ABS(2 * c - p[x - 2 * tstride] - p[x + 2 * tstride]);
+
+            if (dh < dv)
+                est = 2 * gh;
+            else if (dv < dh)
+                est = 2 * gv;
+            else
+                est = gh + gv;
+
+            g[x] = clampTo((est + 4) >> 3, max);
+        }
+    }
+}
+
+static void edgeBand(const Band *b, const unsigned short *tile, int tstride, int *green, int gstride, unsigned short *rows)
+{
+    int max = (b->depth == 8) ? 255 : 65535;
+    unsigned short *out[3] = { rows, rows + b->width, rows + 2 * b->width };
+    int x, y;
+
+    edgeGreen(b, tile, tstride, green, gstride, max);
+
+    for (y = b->y0; y < b->y1; y++)
+    {
+        const int *colors = &cfa_colors[b->cfa][(y & 1) * 2];
+        const unsigned short *p = tile + (y - b->y0 + HALO) * tstride + HALO;
+        const int *g = green + (y - b->y0 + 1) * gstride + 1;
+
+        for (x = 0; x < b->width; x++)
+        {
+            int c = colors[x & 1];
+
+            if (c == G)
+            {
+                /* colour differences of the horizontal and of the vertical neighbours */
+                int h = colors[(x & 1) ^ 1], v = 2 - h;
+                int eh = g[x] + ((p[x - 1] - g[x - 1]) + (p[x + 1] - g[x + 1])) / 2;
+                int ev = g[x] + ((p[x - tstride] - g[x - gstride]) + (p[x + tstride] - g[x + gstride])) / 2;
+
+                out[G][x] = p[x];
+                out[h][x] = clampTo(eh, max);
+                out[v][x] = clampTo(ev, max);
+            }
+            else
+            {
+                /* the other colour sits on the diagonals */
+                int o = 2 - c;
+                int d1 = ABS(p[x - tstride - 1] - p[x + tstride + 1]) + ABS(2 * g[x] - g[x - gstride - 1] - g[x + gstride + 1]);
+                int d2 = ABS(p[x - tstride + 1] - p[x + tstride - 1]) + ABS(2 * g[x] - g[x - gstride + 1] - g[x + gstride - 1]);
+                int e1 = g[x] + ((p[x - tstride - 1] - g[x - gstride - 1]) + (p[x + tstride + 1] - g[x + gstride + 1])) / 2;
+                int e2 = g[x] + ((p[x - tstride + 1] - g[x - gstride + 1]) + (p[x + tstride - 1] - g[x + gstride - 1])) / 2;
+
+                out[c][x] = p[x];
+                out[G][x] = g[x];
+                out[o][x] = clampTo(d1 < d2 ? e1 : (d2 < d1 ? e2 : (e1 + e2) / 2), max);
+            }
+        }
+
+        storeRow(b, out[R], out[G], out[B], b->width, b->dst + y * b->dststride);
+    }
+}
+
+/* superpixel, y0 and y1 are output rows */
+static void superpixelBand(const Band *b, unsigned short *rows)
+{
+    int w = b->width / 2;
+    unsigned short *out[3] = { rows, rows + w, rows + 2 * w };
+    const int *colors = cfa_colors[b->cfa];
+    int x, y, k;
+
+    for (y = b->y0; y < b->y1; y++)
+    {
+        for (x = 0; x < w; x++)
+        {
+            unsigned int v[4], sum[3] = { 0, 0, 0 };
+
+            if (b->depth == 8)
+            {
+                const unsigned char *s = (const unsigned char *) b->src + 2 * y * b->srcstride + 2 * x;
+                v[0] = s[0];
+                v[1] = s[1];
+                v[2] = s[b->srcstride];
+                v[3] = s[b->srcstride + 1];
+            }
+            else
+            {
+                const unsigned short *s = (const unsigned short *)((const unsigned char *) b->src + 2 * y * b->srcstride) + 2 * x;
+                const unsigned short *s2 = (const unsigned short *)((const unsigned char *) s + b->srcstride);
+                v[0] = s[0];
+                v[1] = s[1];
+                v[2] = s2[0];
+                v[3] = s2[1];
+            }
+
+            for (k = 0; k < 4; k++)
+                sum[colors[k]] += v[k];
+
+            out[R][x] = sum[R];
+            out[G][x] = sum[G] >> 1;
+            out[B][x] = sum[B];
+        }
+
+        storeRow(b, out[R], out[G], out[B], w, b->dst + y * b->dststride);
+    }
+}
+
+static void *demosaicBand(void *arg)
+{
+    Band *b = (Band *) arg;
+    int tstride = b->width + 2 * HALO, gstride = b->width + 2;
+    unsigned short *tile = NULL, *rows;
+    int *green = NULL;
+
+    rows = malloc(3 * b->width * sizeof(*rows));
+    if (rows == NULL)
+        return NULL;
+
+    if (b->method == CCVT_DEMOSAIC_SUPERPIXEL)
+    {
+        superpixelBand(b, rows);
+        free(rows);
+        return NULL;
+    }
+
+    tile = malloc((b->y1 - b->y0 + 2 * HALO) * tstride * sizeof(*tile));
+    if (b->method == CCVT_DEMOSAIC_EDGE)
+        green = malloc((b->y1 - b->y0 + 2) * gstride * sizeof(*green));
+
+    if (tile && (green || b->method != CCVT_DEMOSAIC_EDGE))
+    {
+        fillTile(b, tile, tstride);
+        if (b->method == CCVT_DEMOSAIC_EDGE)
+            edgeBand(b, tile, tstride, green, gstride, rows);
+        else
+            bilinearBand(b, tile, tstride, rows);
+    }
+
+    free(green);
+    free(tile);
+    free(rows);
+    return NULL;
+}
+
+static void demosaic(int width, int height, const void *src, int srcstride, int depth, int cfa, int method, void *dst,
+                     int dststride, int layout)
+{
+    Band bands[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    int started[MAX_THREADS];
+    int rows = (method == CCVT_DEMOSAIC_SUPERPIXEL) ? height / 2 : height;
+    int n = demosaic_threads, i, y;
+
+    if (width < 2 || rows < 1 || cfa < 0 || cfa > 3)
+        return;
+
+    if (n <= 0)
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > rows / MIN_ROWS)
+        n = rows / MIN_ROWS;
+    if (n > MAX_THREADS)
+        n = MAX_THREADS;
+    if (n < 1)
+        n = 1;
+
+    for (i = 0, y = 0; i < n; i++)
+    {
+        Band *b = &bands[i];
+
+        b->width     = width;
+        b->height    = height;
+        b->src       = src;
+        b->srcstride = srcstride;
+        b->depth     = depth;
+        b->cfa       = cfa;
+        b->method    = method;
+        b->dst       = dst;
+        b->dststride = dststride;
+        b->layout    = layout;
+        b->y0        = y;
+        b->y1        = y = (int)((long) rows * (i + 1) / n);
+    }
+
+    /* the calling thread takes the first band */
+    for (i = 1; i < n; i++)
+        started[i] = (pthread_create(&threads[i], NULL, demosaicBand, &bands[i]) == 0);
+
+    demosaicBand(&bands[0]);
+
+    for (i = 1; i < n; i++)
+    {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            demosaicBand(&bands[i]);
+    }
+}
+
+void ccvt_demosaic8(int width, int height, const unsigned char *src, int srcstride, int cfa, int method, void *dst,
+                    int dststride, int layout)
+{
+    demosaic(width, height, src, srcstride, 8, cfa, method, dst, dststride, layout);
+}
+
+void ccvt_demosaic16(int width, int height, const unsigned short *src, int srcstride, int cfa, int method, void *dst,
+                     int dststride, int layout)
+{
+    demosaic(width, height, src, srcstride, 16, cfa, method, dst, dststride, layout);
+}
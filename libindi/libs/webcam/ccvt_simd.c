@@ -0,0 +1,805 @@
+/*  CCVT: ColourConVerT: strided conversions with SIMD kernels
+    Copyright (C) 2026 INDI Library contributors
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   Each conversion works row by row between strided buffers, so cropping is
+   only a matter of pointing at the first pixel of the crop and flipping a
+   matter of a negative stride. Rows are handed to the best kernel the CPU
+   supports, chosen once at run time, and the kernels return how many pixels
+   they converted. The scalar code finishes the row, so widths need not be
+   multiples of the SIMD block.
+
+   The YUV to RGB kernels use the same fixed point arithmetic as ccvt_c2.c
+   and ccvt_misc.c and give identical results:
+
+     cb = ((u-128) * 454) >> 8
+     cr = ((v-128) * 359) >> 8
+     cg = ((v-128) * 183 + (u-128) * 88) >> 8
+
+   With d = u-128 or v-128, (d << 8) fits 16 bits and a high multiply by the
+   coefficient gives (d * k) >> 8 exactly. cg may overflow 16 bits before the
+   shift, so it is summed in 32 bits.
+*/
+
+#include "ccvt.h"
+#include "ccvt_types.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CCVT_X86 1
+#include <immintrin.h>
+#define SSE41 __attribute__((target("sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CCVT_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* pixels converted by a kernel, the scalar code does the rest */
+typedef int (*yuvrow_t)(const unsigned char *y, const unsigned char *u, const unsigned char *v, unsigned char *d, int width, int layout);
+typedef int (*unpack_t)(const unsigned char *s, const int *pos, unsigned char *y, unsigned char *u, unsigned char *v, int width);
+typedef int (*reorder_t)(const unsigned char *s, const int *pos, unsigned char *d, int width);
+typedef int (*split_t)(const unsigned char *s, unsigned char *u, unsigned char *v, int n);
+typedef int (*rgbrow_t)(const unsigned char *s, unsigned char *d, int width);
+typedef int (*row16_t)(const unsigned short *s, unsigned short *d, int width);
+
+typedef struct
+{
+    const char *name;
+    yuvrow_t yuvrow;        /* planar YUV row to BGR32 or RGB24 */
+    unpack_t unpack;        /* packed 4:2:2 row to Y, U and V rows */
+    reorder_t reorder;      /* packed 4:2:2 row to YUYV */
+    split_t split;          /* interleaved chroma row to U and V rows */
+    rgbrow_t rgb24bgr32;    /* RGB24 row to BGR32 */
+    row16_t y16;            /* 16 bits grey row to 16 bits BGRA */
+    row16_t rgb48;          /* 16 bits RGB row to 16 bits BGRA */
+} Kernels;
+
+/* byte offsets of Y0, U, Y1 and V in each 4 bytes group, by ccvt_order */
+static const int order_pos[4][4] = {
+    { 0, 1, 2, 3 },     /* CCVT_YUYV */
+    { 1, 0, 3, 2 },     /* CCVT_UYVY */
+    { 0, 3, 2, 1 },     /* CCVT_YVYU */
+    { 1, 2, 3, 0 },     /* CCVT_VYUY */
+};
+
+/* scalar rows */
+
+static void yuvRowC(const unsigned char *y, const unsigned char *u, const unsigned char *v, unsigned char *d, int width, int layout)
+{
+    int i, r, g, b, cb, cr, cg;
+
+    for (i = 0; i < width; i++)
+    {
+        int du = u[i >> 1] - 128, dv = v[i >> 1] - 128;
+
+        cb = (du * 454) >> 8;
+        cr = (dv * 359) >> 8;
+        cg = (dv * 183 + du * 88) >> 8;
+        r = y[i] + cr;
+        g = y[i] - cg;
+        b = y[i] + cb;
+        SAT(r);
+        SAT(g);
+        SAT(b);
+
+        if (layout == CCVT_BGR32)
+        {
+            *d++ = b;
+            *d++ = g;
+            *d++ = r;
+            *d++ = 0;
+        }
+        else
+        {
+            *d++ = r;
+            *d++ = g;
+            *d++ = b;
+        }
+    }
+}
+
+static void unpackC(const unsigned char *s, const int *pos, unsigned char *y, unsigned char *u, unsigned char *v, int width)
+{
+    int i;
+
+    for (i = 0; i + 1 < width; i += 2, s += 4)
+    {
+        *y++ = s[pos[0]];
+        *y++ = s[pos[2]];
+        *u++ = s[pos[1]];
+        *v++ = s[pos[3]];
+    }
+    if (i < width)
+    {
+        *y = s[pos[0]];
+        *u = s[pos[1]];
+        *v = s[pos[3]];
+    }
+}
+
+static void reorderC(const unsigned char *s, const int *pos, unsigned char *d, int width)
+{
+    int i;
+
+    for (i = 0; i + 1 < width; i += 2, s += 4)
+    {
+        *d++ = s[pos[0]];
+        *d++ = s[pos[1]];
+        *d++ = s[pos[2]];
+        *d++ = s[pos[3]];
+    }
+}
+
+static void splitC(const unsigned char *s, unsigned char *u, unsigned char *v, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        *u++ = *s++;
+        *v++ = *s++;
+    }
+}
+
+static void rgb24bgr32C(const unsigned char *s, unsigned char *d, int width)
+{
+    int i;
+
+    for (i = 0; i < width; i++, s += 3)
+    {
+        *d++ = s[2];
+        *d++ = s[1];
+        *d++ = s[0];
+        *d++ = 0;
+    }
+}
+
+static void y16C(const unsigned short *s, unsigned short *d, int width)
+{
+    int i;
+
+    for (i = 0; i < width; i++)
+    {
+        *d++ = *s;
+        *d++ = *s;
+        *d++ = *s++;
+        *d++ = 0;
+    }
+}
+
+static void rgb48C(const unsigned short *s, unsigned short *d, int width)
+{
+    int i;
+
+    for (i = 0; i < width; i++, s += 3)
+    {
+        *d++ = s[2];
+        *d++ = s[1];
+        *d++ = s[0];
+        *d++ = 0;
+    }
+}
+
+#ifdef CCVT_X86
+
+/* SSE4.1: 16 pixels per step */
+
+SSE41 static int yuvRowSSE41(const unsigned char *y, const unsigned char *u, const unsigned char *v, unsigned char *d, int width, int layout)
+{
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i kb = _mm_set1_epi16(454), kr = _mm_set1_epi16(359);
+    const __m128i kg = _mm_set1_epi32((88 << 16) | 183);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i pack24 = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    /* RGB24 stores spill 4 bytes past the 16 pixels */
+    int last = (layout == CCVT_RGB24 ? width - 18 : width - 16);
+    int n;
+
+    for (n = 0; n <= last; n += 16)
+    {
+        __m128i yy = _mm_loadu_si128((const __m128i *)(y + n));
+        __m128i du = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(u + n / 2))), k128);
+        __m128i dv = _mm_sub_epi16(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(v + n / 2))), k128);
+        __m128i cb = _mm_mulhi_epi16(_mm_slli_epi16(du, 8), kb);
+        __m128i cr = _mm_mulhi_epi16(_mm_slli_epi16(dv, 8), kr);
+        __m128i cg = _mm_packs_epi32(_mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(dv, du), kg), 8),
+                                     _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(dv, du), kg), 8));
+        __m128i ylo = _mm_cvtepu8_epi16(yy), yhi = _mm_unpackhi_epi8(yy, zero);
+        __m128i r = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(cr, cr)),
+                                     _mm_add_epi16(yhi, _mm_unpackhi_epi16(cr, cr)));
+        __m128i g = _mm_packus_epi16(_mm_sub_epi16(ylo, _mm_unpacklo_epi16(cg, cg)),
+                                     _mm_sub_epi16(yhi, _mm_unpackhi_epi16(cg, cg)));
+        __m128i b = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(cb, cb)),
+                                     _mm_add_epi16(yhi, _mm_unpackhi_epi16(cb, cb)));
+
+        if (layout == CCVT_BGR32)
+        {
+            __m128i *o = (__m128i *)(d + 4 * n);
+            __m128i bg = _mm_unpacklo_epi8(b, g), r0 = _mm_unpacklo_epi8(r, zero);
+            _mm_storeu_si128(o, _mm_unpacklo_epi16(bg, r0));
+            _mm_storeu_si128(o + 1, _mm_unpackhi_epi16(bg, r0));
+            bg = _mm_unpackhi_epi8(b, g);
+            r0 = _mm_unpackhi_epi8(r, zero);
+            _mm_storeu_si128(o + 2, _mm_unpacklo_epi16(bg, r0));
+            _mm_storeu_si128(o + 3, _mm_unpackhi_epi16(bg, r0));
+        }
+        else
+        {
+            unsigned char *o = d + 3 * n;
+            __m128i rg = _mm_unpacklo_epi8(r, g), b0 = _mm_unpacklo_epi8(b, zero);
+            _mm_storeu_si128((__m128i *)o, _mm_shuffle_epi8(_mm_unpacklo_epi16(rg, b0), pack24));
+            _mm_storeu_si128((__m128i *)(o + 12), _mm_shuffle_epi8(_mm_unpackhi_epi16(rg, b0), pack24));
+            rg = _mm_unpackhi_epi8(r, g);
+            b0 = _mm_unpackhi_epi8(b, zero);
+            _mm_storeu_si128((__m128i *)(o + 24), _mm_shuffle_epi8(_mm_unpacklo_epi16(rg, b0), pack24));
+            _mm_storeu_si128((__m128i *)(o + 36), _mm_shuffle_epi8(_mm_unpackhi_epi16(rg, b0), pack24));
+        }
+    }
+
+    return n;
+}
+
+SSE41 static int unpackSSE41(const unsigned char *s, const int *pos, unsigned char *y, unsigned char *u, unsigned char *v, int width)
+{
+    __m128i mask;
+    char m[16];
+    int n, k;
+
+    /* 8 Y, then 4 U, then 4 V from each 16 bytes */
+    for (k = 0; k < 4; k++)
+    {
+        m[2 * k] = pos[0] + 4 * k;
+        m[2 * k + 1] = pos[2] + 4 * k;
+        m[8 + k] = pos[1] + 4 * k;
+        m[12 + k] = pos[3] + 4 * k;
+    }
+    mask = _mm_loadu_si128((const __m128i *)m);
+
+    for (n = 0; n <= width - 16; n += 16)
+    {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 2 * n)), mask);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 2 * n + 16)), mask);
+        __m128i uv = _mm_shuffle_epi32(_mm_unpackhi_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm_storeu_si128((__m128i *)(y + n), _mm_unpacklo_epi64(a, b));
+        _mm_storel_epi64((__m128i *)(u + n / 2), uv);
+        _mm_storel_epi64((__m128i *)(v + n / 2), _mm_srli_si128(uv, 8));
+    }
+
+    return n;
+}
+
+SSE41 static int reorderSSE41(const unsigned char *s, const int *pos, unsigned char *d, int width)
+{
+    __m128i mask;
+    char m[16];
+    int n, k;
+
+    for (k = 0; k < 16; k++)
+        m[k] = pos[k & 3] + (k & ~3);
+    mask = _mm_loadu_si128((const __m128i *)m);
+
+    for (n = 0; n <= width - 8; n += 8)
+        _mm_storeu_si128((__m128i *)(d + 2 * n), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 2 * n)), mask));
+
+    return n;
+}
+
+SSE41 static int splitSSE41(const unsigned char *s, unsigned char *u, unsigned char *v, int n)
+{
+    const __m128i lo = _mm_set1_epi16(0xff);
+    int i;
+
+    for (i = 0; i <= n - 16; i += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + 2 * i + 16));
+
+        _mm_storeu_si128((__m128i *)(u + i), _mm_packus_epi16(_mm_and_si128(a, lo), _mm_and_si128(b, lo)));
+        _mm_storeu_si128((__m128i *)(v + i), _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+
+    return i;
+}
+
+SSE41 static int rgb24bgr32SSE41(const unsigned char *s, unsigned char *d, int width)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    int n;
+
+    /* each load reads 4 bytes past its 4 pixels */
+    for (n = 0; n <= width - 6; n += 4)
+        _mm_storeu_si128((__m128i *)(d + 4 * n), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 3 * n)), mask));
+
+    return n;
+}
+
+SSE41 static int y16SSE41(const unsigned short *s, unsigned short *d, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int n;
+
+    for (n = 0; n <= width - 8; n += 8)
+    {
+        __m128i yy = _mm_loadu_si128((const __m128i *)(s + n));
+        __m128i a = _mm_unpacklo_epi16(yy, yy), b = _mm_unpacklo_epi16(yy, zero);
+        __m128i *o = (__m128i *)(d + 4 * n);
+
+        _mm_storeu_si128(o, _mm_unpacklo_epi32(a, b));
+        _mm_storeu_si128(o + 1, _mm_unpackhi_epi32(a, b));
+        a = _mm_unpackhi_epi16(yy, yy);
+        b = _mm_unpackhi_epi16(yy, zero);
+        _mm_storeu_si128(o + 2, _mm_unpacklo_epi32(a, b));
+        _mm_storeu_si128(o + 3, _mm_unpackhi_epi32(a, b));
+    }
+
+    return n;
+}
+
+SSE41 static int rgb48SSE41(const unsigned short *s, unsigned short *d, int width)
+{
+    const __m128i mask = _mm_setr_epi8(4, 5, 2, 3, 0, 1, -1, -1, 10, 11, 8, 9, 6, 7, -1, -1);
+    int n;
+
+    /* each load reads 4 bytes past its 2 pixels */
+    for (n = 0; n <= width - 3; n += 2)
+        _mm_storeu_si128((__m128i *)(d + 4 * n), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 3 * n)), mask));
+
+    return n;
+}
+
+/* AVX2: 32 pixels per step. unpack and pack work within each 128 bits lane,
+ * pixels 0-7 and 16-23 end up in the low halves, 8-15 and 24-31 in the high
+ * ones, which packus puts back in order.
+ */
+
+AVX2 static int yuvRowAVX2(const unsigned char *y, const unsigned char *u, const unsigned char *v, unsigned char *d, int width, int layout)
+{
+    const __m256i k128 = _mm256_set1_epi16(128);
+    const __m256i kb = _mm256_set1_epi16(454), kr = _mm256_set1_epi16(359);
+    const __m256i kg = _mm256_set1_epi32((88 << 16) | 183);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i pack24 = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                            0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    int last = (layout == CCVT_RGB24 ? width - 34 : width - 32);
+    int n;
+
+    for (n = 0; n <= last; n += 32)
+    {
+        __m256i yy = _mm256_loadu_si256((const __m256i *)(y + n));
+        __m256i du = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(u + n / 2))), k128);
+        __m256i dv = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(v + n / 2))), k128);
+        __m256i cb = _mm256_mulhi_epi16(_mm256_slli_epi16(du, 8), kb);
+        __m256i cr = _mm256_mulhi_epi16(_mm256_slli_epi16(dv, 8), kr);
+        __m256i cg = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(dv, du), kg), 8),
+                                        _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(dv, du), kg), 8));
+        __m256i ylo = _mm256_unpacklo_epi8(yy, zero), yhi = _mm256_unpackhi_epi8(yy, zero);
+        __m256i r = _mm256_packus_epi16(_mm256_add_epi16(ylo, _mm256_unpacklo_epi16(cr, cr)),
+                                        _mm256_add_epi16(yhi, _mm256_unpackhi_epi16(cr, cr)));
+        __m256i g = _mm256_packus_epi16(_mm256_sub_epi16(ylo, _mm256_unpacklo_epi16(cg, cg)),
+                                        _mm256_sub_epi16(yhi, _mm256_unpackhi_epi16(cg, cg)));
+        __m256i b = _mm256_packus_epi16(_mm256_add_epi16(ylo, _mm256_unpacklo_epi16(cb, cb)),
+                                        _mm256_add_epi16(yhi, _mm256_unpackhi_epi16(cb, cb)));
+        __m256i c0, c1, c2, q0, q1, q2, q3, p[4];
+        int k;
+
+        /* 4 bytes per pixel, in the order of the layout */
+        if (layout == CCVT_BGR32)
+        {
+            c0 = b;
+            c2 = r;
+        }
+        else
+        {
+            c0 = r;
+            c2 = b;
+        }
+        c1 = _mm256_unpacklo_epi8(c0, g);
+        q0 = _mm256_unpacklo_epi16(c1, _mm256_unpacklo_epi8(c2, zero));
+        q1 = _mm256_unpackhi_epi16(c1, _mm256_unpacklo_epi8(c2, zero));
+        c1 = _mm256_unpackhi_epi8(c0, g);
+        q2 = _mm256_unpacklo_epi16(c1, _mm256_unpackhi_epi8(c2, zero));
+        q3 = _mm256_unpackhi_epi16(c1, _mm256_unpackhi_epi8(c2, zero));
+        p[0] = _mm256_permute2x128_si256(q0, q1, 0x20);
+        p[1] = _mm256_permute2x128_si256(q2, q3, 0x20);
+        p[2] = _mm256_permute2x128_si256(q0, q1, 0x31);
+        p[3] = _mm256_permute2x128_si256(q2, q3, 0x31);
+
+        if (layout == CCVT_BGR32)
+        {
+            for (k = 0; k < 4; k++)
+                _mm256_storeu_si256((__m256i *)(d + 4 * n + 32 * k), p[k]);
+        }
+        else
+        {
+            /* 12 bytes per 4 pixels, each store spills 4 bytes */
+            unsigned char *o = d + 3 * n;
+            for (k = 0; k < 4; k++, o += 24)
+            {
+                __m256i t = _mm256_shuffle_epi8(p[k], pack24);
+                _mm_storeu_si128((__m128i *)o, _mm256_castsi256_si128(t));
+                _mm_storeu_si128((__m128i *)(o + 12), _mm256_extracti128_si256(t, 1));
+            }
+        }
+    }
+
+    return n;
+}
+
+static const Kernels sse41 = { "sse4.1", yuvRowSSE41, unpackSSE41, reorderSSE41, splitSSE41, rgb24bgr32SSE41, y16SSE41, rgb48SSE41 };
+static const Kernels avx2 = { "avx2", yuvRowAVX2, unpackSSE41, reorderSSE41, splitSSE41, rgb24bgr32SSE41, y16SSE41, rgb48SSE41 };
+
+#endif /* CCVT_X86 */
+
+#ifdef CCVT_NEON
+
+/* NEON: 16 pixels per step, structure loads and stores do the shuffles */
+
+static int yuvRowNEON(const unsigned char *y, const unsigned char *u, const unsigned char *v, unsigned char *d, int width, int layout)
+{
+    const uint8x8_t k128 = vdup_n_u8(128);
+    int n;
+
+    for (n = 0; n <= width - 16; n += 16)
+    {
+        uint8x16_t yy = vld1q_u8(y + n);
+        int16x8_t du = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(u + n / 2), k128));
+        int16x8_t dv = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(v + n / 2), k128));
+        /* doubling high multiply: ((d << 7) * k * 2) >> 16 == (d * k) >> 8 */
+        int16x8_t cb = vqdmulhq_n_s16(vshlq_n_s16(du, 7), 454);
+        int16x8_t cr = vqdmulhq_n_s16(vshlq_n_s16(dv, 7), 359);
+        int32x4_t glo = vmlal_n_s16(vmull_n_s16(vget_low_s16(dv), 183), vget_low_s16(du), 88);
+        int32x4_t ghi = vmlal_n_s16(vmull_n_s16(vget_high_s16(dv), 183), vget_high_s16(du), 88);
+        int16x8_t cg = vcombine_s16(vshrn_n_s32(glo, 8), vshrn_n_s32(ghi, 8));
+        int16x8x2_t crx = vzipq_s16(cr, cr), cgx = vzipq_s16(cg, cg), cbx = vzipq_s16(cb, cb);
+        int16x8_t ylo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(yy)));
+        int16x8_t yhi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(yy)));
+        uint8x16_t r = vcombine_u8(vqmovun_s16(vaddq_s16(ylo, crx.val[0])), vqmovun_s16(vaddq_s16(yhi, crx.val[1])));
+        uint8x16_t g = vcombine_u8(vqmovun_s16(vsubq_s16(ylo, cgx.val[0])), vqmovun_s16(vsubq_s16(yhi, cgx.val[1])));
+        uint8x16_t b = vcombine_u8(vqmovun_s16(vaddq_s16(ylo, cbx.val[0])), vqmovun_s16(vaddq_s16(yhi, cbx.val[1])));
+
+        if (layout == CCVT_BGR32)
+        {
+            uint8x16x4_t o;
+            o.val[0] = b;
+            o.val[1] = g;
+            o.val[2] = r;
+            o.val[3] = vdupq_n_u8(0);
+            vst4q_u8(d + 4 * n, o);
+        }
+        else
+        {
+            uint8x16x3_t o;
+            o.val[0] = r;
+            o.val[1] = g;
+            o.val[2] = b;
+            vst3q_u8(d + 3 * n, o);
+        }
+    }
+
+    return n;
+}
+
+static int unpackNEON(const unsigned char *s, const int *pos, unsigned char *y, unsigned char *u, unsigned char *v, int width)
+{
+    int n;
+
+    for (n = 0; n <= width - 32; n += 32)
+    {
+        uint8x16x4_t c = vld4q_u8(s + 2 * n);
+        uint8x16x2_t yy;
+
+        yy.val[0] = c.val[pos[0]];
+        yy.val[1] = c.val[pos[2]];
+        vst2q_u8(y + n, yy);
+        vst1q_u8(u + n / 2, c.val[pos[1]]);
+        vst1q_u8(v + n / 2, c.val[pos[3]]);
+    }
+
+    return n;
+}
+
+static int reorderNEON(const unsigned char *s, const int *pos, unsigned char *d, int width)
+{
+    int n, k;
+
+    for (n = 0; n <= width - 32; n += 32)
+    {
+        uint8x16x4_t c = vld4q_u8(s + 2 * n), o;
+
+        for (k = 0; k < 4; k++)
+            o.val[k] = c.val[pos[k]];
+        vst4q_u8(d + 2 * n, o);
+    }
+
+    return n;
+}
+
+static int splitNEON(const unsigned char *s, unsigned char *u, unsigned char *v, int n)
+{
+    int i;
+
+    for (i = 0; i <= n - 16; i += 16)
+    {
+        uint8x16x2_t c = vld2q_u8(s + 2 * i);
+        vst1q_u8(u + i, c.val[0]);
+        vst1q_u8(v + i, c.val[1]);
+    }
+
+    return i;
+}
+
+static int rgb24bgr32NEON(const unsigned char *s, unsigned char *d, int width)
+{
+    int n;
+
+    for (n = 0; n <= width - 16; n += 16)
+    {
+        uint8x16x3_t c = vld3q_u8(s + 3 * n);
+        uint8x16x4_t o;
+
+        o.val[0] = c.val[2];
+        o.val[1] = c.val[1];
+        o.val[2] = c.val[0];
+        o.val[3] = vdupq_n_u8(0);
+        vst4q_u8(d + 4 * n, o);
+    }
+
+    return n;
+}
+
+static int y16NEON(const unsigned short *s, unsigned short *d, int width)
+{
+    int n;
+
+    for (n = 0; n <= width - 8; n += 8)
+    {
+        uint16x8x4_t o;
+
+        o.val[0] = o.val[1] = o.val[2] = vld1q_u16(s + n);
+        o.val[3] = vdupq_n_u16(0);
+        vst4q_u16(d + 4 * n, o);
+    }
+
+    return n;
+}
+
+static int rgb48NEON(const unsigned short *s, unsigned short *d, int width)
+{
+    int n;
+
+    for (n = 0; n <= width - 8; n += 8)
+    {
+        uint16x8x3_t c = vld3q_u16(s + 3 * n);
+        uint16x8x4_t o;
+
+        o.val[0] = c.val[2];
+        o.val[1] = c.val[1];
+        o.val[2] = c.val[0];
+        o.val[3] = vdupq_n_u16(0);
+        vst4q_u16(d + 4 * n, o);
+    }
+
+    return n;
+}
+
+static const Kernels neon = { "neon", yuvRowNEON, unpackNEON, reorderNEON, splitNEON, rgb24bgr32NEON, y16NEON, rgb48NEON };
+
+#endif /* CCVT_NEON */
+
+static const Kernels scalar = { "c", NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+
+static const Kernels *best;
+static int simd_enabled = 1;
+
+/* pick the kernels of the running CPU once */
+static const Kernels *kernels(void)
+{
+    if (!simd_enabled)
+        return &scalar;
+
+    if (best == NULL)
+    {
+        best = &scalar;
+#ifdef CCVT_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            best = &avx2;
+        else if (__builtin_cpu_supports("sse4.1"))
+            best = &sse41;
+#endif
+#ifdef CCVT_NEON
+        best = &neon;
+#endif
+    }
+
+    return best;
+}
+
+const char *ccvt_simd_name(void)
+{
+    return kernels()->name;
+}
+
+void ccvt_simd_enable(int enable)
+{
+    simd_enabled = enable;
+}
+
+void ccvt_420p_to(int width, int height, const unsigned char *y, int ystride, const unsigned char *u, const unsigned char *v,
+                  int uvstride, void *dst, int dststride, int layout)
+{
+    const Kernels *k = kernels();
+    int bpp = (layout == CCVT_BGR32 ? 4 : 3);
+    unsigned char *d = dst;
+    int j, n;
+
+    for (j = 0; j < height; j++, y += ystride, d += dststride)
+    {
+        const unsigned char *ur = u + (j >> 1) * uvstride, *vr = v + (j >> 1) * uvstride;
+
+        n = k->yuvrow ? k->yuvrow(y, ur, vr, d, width, layout) : 0;
+        yuvRowC(y + n, ur + n / 2, vr + n / 2, d + n * bpp, width - n, layout);
+    }
+}
+
+void ccvt_422_to(int width, int height, const unsigned char *src, int srcstride, int order, void *dst, int dststride, int layout)
+{
+    const Kernels *k = kernels();
+    const int *pos = order_pos[order & 3];
+    int bpp = (layout == CCVT_BGR32 ? 4 : 3);
+    int cw = (width + 1) / 2;
+    unsigned char *d = dst;
+    unsigned char *y, *u, *v;
+    int j, n;
+
+    /* one row of planes, it stays in cache */
+    y = malloc(width + 2 * cw);
+    if (y == NULL)
+        return;
+    u = y + width;
+    v = u + cw;
+
+    for (j = 0; j < height; j++, src += srcstride, d += dststride)
+    {
+        n = k->unpack ? k->unpack(src, pos, y, u, v, width) : 0;
+        unpackC(src + 2 * n, pos, y + n, u + n / 2, v + n / 2, width - n);
+
+        n = k->yuvrow ? k->yuvrow(y, u, v, d, width, layout) : 0;
+        yuvRowC(y + n, u + n / 2, v + n / 2, d + n * bpp, width - n, layout);
+    }
+
+    free(y);
+}
+
+void ccvt_422_yuyv(int width, int height, const unsigned char *src, int srcstride, int order, unsigned char *dst, int dststride)
+{
+    const Kernels *k = kernels();
+    const int *pos = order_pos[order & 3];
+    int j, n;
+
+    for (j = 0; j < height; j++, src += srcstride, dst += dststride)
+    {
+        if (order == CCVT_YUYV)
+        {
+            memcpy(dst, src, 2 * width);
+            continue;
+        }
+        n = k->reorder ? k->reorder(src, pos, dst, width) : 0;
+        reorderC(src + 2 * n, pos, dst + 2 * n, width - n);
+    }
+}
+
+void ccvt_uv_split(int width, int height, const unsigned char *src, int srcstride, unsigned char *u, unsigned char *v, int dststride)
+{
+    const Kernels *k = kernels();
+    int j, n;
+
+    for (j = 0; j < height; j++, src += srcstride, u += dststride, v += dststride)
+    {
+        n = k->split ? k->split(src, u, v, width) : 0;
+        splitC(src + 2 * n, u + n, v + n, width - n);
+    }
+}
+
+void ccvt_rgb24_to(int width, int height, const unsigned char *src, int srcstride, void *dst, int dststride, int layout)
+{
+    const Kernels *k = kernels();
+    unsigned char *d = dst;
+    int j, n;
+
+    for (j = 0; j < height; j++, src += srcstride, d += dststride)
+    {
+        if (layout == CCVT_RGB24)
+        {
+            memcpy(d, src, 3 * width);
+            continue;
+        }
+        n = k->rgb24bgr32 ? k->rgb24bgr32(src, d, width) : 0;
+        rgb24bgr32C(src + 3 * n, d + 4 * n, width - n);
+    }
+}
+
+void ccvt_rgb16_rgb24(int width, int height, const unsigned char *src, int srcstride, unsigned char *dst, int dststride, int rgb555)
+{
+    static unsigned char lut5[32], lut6[64];
+    int i, j;
+
+    /* as the former decoder tables, i * 255 / 31 and i * 255 / 63 */
+    if (lut5[31] == 0)
+    {
+        for (i = 0; i < 64; i++)
+            lut6[i] = (i * 255) / 63;
+        for (i = 0; i < 32; i++)
+            lut5[i] = (i * 255) / 31;
+    }
+
+    for (j = 0; j < height; j++, src += srcstride, dst += dststride)
+    {
+        const unsigned char *s = src;
+        unsigned char *d = dst;
+
+        for (i = 0; i < width; i++, s += 2)
+        {
+            if (rgb555)
+            {
+                *d++ = lut5[(s[1] & 0x7C) >> 2];
+                *d++ = lut5[((s[1] & 0x03) << 3) | ((s[0] & 0xE0) >> 5)];
+            }
+            else
+            {
+                *d++ = lut5[(s[1] & 0xF8) >> 3];
+                *d++ = lut6[((s[1] & 0x07) << 3) | ((s[0] & 0xE0) >> 5)];
+            }
+            *d++ = lut5[s[0] & 0x1F];
+        }
+    }
+}
+
+void ccvt_y16_bgra64(int width, int height, const unsigned short *src, int srcstride, unsigned short *dst, int dststride)
+{
+    const Kernels *k = kernels();
+    int j, n;
+
+    for (j = 0; j < height; j++)
+    {
+        const unsigned short *s = (const unsigned short *)((const unsigned char *)src + j * srcstride);
+        unsigned short *d = (unsigned short *)((unsigned char *)dst + j * dststride);
+
+        n = k->y16 ? k->y16(s, d, width) : 0;
+        y16C(s + n, d + 4 * n, width - n);
+    }
+}
+
+void ccvt_rgb48_bgra64(int width, int height, const unsigned short *src, int srcstride, unsigned short *dst, int dststride)
+{
+    const Kernels *k = kernels();
+    int j, n;
+
+    for (j = 0; j < height; j++)
+    {
+        const unsigned short *s = (const unsigned short *)((const unsigned char *)src + j * srcstride);
+        unsigned short *d = (unsigned short *)((unsigned char *)dst + j * dststride);
+
+        n = k->rgb48 ? k->rgb48(s, d, width) : 0;
+        rgb48C(s + 3 * n, d + 4 * n, width - n);
+    }
+}
@@ -339,70 +339,73 @@ static void add_huff_table(j_decompress_ptr dinfo, JHUFF_TBL **htblptr,
 
 
 
+/* Standard Huffman tables (cf. JPEG standard section K.3), also the
+ * implicit tables of MJPEG streams which leave out their DHT segment.
+ * IMPORTANT: these are only valid for 8-bit data precision!
+ */
+static const UINT8 bits_dc_luminance[17] =
+{ /* 0-base */ 0, 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const UINT8 val_dc_luminance[] =
+{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const UINT8 bits_dc_chrominance[17] =
+{ /* 0-base */ 0, 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const UINT8 val_dc_chrominance[] =
+{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const UINT8 bits_ac_luminance[17] =
+{ /* 0-base */ 0, 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const UINT8 val_ac_luminance[] =
+{ 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12,
+  0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+  0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+  0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+  0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16,
+  0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+  0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+  0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+  0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+  0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+  0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+  0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98,
+  0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+  0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+  0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+  0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4,
+  0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+  0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+  0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa };
+
+static const UINT8 bits_ac_chrominance[17] =
+{ /* 0-base */ 0, 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const UINT8 val_ac_chrominance[] =
+{ 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21,
+  0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+  0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+  0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+  0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34,
+  0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+  0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38,
+  0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+  0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+  0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+  0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+  0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+  0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96,
+  0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+  0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
+  0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+  0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
+  0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+  0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
+  0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+  0xf9, 0xfa };
+
 static void std_huff_tables (j_decompress_ptr dinfo)
-/* Set up the standard Huffman tables (cf. JPEG standard section K.3) */
-/* IMPORTANT: these are only valid for 8-bit data precision! */
+/* Set up the standard Huffman tables */
 {
-    static const UINT8 bits_dc_luminance[17] =
-    { /* 0-base */ 0, 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
-    static const UINT8 val_dc_luminance[] =
-    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
-
-    static const UINT8 bits_dc_chrominance[17] =
-    { /* 0-base */ 0, 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
-    static const UINT8 val_dc_chrominance[] =
-    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
-
-    static const UINT8 bits_ac_luminance[17] =
-    { /* 0-base */ 0, 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
-    static const UINT8 val_ac_luminance[] =
-    { 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12,
-      0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
-      0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
-      0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
-      0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16,
-      0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
-      0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
-      0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
-      0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
-      0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
-      0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
-      0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
-      0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98,
-      0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
-      0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
-      0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
-      0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4,
-      0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
-      0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
-      0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
-      0xf9, 0xfa };
-
-    static const UINT8 bits_ac_chrominance[17] =
-    { /* 0-base */ 0, 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
-    static const UINT8 val_ac_chrominance[] =
-    { 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21,
-      0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
-      0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
-      0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
-      0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34,
-      0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
-      0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38,
-      0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
-      0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
-      0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
-      0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
-      0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
-      0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96,
-      0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
-      0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
-      0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
-      0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
-      0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
-      0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
-      0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
-      0xf9, 0xfa };
-
     add_huff_table(dinfo, &dinfo->dc_huff_tbl_ptrs[0],
                    bits_dc_luminance, val_dc_luminance);
     add_huff_table(dinfo, &dinfo->ac_huff_tbl_ptrs[0],
@@ -428,6 +431,78 @@ static void guarantee_huff_tables(j_decompress_ptr dinfo)
 
 #endif /* ...'std' Huffman table generation */
 
+/* append one table of a DHT segment: class/id byte, 16 counts, symbols */
+static unsigned char *put_huff_table(unsigned char *p, int tc_th,
+                                     const UINT8 *bits, const UINT8 *val)
+{
+    int len, nsymbols = 0;
+
+    *p++ = tc_th;
+    for (len = 1; len <= 16; len++) {
+        *p++ = bits[len];
+        nsymbols += bits[len];
+    }
+    memcpy(p, val, nsymbols);
+    return p + nsymbols;
+}
+
+/*******************************************************************
+ * MJPEG frames, as sent by most UVC cameras, usually carry no DHT
+ * segment and rely on the standard tables. Copy such a frame to dst,
+ * inserting the standard DHT segment before the first scan, so that
+ * any JPEG reader accepts it. Frames with their own tables are
+ * copied unchanged.
+ *
+ * dst must hold len + MJPEG_DHT_SIZE bytes.
+ * returns:
+ *	-1 if the frame is not a JPEG image
+ *	the size of the output image otherwise
+ */
+
+int mjpeg_to_jpeg(const unsigned char *jpeg_data, int len,
+                  unsigned char *dst)
+{
+    int pos = 2, seglen;
+    unsigned char *p;
+
+    if (len < 4 || jpeg_data[0] != 0xFF || jpeg_data[1] != 0xD8)
+        return -1;
+
+    /* walk the marker segments up to the first scan */
+    while (pos + 4 <= len) {
+        if (jpeg_data[pos] != 0xFF)
+            return -1;
+        if (jpeg_data[pos + 1] == 0xFF) {    /* fill byte */
+            pos++;
+            continue;
+        }
+        if (jpeg_data[pos + 1] == 0xC4) {    /* has its own tables */
+            memcpy(dst, jpeg_data, len);
+            return len;
+        }
+        if (jpeg_data[pos + 1] == 0xDA)      /* start of scan */
+            break;
+        seglen = (jpeg_data[pos + 2] << 8) | jpeg_data[pos + 3];
+        pos += 2 + seglen;
+    }
+    if (pos + 4 > len)
+        return -1;
+
+    memcpy(dst, jpeg_data, pos);
+    p = dst + pos;
+    *p++ = 0xFF;
+    *p++ = 0xC4;
+    *p++ = (MJPEG_DHT_SIZE - 2) >> 8;
+    *p++ = (MJPEG_DHT_SIZE - 2) & 0xFF;
+    p = put_huff_table(p, 0x00, bits_dc_luminance, val_dc_luminance);
+    p = put_huff_table(p, 0x10, bits_ac_luminance, val_ac_luminance);
+    p = put_huff_table(p, 0x01, bits_dc_chrominance, val_dc_chrominance);
+    p = put_huff_table(p, 0x11, bits_ac_chrominance, val_ac_chrominance);
+    memcpy(p, jpeg_data + pos, len - pos);
+
+    return len + MJPEG_DHT_SIZE;
+}
+
 
 
 /*
@@ -1184,3 +1259,81 @@ ERR_EXIT:
     jpeg_destroy_compress (&cinfo);
     return -1;
 }
+
+/*******************************************************************
+ * encode a grey (components 1), RGB (3) or BGRx (4) image of any size
+ * with the scanline interface of the jpeg library. Rows are stride
+ * bytes apart.
+ *
+ * jpeg_data must hold encode_jpeg_bound(width, height) bytes.
+ * returns:
+ *	-1 on fatal error
+ *	the size of the jpeg image otherwise
+ */
+
+long encode_jpeg_bound(unsigned int width, unsigned int height)
+{
+    /* 4:2:0 MCUs, worst case of libjpeg-turbo's tjBufSize */
+    return (long)((width + 15) & ~15U) * ((height + 15) & ~15U) * 3 + 2048;
+}
+
+int encode_jpeg_image(unsigned char *jpeg_data, int len, int quality,
+                      unsigned int width, unsigned int height, int components,
+                      const unsigned char *image, int stride)
+{
+    struct jpeg_compress_struct cinfo;
+    struct my_error_mgr jerr;
+    unsigned char *volatile rgb = NULL;
+    JSAMPROW row;
+    unsigned int x;
+    int size;
+
+    if (components != 1 && components != 3 && components != 4)
+        return -1;
+
+    cinfo.err = jpeg_std_error (&jerr.pub);
+    jerr.pub.error_exit = my_error_exit;
+
+    if (setjmp (jerr.setjmp_buffer)) {
+        jpeg_destroy_compress (&cinfo);
+        free(rgb);
+        return -1;
+    }
+
+    jpeg_create_compress (&cinfo);
+    jpeg_buffer_dest(&cinfo, jpeg_data, len);
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = (components == 1) ? 1 : 3;
+    cinfo.in_color_space = (components == 1) ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults (&cinfo);
+    jpeg_set_quality (&cinfo, quality, TRUE);
+    cinfo.dct_method = JDCT_IFAST;
+
+    if (components == 4)
+        rgb = malloc(width * 3);
+
+    jpeg_start_compress (&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const unsigned char *src = image + (long) cinfo.next_scanline * stride;
+
+        if (components == 4) {
+            for (x = 0; x < width; x++) {
+                rgb[3 * x]     = src[4 * x + 2];
+                rgb[3 * x + 1] = src[4 * x + 1];
+                rgb[3 * x + 2] = src[4 * x];
+            }
+            row = rgb;
+        } else
+            row = (JSAMPROW) src;
+
+        jpeg_write_scanlines (&cinfo, &row, 1);
+    }
+    jpeg_finish_compress (&cinfo);
+
+    size = len - cinfo.dest->free_in_buffer;
+    jpeg_destroy_compress (&cinfo);
+    free(rgb);
+    return size;
+}
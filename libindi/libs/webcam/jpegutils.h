@@ -30,6 +30,10 @@
 
 /*@{*/
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define Y4M_ILACE_NONE          0  /** non-interlaced, progressive frame    */
 #define Y4M_ILACE_TOP_FIRST     1  /** interlaced, top-field first          */
 #define Y4M_ILACE_BOTTOM_FIRST  2  /** interlaced, bottom-field first       */
@@ -70,6 +74,37 @@ int encode_jpeg_raw(unsigned char *jpeg_data, int len, int quality,
                     unsigned int height, unsigned char *raw0, 
                     unsigned char *raw1, unsigned char *raw2);
 
+/**
+ * @short largest size of a jpeg image made by encode_jpeg_image
+ */
+long encode_jpeg_bound(unsigned int width, unsigned int height);
+
+/**
+ * @short encode a grey (components 1), RGB (3) or BGRx (4) image of any size,
+ * rows stride bytes apart. jpeg_data holds encode_jpeg_bound() bytes.
+ * Returns the jpeg size, or -1 on error.
+ */
+int encode_jpeg_image(unsigned char *jpeg_data, int len, int quality,
+                      unsigned int width, unsigned int height, int components,
+                      const unsigned char *image, int stride);
+
+/**
+ * @short size of the standard DHT segment added by mjpeg_to_jpeg
+ */
+#define MJPEG_DHT_SIZE 420
+
+/**
+ * @short make a MJPEG frame a standalone JPEG image, adding the standard
+ * Huffman tables when it has none. dst holds len + MJPEG_DHT_SIZE bytes.
+ * Returns the image size, or -1 when the frame is not a JPEG image.
+ */
+int mjpeg_to_jpeg(const unsigned char *jpeg_data, int len,
+                  unsigned char *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
 /*@}*/
 
 #endif
@@ -32,6 +32,8 @@
 #include <errno.h>
 #include <sys/mman.h>
 #include <string.h>
+#include <time.h>
+#include <sys/time.h>
 #include <asm/types.h>          /* for videodev2.h */
 
 #include "ccvt.h"
@@ -87,6 +89,11 @@ V4L2_Base::V4L2_Base()
    decoder=v4l2_decode->getDefaultDecoder();
    decoder->init();
    dodecode=true;
+   encodedFrame=NULL;
+   encodedFrameSize=encodedFrameAlloc=0;
+   decodePending=false;
+   frameTime.tv_sec=0;
+   frameTime.tv_usec=0;
    bpp=8; 
    has_ext_pix_format=false;
    const std::vector<unsigned int> &vsuppformats=decoder->getsupportedformats();
@@ -99,6 +106,7 @@ V4L2_Base::V4L2_Base()
 
 V4L2_Base::~V4L2_Base()
 {
+  free(encodedFrame);
 
 }
 
@@ -186,6 +194,26 @@ bool V4L2_Base::isLXmodCapable()
 
 
 
+/* UTC time of a dequeued buffer, most drivers stamp them with the monotonic clock */
+static struct timeval buffer_time(struct v4l2_buffer *buf)
+{
+  struct timeval tv;
+  struct timespec mono, real;
+  long long us;
+
+  gettimeofday(&tv, NULL);
+#ifdef V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+  if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC &&
+      clock_gettime(CLOCK_MONOTONIC, &mono) == 0 && clock_gettime(CLOCK_REALTIME, &real) == 0) {
+    us = (real.tv_sec - mono.tv_sec) * 1000000LL + (real.tv_nsec - mono.tv_nsec) / 1000
+       + buf->timestamp.tv_sec * 1000000LL + buf->timestamp.tv_usec;
+    tv.tv_sec = us / 1000000;
+    tv.tv_usec = us % 1000000;
+  }
+#endif
+  return tv;
+}
+
 int V4L2_Base::read_frame(char *errmsg) {
   
   unsigned int i;
@@ -229,6 +257,7 @@ int V4L2_Base::read_frame(char *errmsg) {
     }
 
     assert (buf.index < n_buffers);
+    frameTime = buffer_time(&buf);
     //IDLog("drop %c %d on %d\n", (dropFrameEnabled?'Y':'N'),dropFrame, dropFrameCount);
     /*if (dropFrame > 0)
       {
@@ -257,9 +286,25 @@ int V4L2_Base::read_frame(char *errmsg) {
     //IDLog("v4l2_base: dequeuing buffer %d, bytesused = %d, flags = 0x%X, field = %d, sequence = %d\n", buf.index, buf.bytesused, buf.flags, buf.field, buf.sequence);
     //IDLog("v4l2_base: dequeuing buffer %d for fd=%d, cropset %c\n", buf.index, fd, (cropset?'Y':'N'));
     //IDLog("V4L2_base read_frame: calling decoder (@ %x) %c\n", decoder, (dodecode?'Y':'N'));
-    if (dodecode) decoder->decode((unsigned char *)(buffers[buf.index].start), &buf);
+    if (dodecode) {
+      if (isEncodedFormat()) {
+	/* keep the bitstream, the buffer goes back to the driver below */
+	if (encodedFrameAlloc < buf.bytesused) {
+	  encodedFrame=(unsigned char *)realloc(encodedFrame, buf.bytesused);
+	  encodedFrameAlloc=buf.bytesused;
+	}
+	memcpy(encodedFrame, buffers[buf.index].start, buf.bytesused);
+	encodedFrameSize=buf.bytesused;
+	encodedBuf=buf;
+	decodePending=true;
+      } else
+	decoder->decode((unsigned char *)(buffers[buf.index].start), &buf);
+    }
     //IDLog("V4L2_base read_frame: calling recorder(@ %x) %c\n", recorder, (dorecord?'Y':'N'));
-    if (dorecord) recorder->writeFrame((unsigned char *)(buffers[buf.index].start));
+    if (dorecord) {
+      recorder->setFrameTime(&frameTime);
+      recorder->writeFrame((unsigned char *)(buffers[buf.index].start));
+    }
     
     //IDLog("lxstate is %d, dropFrame %c\n", lxstate, (dropFrame?'Y':'N'));
 
@@ -848,6 +893,7 @@ int V4L2_Base::check_device(char *errmsg) {
   
   if (-1 == xioctl (fd, VIDIOC_G_FMT, &fmt))
     return errno_exit ("VIDIOC_G_FMT", errmsg);
+  decodePending=false;
   decoder->setformat(fmt, has_ext_pix_format);
   bpp=decoder->getBpp();
   
@@ -1030,6 +1076,7 @@ int V4L2_Base::setcaptureformat(unsigned int captureformat, char *errmsg) {
     return errno_exit ("VIDIOC_S_FMT", errmsg);
   }
   //decode reallocate_buffers=true;
+  decodePending=false;
   decoder->setformat(fmt, has_ext_pix_format);
   bpp=decoder->getBpp();
   return 0;
@@ -1113,6 +1160,7 @@ int V4L2_Base::setcapturesize(unsigned int w, unsigned int h, char *errmsg) {
       fmt.fmt.pix.height = oldh;
     return errno_exit ("VIDIOC_G_FMT", errmsg);
   }
+  decodePending=false;
   decoder->setformat(fmt, has_ext_pix_format);
   bpp=decoder->getBpp();
   //decode reallocate_buffers=true;
@@ -1194,6 +1242,7 @@ int V4L2_Base::setcroprect(int x, int y, int w, int h, char *errmsg) {
   }
   if ((crop.c.left==0)&&(crop.c.top==0)&&(crop.c.width==fmt.fmt.pix.width)&&(crop.c.height==fmt.fmt.pix.height)) {
     cropset=false;
+    decodePending=false;
     decoder->resetcrop();
   } else {
     if (cancrop) {
@@ -1204,6 +1253,7 @@ int V4L2_Base::setcroprect(int x, int y, int w, int h, char *errmsg) {
 	return errno_exit ("VIDIOC_G_CROP", errmsg);
       } 
     }
+    decodePending=false;
     softcrop=decoder->setcrop(crop);
     cropset=true;
     if ((!cancrop) && (!softcrop)) {
@@ -1338,33 +1388,60 @@ void V4L2_Base::setColorProcessing(bool quantization, bool colorconvert, bool li
   bpp=decoder->getBpp();
 }
 
+bool V4L2_Base::isEncodedFormat()
+{
+  return fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_JPEG || fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_MJPEG;
+}
+
+/* decode the last compressed frame on the first pixel access */
+void V4L2_Base::decodeFrame()
+{
+  if (!decodePending) return;
+  decodePending=false;
+  if (isEncodedFormat())
+    decoder->decode(encodedFrame, &encodedBuf);
+}
+
+unsigned char * V4L2_Base::getEncodedFrame(unsigned int *size)
+{
+  if (!isEncodedFormat() || encodedFrame == NULL) return NULL;
+  *size=encodedFrameSize;
+  return encodedFrame;
+}
+
 unsigned char * V4L2_Base::getY()
 {
+  decodeFrame();
   return decoder->getY();
 }
 
 unsigned char * V4L2_Base::getU()
 {
+  decodeFrame();
   return decoder->getU();
 }
 
 unsigned char * V4L2_Base::getV()
 {
+  decodeFrame();
   return decoder->getV();
 }
 
 unsigned char * V4L2_Base::getColorBuffer()
 {
+  decodeFrame();
   return decoder->getColorBuffer();
 }
 
 unsigned char * V4L2_Base::getRGBBuffer()
 {
+  decodeFrame();
   return decoder->getRGBBuffer();
 }
 
 float * V4L2_Base::getLinearY()
 {
+  decodeFrame();
   return decoder->getLinearY();
 }
 
@@ -1585,8 +1662,8 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 	      num_ctrls = (num_ctrls == NULL) ? (unsigned int *) malloc  (sizeof (unsigned int)) :
 		(unsigned int *) realloc (num_ctrls, (nnum+1) * sizeof (unsigned int));
 	      
-	      strncpy(numbers[nnum].name, (const char *)entityXML((char *) queryctrl.name) , MAXINDINAME);
-	      strncpy(numbers[nnum].label, (const char *)entityXML((char *) queryctrl.name), MAXINDILABEL);
+	      strncpy(numbers[nnum].name, (const char *) queryctrl.name , MAXINDINAME);
+	      strncpy(numbers[nnum].label, (const char *) queryctrl.name, MAXINDILABEL);
 	      strncpy(numbers[nnum].format, "%0.f", MAXINDIFORMAT);
 	      numbers[nnum].min    = queryctrl.minimum;
 	      numbers[nnum].max    = queryctrl.maximum;
@@ -1625,7 +1702,7 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 	      IUFillSwitch(sw, swonname, "Off", (control.value?ISS_OFF:ISS_ON));
 	      IUFillSwitch(sw+1, swoffname, "On", (control.value?ISS_ON:ISS_OFF));
 	      queryctrl.name[31]='\0';
-	      IUFillSwitchVector (&opt[nopt], sw, 2, dev, optname, (const char *)entityXML((char *)queryctrl.name), group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
+	      IUFillSwitchVector (&opt[nopt], sw, 2, dev, optname, (const char *) queryctrl.name, group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
               opt[nopt].aux=malloc(sizeof(unsigned int));
 	      *(unsigned int *)(opt[nopt].aux)=(queryctrl.id);
 
@@ -1662,7 +1739,7 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 		      sname[31]='\0';
 		      IDLog("Adding menu item %s %s %s item %d \n", querymenu.name, sname, menuoptname, nmenuopt);
 		      //IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *)sname, (control.value==nmenuopt?ISS_ON:ISS_OFF));
-		      IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *)entityXML((char *)querymenu.name), (control.value==nmenuopt?ISS_ON:ISS_OFF));
+		      IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *) querymenu.name, (control.value==nmenuopt?ISS_ON:ISS_OFF));
 		      nmenuopt+=1;
 		    } else
 		    {
@@ -1672,7 +1749,7 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 		}
 	      
 	      queryctrl.name[31]='\0';
-	      IUFillSwitchVector (&opt[nopt], sw, nmenuopt, dev, menuname, (const char *)entityXML((char *)queryctrl.name), group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
+	      IUFillSwitchVector (&opt[nopt], sw, nmenuopt, dev, menuname, (const char *) queryctrl.name, group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
 	      opt[nopt].aux=malloc(sizeof(unsigned int));
 	      *(unsigned int *)(opt[nopt].aux)=(queryctrl.id);
 
@@ -1707,8 +1784,8 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 	    num_ctrls = (num_ctrls == NULL) ? (unsigned int *) malloc  (sizeof (unsigned int)) :
 	      (unsigned int *) realloc (num_ctrls, (nnum+1) * sizeof (unsigned int));
 	    
-	    strncpy(numbers[nnum].name, (const char *)entityXML((char *) queryctrl.name) , MAXINDINAME);
-	    strncpy(numbers[nnum].label, (const char *)entityXML((char *) queryctrl.name), MAXINDILABEL);
+	    strncpy(numbers[nnum].name, (const char *) queryctrl.name , MAXINDINAME);
+	    strncpy(numbers[nnum].label, (const char *) queryctrl.name, MAXINDILABEL);
 	    strncpy(numbers[nnum].format, "%0.f", MAXINDIFORMAT);
 	    numbers[nnum].min    = queryctrl.minimum;
 	    numbers[nnum].max    = queryctrl.maximum;
@@ -1746,7 +1823,7 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 	      IUFillSwitch(sw, swonname, "On", (control.value?ISS_ON:ISS_OFF));
 	      IUFillSwitch(sw+1, swoffname, "Off", (control.value?ISS_OFF:ISS_ON));
 	      queryctrl.name[31]='\0';
-	      IUFillSwitchVector (&opt[nopt], sw, 2, dev, optname, (const char *)entityXML((char *)queryctrl.name), group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
+	      IUFillSwitchVector (&opt[nopt], sw, 2, dev, optname, (const char *) queryctrl.name, group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
 
 	      opt[nopt].aux=malloc(sizeof(unsigned int));
 	      *(unsigned int *)(opt[nopt].aux)=(queryctrl.id);
@@ -1784,7 +1861,7 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 		      sname[31]='\0';
 		      IDLog("Adding menu item %s %s %s item %d \n", querymenu.name, sname, menuoptname, nmenuopt);
 		      //IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *)sname, (control.value==nmenuopt?ISS_ON:ISS_OFF));
-		      IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *)entityXML((char *)querymenu.name), (control.value==nmenuopt?ISS_ON:ISS_OFF));
+		      IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *) querymenu.name, (control.value==nmenuopt?ISS_ON:ISS_OFF));
 		      nmenuopt+=1;
 		    } else
 		    {
@@ -1794,7 +1871,7 @@ void  V4L2_Base::queryControls(INumberVectorProperty *nvp, unsigned int *nnumber
 		}
 	      
 	      queryctrl.name[31]='\0';
-	      IUFillSwitchVector (&opt[nopt], sw, nmenuopt, dev, menuname, (const char *)entityXML((char *)queryctrl.name), group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
+	      IUFillSwitchVector (&opt[nopt], sw, nmenuopt, dev, menuname, (const char *) queryctrl.name, group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
 
 	      opt[nopt].aux=malloc(sizeof(unsigned int));
 	      *(unsigned int *)(opt[nopt].aux)=(queryctrl.id);
@@ -2064,8 +2141,8 @@ bool  V4L2_Base::queryExtControls(INumberVectorProperty *nvp, unsigned int *nnum
 	  num_ctrls = (num_ctrls == NULL) ? (unsigned int *) malloc  (sizeof (unsigned int)) :
 	    (unsigned int *) realloc (num_ctrls, (nnum+1) * sizeof (unsigned int));
 	  
-	  strncpy(numbers[nnum].name, (const char *)entityXML((char *) queryctrl.name) , MAXINDINAME);
-	  strncpy(numbers[nnum].label, (const char *)entityXML((char *) queryctrl.name), MAXINDILABEL);
+	  strncpy(numbers[nnum].name, (const char *) queryctrl.name , MAXINDINAME);
+	  strncpy(numbers[nnum].label, (const char *) queryctrl.name, MAXINDILABEL);
 	  strncpy(numbers[nnum].format, "%0.f", MAXINDIFORMAT);
 	  numbers[nnum].min    = queryctrl.minimum;
 	  numbers[nnum].max    = queryctrl.maximum;
@@ -2106,7 +2183,7 @@ bool  V4L2_Base::queryExtControls(INumberVectorProperty *nvp, unsigned int *nnum
 	  IUFillSwitch(sw+1, swoffname, "On", (control.value?ISS_ON:ISS_OFF));
 	  (sw+1)->aux=NULL;
 	  queryctrl.name[31]='\0';
-	  IUFillSwitchVector (&opt[nopt], sw, 2, dev, optname, (const char *)entityXML((char *)queryctrl.name), group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
+	  IUFillSwitchVector (&opt[nopt], sw, 2, dev, optname, (const char *) queryctrl.name, group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
 	  opt[nopt].aux=malloc(sizeof(unsigned int));
 	  *(unsigned int *)(opt[nopt].aux)=(queryctrl.id);
 	  
@@ -2124,9 +2201,9 @@ bool  V4L2_Base::queryExtControls(INumberVectorProperty *nvp, unsigned int *nnum
 	    (ISwitchVectorProperty *) realloc (opt, (nopt+1) * sizeof (ISwitchVectorProperty));
 
 	  queryctrl.name[31]='\0';
-	  IUFillSwitch(sw, swonname, (const char *)entityXML((char *)queryctrl.name), ISS_OFF);
+	  IUFillSwitch(sw, swonname, (const char *) queryctrl.name, ISS_OFF);
 	  sw->aux=NULL;
-	  IUFillSwitchVector (&opt[nopt], sw, 1, dev, optname, (const char *)entityXML((char *)queryctrl.name), group, IP_RW, ISR_NOFMANY, 0.0, IPS_IDLE);
+	  IUFillSwitchVector (&opt[nopt], sw, 1, dev, optname, (const char *) queryctrl.name, group, IP_RW, ISR_NOFMANY, 0.0, IPS_IDLE);
 	  opt[nopt].aux=malloc(sizeof(unsigned int));
 	  *(unsigned int *)(opt[nopt].aux)=(queryctrl.id);	  
 	  IDLog("Adding Button  \"%s\" \n", queryctrl.name);
@@ -2162,7 +2239,7 @@ bool  V4L2_Base::queryExtControls(INumberVectorProperty *nvp, unsigned int *nnum
 		  sname[31]='\0';
 		  IDLog("Adding menu item %s %s %s item %d index %d\n", querymenu.name, sname, menuoptname, nmenuopt, querymenu.index);
 		  //IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *)sname, (control.value==nmenuopt?ISS_ON:ISS_OFF));
-		  IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *)entityXML((char *)querymenu.name), (control.value==nmenuopt?ISS_ON:ISS_OFF));
+		  IUFillSwitch(&sw[nmenuopt], menuoptname, (const char *) querymenu.name, (control.value==nmenuopt?ISS_ON:ISS_OFF));
 		  sw[nmenuopt].aux=malloc(sizeof(unsigned int));
 		  *(unsigned int *)(sw[nmenuopt].aux)=(querymenu.index);
 		  nmenuopt+=1;
@@ -2174,7 +2251,7 @@ bool  V4L2_Base::queryExtControls(INumberVectorProperty *nvp, unsigned int *nnum
 	    }
 	  
 	  queryctrl.name[31]='\0';
-	  IUFillSwitchVector (&opt[nopt], sw, nmenuopt, dev, menuname, (const char *)entityXML((char *)queryctrl.name), group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
+	  IUFillSwitchVector (&opt[nopt], sw, nmenuopt, dev, menuname, (const char *) queryctrl.name, group, IP_RW, ISR_1OFMANY, 0.0, IPS_IDLE);
 	  opt[nopt].aux=malloc(sizeof(unsigned int));
 	  *(unsigned int *)(opt[nopt].aux)=(queryctrl.id);
 	  
@@ -88,6 +88,10 @@ class V4L2_Base
   unsigned char * getColorBuffer();
   unsigned char * getRGBBuffer();
   float * getLinearY();
+  /* last compressed (JPEG/MJPEG) frame, NULL for other formats */
+  unsigned char * getEncodedFrame(unsigned int *size);
+  /* UTC time the last frame was captured */
+  const struct timeval * getFrameTime() { return &frameTime; }
 
   void registerCallback(WPF *fp, void *ud);
 
@@ -144,6 +148,8 @@ class V4L2_Base
   void init_read(unsigned int buffer_size);
 
   void findMinMax();
+  bool isEncodedFormat();
+  void decodeFrame();
 
   
   /* Frame rate */
@@ -192,9 +198,15 @@ class V4L2_Base
   V4L2_Decode *v4l2_decode;
   V4L2_Decoder *decoder;
   bool dodecode;
+  /* compressed frames are kept and only decoded when pixels are read */
+  unsigned char *encodedFrame;
+  unsigned int encodedFrameSize, encodedFrameAlloc;
+  struct v4l2_buffer encodedBuf;
+  bool decodePending;
 
   V4L2_Recorder *recorder;
   bool dorecord;
+  struct timeval frameTime;
 
   int bpp;
 
@@ -1,5 +1,13 @@
 #include "v4l2_colorspace.h"
+#include "ccvt.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LUT_X86
+#endif
 
 unsigned char lutrangey8[256];
 unsigned short lutrangey10[1024];
@@ -14,7 +22,7 @@ void initColorSpace() {
   unsigned int i;
 
   for (i=0; i < 256; i++) {
-    lutrangey8[i] = (unsigned char)((255.0 / 219.0) * (i - 16));
+    lutrangey8[i] = (i < 16) ? 0 : (unsigned char)((255.0 / 219.0) * (i - 16));
     if (i > 235) lutrangey8[i] = 255;
     lutrangecbcr8[i] = (unsigned char)((255.0 / 224.0) * i);
   }
@@ -23,27 +31,22 @@ void initColorSpace() {
 void rangeY8(unsigned char *buf, unsigned int len) {
   unsigned int i;
   unsigned char *s=buf;
-  for (i=0; i < len; i++) {
-    *s++ = lutrangey8[*s];
+  for (i=0; i < len; i++, s++) {
+    *s = lutrangey8[*s];
   }
 }
 
-void linearize(float *buf, unsigned int len, struct v4l2_format *fmt) {
-  unsigned int i;
-  float *src=buf;
-  switch (fmt->fmt.pix.colorspace) {
+/* transfer function of the colourspace, from a non linear value to linear light */
+static double transfer(unsigned int colorspace, double v) {
+  switch (colorspace) {
   case V4L2_COLORSPACE_SMPTE240M:
     // Old obsolete HDTV standard. Replaced by REC 709.
     // This is the transfer function for SMPTE 240M
-    for (i = 0; i < len; i++)
-      *src++ = (*src < 0.0913) ? *src / 4.0 : pow((*src + 0.1115) / 1.1115, 1.0 / 0.45);
-    break;
+    return (v < 0.0913) ? v / 4.0 : pow((v + 0.1115) / 1.1115, 1.0 / 0.45);
   case V4L2_COLORSPACE_SRGB:
     // This is used for sRGB as specified by the IEC FDIS 61966-2-1 standard
-    for (i = 0; i < len; i++)
-      *src++ = (*src < -0.04045) ? -pow((-*src + 0.055) / 1.055, 2.4) : 
-	((*src <= 0.04045) ? *src / 12.92 : pow((*src + 0.055) / 1.055, 2.4));
-    break;
+    return (v < -0.04045) ? -pow((-v + 0.055) / 1.055, 2.4) :
+      ((v <= 0.04045) ? v / 12.92 : pow((v + 0.055) / 1.055, 2.4));
     //case V4L2_COLORSPACE_ADOBERGB:
     //r = pow(r, 2.19921875);
     //break;
@@ -51,9 +54,162 @@ void linearize(float *buf, unsigned int len, struct v4l2_format *fmt) {
     //case V4L2_COLORSPACE_BT2020:
   default:
     // All others use the transfer function specified by REC 709
+    return (v <= -0.081) ? -pow((v - 0.099) / -1.099, 1.0 / 0.45) :
+      ((v < 0.081) ? v / 4.5 : pow((v + 0.099) / 1.099, 1.0 / 0.45));
+  }
+}
+
+void linearize(float *buf, unsigned int len, struct v4l2_format *fmt) {
+  unsigned int i;
+  for (i = 0; i < len; i++)
+    buf[i] = transfer(fmt->fmt.pix.colorspace, buf[i]);
+}
+
+/* Linearization tables, one per transfer function, range mapping and sample
+   depth, built on first use and kept for the life of the process. */
+#define LUT_TRANSFERS 3
+#define LUT_MINBITS 8
+#define LUT_MAXBITS 16
+static float *lutlinear[LUT_TRANSFERS][2][LUT_MAXBITS - LUT_MINBITS + 1];
+static unsigned short *lutlinear16[LUT_TRANSFERS][2][LUT_MAXBITS - LUT_MINBITS + 1];
+
+static unsigned int transferIndex(struct v4l2_format *fmt) {
+  switch (fmt->fmt.pix.colorspace) {
+  case V4L2_COLORSPACE_SMPTE240M:
+    return 1;
+  case V4L2_COLORSPACE_SRGB:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+/* colourspace whose transfer function the table index stands for */
+static const unsigned int transferColorSpace[LUT_TRANSFERS] = {
+  V4L2_COLORSPACE_REC709, V4L2_COLORSPACE_SMPTE240M, V4L2_COLORSPACE_SRGB
+};
+
+static int validBits(unsigned int bits) {
+  return bits >= LUT_MINBITS && bits <= LUT_MAXBITS;
+}
+
+const float * getLinearTable(struct v4l2_format *fmt, unsigned int bits, int expandrange) {
+  unsigned int t = transferIndex(fmt), q = expandrange ? 1 : 0;
+  unsigned int i, n = 1U << bits;
+  double black, white;
+  float *lut;
+
+  if (!validBits(bits))
+    return NULL;
+  if (lutlinear[t][q][bits - LUT_MINBITS])
+    return lutlinear[t][q][bits - LUT_MINBITS];
+
+  lut = (float *)malloc(n * sizeof(float));
+  if (!lut)
+    return NULL;
+  /* limited range puts black at 16 and white at 235, scaled to the depth */
+  black = expandrange ? (16 << (bits - 8)) : 0.0;
+  white = expandrange ? (235 << (bits - 8)) : (double)(n - 1);
+  for (i = 0; i < n; i++) {
+    double v = (i - black) / (white - black);
+    if (v < 0.0) v = 0.0;
+    if (v > 1.0) v = 1.0;
+    lut[i] = (float)transfer(transferColorSpace[t], v);
+  }
+  lutlinear[t][q][bits - LUT_MINBITS] = lut;
+  return lut;
+}
+
+const unsigned short * getLinearTable16(struct v4l2_format *fmt, unsigned int bits, int expandrange) {
+  unsigned int t = transferIndex(fmt), q = expandrange ? 1 : 0;
+  unsigned int i, n = 1U << bits;
+  const float *flut;
+  unsigned short *lut;
+
+  if (!validBits(bits))
+    return NULL;
+  if (lutlinear16[t][q][bits - LUT_MINBITS])
+    return lutlinear16[t][q][bits - LUT_MINBITS];
+
+  flut = getLinearTable(fmt, bits, expandrange);
+  lut = (unsigned short *)malloc(n * sizeof(unsigned short));
+  if (!flut || !lut) {
+    free(lut);
+    return NULL;
+  }
+  for (i = 0; i < n; i++)
+    lut[i] = (unsigned short)(flut[i] * 65535.0);
+  lutlinear16[t][q][bits - LUT_MINBITS] = lut;
+  return lut;
+}
+
+#ifdef LUT_X86
+/* gather 8 table entries at a time, indices widened from 8 or 16 bits samples */
+__attribute__((target("avx2")))
+static unsigned int linearizeAVX2(const unsigned char *src, unsigned int bits, unsigned int step,
+                                  unsigned int len, const float *lut, float *dst) {
+  const __m256i mask = _mm256_set1_epi32((1 << bits) - 1);
+  unsigned int i = 0;
+  __m256i idx;
+
+  if (bits == 8 && step == 1) {
+    for (; i + 8 <= len; i += 8) {
+      idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+      _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(lut, idx, 4));
+    }
+  } else if (bits == 8 && step == 2) {
+    /* the last group is left to the caller, its load would end one byte past an odd src */
+    for (; i + 8 < len; i += 8) {
+      idx = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + 2 * i)));
+      idx = _mm256_and_si256(idx, _mm256_set1_epi32(0xFF));
+      _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(lut, idx, 4));
+    }
+  } else if (bits > 8 && step == 1) {
+    for (; i + 8 <= len; i += 8) {
+      idx = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + 2 * i)));
+      idx = _mm256_and_si256(idx, mask);
+      _mm256_storeu_ps(dst + i, _mm256_i32gather_ps(lut, idx, 4));
+    }
+  }
+  return i;
+}
+#endif
+
+static int useGather(void) {
+  return strcmp(ccvt_simd_name(), "avx2") == 0;
+}
+
+void linearizeY(const unsigned char *src, unsigned int bits, unsigned int step, unsigned int len,
+                const float *lut, float *dst) {
+  unsigned int i = 0;
+
+#ifdef LUT_X86
+  if (useGather())
+    i = linearizeAVX2(src, bits, step, len, lut, dst);
+#endif
+  if (bits == 8) {
+    for (; i < len; i++)
+      dst[i] = lut[src[i * step]];
+  } else {
+    const unsigned short *s = (const unsigned short *)src;
+    unsigned short mask = (1 << bits) - 1;
+    for (; i < len; i++)
+      dst[i] = lut[s[i * step] & mask];
+  }
+}
+
+void linearizeY16(const unsigned char *src, unsigned int bits, unsigned int step, unsigned int len,
+                  const unsigned short *lut, unsigned short *dst) {
+  unsigned int i;
+
+  if (bits == 8) {
+    for (i = 0; i < len; i++)
+      dst[i] = lut[src[i * step]];
+  } else {
+    const unsigned short *s = (const unsigned short *)src;
+    unsigned short mask = (1 << bits) - 1;
     for (i = 0; i < len; i++)
-      *src++ = (*src <= -0.081) ? -pow((*src - 0.099) / -1.099, 1.0 / 0.45) : 
-	((*src < 0.081) ? *src / 4.5 : pow((*src + 0.099) / 1.099, 1.0 / 0.45));
+      dst[i] = lut[s[i * step] & mask];
   }
 }
 
@@ -30,6 +30,18 @@ const char * getQuantizationName(struct v4l2_format *fmt);
 void rangeY8(unsigned char *buf, unsigned int len);
 void linearize(float *buf, unsigned int len, struct v4l2_format *fmt);
 
+/* Tables mapping a bits deep sample (8 to 16) to linear light with the transfer
+   function of the colourspace, as float in [0, 1] or scaled to 16 bits. With
+   expandrange, limited range samples are stretched to full range first. */
+const float * getLinearTable(struct v4l2_format *fmt, unsigned int bits, int expandrange);
+const unsigned short * getLinearTable16(struct v4l2_format *fmt, unsigned int bits, int expandrange);
+/* look up len samples, taken every step samples from src (bytes for 8 bits,
+   native endian shorts above) */
+void linearizeY(const unsigned char *src, unsigned int bits, unsigned int step, unsigned int len,
+                const float *lut, float *dst);
+void linearizeY16(const unsigned char *src, unsigned int bits, unsigned int step, unsigned int len,
+                  const unsigned short *lut, unsigned short *dst);
+
 #ifdef __cplusplus
 }
 #endif
@@ -67,7 +67,6 @@
 //#include <indilogger.h>
 
 V4L2_Builtin_Decoder::V4L2_Builtin_Decoder() {
-  unsigned int i;
   name="Builtin decoder";
   useSoftCrop=false;
   doCrop=false;
@@ -80,13 +79,8 @@ V4L2_Builtin_Decoder::V4L2_Builtin_Decoder() {
   colorBuffer  = NULL;
   rgb24_buffer = NULL;
   linearBuffer    = NULL;
+  linearYBuffer = NULL;
   //cropbuf = NULL;
-  for (i=0; i< 32; i++) {
-    lut5[i] = (char)(((float)i * 255.0) / 31.0);
-  }
-  for (i=0; i< 64; i++) {
-    lut6[i] = (char)(((float)i * 255.0) / 63.0);
-  }
   initColorSpace();
   bpp=8;
 }
@@ -100,6 +94,7 @@ V4L2_Builtin_Decoder::~V4L2_Builtin_Decoder() {
    if (colorBuffer) delete [] (colorBuffer); colorBuffer = NULL;
    if (rgb24_buffer) delete [] (rgb24_buffer); rgb24_buffer = NULL;
    if (linearBuffer) delete [] (linearBuffer); linearBuffer = NULL;
+   if (linearYBuffer) delete [] (linearYBuffer); linearYBuffer = NULL;
 };
 
 void V4L2_Builtin_Decoder::init() {
@@ -201,7 +196,7 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
 	{
 	  unsigned char *src=frame + crop.c.left + (crop.c.top * fmt.fmt.pix.bytesperline);
 	  unsigned char *dest=YBuf, *destv;
-	  unsigned int i, j;
+	  unsigned int i;
 	  //IDLog("grabImage: src=%d dest=%d\n", src, dest);
 	  for (i= 0; i < crop.c.height; i++)
 	    {
@@ -212,39 +207,21 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
 	  
 	  dest=UBuf; destv=VBuf;src=frame + (fmt.fmt.pix.bytesperline * fmt.fmt.pix.height) + ((crop.c.left + (crop.c.top * fmt.fmt.pix.bytesperline)/2) / 2);
 	  if (fmt.fmt.pix.pixelformat ==  V4L2_PIX_FMT_NV21) { dest=VBuf; destv=UBuf;}
-	  for (i= 0; i < crop.c.height / 2; i++)
-	    {
-	      unsigned char *s = src;
-	      for (j=0; j < crop.c.width; j+=2) {
-		*(dest++)=*(s++);
-		*(destv++)=*(s++);
-	      }
-	      src += fmt.fmt.pix.bytesperline;
-	    }
+	  ccvt_uv_split(crop.c.width / 2, crop.c.height / 2, src, fmt.fmt.pix.bytesperline, dest, destv, crop.c.width / 2);
 	}
       else
 	{
 	  unsigned char *src=frame;
 	  unsigned char *dest=YBuf;
 	  unsigned char *destv=VBuf;
-	  unsigned int i, j;
-	  unsigned char *s;
+	  unsigned int i;
 
 	  for (i=0; i< bufheight; i++) {
 	    memcpy(dest,src, bufwidth); src+=fmt.fmt.pix.bytesperline; dest+=bufwidth;
 	  }
 	  dest=UBuf; src=frame + (fmt.fmt.pix.bytesperline * bufheight);
 	  if (fmt.fmt.pix.pixelformat ==  V4L2_PIX_FMT_NV21) { dest=VBuf; destv=UBuf;}
-	  for (i= 0; i < bufheight / 2; i++)
-	    {
-	      s = src;
-	      //IDLog("NV12: converting UV line %d at %p, offset %d, pUbuf %p offset %d,  pVbuf %p offset %d\n", i, s, s- (frame + (fmt.fmt.pix.bytesperline * bufheight)), dest, dest-UBuf, destv, destv-VBuf);
-	      for (j=0; j < bufwidth; j+=2) {
-		*(dest++)=*(s++);
-		*(destv++)=*(s++);
-	      }
-	      src += fmt.fmt.pix.bytesperline; 
-	    }	  
+	  ccvt_uv_split(bufwidth / 2, bufheight / 2, src, fmt.fmt.pix.bytesperline, dest, destv, bufwidth / 2);
 	}
       break;
      
@@ -269,9 +246,7 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
     case V4L2_PIX_FMT_YVYU: 
       {
       unsigned char *src;
-      unsigned char *dest=yuyvBuffer;
-      unsigned char *s, *s1, *s2, *s3, *s4;	
-      int i, j;
+      int order = CCVT_UYVY;
 
       if (useSoftCrop && doCrop) {
 	src=frame + 2*(crop.c.left) + (crop.c.top * fmt.fmt.pix.bytesperline);
@@ -280,22 +255,10 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
 	src=frame;
 	//IDLog("Decoding UYVY  %dx%d frame at %lx\n", width, height, src);
       }
-      for (i=0; i < bufheight; i++) { 
-	s=src;
-	switch (fmt.fmt.pix.pixelformat) {
-	case V4L2_PIX_FMT_UYVY: s1=(s+1);s2=(s);s3=(s+3);s4=(s+2); break;
-	case V4L2_PIX_FMT_VYUY: s1=(s+1);s2=(s+2);s3=(s+3);s4=(s); break;
-	case V4L2_PIX_FMT_YVYU: s1=(s);s2=(s+3);s3=(s+2);s4=(s+1); break;
-	}
-	for (j=0; j < (bufwidth / 2); j++) {
-	  *(dest++)=*(s1);
-	  *(dest++)=*(s2);
-	  *(dest++)=*(s3);
-	  *(dest++)=*(s4);
-	  s1+=4;s2+=4; s3+=4;s4+=4;
-	}
-	src+= fmt.fmt.pix.bytesperline;
-      }
+      if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_VYUY) order = CCVT_VYUY;
+      if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YVYU) order = CCVT_YVYU;
+      /* crop and reorder to YUYV in one pass */
+      ccvt_422_yuyv(bufwidth, bufheight, src, fmt.fmt.pix.bytesperline, order, yuyvBuffer, 2 * bufwidth);
       }
       break;
       
@@ -320,60 +283,48 @@ void V4L2_Builtin_Decoder::decode(unsigned char *frame, struct v4l2_buffer *buf)
 
     case V4L2_PIX_FMT_RGB555:
       {
-	unsigned char *src, *dest=rgb24_buffer;
-	unsigned int i, j;
+	unsigned char *src;
 	if (useSoftCrop && doCrop) {
 	  src=frame + (2*(crop.c.left)) + (crop.c.top * fmt.fmt.pix.bytesperline);
 	} else {
 	  src=frame;
 	}
-	for (i= 0; i < bufheight; i++)
-	  {
-	    unsigned char *s = src;
-	    for (j=0; j < bufwidth; j++) {
-	      *(dest++) = lut5[((*(s+1)&0x7C)>>2)]; // R 
-	      *(dest++) = lut5[(((*(s+1)&0x03) << 3) | ((*(s)&0xE0)>>5))]; // G 
-	      *(dest++) = lut5[((*s) & 0x1F)]; // B 
-	      s+=2;
-	    }
-	    src += fmt.fmt.pix.bytesperline;
-	  }
+	ccvt_rgb16_rgb24(bufwidth, bufheight, src, fmt.fmt.pix.bytesperline, rgb24_buffer, 3 * bufwidth, 1);
       }      
       break;
 
     case V4L2_PIX_FMT_RGB565:
       {
-	unsigned char *src, *dest=rgb24_buffer;
-	unsigned int i, j;
+	unsigned char *src;
 	if (useSoftCrop && doCrop) {
 	  src=frame + (2*(crop.c.left)) + (crop.c.top * fmt.fmt.pix.bytesperline);
 	} else {
 	  src=frame;
 	}
-	for (i= 0; i < bufheight; i++)
-	  {
-	    unsigned char *s = src;
-	    for (j=0; j < bufwidth; j++) {
-	      *(dest++) = lut5[((*(s+1)&0xF8)>>3)]; // R 
-	      *(dest++) = lut6[(((*(s+1)&0x07) << 3) | ((*(s)&0xE0)>>5))]; // G 
-	      *(dest++) = lut5[((*s) & 0x1F)]; // B 
-	      s+=2;
-	    }
-	    src += fmt.fmt.pix.bytesperline;
-	  }
+	ccvt_rgb16_rgb24(bufwidth, bufheight, src, fmt.fmt.pix.bytesperline, rgb24_buffer, 3 * bufwidth, 0);
       }      
       break;
       
     case V4L2_PIX_FMT_SBGGR8:
-      bayer2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
-      break;
-
+    case V4L2_PIX_FMT_SGBRG8:
+    case V4L2_PIX_FMT_SGRBG8:
     case V4L2_PIX_FMT_SRGGB8:
-      bayer_rggb_2rgb24(rgb24_buffer, frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
-      break;
-
     case V4L2_PIX_FMT_SBGGR16:
-      bayer16_2_rgb24((unsigned short *)rgb24_buffer, (unsigned short *)frame, fmt.fmt.pix.width, fmt.fmt.pix.height);
+      {
+	unsigned char *src=frame;
+	int cfa=bayerPattern();
+	int bytes=(fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_SBGGR16) ? 2 : 1;
+	if (useSoftCrop && doCrop) {
+	  src=frame + bytes * crop.c.left + (crop.c.top * fmt.fmt.pix.bytesperline);
+	  cfa=ccvt_cfa_offset(cfa, crop.c.left, crop.c.top);
+	}
+	if (bytes == 2)
+	  ccvt_demosaic16(bufwidth, bufheight, (unsigned short *)src, fmt.fmt.pix.bytesperline, cfa, CCVT_DEMOSAIC_BILINEAR,
+			  rgb24_buffer, 6 * bufwidth, CCVT_RGB24);
+	else
+	  ccvt_demosaic8(bufwidth, bufheight, src, fmt.fmt.pix.bytesperline, cfa, CCVT_DEMOSAIC_BILINEAR,
+			 rgb24_buffer, 3 * bufwidth, CCVT_RGB24);
+      }
       break;
       
     case V4L2_PIX_FMT_JPEG:
@@ -456,6 +407,7 @@ void V4L2_Builtin_Decoder::allocBuffers()
   if (colorBuffer) delete [] (colorBuffer); colorBuffer = NULL;
   if (rgb24_buffer) delete [] (rgb24_buffer); rgb24_buffer = NULL;
   if (linearBuffer) delete [](linearBuffer); linearBuffer = NULL;
+  if (linearYBuffer) delete [](linearYBuffer); linearYBuffer = NULL;
   //if (cropbuf) free(cropbuf); cropbuf=NULL;
    
   if (doCrop) {
@@ -489,6 +441,8 @@ void V4L2_Builtin_Decoder::allocBuffers()
   case V4L2_PIX_FMT_RGB555:
   case V4L2_PIX_FMT_RGB565:
   case V4L2_PIX_FMT_SBGGR8:
+  case V4L2_PIX_FMT_SGBRG8:
+  case V4L2_PIX_FMT_SGRBG8:
   case V4L2_PIX_FMT_SRGGB8:
   case V4L2_PIX_FMT_SBGGR16:
     rgb24_buffer = new unsigned char[(bufwidth * bufheight) * (bpp / 8) * 3];
@@ -503,18 +457,41 @@ void V4L2_Builtin_Decoder::allocBuffers()
 
 void V4L2_Builtin_Decoder::makeLinearY()
 {
-  unsigned char *src=YBuf;
-  float *dest;
-  unsigned int i;
+  unsigned int step, bits;
+  unsigned char *src=lumaSamples(&step, &bits);
   if (!linearBuffer) {
     linearBuffer = new float[(bufwidth * bufheight)];
   }
-  dest=linearBuffer;
-  for (i=0; i < bufwidth * bufheight; i++)
-    *dest++ = (*src++) / 255.0;
-  linearize(linearBuffer, bufwidth * bufheight, &fmt);
+  linearizeY(src, bits, step, bufwidth * bufheight, getLinearTable(&fmt, bits, expandRange()), linearBuffer);
+}
+
+/* Y samples of the decoded frame, read in place from the packed formats */
+unsigned char * V4L2_Builtin_Decoder::lumaSamples(unsigned int *step, unsigned int *bits)
+{
+  *step=1; *bits=8;
+  switch (fmt.fmt.pix.pixelformat) {
+  case V4L2_PIX_FMT_Y16:
+    *bits=16;
+    return yuyvBuffer;
+  case V4L2_PIX_FMT_YUYV:
+  case V4L2_PIX_FMT_UYVY:
+  case V4L2_PIX_FMT_VYUY: 
+  case V4L2_PIX_FMT_YVYU:
+    // all reordered to YUYV by decode()
+    *step=2;
+    return yuyvBuffer;
+  default:
+    makeY();
+    return YBuf;
+  }
+}
 
+/* limited range samples are stretched to full range when quantization is on */
+bool V4L2_Builtin_Decoder::expandRange()
+{
+  return doQuantization && getQuantization(&fmt) == QUANTIZATION_LIM_RANGE;
 }
+
 void V4L2_Builtin_Decoder::makeY()
 {
   if (!yuvBuffer) {
@@ -526,6 +503,8 @@ void V4L2_Builtin_Decoder::makeY()
   case V4L2_PIX_FMT_RGB555:
   case V4L2_PIX_FMT_RGB565:
   case V4L2_PIX_FMT_SBGGR8:
+  case V4L2_PIX_FMT_SGBRG8:
+  case V4L2_PIX_FMT_SGRBG8:
   case V4L2_PIX_FMT_SRGGB8:
     RGB2YUV(bufwidth, bufheight, rgb24_buffer, YBuf, UBuf, VBuf, 0);
     break;
@@ -539,34 +518,41 @@ void V4L2_Builtin_Decoder::makeY()
   }
 }
 
+/* colour filter array of the raw formats, in ccvt_cfa */
+int V4L2_Builtin_Decoder::bayerPattern()
+{
+  switch (fmt.fmt.pix.pixelformat) {
+  case V4L2_PIX_FMT_SGBRG8:
+    return CCVT_CFA_GBRG;
+  case V4L2_PIX_FMT_SGRBG8:
+    return CCVT_CFA_GRBG;
+  case V4L2_PIX_FMT_SRGGB8:
+    return CCVT_CFA_RGGB;
+  default:
+    return CCVT_CFA_BGGR;
+  }
+}
+
 unsigned char * V4L2_Builtin_Decoder::getY()
 {
   if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_Y16)
     return yuyvBuffer;
   makeY();
-  if (doQuantization && getQuantization(&fmt) == QUANTIZATION_LIM_RANGE)
-    rangeY8(YBuf, (bufwidth * bufheight));
   if (doLinearization) {
-    unsigned int i;
-    float *src;
-    unsigned short *dest;
-    if (!yuyvBuffer)
-      yuyvBuffer=new unsigned char[(bufwidth * bufheight) * 2];
-    makeLinearY();
-    src=linearBuffer;
-    dest=(unsigned short *)yuyvBuffer;
-    for (i=0; i < bufwidth * bufheight; i++)
-      *dest++ = (unsigned short)(*src++ * 65535.0);
-    return yuyvBuffer;
+    // range mapping is part of the table, the packed frame stays intact for getLinearY()
+    if (!linearYBuffer)
+      linearYBuffer=new unsigned short[(bufwidth * bufheight)];
+    linearizeY16(YBuf, 8, 1, bufwidth * bufheight, getLinearTable16(&fmt, 8, expandRange()),
+                 linearYBuffer);
+    return (unsigned char *)linearYBuffer;
   }
+  if (expandRange())
+    rangeY8(YBuf, (bufwidth * bufheight));
   return YBuf;
 }
 
 float * V4L2_Builtin_Decoder::getLinearY()
 {
-  makeY();  
-  if (doQuantization && getQuantization(&fmt) == QUANTIZATION_LIM_RANGE)
-    rangeY8(YBuf, (bufwidth * bufheight));
   makeLinearY();
   return linearBuffer;
 }
@@ -595,56 +581,35 @@ unsigned char * V4L2_Builtin_Decoder::getColorBuffer()
   case V4L2_PIX_FMT_YVU420:
   case V4L2_PIX_FMT_NV12:
   case V4L2_PIX_FMT_NV21:
-    ccvt_420p_bgr32(bufwidth, bufheight, (void *)yuvBuffer, (void*)colorBuffer);
+    ccvt_420p_to(bufwidth, bufheight, YBuf, bufwidth, UBuf, VBuf, bufwidth / 2, colorBuffer, 4 * bufwidth, CCVT_BGR32);
     break;
 
   case V4L2_PIX_FMT_YUYV:
   case V4L2_PIX_FMT_UYVY:
   case V4L2_PIX_FMT_VYUY: 
   case V4L2_PIX_FMT_YVYU: 
-    ccvt_yuyv_bgr32(bufwidth, bufheight, yuyvBuffer, (void*)colorBuffer);
+    ccvt_422_to(bufwidth, bufheight, yuyvBuffer, 2 * bufwidth, CCVT_YUYV, colorBuffer, 4 * bufwidth, CCVT_BGR32);
     break;
   case V4L2_PIX_FMT_RGB24:
   case V4L2_PIX_FMT_RGB555:
   case V4L2_PIX_FMT_RGB565:
   case V4L2_PIX_FMT_SBGGR8:
+  case V4L2_PIX_FMT_SGBRG8:
+  case V4L2_PIX_FMT_SGRBG8:
   case V4L2_PIX_FMT_SRGGB8:
-    ccvt_rgb24_bgr32(bufwidth, bufheight,rgb24_buffer, (void*)colorBuffer);
+    /* bottom-up, as ccvt_rgb24_bgr32 did */
+    ccvt_rgb24_to(bufwidth, bufheight, rgb24_buffer, 3 * bufwidth,
+		  colorBuffer + (bufheight - 1) * 4 * bufwidth, -4 * (int)bufwidth, CCVT_BGR32);
     break;
   case V4L2_PIX_FMT_Y16:
-    /* OOOps this is planar ARGB */
-    /*
-    bzero(colorBuffer, bufwidth * bufheight * 2);
-    memcpy(colorBuffer + (bufwidth * bufheight * 2), yuyvBuffer, bufwidth * bufheight * 2);
-    memcpy(colorBuffer + 2 * (bufwidth * bufheight * 2), yuyvBuffer, bufwidth * bufheight * 2);
-    memcpy(colorBuffer + 3 * (bufwidth * bufheight * 2), yuyvBuffer, bufwidth * bufheight * 2);
-    */
-    { /* this is bgra , use unsigned short here... */
-      unsigned int i;
-      unsigned char *src = yuyvBuffer;
-      unsigned char *dest = colorBuffer;
-      for (i = 0; i < bufwidth * bufheight; i += 1) {
-	*dest++=*src; *dest++=*(src+1);
-	*dest++=*src; *dest++=*(src+1);
-	*dest++=*src; *dest++=*(src+1);
-	*dest++=0; *dest++=0;
-	src += 2;
-      }
-    }
+    /* this is bgra, 16 bits per channel */
+    ccvt_y16_bgra64(bufwidth, bufheight, (unsigned short *)yuyvBuffer, 2 * bufwidth,
+		    (unsigned short *)colorBuffer, 8 * bufwidth);
     break;
   case V4L2_PIX_FMT_SBGGR16:
-    { /* this is bgra , now I use unsigned short! */
-      unsigned int i;
-      unsigned short *src = (unsigned short *)rgb24_buffer;
-      unsigned short *dest = (unsigned short *)colorBuffer;
-      for (i = 0; i < bufwidth * bufheight; i += 1) {
-	*dest++=*(src + 2); 
-	*dest++=*(src + 1);
-	*dest++=*(src);
-	*dest++=0;
-	src += 3;
-      }
-    }
+    ccvt_rgb48_bgra64(bufwidth, bufheight, (unsigned short *)rgb24_buffer, 6 * bufwidth,
+		      (unsigned short *)colorBuffer, 8 * bufwidth);
+    break;
   default:
     ccvt_420p_bgr32(bufwidth, bufheight, (void *)yuvBuffer, (void*)colorBuffer);
     break;
@@ -665,20 +630,22 @@ unsigned char * V4L2_Builtin_Decoder::getRGBBuffer()
   case V4L2_PIX_FMT_YVU420:
   case V4L2_PIX_FMT_NV12:
   case V4L2_PIX_FMT_NV21:
-    ccvt_420p_rgb24(bufwidth, bufheight, (void *)yuvBuffer, (void*)rgb24_buffer);
+    ccvt_420p_to(bufwidth, bufheight, YBuf, bufwidth, UBuf, VBuf, bufwidth / 2, rgb24_buffer, 3 * bufwidth, CCVT_RGB24);
     break;
   case V4L2_PIX_FMT_YUYV:
   case V4L2_PIX_FMT_UYVY:
   case V4L2_PIX_FMT_VYUY: 
   case V4L2_PIX_FMT_YVYU: 
-    if (!colorBuffer) colorBuffer = new unsigned char[(bufwidth * bufheight) * 4];
-    ccvt_yuyv_bgr32(bufwidth, bufheight, yuyvBuffer, (void*)colorBuffer);
-    ccvt_bgr32_rgb24(bufwidth, bufheight, colorBuffer, (void*)rgb24_buffer);
+    /* single pass, bottom-up as the former detour through ccvt_bgr32_rgb24 */
+    ccvt_422_to(bufwidth, bufheight, yuyvBuffer, 2 * bufwidth, CCVT_YUYV,
+		rgb24_buffer + (bufheight - 1) * 3 * bufwidth, -3 * (int)bufwidth, CCVT_RGB24);
     break;
   case V4L2_PIX_FMT_RGB24:
   case V4L2_PIX_FMT_RGB555:
   case V4L2_PIX_FMT_RGB565:
   case V4L2_PIX_FMT_SBGGR8:
+  case V4L2_PIX_FMT_SGBRG8:
+  case V4L2_PIX_FMT_SGRBG8:
   case V4L2_PIX_FMT_SRGGB8:
   case V4L2_PIX_FMT_SBGGR16:
     break;
@@ -793,7 +760,9 @@ void V4L2_Builtin_Decoder::init_supported_formats() {
 //  V4L2_PIX_FMT_SBGGR8  , // v4l2_fourcc('B', 'A', '8', '1') /*  8  BGBG.. GRGR.. */
   supported_formats.insert(std::make_pair(V4L2_PIX_FMT_SBGGR8,  new V4L2_Builtin_Decoder::format(V4L2_PIX_FMT_SBGGR8, 8,false)));
 // V4L2_PIX_FMT_SGBRG8  , // v4l2_fourcc('G', 'B', 'R', 'G') /*  8  GBGB.. RGRG.. */
+  supported_formats.insert(std::make_pair(V4L2_PIX_FMT_SGBRG8,  new V4L2_Builtin_Decoder::format(V4L2_PIX_FMT_SGBRG8, 8,false)));
 // V4L2_PIX_FMT_SGRBG8  , // v4l2_fourcc('G', 'R', 'B', 'G') /*  8  GRGR.. BGBG.. */
+  supported_formats.insert(std::make_pair(V4L2_PIX_FMT_SGRBG8,  new V4L2_Builtin_Decoder::format(V4L2_PIX_FMT_SGRBG8, 8,false)));
 //  V4L2_PIX_FMT_SRGGB8  , // v4l2_fourcc('R', 'G', 'G', 'B') /*  8  RGRG.. GBGB.. */
   supported_formats.insert(std::make_pair(V4L2_PIX_FMT_SRGGB8,  new V4L2_Builtin_Decoder::format(V4L2_PIX_FMT_SRGGB8, 8,false)));
 // V4L2_PIX_FMT_SBGGR10 , // v4l2_fourcc('B', 'G', '1', '0') /* 10  BGBG.. GRGR.. */
@@ -63,7 +63,10 @@ class V4L2_Builtin_Decoder: public V4L2_Decoder
   std::vector<unsigned int> vsuppformats;
   void allocBuffers();
   void makeY();
+  int bayerPattern();
   void makeLinearY();
+  unsigned char *lumaSamples(unsigned int *step, unsigned int *bits);
+  bool expandRange();
 
   struct v4l2_crop crop;
   struct v4l2_format fmt;
@@ -80,11 +83,10 @@ class V4L2_Builtin_Decoder: public V4L2_Decoder
   unsigned char *colorBuffer;
   unsigned char *rgb24_buffer;
   float *linearBuffer;
+  unsigned short *linearYBuffer;
   //unsigned char *cropbuf;
   unsigned int bufwidth;
   unsigned int bufheight;
-  char lut5[32];
-  char lut6[64];
   unsigned char bpp;
 };
 #endif
@@ -0,0 +1,96 @@
+/*
+    Copyright (C) 2026 by INDI Library contributors
+
+    MJPEG Recorder
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/ 
+
+#include "mjpeg_recorder.h"
+#include <string.h>
+#include <errno.h>
+
+#define ERRMSGSIZ	1024
+
+MJPEG_Recorder::MJPEG_Recorder() {
+  name="MJPEG File Recorder";
+  streaming_active=false;
+  f=NULL;
+}
+
+MJPEG_Recorder::~MJPEG_Recorder() {
+
+}
+
+void MJPEG_Recorder::init() {
+
+}
+
+bool MJPEG_Recorder::setpixelformat(unsigned int format) {
+  return format == V4L2_PIX_FMT_JPEG || format == V4L2_PIX_FMT_MJPEG;
+}
+
+bool MJPEG_Recorder::setsize(unsigned int width, unsigned int height) {
+  // frames carry their own size
+  return !streaming_active;
+}
+
+bool MJPEG_Recorder::open(const char *filename, char *errmsg) {
+  if (streaming_active) return false;
+  if ((f=fopen(filename, "w")) == NULL) {
+    snprintf(errmsg, ERRMSGSIZ, "recorder open error %d, %s\n", errno, strerror (errno));
+    return false;
+  }
+  streaming_active = true;
+  return true;
+}
+
+bool MJPEG_Recorder::close() {
+  if (f)
+  {
+      fclose(f);
+      f=NULL;
+  }
+
+  streaming_active = false;
+  return true;
+}
+
+bool MJPEG_Recorder::writeFrameEncoded(unsigned char *frame, unsigned int size) {
+  if (!streaming_active) return false;
+  return fwrite(frame, size, 1, f) == 1;
+}
+
+// decoded frames are not recorded, use the SER recorder for them
+bool MJPEG_Recorder::writeFrame(unsigned char *frame) {
+  return false;
+}
+
+bool MJPEG_Recorder::writeFrameMono(unsigned char *frame) {
+  return false;
+}
+
+bool MJPEG_Recorder::writeFrameColor(unsigned char *frame) {
+  return false;
+}
+
+void MJPEG_Recorder::setDefaultMono() {
+
+}
+
+void MJPEG_Recorder::setDefaultColor() {
+
+}
@@ -0,0 +1,54 @@
+/*
+    Copyright (C) 2026 by INDI Library contributors
+
+    MJPEG Recorder
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/ 
+
+#ifndef MJPEG_RECORDER_H
+#define MJPEG_RECORDER_H
+
+#include "v4l2_record.h"
+#include <stdio.h>
+
+/* Records the JPEG frames of a camera as they come, one after the other.
+   The file is a raw MJPEG stream, read by ffmpeg, vlc or mplayer. */
+class MJPEG_Recorder: public V4L2_Recorder
+{
+ public:
+
+  MJPEG_Recorder();
+  virtual ~MJPEG_Recorder();
+  
+  virtual void init();
+  virtual bool setpixelformat(unsigned int f);
+  virtual bool setsize(unsigned int width, unsigned int height);
+  virtual bool open(const char *filename, char *errmsg);
+  virtual bool close();
+  virtual bool writeFrame(unsigned char *frame);
+  virtual bool writeFrameMono(unsigned char *frame);
+  virtual bool writeFrameColor(unsigned char *frame);
+  virtual bool writeFrameEncoded(unsigned char *frame, unsigned int size);
+  virtual void setDefaultMono();
+  virtual void setDefaultColor();
+
+ protected:
+  bool streaming_active;
+  FILE *f;
+};
+
+#endif // MJPEG_RECORDER_H
@@ -28,8 +28,14 @@
 #include "ser_recorder.h"
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
 
 #define ERRMSGSIZ	1024
+/* SER dates are 100ns ticks since 0001-01-01, this is 1970-01-01 */
+#define SER_EPOCH_TICKS 621355968000000000ULL
 
 SER_Recorder::SER_Recorder() {
   useSER_V3=true;
@@ -44,10 +50,18 @@ SER_Recorder::SER_Recorder() {
   else
     serh.LittleEndian=SER_BIG_ENDIAN;
   streaming_active=false;
+  fd=-1;
+  nblocks=0;
+  current=NULL;
+  frame_time_set=false;
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&cond, NULL);
 }
 
 SER_Recorder::~SER_Recorder() {
-
+  close();
+  pthread_mutex_destroy(&lock);
+  pthread_cond_destroy(&cond);
 }
 
 bool SER_Recorder::is_little_endian() {
@@ -56,42 +70,151 @@ bool SER_Recorder::is_little_endian() {
   return black_magic == 0x01;
 }
  
-void SER_Recorder::write_int_le(unsigned int *i) {
-  if (is_little_endian())
-    fwrite((const void *)(i), sizeof(int), 1, f);
-  else {
-    unsigned char *c=(unsigned char *)i;
-    fwrite((const void *)(c+3), sizeof(char), 1, f);
-    fwrite((const void *)(c+2), sizeof(char), 1, f);
-    fwrite((const void *)(c+1), sizeof(char), 1, f);
-    fwrite((const void *)(c), sizeof(char), 1, f);
+void SER_Recorder::put_int_le(unsigned char *c, uint32_t i) {
+  c[0]=i & 0xFF;
+  c[1]=(i >> 8) & 0xFF;
+  c[2]=(i >> 16) & 0xFF;
+  c[3]=(i >> 24) & 0xFF;
+}
+
+void SER_Recorder::put_long_int_le(unsigned char *c, uint64_t i) {
+  put_int_le(c, i & 0xFFFFFFFF);
+  put_int_le(c + 4, i >> 32);
+}
+
+/* the header is made in memory and written at once */
+void SER_Recorder::put_header(ser_header *s, unsigned char *h) {
+  memcpy(h, s->FileID, 14);
+  put_int_le(h + 14, s->LuID);
+  put_int_le(h + 18, s->ColorID);
+  put_int_le(h + 22, s->LittleEndian);
+  put_int_le(h + 26, s->ImageWidth);
+  put_int_le(h + 30, s->ImageHeight);
+  put_int_le(h + 34, s->PixelDepth);
+  put_int_le(h + 38, s->FrameCount);
+  memcpy(h + 42, s->Observer, 40);
+  memcpy(h + 82, s->Instrume, 40);
+  memcpy(h + 122, s->Telescope, 40);
+  put_long_int_le(h + 162, s->DateTime);
+  put_long_int_le(h + 170, s->DateTime_UTC);
+}
+
+bool SER_Recorder::write_header(ser_header *s) {
+  unsigned char h[SER_HEADER_SIZE];
+  put_header(s, h);
+  return pwrite(fd, h, SER_HEADER_SIZE, 0) == SER_HEADER_SIZE;
+}
+
+/* SER v3 trailer: the UTC time of each frame after the last one */
+bool SER_Recorder::write_trailer() {
+  std::vector<unsigned char> t(timestamps.size() * 8);
+  off_t end = SER_HEADER_SIZE + (off_t)serh.FrameCount * frame_size;
+  size_t done = 0;
+  ssize_t n;
+
+  if (!useSER_V3 || timestamps.size() != serh.FrameCount) {
+    timestamps.clear();
+    return ftruncate(fd, end) == 0;
+  }
+  for (size_t i = 0; i < timestamps.size(); i++)
+    put_long_int_le(&t[i * 8], timestamps[i]);
+  while (done < t.size()) {
+    n = pwrite(fd, &t[done], t.size() - done, end + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += n;
   }
+  /* drops the space reserved beyond the end */
+  return ftruncate(fd, end + t.size()) == 0;
 }
 
-void SER_Recorder::write_long_int_le(unsigned long *i) {
-  if (is_little_endian()) {
-    fwrite((const void *)((unsigned int *)i), sizeof(int), 1, f);
-    fwrite((const void *)((unsigned int *)(i) + 1), sizeof(int), 1, f);
-  } else {
-    write_int_le((unsigned int *)(i) + 1);
-    write_int_le((unsigned int *)(i));
+uint64_t SER_Recorder::ser_time(const struct timeval *tv) {
+  return SER_EPOCH_TICKS + (uint64_t)tv->tv_sec * 10000000ULL + (uint64_t)tv->tv_usec * 10ULL;
+}
+
+/* a free block, a new one while less than SER_MAX_BLOCKS exist; waits for the writer otherwise */
+SER_Recorder::block *SER_Recorder::get_block() {
+  block *b=NULL;
+
+  pthread_mutex_lock(&lock);
+  while (free_blocks.empty() && nblocks >= SER_MAX_BLOCKS && writer_error == 0)
+    pthread_cond_wait(&cond, &lock);
+  /* nothing more reaches the file once a write failed */
+  if (writer_error) {
+    pthread_mutex_unlock(&lock);
+    return NULL;
+  }
+  if (!free_blocks.empty()) {
+    b=free_blocks.back();
+    free_blocks.pop_back();
   }
+  pthread_mutex_unlock(&lock);
+
+  if (b == NULL) {
+    if (nblocks >= SER_MAX_BLOCKS) return NULL;
+    b=new block;
+    b->data=(unsigned char *)malloc(SER_BLOCK_SIZE);
+    if (b->data == NULL) {
+      delete b;
+      return NULL;
+    }
+    nblocks+=1;
+  }
+  b->len=0;
+  return b;
+}
+
+void SER_Recorder::queue_block(block *b) {
+  pthread_mutex_lock(&lock);
+  full_blocks.push_back(b);
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
 }
 
-void SER_Recorder::write_header(ser_header *s) {
-  fwrite((const void *)(s->FileID), sizeof(char), 14, f);
-  write_int_le(&(s->LuID));
-  write_int_le(&(s->ColorID));
-  write_int_le(&(s->LittleEndian));
-  write_int_le(&(s->ImageWidth));
-  write_int_le(&(s->ImageHeight));
-  write_int_le(&(s->PixelDepth));
-  write_int_le(&(s->FrameCount));
-  fwrite((const void *)(s->Observer), sizeof(char), 40, f);
-  fwrite((const void *)(s->Instrume), sizeof(char), 40, f);
-  fwrite((const void *)(s->Telescope), sizeof(char), 40, f);
-  write_long_int_le(&(s->DateTime));
-  write_long_int_le(&(s->DateTime_UTC));
+void *SER_Recorder::writer_thread(void *arg) {
+  ((SER_Recorder *)arg)->write_blocks();
+  return NULL;
+}
+
+/* write the queued blocks in order until close() and the queue is empty */
+void SER_Recorder::write_blocks() {
+  block *b;
+  size_t done;
+  ssize_t n;
+  int err;
+
+  pthread_mutex_lock(&lock);
+  while (true) {
+    while (full_blocks.empty() && !writer_quit)
+      pthread_cond_wait(&cond, &lock);
+    if (full_blocks.empty())
+      break;
+    b=full_blocks.front();
+    full_blocks.pop_front();
+    pthread_mutex_unlock(&lock);
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    /* reserve the space ahead in large extents, stops on filesystems which can not */
+    if (preallocated >= 0 && b->offset + (off_t)b->len > preallocated) {
+      if (fallocate(fd, FALLOC_FL_KEEP_SIZE, preallocated, SER_PREALLOC_SIZE) == 0)
+        preallocated+=SER_PREALLOC_SIZE;
+      else
+        preallocated=-1;
+    }
+#endif
+    err=0;
+    for (done=0; done < b->len; done+=n) {
+      n=pwrite(fd, b->data + done, b->len - done, b->offset + done);
+      if (n < 0 && errno == EINTR) { n=0; continue; }
+      if (n <= 0) { err=(n < 0) ? errno : EIO; break; }
+    }
+
+    pthread_mutex_lock(&lock);
+    if (err && !writer_error) writer_error=err;
+    free_blocks.push_back(b);
+    pthread_cond_broadcast(&cond);
+  }
+  pthread_mutex_unlock(&lock);
 }
 
 void SER_Recorder::init() {
@@ -221,34 +344,124 @@ bool SER_Recorder::setsize(unsigned int width, unsigned int height) {
 bool SER_Recorder::open(const char *filename, char *errmsg) {
   if (streaming_active) return false;
   serh.FrameCount = 0;
-  serh.DateTime=0; // no timestamp
-  serh.DateTime_UTC=0; // no timestamp
-  if ((f=fopen(filename, "w")) == NULL) {
+  serh.DateTime=0; // set by the first frame
+  serh.DateTime_UTC=0;
+  if ((fd=::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
     snprintf(errmsg, ERRMSGSIZ, "recorder open error %d, %s\n", errno, strerror (errno));
     return false;
   }
-  write_header(&serh);
   frame_size=serh.ImageWidth * serh.ImageHeight * (serh.PixelDepth <= 8 ? 1 : 2) * number_of_planes;
+  timestamps.clear();
+  frame_time_set=false;
+  writer_quit=false;
+  writer_error=0;
+  preallocated=0;
+
+  /* blocks start on file offsets multiple of their size, the header opens the first one */
+  current=get_block();
+  if (current == NULL) {
+    snprintf(errmsg, ERRMSGSIZ, "recorder open error, out of memory\n");
+    ::close(fd);
+    return false;
+  }
+  current->offset=0;
+  put_header(&serh, current->data);
+  current->len=SER_HEADER_SIZE;
+  offset=SER_HEADER_SIZE;
+
+  if (pthread_create(&writer, NULL, writer_thread, this) != 0) {
+    snprintf(errmsg, ERRMSGSIZ, "recorder open error, can not start the writer thread\n");
+    free_blocks.push_back(current);
+    current=NULL;
+    ::close(fd);
+    return false;
+  }
   streaming_active = true;
   return true;
 }
 
 bool SER_Recorder::close() {
-  if (f)
-  {
-      fseek(f, 0L, SEEK_SET);
-      write_header(&serh);
-      fclose(f);
-  }
+  bool ok=true;
 
+  if (!streaming_active) return true;
   streaming_active = false;
-  return true;
+
+  if (current != NULL) {
+    queue_block(current);
+    current=NULL;
+  }
+  pthread_mutex_lock(&lock);
+  writer_quit=true;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+  pthread_join(writer, NULL);
+
+  if (writer_error) {
+    IDLog("recorder: write error %d, %s\n", writer_error, strerror(writer_error));
+    ok=false;
+  }
+  if (!write_trailer() || !write_header(&serh)) {
+    IDLog("recorder: can not complete the file, %s\n", strerror(errno));
+    ok=false;
+  }
+  ::close(fd);
+  fd=-1;
+
+  /* the blocks are only kept while recording */
+  for (size_t i = 0; i < free_blocks.size(); i++) {
+    free(free_blocks[i]->data);
+    delete free_blocks[i];
+  }
+  free_blocks.clear();
+  nblocks=0;
+  return ok;
+}
+
+void SER_Recorder::setFrameTime(const struct timeval *utc) {
+  frame_time=*utc;
+  frame_time_set=true;
 }
 
+/* copy the frame to the current block, the writer thread does the disk I/O; false once a write failed */
 bool SER_Recorder::writeFrame(unsigned char *frame) {
-  if (!streaming_active) return false;
+  size_t done=0, n;
+  uint64_t t;
+  int err;
+
+  if (!streaming_active || current == NULL) return false;
+  pthread_mutex_lock(&lock);
+  err=writer_error;
+  pthread_mutex_unlock(&lock);
+  if (err) return false;
   //IDLog("recorder: writeFrame @ %p\n", frame);
-  fwrite(frame, frame_size, 1, f);
+  if (!frame_time_set)
+    gettimeofday(&frame_time, NULL);
+  frame_time_set=false;
+
+  while (done < frame_size) {
+    n=frame_size - done;
+    if (n > SER_BLOCK_SIZE - current->len)
+      n=SER_BLOCK_SIZE - current->len;
+    memcpy(current->data + current->len, frame + done, n);
+    current->len+=n;
+    offset+=n;
+    done+=n;
+    if (current->len == SER_BLOCK_SIZE) {
+      queue_block(current);
+      current=get_block();
+      if (current == NULL) return false;
+      current->offset=offset;
+    }
+  }
+
+  t=ser_time(&frame_time);
+  timestamps.push_back(t);
+  if (serh.FrameCount == 0) {
+    struct tm tm;
+    localtime_r(&frame_time.tv_sec, &tm);
+    serh.DateTime_UTC=t;
+    serh.DateTime=t + (int64_t)tm.tm_gmtoff * 10000000LL;
+  }
   serh.FrameCount+=1;
   return true;
 }
@@ -29,6 +29,12 @@
 #include <linux/videodev2.h>
 #endif
 #include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <deque>
+#include <vector>
 
 typedef struct ser_header {
   char FileID[14];
@@ -42,8 +48,8 @@ typedef struct ser_header {
   char Observer[40];
   char Instrume[40];
   char Telescope[40];
-  unsigned long int DateTime;
-  unsigned long int DateTime_UTC;
+  uint64_t DateTime;
+  uint64_t DateTime_UTC;
 } ser_header;
 
 enum ser_color_id {
@@ -63,6 +69,13 @@ enum ser_color_id {
 #define SER_BIG_ENDIAN 0
 #define SER_LITTLE_ENDIAN 1
 
+#define SER_HEADER_SIZE 178
+/* frames are gathered in blocks written by a thread, at most SER_MAX_BLOCKS queued */
+#define SER_BLOCK_SIZE (4 * 1024 * 1024)
+#define SER_MAX_BLOCKS 32
+/* disk space reserved ahead of the writes where the filesystem allows it */
+#define SER_PREALLOC_SIZE (256 * 1024 * 1024)
+
 class SER_Recorder: public V4L2_Recorder
 {
  public:
@@ -79,21 +92,53 @@ class SER_Recorder: public V4L2_Recorder
   virtual bool writeFrame(unsigned char *frame);
   virtual bool writeFrameMono(unsigned char *frame); // default way to write a GREY frame
   virtual bool writeFrameColor(unsigned char *frame); // default way to write a RGB3 frame
+  virtual void setFrameTime(const struct timeval *utc);
   virtual void setDefaultMono(); // prepare to write GREY frame
   virtual void setDefaultColor(); // prepare to write RGB24 frame
 
 
  protected:
+  struct block {
+    unsigned char *data;
+    size_t len;
+    off_t offset;
+  };
+
   bool is_little_endian();
-  void write_int_le(unsigned int *i);
-  void write_long_int_le(unsigned long *i);
-  void write_header(ser_header *s);
+  void put_int_le(unsigned char *c, uint32_t i);
+  void put_long_int_le(unsigned char *c, uint64_t i);
+  void put_header(ser_header *s, unsigned char *h);
+  bool write_header(ser_header *s);
+  bool write_trailer();
+  static uint64_t ser_time(const struct timeval *tv);
+  block *get_block();
+  void queue_block(block *b);
+  static void *writer_thread(void *arg);
+  void write_blocks();
   ser_header serh;
   bool streaming_active;
   bool useSER_V3;
-  FILE *f;
+  int fd;
   unsigned int frame_size;
   unsigned int number_of_planes;
+
+  /* writer thread */
+  pthread_t writer;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  std::deque<block *> full_blocks;
+  std::vector<block *> free_blocks;
+  unsigned int nblocks;
+  bool writer_quit;
+  int writer_error;
+  block *current;
+  off_t offset; // file offset of the next frame byte
+  off_t preallocated;
+
+  /* SER v3 trailer, capture time of each frame */
+  std::vector<uint64_t> timestamps;
+  struct timeval frame_time;
+  bool frame_time_set;
 };
 
 #endif // SER_RECORDER_H
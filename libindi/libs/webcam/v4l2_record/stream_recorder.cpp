@@ -23,10 +23,19 @@
 #include <indilogger.h>
 
 #include <signal.h>
+#include <unistd.h>
+#include <math.h>
 #include <zlib.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+
 #include "stream_recorder.h"
+#include "ccvt.h"
+#include "jpegutils.h"
+
+/* pre-trigger frames written to a record for each new frame, until it caught up with the camera */
+#define PRETRIGGER_FLUSH_FRAMES 2
 
 const char *STREAM_TAB          = "Streaming";
 
@@ -37,7 +46,42 @@ StreamRecorder::StreamRecorder(INDI::CCD *mainCCD)
    is_streaming = false;
    is_recording = false;
 
-   compressedFrame = (uint8_t* ) malloc(1);
+   rawFrame8 = NULL;
+   colorFrame = NULL;
+   colorFrameSize = 0;
+   jpegFrame = NULL;
+   jpegFrameSize = 0;
+   encoded_source = false;
+
+   pthread_mutex_init(&encoderLock, NULL);
+   pthread_cond_init(&encoderCond, NULL);
+   encoder_running = false;
+   encoder_quit = false;
+   encoder_busy = false;
+   encoder_queued = false;
+   droppedFrames = 0;
+   encodeFrame = NULL;
+   encodeFrameSize = 0;
+   encodedStream = NULL;
+   encodedStreamSize = 0;
+   stretchHistogram = NULL;
+   stretchLUT = NULL;
+   previewFrame = NULL;
+   previewFrameSize = 0;
+
+   adaptiveDivisor = 0;
+   adaptiveQuality = 75;
+   adaptiveCompress = false;
+   statsSendMs = 0;
+   statsBytes = statsRawBytes = 0;
+   statsFrames = 0;
+   gettimeofday(&statsStart, NULL);
+
+   pretriggerBuffer = NULL;
+   pretriggerSize = 0;
+   pretriggerWrite = 0;
+   pretriggerDuration = 0;
+   pretriggerPending = false;
 
    // Timer
    // now use BSD setimer to avoi librt dependency
@@ -58,7 +102,9 @@ StreamRecorder::StreamRecorder(INDI::CCD *mainCCD)
    v4l2_record=new V4L2_Record();
    recorder=v4l2_record->getDefaultRecorder();
    recorder->init();
+   encoded_recorder=v4l2_record->getEncodedRecorder(V4L2_PIX_FMT_MJPEG);
    direct_record=false;
+   encoded_record=false;
 
    DEBUGF( INDI::Logger::DBG_SESSION, "Using default recorder (%s)", recorder->getName());
 
@@ -66,8 +112,20 @@ StreamRecorder::StreamRecorder(INDI::CCD *mainCCD)
 
 StreamRecorder::~StreamRecorder()
 {
+    stopEncoder();
+    pthread_mutex_destroy(&encoderLock);
+    pthread_cond_destroy(&encoderCond);
+
     delete (v4l2_record);
-    free(compressedFrame);
+    free(rawFrame8);
+    free(colorFrame);
+    free(jpegFrame);
+    free(encodeFrame);
+    free(encodedStream);
+    free(stretchHistogram);
+    free(stretchLUT);
+    free(previewFrame);
+    free(pretriggerBuffer);
 }
 
 bool StreamRecorder::initProperties()
@@ -81,11 +139,47 @@ bool StreamRecorder::initProperties()
      IUFillNumber(&StreamOptionsN[0], "STREAM_RATE", "Rate Divisor", "%3.0f", 0, 60.0, 5, 0);
      IUFillNumberVector(&StreamOptionsNP, StreamOptionsN, NARRAY(StreamOptionsN), getDeviceName(), "STREAM_OPTIONS", "Streaming", STREAM_TAB, IP_RW, 60, IPS_IDLE);
 
+     /* Colour preview of Bayer frames */
+     IUFillSwitch(&DebayerS[DEBAYER_OFF], "DEBAYER_OFF", "Raw", ISS_ON);
+     IUFillSwitch(&DebayerS[DEBAYER_BILINEAR], "DEBAYER_BILINEAR", "Bilinear", ISS_OFF);
+     IUFillSwitch(&DebayerS[DEBAYER_EDGE], "DEBAYER_EDGE", "Edge directed", ISS_OFF);
+     IUFillSwitchVector(&DebayerSP, DebayerS, NARRAY(DebayerS), getDeviceName(), "STREAM_DEBAYER", "Debayer", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+     /* Compressed frames of JPEG/MJPEG cameras sent or recorded without decoding */
+     IUFillSwitch(&PassthroughS[PASSTHROUGH_STREAM], "PASSTHROUGH_STREAM", "Stream JPEG", ISS_OFF);
+     IUFillSwitch(&PassthroughS[PASSTHROUGH_RECORD], "PASSTHROUGH_RECORD", "Record MJPEG", ISS_OFF);
+     IUFillSwitchVector(&PassthroughSP, PassthroughS, NARRAY(PassthroughS), getDeviceName(), "STREAM_PASSTHROUGH", "Passthrough", STREAM_TAB, IP_RW, ISR_NOFMANY, 0, IPS_IDLE);
+
+     /* Stream encoding, zlib and JPEG run on the encoder thread */
+     IUFillSwitch(&EncodingS[ENCODE_RAW], "ENCODE_RAW", "Raw", ISS_ON);
+     IUFillSwitch(&EncodingS[ENCODE_ZLIB], "ENCODE_ZLIB", "Zlib", ISS_OFF);
+     IUFillSwitch(&EncodingS[ENCODE_JPEG], "ENCODE_JPEG", "JPEG", ISS_OFF);
+     IUFillSwitchVector(&EncodingSP, EncodingS, NARRAY(EncodingS), getDeviceName(), "STREAM_ENCODING", "Encoding", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+     IUFillNumber(&QualityN[0], "JPEG_QUALITY", "Quality", "%3.0f", 10.0, 100.0, 5.0, 75.0);
+     IUFillNumberVector(&QualityNP, QualityN, NARRAY(QualityN), getDeviceName(), "STREAM_JPEG", "JPEG", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
      /* Measured FPS */
      IUFillNumber(&FpsN[0], "EST_FPS", "Instant.", "%3.2f", 0.0, 999.0, 0.0, 30);
      IUFillNumber(&FpsN[1], "AVG_FPS", "Average (1 sec.)", "%3.2f", 0.0, 999.0, 0.0, 30);
      IUFillNumberVector(&FpsNP, FpsN, NARRAY(FpsN), getDeviceName(), "FPS", "FPS", STREAM_TAB, IP_RO, 60, IPS_IDLE);
 
+     /* Adaptive stream rate */
+     IUFillSwitch(&AdaptiveS[0], "ADAPTIVE_ON", "On", ISS_OFF);
+     IUFillSwitch(&AdaptiveS[1], "ADAPTIVE_OFF", "Off", ISS_ON);
+     IUFillSwitchVector(&AdaptiveSP, AdaptiveS, NARRAY(AdaptiveS), getDeviceName(), "STREAM_ADAPTIVE", "Adaptive Rate", STREAM_TAB, IP_RW, ISR_1OFMANY, 0, IPS_IDLE);
+
+     IUFillNumber(&BudgetN[BUDGET_BITRATE], "BUDGET_BITRATE", "Bitrate (Mbit/s)", "%6.1f", 0.1, 10000.0, 1.0, 20.0);
+     IUFillNumber(&BudgetN[BUDGET_LATENCY], "BUDGET_LATENCY", "Send time (ms)", "%6.0f", 1.0, 10000.0, 10.0, 100.0);
+     IUFillNumberVector(&BudgetNP, BudgetN, NARRAY(BudgetN), getDeviceName(), "STREAM_BUDGET", "Stream Budget", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
+     IUFillNumber(&StreamStatsN[STATS_FPS], "STREAM_FPS", "Sent fps", "%6.2f", 0.0, 999.0, 0.0, 0.0);
+     IUFillNumber(&StreamStatsN[STATS_BITRATE], "STREAM_BITRATE", "Bitrate (Mbit/s)", "%6.2f", 0.0, 100000.0, 0.0, 0.0);
+     IUFillNumber(&StreamStatsN[STATS_SEND_TIME], "STREAM_SEND_TIME", "Send time (ms)", "%6.1f", 0.0, 100000.0, 0.0, 0.0);
+     IUFillNumber(&StreamStatsN[STATS_DIVISOR], "STREAM_DIVISOR", "Rate Divisor", "%3.0f", 0.0, 1000.0, 0.0, 0.0);
+     IUFillNumber(&StreamStatsN[STATS_QUALITY], "STREAM_QUALITY", "JPEG Quality", "%3.0f", 0.0, 100.0, 0.0, 75.0);
+     IUFillNumberVector(&StreamStatsNP, StreamStatsN, NARRAY(StreamStatsN), getDeviceName(), "STREAM_STATS", "Stream Stats", STREAM_TAB, IP_RO, 60, IPS_IDLE);
+
      /* Frames to Drop */
      //IUFillNumber(&FramestoDropN[0], "To drop", "", "%2.0f", 0, 99, 1, 0);
      //IUFillNumberVector(&FramestoDropNP, FramestoDropN, NARRAY(FramestoDropN), getDeviceName(), "Frames", "", STREAM_TAB, IP_RW, 60, IPS_IDLE);
@@ -101,6 +195,15 @@ bool StreamRecorder::initProperties()
      IUFillNumber(&RecordOptionsN[1], "RECORD_FRAME_TOTAL", "Frames", "%9.0f", 1.0, 999999999.0, 1.0, 30.0);
      IUFillNumberVector(&RecordOptionsNP, RecordOptionsN, NARRAY(RecordOptionsN), getDeviceName(), "RECORD_OPTIONS", "Record Options", STREAM_TAB, IP_RW, 60, IPS_IDLE);
 
+     /* Pre-trigger ring, off while both Frames and Duration are 0 */
+     IUFillNumber(&PretriggerN[PRETRIGGER_FRAMES], "PRETRIGGER_FRAMES", "Frames", "%6.0f", 0.0, 100000.0, 10.0, 0.0);
+     IUFillNumber(&PretriggerN[PRETRIGGER_DURATION], "PRETRIGGER_DURATION", "Duration (sec)", "%6.2f", 0.0, 3600.0, 1.0, 0.0);
+     IUFillNumber(&PretriggerN[PRETRIGGER_MEMORY], "PRETRIGGER_MEMORY", "Memory (MB)", "%6.0f", 1.0, 65536.0, 64.0, 256.0);
+     IUFillNumberVector(&PretriggerNP, PretriggerN, NARRAY(PretriggerN), getDeviceName(), "RECORD_PRETRIGGER", "Pre-trigger", STREAM_TAB, IP_RW, 60, IPS_IDLE);
+
+     IUFillSwitch(&TriggerS[0], "TRIGGER", "Trigger", ISS_OFF);
+     IUFillSwitchVector(&TriggerSP, TriggerS, NARRAY(TriggerS), getDeviceName(), "RECORD_TRIGGER", "Record Trigger", STREAM_TAB, IP_RW, ISR_ATMOST1, 0, IPS_IDLE);
+
      /* Record Switch */
      IUFillSwitch(&RecordStreamS[0], "RECORD_ON", "Record On", ISS_OFF);
      IUFillSwitch(&RecordStreamS[1], "RECORD_DURATION_ON", "Record (Duration)", ISS_OFF);
@@ -120,11 +223,22 @@ void StreamRecorder::ISGetProperties(const char *dev)
     {
       ccd->defineSwitch(&StreamSP);
       ccd->defineNumber(&StreamOptionsNP);
+      ccd->defineSwitch(&EncodingSP);
+      ccd->defineNumber(&QualityNP);
+      if (ccd->HasBayer())
+          ccd->defineSwitch(&DebayerSP);
+      if (encoded_source)
+          ccd->defineSwitch(&PassthroughSP);
       ccd->defineNumber(&FpsNP);
+      ccd->defineSwitch(&AdaptiveSP);
+      ccd->defineNumber(&BudgetNP);
+      ccd->defineNumber(&StreamStatsNP);
       //ccd->defineNumber(&FramestoDropNP);
       ccd->defineSwitch(&RecordStreamSP);
       ccd->defineText(&RecordFileTP);
       ccd->defineNumber(&RecordOptionsNP);
+      ccd->defineNumber(&PretriggerNP);
+      ccd->defineSwitch(&TriggerSP);
     }
 }
 
@@ -135,33 +249,63 @@ bool StreamRecorder::updateProperties()
       imageBP=ccd->getBLOB("CCD1");
       imageB=imageBP->bp;
 
+      /* streams keep following the compression of the CCD until a client picks an encoding */
+      if (EncodingSP.s == IPS_IDLE)
+      {
+          IUResetSwitch(&EncodingSP);
+          EncodingS[ccd->PrimaryCCD.isCompressed() ? ENCODE_ZLIB : ENCODE_RAW].s = ISS_ON;
+      }
+
       ccd->defineSwitch(&StreamSP);
       ccd->defineNumber(&StreamOptionsNP);
+      ccd->defineSwitch(&EncodingSP);
+      ccd->defineNumber(&QualityNP);
+      if (ccd->HasBayer())
+          ccd->defineSwitch(&DebayerSP);
+      if (encoded_source)
+          ccd->defineSwitch(&PassthroughSP);
       ccd->defineNumber(&FpsNP);
+      ccd->defineSwitch(&AdaptiveSP);
+      ccd->defineNumber(&BudgetNP);
+      ccd->defineNumber(&StreamStatsNP);
       //ccd->defineNumber(&FramestoDropNP);
       ccd->defineSwitch(&RecordStreamSP);
       ccd->defineText(&RecordFileTP);
       ccd->defineNumber(&RecordOptionsNP);
+      ccd->defineNumber(&PretriggerNP);
+      ccd->defineSwitch(&TriggerSP);
 
     }
     else
     {
       ccd->deleteProperty(StreamSP.name);
       ccd->deleteProperty(StreamOptionsNP.name);
+      ccd->deleteProperty(EncodingSP.name);
+      ccd->deleteProperty(QualityNP.name);
+      if (ccd->HasBayer())
+          ccd->deleteProperty(DebayerSP.name);
+      if (encoded_source)
+          ccd->deleteProperty(PassthroughSP.name);
       ccd->deleteProperty(FpsNP.name);
+      ccd->deleteProperty(AdaptiveSP.name);
+      ccd->deleteProperty(BudgetNP.name);
+      ccd->deleteProperty(StreamStatsNP.name);
       //ccd->deleteProperty(FramestoDropNP.name);
       ccd->deleteProperty(RecordFileTP.name);
       ccd->deleteProperty(RecordStreamSP.name);
       ccd->deleteProperty(RecordOptionsNP.name);
+      ccd->deleteProperty(PretriggerNP.name);
+      ccd->deleteProperty(TriggerSP.name);
 
       return true;
     }
     return true;
 }
 
-void StreamRecorder::newFrame(unsigned char *buffer)
+void StreamRecorder::newFrame(unsigned char *buffer, unsigned char *encoded, uint32_t encodedSize, const struct timeval *captured)
 {
     double ms1, ms2, deltams;
+    struct timeval now;
 
     // Measure FPS
     getitimer(ITIMER_REAL, &tframe2);
@@ -189,46 +333,373 @@ void StreamRecorder::newFrame(unsigned char *buffer)
 
     IDSetNumber(&FpsNP, NULL);    
 
+    if (captured == NULL)
+    {
+      gettimeofday(&now, NULL);
+      captured = &now;
+    }
+
+    /* add the tables MJPEG frames leave out, once for the stream and the record */
+    if (encoded != NULL && encoded_source)
+    {
+      encodedSize = completeJPEG(encoded, encodedSize);
+      encoded = encodedSize > 0 ? jpegFrame : NULL;
+    }
+    else
+      encoded = NULL;
+
     if (StreamSP.s == IPS_BUSY)
     {
       streamframeCount++;
-      if (streamframeCount >= StreamOptionsN[0].value)
+      if (streamframeCount >= streamDivisor())
       {
-        uploadStream(buffer);
+        if (encoded != NULL && PassthroughS[PASSTHROUGH_STREAM].s == ISS_ON)
+          uploadEncodedStream(encoded, encodedSize);
+        else if (buffer != NULL)
+          uploadStream(buffer);
         streamframeCount = 0;
       }
+      updateStreamStats();
     }
 
     if (RecordStreamSP.s == IPS_BUSY)
     {
-      recordStream(deltams, buffer);
+      recordStream(deltams, buffer, encoded, encodedSize, captured);
+    }
+    else if (pretriggerBuffer != NULL)
+    {
+      bufferFrame(deltams, buffer, encoded, encodedSize, captured);
+    }
+}
+
+bool StreamRecorder::needsDecodedFrame()
+{
+    if (!encoded_source)
+        return true;
+
+    /* a frame skipped by the rate divisor needs no pixels either */
+    if (StreamSP.s == IPS_BUSY && PassthroughS[PASSTHROUGH_STREAM].s != ISS_ON &&
+        streamframeCount + 1 >= streamDivisor())
+        return true;
+
+    if (RecordStreamSP.s == IPS_BUSY && !encoded_record)
+        return true;
+
+    if (RecordStreamSP.s != IPS_BUSY && pretriggerBuffer != NULL && PassthroughS[PASSTHROUGH_RECORD].s != ISS_ON)
+        return true;
+
+    return false;
+}
+
+/* copy a camera JPEG frame to jpegFrame, with the standard Huffman tables if it has none */
+uint32_t StreamRecorder::completeJPEG(uint8_t *encoded, uint32_t size)
+{
+    int len;
+
+    if (jpegFrameSize < size + MJPEG_DHT_SIZE)
+    {
+        jpegFrameSize = size + MJPEG_DHT_SIZE;
+        jpegFrame = (uint8_t *) realloc(jpegFrame, jpegFrameSize);
+    }
+
+    len = mjpeg_to_jpeg(encoded, size, jpegFrame);
+    if (len < 0)
+    {
+        DEBUG(INDI::Logger::DBG_DEBUG, "Dropping a frame which is not a JPEG image.");
+        return 0;
+    }
+
+    return len;
+}
+
+/* (re)allocate the pre-trigger ring to the memory budget, or free it when it is off */
+bool StreamRecorder::setupPretrigger()
+{
+    size_t size = (size_t) PretriggerN[PRETRIGGER_MEMORY].value * 1024 * 1024;
+    bool enabled = PretriggerN[PRETRIGGER_FRAMES].value > 0 || PretriggerN[PRETRIGGER_DURATION].value > 0;
+
+    /* a record still catching up gets the rest of its frames before the ring goes */
+    if (pretriggerPending && !drainPretrigger(pretriggerFrames.size()))
+        recordFailed();
+    clearPretrigger();
+    if (!enabled || size != pretriggerSize)
+    {
+        free(pretriggerBuffer);
+        pretriggerBuffer = NULL;
+        pretriggerSize = 0;
+    }
+    if (!enabled || pretriggerBuffer != NULL)
+        return true;
+
+    pretriggerBuffer = (uint8_t *) malloc(size);
+    if (pretriggerBuffer == NULL)
+    {
+        DEBUGF(INDI::Logger::DBG_ERROR, "Can not allocate %g MB for the pre-trigger frames.", PretriggerN[PRETRIGGER_MEMORY].value);
+        return false;
     }
+    pretriggerSize = size;
+    return true;
+}
+
+/* copy a frame to the pre-trigger ring, dropping the oldest ones it overwrites or which are over the limits */
+void StreamRecorder::bufferFrame(double deltams, uint8_t *buffer, uint8_t *encoded, uint32_t encodedSize, const struct timeval *captured)
+{
+    bool asEncoded = encoded_source && encoded_recorder != NULL && PassthroughS[PASSTHROUGH_RECORD].s == ISS_ON;
+    uint8_t *frame = asEncoded ? encoded : buffer;
+    uint32_t size = asEncoded ? encodedSize : ccd->PrimaryCCD.getFrameBufferSize();
+    double maxFrames = PretriggerN[PRETRIGGER_FRAMES].value;
+    double maxDuration = PretriggerN[PRETRIGGER_DURATION].value * 1000.0;
+    PretriggerFrame f;
+
+    /* direct records take the camera frames from the driver */
+    if (frame == NULL || size == 0 || size > pretriggerSize || (!asEncoded && direct_record))
+        return;
+
+    /* the passthrough switch changed what a record would be made of */
+    if (!pretriggerFrames.empty() && pretriggerFrames.back().encoded != asEncoded)
+        clearPretrigger();
+
+    reservePretrigger(size);
+
+    memcpy(pretriggerBuffer + pretriggerWrite, frame, size);
+    f.offset = pretriggerWrite;
+    f.size = size;
+    f.deltams = deltams;
+    f.captured = *captured;
+    f.encoded = asEncoded;
+    f.live = false;
+    pretriggerFrames.push_back(f);
+    pretriggerWrite += size;
+    pretriggerDuration += deltams;
+
+    while ((maxFrames > 0 && pretriggerFrames.size() > maxFrames) ||
+           (maxDuration > 0 && pretriggerFrames.size() > 1 && pretriggerDuration > maxDuration))
+        dropPretriggerFrame();
+}
+
+/* make size bytes free at the write position, the tail too short for them is skipped */
+bool StreamRecorder::reservePretrigger(uint32_t size)
+{
+    if (pretriggerWrite + size > pretriggerSize)
+    {
+        while (!pretriggerFrames.empty() && pretriggerFrames.front().offset >= pretriggerWrite)
+            if (!releasePretriggerFrame())
+                return false;
+        pretriggerWrite = 0;
+    }
+    while (!pretriggerFrames.empty() && pretriggerFrames.front().offset >= pretriggerWrite &&
+           pretriggerFrames.front().offset < pretriggerWrite + size)
+        if (!releasePretriggerFrame())
+            return false;
+    return true;
+}
+
+/* the oldest frame leaves the ring, to the record while it catches up, dropped otherwise */
+bool StreamRecorder::releasePretriggerFrame()
+{
+    if (pretriggerPending)
+        return writePretriggerFrame();
+    dropPretriggerFrame();
+    return true;
+}
+
+void StreamRecorder::dropPretriggerFrame()
+{
+    pretriggerDuration -= pretriggerFrames.front().deltams;
+    pretriggerFrames.pop_front();
+}
+
+/* the ring goes to the record just opened, a few frames with each new frame so the start does not stall the capture */
+void StreamRecorder::startPretrigger()
+{
+    size_t count = 0;
+
+    for (std::deque<PretriggerFrame>::iterator it = pretriggerFrames.begin(); it != pretriggerFrames.end(); ++it)
+        if (it->encoded == encoded_record)
+            count++;
+
+    if (count == 0)
+    {
+        clearPretrigger();
+        return;
+    }
+
+    pretriggerPending = true;
+    DEBUGF(INDI::Logger::DBG_SESSION, "Recording %d pre-trigger frames.", (int) count);
+}
+
+/* a new frame of the record waits behind the pre-trigger frames, older frames are written to make room */
+bool StreamRecorder::queueRecordFrame(uint8_t *frame, uint32_t size, double deltams, const struct timeval *captured)
+{
+    PretriggerFrame f;
+
+    if (size > pretriggerSize)
+        return drainPretrigger(pretriggerFrames.size()) && writeRecordFrame(frame, size, captured);
+
+    if (!reservePretrigger(size))
+        return false;
+
+    memcpy(pretriggerBuffer + pretriggerWrite, frame, size);
+    f.offset = pretriggerWrite;
+    f.size = size;
+    f.deltams = deltams;
+    f.captured = *captured;
+    f.encoded = encoded_record;
+    f.live = true;
+    pretriggerFrames.push_back(f);
+    pretriggerWrite += size;
+    pretriggerDuration += deltams;
+    return true;
+}
+
+/* write the oldest frame of the ring to the record, frames captured before the start are outside of its Duration and Frames */
+bool StreamRecorder::writePretriggerFrame()
+{
+    PretriggerFrame f = pretriggerFrames.front();
+
+    dropPretriggerFrame();
+    if (f.encoded != encoded_record)
+        return true;
+    if (!writeRecordFrame(pretriggerBuffer + f.offset, f.size, &f.captured))
+        return false;
+    if (f.live)
+        countRecordFrame(f.deltams);
+    return true;
+}
+
+bool StreamRecorder::drainPretrigger(size_t count)
+{
+    while (pretriggerPending && count-- > 0 && !pretriggerFrames.empty())
+        if (!writePretriggerFrame())
+            return false;
+
+    if (pretriggerFrames.empty())
+        clearPretrigger();
+    return true;
+}
+
+void StreamRecorder::clearPretrigger()
+{
+    pretriggerPending = false;
+    pretriggerFrames.clear();
+    pretriggerWrite = 0;
+    pretriggerDuration = 0;
 }
 
 void StreamRecorder::setRecorderSize(uint16_t width, uint16_t height)
 {
+    clearPretrigger();
     recorder->setsize(width, height);
 }
 
 bool StreamRecorder::close()
 {
+    if (encoded_recorder)
+        encoded_recorder->close();
     return recorder->close();
 }
 
 bool StreamRecorder::setPixelFormat(uint32_t format)
 {
+    bool encoded = (format == V4L2_PIX_FMT_JPEG || format == V4L2_PIX_FMT_MJPEG);
+
+    clearPretrigger();
     direct_record = recorder->setpixelformat(format);
+
+    /* passthrough is only offered for compressed formats */
+    if (encoded != encoded_source)
+    {
+        encoded_source = encoded;
+        if (ccd->isConnected())
+        {
+            if (encoded_source)
+                ccd->defineSwitch(&PassthroughSP);
+            else
+                ccd->deleteProperty(PassthroughSP.name);
+        }
+    }
+    return true;
+}
+
+/* demosaic a raw frame of a Bayer CCD to a BGR32 colour preview, as colour V4L2 streams */
+bool StreamRecorder::debayerStream(uint8_t *buffer)
+{
+    int method = IUFindOnSwitchIndex(&DebayerSP);
+    int binX = ccd->PrimaryCCD.getBinX(), binY = ccd->PrimaryCCD.getBinY();
+    int w = ccd->PrimaryCCD.getSubW(), h = ccd->PrimaryCCD.getSubH();
+    int bpp = ccd->PrimaryCCD.getBPP();
+    int cfa, cw, ch;
+    uint8_t *raw = buffer;
+
+    if (method == DEBAYER_OFF || method < 0 || !ccd->HasBayer() || ccd->PrimaryCCD.getNAxis() != 2)
+        return false;
+
+    /* 2x2 binning of a Bayer frame is its superpixel image */
+    if (binX == 1 && binY == 1)
+        method = (method == DEBAYER_EDGE) ? CCVT_DEMOSAIC_EDGE : CCVT_DEMOSAIC_BILINEAR;
+    else if (binX == 2 && binY == 2)
+        method = CCVT_DEMOSAIC_SUPERPIXEL;
+    else
+        return false;
+
+    cfa = ccvt_cfa_parse(ccd->BayerT[2].text);
+    if (cfa < 0)
+        return false;
+    cfa = ccvt_cfa_offset(cfa, atoi(ccd->BayerT[0].text), atoi(ccd->BayerT[1].text));
+
+    cw = (method == CCVT_DEMOSAIC_SUPERPIXEL) ? w / 2 : w;
+    ch = (method == CCVT_DEMOSAIC_SUPERPIXEL) ? h / 2 : h;
+    if (colorFrameSize != (uint32_t)(cw * ch * 4))
+    {
+        colorFrameSize = cw * ch * 4;
+        colorFrame = (uint8_t *) realloc(colorFrame, colorFrameSize);
+    }
+    colorWidth = cw;
+    colorHeight = ch;
+
+    /* the stream carries 8 bits channels */
+    if (bpp > 8)
+    {
+        uint16_t *src = (uint16_t *) buffer;
+        int shift = (bpp > 16 ? 16 : bpp) - 8;
+        rawFrame8 = (uint8_t *) realloc(rawFrame8, w * h);
+        for (int i = 0; i < w * h; i++)
+            rawFrame8[i] = src[i] >> shift;
+        raw = rawFrame8;
+    }
+
+    ccvt_demosaic8(w, h, raw, w, cfa, method, colorFrame, cw * 4, CCVT_BGR32);
     return true;
 }
 
 bool StreamRecorder::uploadStream(uint8_t *buffer)
 {
-    int ret=0;
-    uLongf compressedBytes = 0;
     uLong totalBytes = ccd->PrimaryCCD.getFrameBufferSize() / (ccd->PrimaryCCD.getBinX()*ccd->PrimaryCCD.getBinY());
+    const uint8_t *frame = NULL;
+    uint32_t width = ccd->PrimaryCCD.getSubW() / ccd->PrimaryCCD.getBinX();
+    uint32_t height = ccd->PrimaryCCD.getSubH() / ccd->PrimaryCCD.getBinY();
+    int components = (ccd->PrimaryCCD.getNAxis() == 2) ? 1 : 4;
+    int encoding = streamEncoding();
+
+    /* the encoder is still busy with an earlier frame, drop this one */
+    if (encoding != ENCODE_RAW && encoder_busy)
+    {
+        droppedFrames++;
+        return true;
+    }
 
-    //if (ccd->PrimaryCCD.getNAxis() == 2)
-        memcpy(ccd->PrimaryCCD.getFrameBuffer(), buffer, ccd->PrimaryCCD.getFrameBufferSize());
+    if (debayerStream(buffer))
+    {
+        frame = colorFrame;
+        totalBytes = colorFrameSize;
+        width = colorWidth;
+        height = colorHeight;
+        components = 4;
+    }
+    else
+    {
+        // The chip reads the driver frame in place, binning writes to its own buffer
+        ccd->PrimaryCCD.attachFrameBuffer(buffer);
     /*else
     {
       uint8_t *src, *dest;
@@ -247,52 +718,408 @@ bool StreamRecorder::uploadStream(uint8_t *buffer)
      }
    }*/
 
-    ccd->PrimaryCCD.binFrame();
+        ccd->PrimaryCCD.binFrame();
+        frame = ccd->PrimaryCCD.getFrameData();
+    }
 
-    /* Do we want to compress ? */
-     if (ccd->PrimaryCCD.isCompressed())
-     {
-        /* Compress frame */
-        compressedFrame = (uint8_t *) realloc (compressedFrame, sizeof(uint8_t) * totalBytes + totalBytes / 64 + 16 + 3);
-        compressedBytes = sizeof(uint8_t) * totalBytes + totalBytes / 64 + 16 + 3;
+    /* zlib and JPEG are sent by encodedStreamReady() once the encoder thread is done */
+    if (encoding != ENCODE_RAW && queueEncoding(frame, totalBytes, width, height, components, frame == colorFrame ? 8 : ccd->PrimaryCCD.getBPP()))
+    {
+        ccd->PrimaryCCD.releaseFrameBuffer();
+        return true;
+    }
 
-        ret = compress2(compressedFrame, &compressedBytes, ccd->PrimaryCCD.getFrameBuffer(), totalBytes, 4);
-        if (ret != Z_OK)
+    /* Send it uncompressed */
+    imageB->blob = (void *) frame;
+    imageB->bloblen = totalBytes;
+    imageB->size = totalBytes;
+    strcpy(imageB->format, ".stream");
+
+    sendStream(totalBytes);
+    ccd->PrimaryCCD.releaseFrameBuffer();
+    return true;
+}
+
+/* hand a copy of the frame to the encoder thread, false if it can not run */
+bool StreamRecorder::queueEncoding(const uint8_t *frame, uint32_t size, uint32_t width, uint32_t height, int components, int bpp)
+{
+    if (!startEncoder())
+        return false;
+
+    if (encodeFrameSize < size)
+    {
+        encodeFrameSize = size;
+        encodeFrame = (uint8_t *) realloc(encodeFrame, encodeFrameSize);
+    }
+    memcpy(encodeFrame, frame, size);
+
+    pthread_mutex_lock(&encoderLock);
+    encodeBytes = size;
+    encodeWidth = width;
+    encodeHeight = height;
+    encodeComponents = components;
+    encodeBpp = bpp;
+    encodeQuality = (AdaptiveS[0].s == ISS_ON) ? adaptiveQuality : QualityN[0].value;
+    encodeMethod = streamEncoding();
+    /* JPEG carries 8 bits grey or colour, other frames are sent zlib compressed */
+    if (encodeMethod == ENCODE_JPEG && !(bpp == 8 || (bpp == 16 && components == 1)))
+        encodeMethod = ENCODE_ZLIB;
+    encoder_queued = true;
+    encoder_busy = true;
+    pthread_cond_signal(&encoderCond);
+    pthread_mutex_unlock(&encoderLock);
+
+    return true;
+}
+
+/* compress the queued frame to encodedStream, on the encoder thread */
+bool StreamRecorder::encodeStream()
+{
+    const uint8_t *image = encodeFrame;
+    uint32_t bound;
+    int len;
+
+    if (encodeMethod == ENCODE_ZLIB)
+    {
+        uLongf compressedBytes = encodeBytes + encodeBytes / 64 + 16 + 3;
+
+        if (encodedStreamSize < compressedBytes)
         {
-             /* this should NEVER happen */
-             DEBUGF( INDI::Logger::DBG_ERROR, "internal error - compression failed: %d", ret);
-             return false;
-         }
-
-        /* #3.A Send it compressed */
-        imageB->blob = compressedFrame;
-        imageB->bloblen = compressedBytes;
-        imageB->size = totalBytes;
-        strcpy(imageB->format, ".stream.z");
-      }
-      else
-      {
-        /* #3.B Send it uncompressed */
-         imageB->blob = ccd->PrimaryCCD.getFrameBuffer();
-         imageB->bloblen = totalBytes;
-         imageB->size = totalBytes;
-         strcpy(imageB->format, ".stream");
-      }
+            encodedStreamSize = compressedBytes;
+            encodedStream = (uint8_t *) realloc(encodedStream, encodedStreamSize);
+        }
+        if (compress2(encodedStream, &compressedBytes, encodeFrame, encodeBytes, 4) != Z_OK)
+            return false;
+        encodedStreamBytes = compressedBytes;
+        return true;
+    }
+
+    if (encodeBpp == 16)
+        image = stretchPreview((uint16_t *) encodeFrame, encodeWidth * encodeHeight);
+
+    bound = encode_jpeg_bound(encodeWidth, encodeHeight);
+    if (encodedStreamSize < bound)
+    {
+        encodedStreamSize = bound;
+        encodedStream = (uint8_t *) realloc(encodedStream, encodedStreamSize);
+    }
 
+    len = encode_jpeg_image(encodedStream, bound, encodeQuality, encodeWidth, encodeHeight, encodeComponents,
+                            image, encodeWidth * encodeComponents);
+    if (len < 0)
+        return false;
+    encodedStreamBytes = len;
+    return true;
+}
+
+/* map a 16 bits frame to 8 bits for the preview, linearly between its 0.1% and 99.9% levels */
+const uint8_t *StreamRecorder::stretchPreview(const uint16_t *frame, uint32_t pixels)
+{
+    uint32_t clip = pixels / 1000, sum, lo, hi;
+
+    if (stretchHistogram == NULL)
+    {
+        stretchHistogram = (uint32_t *) malloc(65536 * sizeof(uint32_t));
+        stretchLUT = (uint8_t *) malloc(65536);
+    }
+    if (previewFrameSize < pixels)
+    {
+        previewFrameSize = pixels;
+        previewFrame = (uint8_t *) realloc(previewFrame, previewFrameSize);
+    }
+
+    memset(stretchHistogram, 0, 65536 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < pixels; i++)
+        stretchHistogram[frame[i]]++;
+
+    for (lo = 0, sum = 0; lo < 65535 && sum + stretchHistogram[lo] <= clip; lo++)
+        sum += stretchHistogram[lo];
+    for (hi = 65535, sum = 0; hi > lo && sum + stretchHistogram[hi] <= clip; hi--)
+        sum += stretchHistogram[hi];
+    if (hi <= lo)
+        hi = lo + 1;
+
+    for (uint32_t v = 0; v < 65536; v++)
+        stretchLUT[v] = (v <= lo) ? 0 : (v >= hi) ? 255 : ((v - lo) * 255 + (hi - lo) / 2) / (hi - lo);
+
+    for (uint32_t i = 0; i < pixels; i++)
+        previewFrame[i] = stretchLUT[frame[i]];
+
+    return previewFrame;
+}
+
+bool StreamRecorder::startEncoder()
+{
+    if (encoder_running)
+        return true;
+
+    if (pipe(encoderPipe) < 0)
+    {
+        DEBUGF(INDI::Logger::DBG_ERROR, "Can not create the stream encoder pipe: %s", strerror(errno));
+        return false;
+    }
+
+    encoder_quit = false;
+    encoder_queued = false;
+    if (pthread_create(&encoder, NULL, encoderThread, this) != 0)
+    {
+        DEBUG(INDI::Logger::DBG_ERROR, "Can not start the stream encoder thread, sending raw frames.");
+        ::close(encoderPipe[0]);
+        ::close(encoderPipe[1]);
+        return false;
+    }
+
+    encoderCallback = IEAddCallback(encoderPipe[0], encodedStreamReady, this);
+    encoder_running = true;
+    return true;
+}
+
+void StreamRecorder::stopEncoder()
+{
+    if (!encoder_running)
+        return;
+
+    pthread_mutex_lock(&encoderLock);
+    encoder_quit = true;
+    pthread_cond_signal(&encoderCond);
+    pthread_mutex_unlock(&encoderLock);
+    pthread_join(encoder, NULL);
+
+    IERmCallback(encoderCallback);
+    ::close(encoderPipe[0]);
+    ::close(encoderPipe[1]);
+    encoder_running = false;
+    encoder_busy = false;
+}
+
+void *StreamRecorder::encoderThread(void *arg)
+{
+    StreamRecorder *sr = (StreamRecorder *) arg;
+    char done = 0;
+
+    pthread_mutex_lock(&sr->encoderLock);
+    while (true)
+    {
+        while (!sr->encoder_queued && !sr->encoder_quit)
+            pthread_cond_wait(&sr->encoderCond, &sr->encoderLock);
+        if (sr->encoder_quit)
+            break;
+
+        pthread_mutex_unlock(&sr->encoderLock);
+        bool ok = sr->encodeStream();
+        pthread_mutex_lock(&sr->encoderLock);
+
+        sr->encodeOK = ok;
+        sr->encoder_queued = false;
+        /* BLOBs are sent from the event loop, which is not thread safe */
+        if (write(sr->encoderPipe[1], &done, 1) != 1)
+            sr->encodeOK = false;
+    }
+    pthread_mutex_unlock(&sr->encoderLock);
+
+    return NULL;
+}
+
+/* event loop callback of the encoder pipe, sends the encoded frame */
+void StreamRecorder::encodedStreamReady(int fd, void *arg)
+{
+    StreamRecorder *sr = (StreamRecorder *) arg;
+    char done;
+    bool ok;
+
+    if (read(fd, &done, 1) != 1)
+        return;
+
+    pthread_mutex_lock(&sr->encoderLock);
+    ok = sr->encodeOK;
+    pthread_mutex_unlock(&sr->encoderLock);
+
+    if (!ok)
+        DEBUGDEVICE(sr->getDeviceName(), INDI::Logger::DBG_WARNING, "Failed to encode a stream frame.");
+    else if (sr->StreamSP.s == IPS_BUSY)
+    {
+        sr->imageB->blob = sr->encodedStream;
+        sr->imageB->bloblen = sr->encodedStreamBytes;
+        if (sr->encodeMethod == ENCODE_ZLIB)
+        {
+            sr->imageB->size = sr->encodeBytes;
+            strcpy(sr->imageB->format, ".stream.z");
+        }
+        else
+        {
+            sr->imageB->size = sr->encodedStreamBytes;
+            strcpy(sr->imageB->format, ".jpg");
+        }
+
+        sr->sendStream(sr->encodeBytes);
+    }
+
+    sr->encoder_busy = false;
+}
+
+/* send the camera JPEG frame itself, much smaller than the decoded pixels */
+bool StreamRecorder::uploadEncodedStream(uint8_t *jpeg, uint32_t size)
+{
+    imageB->blob = jpeg;
+    imageB->bloblen = size;
+    imageB->size = size;
+    strcpy(imageB->format, ".jpg");
+
+    sendStream(size);
+    return true;
+}
+
+/* send the stream BLOB, IDSetBLOB returns once indiserver took all of it */
+void StreamRecorder::sendStream(uint32_t rawBytes)
+{
+    struct timeval start, end;
+
+    gettimeofday(&start, NULL);
     imageBP->s = IPS_OK;
     IDSetBLOB (imageBP, NULL);
-    return true;
+    gettimeofday(&end, NULL);
+
+    statsSendMs += (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0;
+    statsBytes += imageB->bloblen;
+    statsRawBytes += rawBytes;
+    statsFrames++;
+}
+
+/* publish what the stream sent over the last second, and adapt to it */
+void StreamRecorder::updateStreamStats()
+{
+    struct timeval now;
+    double ms, mbps, rawMbps, sendms;
+
+    gettimeofday(&now, NULL);
+    ms = (now.tv_sec - statsStart.tv_sec) * 1000.0 + (now.tv_usec - statsStart.tv_usec) / 1000.0;
+    /* heavily decimated streams send less than a frame per second, wait for one */
+    if (ms < 1000.0 || (statsFrames == 0 && ms < 10000.0))
+        return;
+
+    mbps = statsBytes * 8.0 / (ms * 1000.0);
+    rawMbps = statsRawBytes * 8.0 / (ms * 1000.0);
+    sendms = statsFrames > 0 ? statsSendMs / statsFrames : 0;
+
+    if (AdaptiveS[0].s == ISS_ON)
+        adaptStream(mbps, rawMbps, sendms);
+
+    StreamStatsN[STATS_FPS].value = statsFrames * 1000.0 / ms;
+    StreamStatsN[STATS_BITRATE].value = mbps;
+    StreamStatsN[STATS_SEND_TIME].value = sendms;
+    StreamStatsN[STATS_DIVISOR].value = streamDivisor();
+    StreamStatsN[STATS_QUALITY].value = (AdaptiveS[0].s == ISS_ON) ? adaptiveQuality : QualityN[0].value;
+    StreamStatsNP.s = IPS_OK;
+    if (AdaptiveS[0].s == ISS_ON && (mbps > BudgetN[BUDGET_BITRATE].value || sendms > BudgetN[BUDGET_LATENCY].value))
+        StreamStatsNP.s = IPS_BUSY;
+    IDSetNumber(&StreamStatsNP, NULL);
+
+    statsStart = now;
+    statsSendMs = 0;
+    statsBytes = statsRawBytes = 0;
+    statsFrames = 0;
+}
+
+/*
+ * Over budget, compress raw frames, then lower the JPEG quality, then send fewer frames, in
+ * proportion to the excess. Well under budget, the same steps are undone in reverse order.
+ */
+void StreamRecorder::adaptStream(double mbps, double rawMbps, double sendms)
+{
+    double bitrate = BudgetN[BUDGET_BITRATE].value, latency = BudgetN[BUDGET_LATENCY].value;
+    double excess = std::max(mbps / bitrate, sendms / latency);
+    int encoding = streamEncoding();
+    int divisor = std::max(adaptiveDivisor, 1);
+
+    if (excess > 1.0)
+    {
+        if (encoding == ENCODE_RAW)
+            adaptiveCompress = true;
+        else if (encoding == ENCODE_JPEG && adaptiveQuality > 30)
+            adaptiveQuality = std::max(adaptiveQuality - 10, 30);
+        else
+            adaptiveDivisor = std::max((int) ceil(divisor * excess * 1.1), divisor + 1);
+    }
+    else if (excess < 0.6)
+    {
+        if (adaptiveDivisor > StreamOptionsN[0].value)
+            adaptiveDivisor = std::max((int) floor(divisor * std::max(excess, 0.5)), (int) StreamOptionsN[0].value);
+        else if (encoding == ENCODE_JPEG && adaptiveQuality < QualityN[0].value)
+            adaptiveQuality = std::min(adaptiveQuality + 5, (int) QualityN[0].value);
+        else if (adaptiveCompress && rawMbps < bitrate * 0.6 && sendms < latency * 0.3)
+            adaptiveCompress = false;
+    }
+}
+
+/* start from the client settings */
+void StreamRecorder::resetAdaptive()
+{
+    adaptiveDivisor = StreamOptionsN[0].value;
+    adaptiveQuality = QualityN[0].value;
+    adaptiveCompress = false;
+
+    gettimeofday(&statsStart, NULL);
+    statsSendMs = 0;
+    statsBytes = statsRawBytes = 0;
+    statsFrames = 0;
+}
+
+/* frames counted per frame streamed */
+int StreamRecorder::streamDivisor()
+{
+    if (AdaptiveS[0].s == ISS_ON)
+        return adaptiveDivisor;
+    return StreamOptionsN[0].value;
+}
+
+int StreamRecorder::streamEncoding()
+{
+    int encoding = IUFindOnSwitchIndex(&EncodingSP);
+
+    if (encoding == ENCODE_RAW && AdaptiveS[0].s == ISS_ON && adaptiveCompress)
+        return ENCODE_ZLIB;
+    return encoding;
 }
 
-void StreamRecorder::recordStream(double deltams, unsigned char *buffer)
+void StreamRecorder::recordStream(double deltams, unsigned char *buffer, unsigned char *encoded, uint32_t encodedSize,
+                                  const struct timeval *captured)
 {
   if (!is_recording)
       return;
 
-  if (ccd->PrimaryCCD.getNAxis() == 2)
-    recorder->writeFrameMono(buffer);
-  else
-    recorder->writeFrameColor(buffer);
+  if (encoded_record ? encoded == NULL : buffer == NULL)
+    return;
+
+  if (pretriggerPending)
+  {
+    uint32_t size = encoded_record ? encodedSize : ccd->PrimaryCCD.getFrameBufferSize();
+    struct timeval now;
+
+    if (captured == NULL)
+    {
+      gettimeofday(&now, NULL);
+      captured = &now;
+    }
+    if (!queueRecordFrame(encoded_record ? encoded : buffer, size, deltams, captured) ||
+        !drainPretrigger(PRETRIGGER_FLUSH_FRAMES))
+      recordFailed();
+    return;
+  }
+
+  if (!writeRecordFrame(encoded_record ? encoded : buffer, encodedSize, captured))
+  {
+    recordFailed();
+    return;
+  }
+
+  countRecordFrame(deltams);
+}
+
+/* account a frame written to the record and end it at the Duration or Frames limit */
+void StreamRecorder::countRecordFrame(double deltams)
+{
+  if (!is_recording)
+      return;
 
   recordDuration+=deltams;
   recordframeCount+=1;
@@ -300,6 +1127,8 @@ void StreamRecorder::recordStream(double deltams, unsigned char *buffer)
   if ((RecordStreamSP.sp[1].s == ISS_ON) && (recordDuration >= (RecordOptionsNP.np[0].value * 1000.0)))
   {
         DEBUGF(INDI::Logger::DBG_SESSION,"Ending record after %g millisecs", recordDuration);
+        /* the frames still in the ring are past the limit */
+        clearPretrigger();
         stopRecording();
         RecordStreamSP.sp[1].s = ISS_OFF; RecordStreamSP.sp[3].s = ISS_ON; RecordStreamSP.s = IPS_IDLE;
         IDSetSwitch(&RecordStreamSP, NULL);
@@ -308,6 +1137,8 @@ void StreamRecorder::recordStream(double deltams, unsigned char *buffer)
   if ((RecordStreamSP.sp[2].s == ISS_ON) && (recordframeCount >= (RecordOptionsNP.np[1].value)))
   {
         DEBUGF(INDI::Logger::DBG_SESSION,"Ending record after %d frames", recordframeCount);
+        /* the frames still in the ring are past the limit */
+        clearPretrigger();
         stopRecording();
         RecordStreamSP.sp[2].s = ISS_OFF; RecordStreamSP.sp[3].s = ISS_ON; RecordStreamSP.s = IPS_IDLE;
         IDSetSwitch(&RecordStreamSP, NULL);
@@ -388,9 +1219,16 @@ bool StreamRecorder::startRecording()
   std::string filename, expfilename, expfiledir;
   std::string filtername;
   std::map<std::string, std::string> patterns;
+  V4L2_Recorder *r;
+  const char *ext;
   if (is_recording)
       return true;
 
+  /* compressed frames go as they come to their own file */
+  encoded_record = encoded_source && encoded_recorder != NULL && PassthroughS[PASSTHROUGH_RECORD].s == ISS_ON;
+  r = encoded_record ? encoded_recorder : recorder;
+  ext = encoded_record ? ".mjpeg" : ".ser";
+
   /* get filter name for pattern substitution */
   if (ccd->CurrentFilterSlot != -1 && ccd->CurrentFilterSlot <= ccd->FilterNames.size())
   {
@@ -405,8 +1243,10 @@ bool StreamRecorder::startRecording()
     expfiledir+='/';
   recordfilename.assign(RecordFileTP.tp[1].text);
   expfilename=expand(recordfilename, patterns);
-  if (expfilename.substr(expfilename.size() - 4, 4) != ".ser")
-    expfilename+=".ser";
+  if (encoded_record && expfilename.size() >= 4 && expfilename.substr(expfilename.size() - 4, 4) == ".ser")
+    expfilename.erase(expfilename.size() - 4);
+  if (expfilename.size() < strlen(ext) || expfilename.substr(expfilename.size() - strlen(ext)) != ext)
+    expfilename+=ext;
   filename=expfiledir+expfilename;
   //DEBUGF(INDI::Logger::DBG_SESSION, "Expanded file is %s", filename.c_str());
   //filename=recordfiledir+recordfilename;
@@ -417,7 +1257,7 @@ bool StreamRecorder::startRecording()
     DEBUGF(INDI::Logger::DBG_WARNING, "Can not create record directory %s: %s", expfiledir.c_str(), strerror(errno));
     return false;
   }
-  if (!recorder->open(filename.c_str(), errmsg))
+  if (!r->open(filename.c_str(), errmsg))
   {
     RecordStreamSP.s = IPS_ALERT;
     IDSetSwitch(&RecordStreamSP, NULL);
@@ -425,7 +1265,11 @@ bool StreamRecorder::startRecording()
     return false;
   }
   /* start capture */
-  if (direct_record)
+  if (encoded_record)
+  {
+    DEBUGF(INDI::Logger::DBG_SESSION, "Recording camera frames as-is (%s).", r->getName());
+  }
+  else if (direct_record)
   {
     DEBUG(INDI::Logger::DBG_SESSION, "Using direct recording (no software cropping).");
     //v4l_base->doDecode(false);
@@ -439,6 +1283,8 @@ bool StreamRecorder::startRecording()
     else
       recorder->setDefaultColor();
   }
+  /* the frames before the start, written ahead of the new ones */
+  startPretrigger();
   recordDuration=0.0;
   recordframeCount=0;
 
@@ -456,6 +1302,36 @@ bool StreamRecorder::startRecording()
   return true;
 }
 
+/* write one frame to the open record, false when the recorder could not take it */
+bool StreamRecorder::writeRecordFrame(uint8_t *frame, uint32_t size, const struct timeval *captured)
+{
+  if (encoded_record)
+  {
+    if (captured != NULL)
+      encoded_recorder->setFrameTime(captured);
+    return encoded_recorder->writeFrameEncoded(frame, size);
+  }
+
+  if (captured != NULL)
+    recorder->setFrameTime(captured);
+  if (ccd->PrimaryCCD.getNAxis() == 2)
+    return recorder->writeFrameMono(frame);
+  else
+    return recorder->writeFrameColor(frame);
+}
+
+/* the record can not continue, usually a full or failing disk */
+void StreamRecorder::recordFailed()
+{
+  clearPretrigger();
+  stopRecording();
+  IUResetSwitch(&RecordStreamSP);
+  RecordStreamS[RECORD_OFF].s = ISS_ON;
+  RecordStreamSP.s = IPS_ALERT;
+  IDSetSwitch(&RecordStreamSP, NULL);
+  DEBUG(INDI::Logger::DBG_ERROR, "Recording stopped, the record file can not be written.");
+}
+
 bool StreamRecorder::stopRecording()
 {
   if (!is_recording) return true;
@@ -463,7 +1339,14 @@ bool StreamRecorder::stopRecording()
       ccd->StopStreaming();
 
   is_recording=false;
-  recorder->close();
+  /* frames captured before the stop are still waiting in the ring */
+  if (pretriggerPending && !drainPretrigger(pretriggerFrames.size()))
+    DEBUG(INDI::Logger::DBG_WARNING, "Failed to write the last frames of the record.");
+  clearPretrigger();
+  if (encoded_record)
+    encoded_recorder->close();
+  else
+    recorder->close();
   DEBUGF(INDI::Logger::DBG_SESSION, "Record Duration(millisec): %g -- Frame count: %d", recordDuration, recordframeCount);
   return true;
 }
@@ -492,6 +1375,89 @@ bool StreamRecorder::ISNewSwitch (const char *dev, const char *name, ISState *st
       return true;
     }
 
+    /* Colour preview of Bayer frames */
+    if (!strcmp(name, DebayerSP.name))
+    {
+      IUUpdateSwitch(&DebayerSP, states, names, n);
+      DebayerSP.s = IPS_OK;
+      if (DebayerS[DEBAYER_OFF].s != ISS_ON && ccvt_cfa_parse(ccd->BayerT[2].text) < 0)
+      {
+          DEBUGF(INDI::Logger::DBG_WARNING, "Unknown Bayer pattern '%s', streaming raw frames.", ccd->BayerT[2].text ? ccd->BayerT[2].text : "");
+          DebayerSP.s = IPS_ALERT;
+      }
+      IDSetSwitch(&DebayerSP, NULL);
+      return true;
+    }
+
+    /* Stream encoding */
+    if (!strcmp(name, EncodingSP.name))
+    {
+      IUUpdateSwitch(&EncodingSP, states, names, n);
+      EncodingSP.s = IPS_OK;
+      IDSetSwitch(&EncodingSP, NULL);
+      return true;
+    }
+
+    /* Adaptive stream rate */
+    if (!strcmp(name, AdaptiveSP.name))
+    {
+      IUUpdateSwitch(&AdaptiveSP, states, names, n);
+      AdaptiveSP.s = IPS_OK;
+      resetAdaptive();
+      IDSetSwitch(&AdaptiveSP, NULL);
+      return true;
+    }
+
+    /* Compressed frames passthrough */
+    if (!strcmp(name, PassthroughSP.name))
+    {
+      ISState record = PassthroughS[PASSTHROUGH_RECORD].s;
+      IUUpdateSwitch(&PassthroughSP, states, names, n);
+      PassthroughSP.s = IPS_OK;
+      if (is_recording && PassthroughS[PASSTHROUGH_RECORD].s != record)
+      {
+          PassthroughS[PASSTHROUGH_RECORD].s = record;
+          PassthroughSP.s = IPS_ALERT;
+          DEBUG(INDI::Logger::DBG_WARNING, "Recording device is busy.");
+      }
+      IDSetSwitch(&PassthroughSP, NULL);
+      return true;
+    }
+
+    /* Record Trigger */
+    if (!strcmp(name, TriggerSP.name))
+    {
+      IUUpdateSwitch(&TriggerSP, states, names, n);
+      if (TriggerS[0].s != ISS_ON)
+        return true;
+      TriggerS[0].s = ISS_OFF;
+
+      if (is_recording)
+      {
+        TriggerSP.s = IPS_ALERT;
+        IDSetSwitch(&TriggerSP, NULL);
+        DEBUG(INDI::Logger::DBG_WARNING, "Recording device is busy.");
+        return false;
+      }
+
+      /* a record of Duration after the trigger, following the pre-trigger frames */
+      DEBUGF(INDI::Logger::DBG_SESSION, "Triggered video record (Duration): %g secs.", RecordOptionsNP.np[0].value);
+      IUResetSwitch(&RecordStreamSP);
+      RecordStreamS[RECORD_TIME].s = ISS_ON;
+      RecordStreamSP.s = IPS_BUSY;
+      TriggerSP.s = IPS_OK;
+      if (!startRecording())
+      {
+        IUResetSwitch(&RecordStreamSP);
+        RecordStreamS[RECORD_OFF].s = ISS_ON;
+        RecordStreamSP.s = IPS_ALERT;
+        TriggerSP.s = IPS_ALERT;
+      }
+      IDSetSwitch(&RecordStreamSP, NULL);
+      IDSetSwitch(&TriggerSP, NULL);
+      return true;
+    }
+
     /* Record Stream */
     if (!strcmp(name, RecordStreamSP.name))
     {
@@ -578,6 +1544,26 @@ bool StreamRecorder::ISNewNumber (const char *dev, const char *name, double valu
         IUUpdateNumber(&StreamOptionsNP, values, names, n);
         StreamOptionsNP.s = IPS_OK;
         IDSetNumber(&StreamOptionsNP, NULL);
+        adaptiveDivisor = std::max(adaptiveDivisor, (int) StreamOptionsN[0].value);
+        return true;
+    }
+
+    /* JPEG quality */
+    if (!strcmp (QualityNP.name, name))
+    {
+        IUUpdateNumber(&QualityNP, values, names, n);
+        QualityNP.s = IPS_OK;
+        IDSetNumber(&QualityNP, NULL);
+        adaptiveQuality = std::min(adaptiveQuality, (int) QualityN[0].value);
+        return true;
+    }
+
+    /* Adaptive stream budget */
+    if (!strcmp (BudgetNP.name, name))
+    {
+        IUUpdateNumber(&BudgetNP, values, names, n);
+        BudgetNP.s = IPS_OK;
+        IDSetNumber(&BudgetNP, NULL);
         return true;
     }
 
@@ -596,6 +1582,21 @@ bool StreamRecorder::ISNewNumber (const char *dev, const char *name, double valu
         return true;
     }
 
+    /* Pre-trigger ring */
+    if (!strcmp (PretriggerNP.name, name))
+    {
+        if (is_recording)
+        {
+            DEBUG(INDI::Logger::DBG_WARNING, "Recording device is busy");
+            return false;
+        }
+
+        IUUpdateNumber(&PretriggerNP, values, names, n);
+        PretriggerNP.s = setupPretrigger() ? IPS_OK : IPS_ALERT;
+        IDSetNumber(&PretriggerNP, NULL);
+        return true;
+    }
+
     /* Frames to drop */
    /*if (!strcmp (FramestoDropNP.name, name))
      {
@@ -622,6 +1623,8 @@ bool StreamRecorder::setStream(bool enable)
                 DEBUGF(INDI::Logger::DBG_SESSION, "Starting the video stream with single frame exposure of %f seconds.", ccd->ExposureTime, StreamOptionsN[0].value);
 
             streamframeCount = 0;
+            droppedFrames = 0;
+            resetAdaptive();
 
             getitimer(ITIMER_REAL, &tframe1);
             mssum=0; framecountsec=0;
@@ -646,7 +1649,7 @@ bool StreamRecorder::setStream(bool enable)
         StreamSP.s = IPS_IDLE;
         if (is_streaming)
         {
-            DEBUGF(INDI::Logger::DBG_DEBUG, "The video stream has been disabled. Frame count %d", streamframeCount);
+            DEBUGF(INDI::Logger::DBG_DEBUG, "The video stream has been disabled. Frame count %d, %d dropped by the encoder", streamframeCount, droppedFrames);
             //if (!is_exposing && !is_recording) stop_capturing();
             if (!is_recording)
             {
@@ -24,8 +24,10 @@
 #define STREAM_RECORDER_H
 
 #include <stdint.h>
+#include <pthread.h>
 #include <string>
 #include <map>
+#include <deque>
 
 #include <indiccd.h>
 #include <indidevapi.h>
@@ -42,6 +44,48 @@ public:
         RECORD_OFF
     };
 
+    enum
+    {
+        DEBAYER_OFF,
+        DEBAYER_BILINEAR,
+        DEBAYER_EDGE
+    };
+
+    enum
+    {
+        PASSTHROUGH_STREAM,
+        PASSTHROUGH_RECORD
+    };
+
+    enum
+    {
+        PRETRIGGER_FRAMES,
+        PRETRIGGER_DURATION,
+        PRETRIGGER_MEMORY
+    };
+
+    enum
+    {
+        ENCODE_RAW,
+        ENCODE_ZLIB,
+        ENCODE_JPEG
+    };
+
+    enum
+    {
+        BUDGET_BITRATE,
+        BUDGET_LATENCY
+    };
+
+    enum
+    {
+        STATS_FPS,
+        STATS_BITRATE,
+        STATS_SEND_TIME,
+        STATS_DIVISOR,
+        STATS_QUALITY
+    };
+
     StreamRecorder(INDI::CCD *mainCCD);
     ~StreamRecorder();
 
@@ -55,10 +99,22 @@ public:
 
     /**
      * @brief newFrame CCD drivers calls this function when a new frame is received.
+     * @param buffer decoded frame, may be NULL when needsDecodedFrame() is false.
+     * @param encoded compressed frame as sent by the camera (JPEG/MJPEG), if any.
+     * @param encodedSize size of the compressed frame in bytes.
+     * @param captured UTC time the frame was captured, now if NULL.
      */
-    void newFrame(unsigned char *buffer);
+    void newFrame(unsigned char *buffer, unsigned char *encoded = NULL, uint32_t encodedSize = 0,
+                  const struct timeval *captured = NULL);
 
-    void recordStream(double deltams, unsigned char *buffer);
+    void recordStream(double deltams, unsigned char *buffer, unsigned char *encoded = NULL, uint32_t encodedSize = 0,
+                      const struct timeval *captured = NULL);
+
+    /**
+     * @brief needsDecodedFrame false when the next frame is only streamed or recorded as the camera
+     * compressed it, so drivers of compressed formats may skip decoding it.
+     */
+    bool needsDecodedFrame();
 
    bool setStream(bool enable);
    // uint8_t getFramesToDrop() { return (uint8_t) FramestoDropN[0].value; }
@@ -86,8 +142,41 @@ private:
 
     bool startRecording();
     bool stopRecording();
+    bool writeRecordFrame(uint8_t *frame, uint32_t size, const struct timeval *captured);
+    void countRecordFrame(double deltams);
+    void recordFailed();
+
+    /* Pre-trigger ring of the last frames, written first when a record starts */
+    bool setupPretrigger();
+    void bufferFrame(double deltams, uint8_t *buffer, uint8_t *encoded, uint32_t encodedSize, const struct timeval *captured);
+    bool reservePretrigger(uint32_t size);
+    bool releasePretriggerFrame();
+    void dropPretriggerFrame();
+    void startPretrigger();
+    bool queueRecordFrame(uint8_t *frame, uint32_t size, double deltams, const struct timeval *captured);
+    bool writePretriggerFrame();
+    bool drainPretrigger(size_t count);
+    void clearPretrigger();
 
     bool uploadStream(uint8_t *buffer);
+    bool queueEncoding(const uint8_t *frame, uint32_t size, uint32_t width, uint32_t height, int components, int bpp);
+    bool encodeStream();
+    const uint8_t *stretchPreview(const uint16_t *frame, uint32_t pixels);
+    bool startEncoder();
+    void stopEncoder();
+    static void *encoderThread(void *arg);
+    static void encodedStreamReady(int fd, void *arg);
+    bool uploadEncodedStream(uint8_t *jpeg, uint32_t size);
+
+    /* Adaptive stream rate, decimation and compression follow how fast the BLOBs are taken */
+    void sendStream(uint32_t rawBytes);
+    void updateStreamStats();
+    void adaptStream(double mbps, double rawMbps, double sendms);
+    void resetAdaptive();
+    int streamDivisor();
+    int streamEncoding();
+    uint32_t completeJPEG(uint8_t *encoded, uint32_t size);
+    bool debayerStream(uint8_t *buffer);
 
     /* Stream switch */
     ISwitch StreamS[2];
@@ -109,14 +198,50 @@ private:
     INumber StreamOptionsN[1];
     INumberVectorProperty StreamOptionsNP;
 
+    /* Colour preview of Bayer frames */
+    ISwitch DebayerS[3];
+    ISwitchVectorProperty DebayerSP;
+
+    /* Compressed frames sent or recorded as-is */
+    ISwitch PassthroughS[2];
+    ISwitchVectorProperty PassthroughSP;
+
+    /* Stream encoding */
+    ISwitch EncodingS[3];
+    ISwitchVectorProperty EncodingSP;
+
+    /* JPEG quality of the stream */
+    INumber QualityN[1];
+    INumberVectorProperty QualityNP;
+
     /* Measured FPS */
     INumber FpsN[2];
     INumberVectorProperty FpsNP;
 
+    /* Adaptive stream rate switch */
+    ISwitch AdaptiveS[2];
+    ISwitchVectorProperty AdaptiveSP;
+
+    /* Bitrate and send time the adaptive rate aims for */
+    INumber BudgetN[2];
+    INumberVectorProperty BudgetNP;
+
+    /* Sent stream fps, bitrate, send time and the current adaptive settings */
+    INumber StreamStatsN[5];
+    INumberVectorProperty StreamStatsNP;
+
     /* Record Options */
     INumber RecordOptionsN[2];
     INumberVectorProperty RecordOptionsNP;
 
+    /* Pre-trigger ring size */
+    INumber PretriggerN[3];
+    INumberVectorProperty PretriggerNP;
+
+    /* Trigger a record of the pre-trigger frames and Duration after */
+    ISwitch TriggerS[1];
+    ISwitchVectorProperty TriggerSP;
+
     /* BLOBs */
     IBLOBVectorProperty *imageBP;
     IBLOB *imageB;
@@ -128,12 +253,79 @@ private:
     int recordframeCount;
     double recordDuration;
 
-    uint8_t *compressedFrame;
+    // Colour preview of Bayer frames
+    uint8_t *rawFrame8;
+    uint8_t *colorFrame;
+    uint32_t colorFrameSize;
+    uint32_t colorWidth, colorHeight;
+
+    // Camera JPEG frames, completed with their Huffman tables
+    uint8_t *jpegFrame;
+    uint32_t jpegFrameSize;
+    bool encoded_source;
+
+    // Stream encoder thread, one frame at a time, frames arriving while it is busy are dropped
+    pthread_t encoder;
+    pthread_mutex_t encoderLock;
+    pthread_cond_t encoderCond;
+    bool encoder_running;
+    bool encoder_quit;
+    bool encoder_busy;  // from queueEncoding() until encodedStreamReady() sent the BLOB
+    bool encoder_queued;
+    int encoderPipe[2];
+    int encoderCallback;
+    int droppedFrames;
+
+    // Frame given to the encoder thread
+    uint8_t *encodeFrame;
+    uint32_t encodeFrameSize, encodeBytes;
+    uint32_t encodeWidth, encodeHeight;
+    int encodeComponents, encodeBpp, encodeMethod, encodeQuality;
+
+    // Encoder output
+    uint8_t *encodedStream;
+    uint32_t encodedStreamSize, encodedStreamBytes;
+    bool encodeOK;
+
+    // 16 bits preview stretch
+    uint32_t *stretchHistogram;
+    uint8_t *stretchLUT;
+    uint8_t *previewFrame;
+    uint32_t previewFrameSize;
+
+    // Stream statistics over about one second, IDSetBLOB blocks while indiserver is behind
+    struct timeval statsStart;
+    double statsSendMs;
+    uint64_t statsBytes, statsRawBytes;
+    int statsFrames;
+
+    // Adaptive stream settings, within the client choices of divisor, encoding and quality
+    int adaptiveDivisor;
+    int adaptiveQuality;
+    bool adaptiveCompress;
+
+    // Pre-trigger ring, frames are copied once into one preallocated buffer
+    struct PretriggerFrame
+    {
+        size_t offset;
+        uint32_t size;
+        double deltams;
+        struct timeval captured;
+        bool encoded;
+        bool live;          // captured after the record started
+    };
+    std::deque<PretriggerFrame> pretriggerFrames;
+    uint8_t *pretriggerBuffer;
+    size_t pretriggerSize, pretriggerWrite;
+    double pretriggerDuration;
+    bool pretriggerPending; // the record is still catching up with the ring
 
     // Record frames
     V4L2_Record *v4l2_record;
     V4L2_Recorder *recorder;
+    V4L2_Recorder *encoded_recorder;
     bool direct_record;
+    bool encoded_record;
     std::string recordfiledir, recordfilename; /* in case we should move it */
 
     // Measure FPS
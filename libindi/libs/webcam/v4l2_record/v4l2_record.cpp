@@ -21,6 +21,7 @@
 
 #include "v4l2_record.h"
 #include "ser_recorder.h"
+#include "mjpeg_recorder.h"
 
 V4L2_Recorder::V4L2_Recorder() {
 }
@@ -32,8 +33,16 @@ const char *V4L2_Recorder::getName() {
   return name;
 }
 
+bool V4L2_Recorder::writeFrameEncoded(unsigned char *frame, unsigned int size) {
+  return false;
+}
+
+void V4L2_Recorder::setFrameTime(const struct timeval *utc) {
+}
+
 V4L2_Record::V4L2_Record() {
   recorder_list.push_back(new SER_Recorder());
+  recorder_list.push_back(new MJPEG_Recorder());
   default_recorder=recorder_list.at(0);
 }
 
@@ -55,6 +64,14 @@ V4L2_Recorder *V4L2_Record::getRecorder() {
 V4L2_Recorder *V4L2_Record::getDefaultRecorder() {
   return default_recorder;
 };
+V4L2_Recorder *V4L2_Record::getEncodedRecorder(unsigned int pixformat) {
+  std::vector<V4L2_Recorder *>::iterator it;
+  for ( it=recorder_list.begin() ; it != recorder_list.end(); it++ ) {
+    if (*it != default_recorder && (*it)->setpixelformat(pixformat))
+      return *it;
+  }
+  return NULL;
+};
 void V4L2_Record::setRecorder(V4L2_Recorder *recorder) {
   current_recorder=recorder;
 };
@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/time.h>
 #ifdef OSX_EMBEDED_MODE
 #define v4l2_fourcc(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
 
@@ -35,6 +36,8 @@
 #define V4L2_PIX_FMT_RGB24   v4l2_fourcc('R', 'G', 'B', '3') /* 24  RGB-8-8-8     */
 #define V4L2_PIX_FMT_SRGGB8  v4l2_fourcc('R', 'G', 'G', 'B') /*  8  RGRG.. GBGB.. */
 #define V4L2_PIX_FMT_SGRBG8  v4l2_fourcc('G', 'R', 'B', 'G') /*  8  GRGR.. BGBG.. */
+#define V4L2_PIX_FMT_MJPEG   v4l2_fourcc('M', 'J', 'P', 'G') /* Motion-JPEG   */
+#define V4L2_PIX_FMT_JPEG    v4l2_fourcc('J', 'P', 'E', 'G') /* JFIF JPEG     */
 
 #else
 #include <linux/videodev2.h>
@@ -58,6 +61,8 @@ virtual bool close()=0;
 virtual bool writeFrame(unsigned char *frame)=0; // when frame is in known encoding format
 virtual bool writeFrameMono(unsigned char *frame)=0; // default way to write a GREY frame
 virtual bool writeFrameColor(unsigned char *frame)=0; // default way to write a RGB24 frame
+virtual bool writeFrameEncoded(unsigned char *frame, unsigned int size); // compressed frame as sent by the camera
+virtual void setFrameTime(const struct timeval *utc); // UTC capture time of the next frame written
 virtual void setDefaultMono()=0; // prepare to write GREY frame
 virtual void setDefaultColor()=0; // prepare to write RGB24 frame
 
@@ -74,6 +79,7 @@ V4L2_Record();
 std::vector<V4L2_Recorder *> getRecorderList();
 V4L2_Recorder *getRecorder();
 V4L2_Recorder *getDefaultRecorder();
+V4L2_Recorder *getEncodedRecorder(unsigned int pixformat); // recorder storing frames of this compressed format as-is
 void setRecorder(V4L2_Recorder *recorder);
 
 protected:
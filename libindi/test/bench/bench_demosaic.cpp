@@ -0,0 +1,104 @@
+/*******************************************************************************
+ Demosaicing benchmark.
+
+ Times every ccvt demosaic method on a synthetic 8 and 16 bits RGGB frame,
+ with one thread and plain C rows, then with SIMD rows, then with one thread
+ per processor. All runs of a method must give the same image.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include "ccvt.h"
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* run a method iterations times with the given threads and SIMD setting, return frames/s */
+static double run(int depth, int method, int threads, int simd, int iterations, int width, int height,
+                  const std::vector<unsigned short> &raw, const std::vector<unsigned char> &raw8,
+                  std::vector<unsigned char> &out)
+{
+    int ow = (method == CCVT_DEMOSAIC_SUPERPIXEL) ? width / 2 : width;
+    int stride = ow * 4 * (depth / 8);
+    double start;
+
+    ccvt_simd_enable(simd);
+    ccvt_demosaic_threads(threads);
+
+    start = now();
+    for (int i = 0; i < iterations; i++)
+    {
+        if (depth == 8)
+            ccvt_demosaic8(width, height, &raw8[0], width, CCVT_CFA_RGGB, method, &out[0], stride, CCVT_BGR32);
+        else
+            ccvt_demosaic16(width, height, &raw[0], 2 * width, CCVT_CFA_RGGB, method, &out[0], stride, CCVT_BGR32);
+    }
+
+    return iterations / (now() - start);
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *names[3] = { "bilinear", "edge", "superpixel" };
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+    int width      = argc > 2 ? atoi(argv[2]) : 1920;
+    int height     = argc > 3 ? atoi(argv[3]) : 1080;
+    std::vector<unsigned short> raw(width * height);
+    std::vector<unsigned char> raw8(width * height);
+    std::vector<unsigned char> ref(width * height * 8), out(width * height * 8);
+    int failures = 0;
+
+    /* smooth shading with noise, so the edge directed paths are all taken */
+    srand(1);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            raw[y * width + x]  = ((x * 37 + y * 11) & 0x3FFF) * 3 + (rand() & 0xFFF);
+            raw8[y * width + x] = raw[y * width + x] >> 8;
+        }
+
+    fprintf(stderr, "Demosaic %dx%d, %d frames, SIMD kernels: %s\n", width, height, iterations, ccvt_simd_name());
+
+    for (int depth = 8; depth <= 16; depth += 8)
+        for (int method = CCVT_DEMOSAIC_BILINEAR; method <= CCVT_DEMOSAIC_SUPERPIXEL; method++)
+        {
+            double c, simd, threaded;
+
+            c = run(depth, method, 1, 0, iterations, width, height, raw, raw8, ref);
+            simd = run(depth, method, 1, 1, iterations, width, height, raw, raw8, out);
+            bool same = (out == ref);
+            threaded = run(depth, method, 0, 1, iterations, width, height, raw, raw8, out);
+            same = same && (out == ref);
+
+            if (!same)
+                failures++;
+
+            fprintf(stderr, "  %2d bits %-10s  C: %7.1f  SIMD: %7.1f  threads: %7.1f frames/s (%.2fx) %s\n", depth,
+                    names[method], c, simd, threaded, threaded / c, same ? "" : "MISMATCH");
+        }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ IDSetNumber throughput benchmark.
+
+ Compares the buffered message builder used by IDSetNumber, with and without
+ batching, against the previous printf based implementation. Driver output is
+ sent to /dev/null so only formatting and write costs are measured.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "indidevapi.h"
+#include "indicom.h"
+#include "lilxml.h"
+#include "indidriver.h"
+
+/* Driver globals and entry points normally provided by indidrivermain and the driver */
+ROSC *roCheck;
+int nroCheck;
+int verbose;
+char *me = (char *) "bench_idsetnumber";
+LilXML *clixml;
+
+void ISGetProperties (const char *) {}
+void ISNewSwitch (const char *, const char *, ISState *, char **, int) {}
+void ISNewText (const char *, const char *, char **, char **, int) {}
+void ISNewNumber (const char *, const char *, double *, char **, int) {}
+void ISNewBLOB (const char *, const char *, int *, int *, char **, char **, char **, int) {}
+void ISSnoopDevice (XMLEle *) {}
+
+/* IDSetNumber as it was implemented before the message builder */
+static void legacySetNumber (const INumberVectorProperty *nvp)
+{
+    int i;
+
+    xmlv1();
+    char *orig = setlocale(LC_NUMERIC,"C");
+    printf ("<setNumberVector\n");
+    printf ("  device='%s'\n", nvp->device);
+    printf ("  name='%s'\n", nvp->name);
+    printf ("  state='%s'\n", pstateStr(nvp->s));
+    printf ("  timeout='%g'\n", nvp->timeout);
+    printf ("  timestamp='%s'\n", timestamp());
+    printf (">\n");
+
+    for (i = 0; i < nvp->nnp; i++)
+    {
+        INumber *np = &nvp->np[i];
+        printf ("  <oneNumber name='%s'>\n", np->name);
+        printf ("      %.20g\n", np->value);
+        printf ("  </oneNumber>\n");
+    }
+
+    printf ("</setNumberVector>\n");
+    setlocale(LC_NUMERIC,orig);
+    fflush (stdout);
+}
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    const int batch = 10;
+    INumber N[6];
+    INumberVectorProperty NP;
+    double start, legacy, single, batched;
+
+    IUFillNumber(&N[0], "RA", "RA (hh:mm:ss)", "%010.6m", 0, 24, 0, 0);
+    IUFillNumber(&N[1], "DEC", "DEC (dd:mm:ss)", "%010.6m", -90, 90, 0, 0);
+    IUFillNumber(&N[2], "AZ", "AZ D:M:S", "%10.6m", 0, 360, 0, 0);
+    IUFillNumber(&N[3], "ALT", "Alt  D:M:S", "%10.6m", -90, 90, 0, 0);
+    IUFillNumber(&N[4], "TEMPERATURE", "Temperature (C)", "%6.2f", -50, 50, 0, 0);
+    IUFillNumber(&N[5], "EXPOSURE", "Duration (s)", "%5.2f", 0, 3600, 1, 0);
+    IUFillNumberVector(&NP, N, 6, "Telescope Simulator", "BENCH_COORD", "Bench", "Main Control", IP_RO, 60, IPS_OK);
+
+    /* Discard driver output */
+    int devnull = open("/dev/null", O_WRONLY);
+    fflush(stdout);
+    dup2(devnull, STDOUT_FILENO);
+
+    start = now();
+    for (int i = 0; i < iterations; i++)
+    {
+        N[0].value = 5.5 + i * 1e-7; N[1].value = 45.25 - i * 1e-7; N[2].value = 180 + i * 3e-6;
+        N[3].value = 30.125; N[4].value = -10 + (i % 100) * 0.01; N[5].value = i % 600;
+        legacySetNumber(&NP);
+    }
+    legacy = now() - start;
+
+    start = now();
+    for (int i = 0; i < iterations; i++)
+    {
+        N[0].value = 5.5 + i * 1e-7; N[1].value = 45.25 - i * 1e-7; N[2].value = 180 + i * 3e-6;
+        N[3].value = 30.125; N[4].value = -10 + (i % 100) * 0.01; N[5].value = i % 600;
+        IDSetNumber(&NP, NULL);
+    }
+    single = now() - start;
+
+    start = now();
+    for (int i = 0; i < iterations; i += batch)
+    {
+        IDBeginBatch();
+        for (int j = i; j < i + batch; j++)
+        {
+            N[0].value = 5.5 + j * 1e-7; N[1].value = 45.25 - j * 1e-7; N[2].value = 180 + j * 3e-6;
+            N[3].value = 30.125; N[4].value = -10 + (j % 100) * 0.01; N[5].value = j % 600;
+            IDSetNumber(&NP, NULL);
+        }
+        IDEndBatch();
+    }
+    batched = now() - start;
+
+    fprintf(stderr, "IDSetNumber, %d updates of %d numbers\n", iterations, NP.nnp);
+    fprintf(stderr, "  printf (before):    %8.0f updates/s\n", iterations / legacy);
+    fprintf(stderr, "  builder:            %8.0f updates/s (%.2fx)\n", iterations / single, legacy / single);
+    fprintf(stderr, "  builder, batch %2d:  %8.0f updates/s (%.2fx)\n", batch, iterations / batched, legacy / batched);
+
+    return 0;
+}
@@ -0,0 +1,241 @@
+/*******************************************************************************
+ Number parsing benchmark.
+
+ Replays a capture of telescope and focuser simulator traffic through
+ INDI::BaseDevice and compares the locale independent number parsers against
+ the previous setlocale, atof and sscanf based ones on every number found in
+ the capture. Usage: bench_numparse [capture.xml] [iterations]
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+#include "indicom.h"
+#include "lilxml.h"
+#include "basedevice.h"
+
+#ifndef BENCH_CAPTURE
+#define BENCH_CAPTURE "mount_focuser_capture.xml"
+#endif
+
+/* Exposes the message handlers used by INDI::BaseClient */
+class ReplayDevice : public INDI::BaseDevice
+{
+public:
+    using INDI::BaseDevice::buildProp;
+    using INDI::BaseDevice::setValue;
+};
+
+/* f_scansexa as it was implemented before the locale independent parser */
+static int legacyScansexa (const char *str0, double *dp)
+{
+    char *orig = setlocale(LC_NUMERIC,"C");
+
+    double a = 0, b = 0, c = 0;
+    char str[128];
+    char *neg;
+    int r;
+
+    strncpy (str, str0, sizeof(str)-1);
+    str[sizeof(str)-1] = '\0';
+
+    neg = strchr(str, '-');
+    if (neg)
+        *neg = ' ';
+
+    r = sscanf (str, "%lf%*[^0-9]%lf%*[^0-9]%lf", &a, &b, &c);
+
+    setlocale(LC_NUMERIC,orig);
+
+    if (r < 1)
+        return (-1);
+    *dp = a + b/60 + c/3600;
+    if (neg)
+        *dp *= -1;
+    return (0);
+}
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static std::vector<XMLEle *> loadCapture(const char *filename)
+{
+    std::vector<XMLEle *> messages;
+    char errmsg[MAXRBUF];
+    char buf[16384];
+    size_t n;
+
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+    {
+        perror(filename);
+        return messages;
+    }
+
+    LilXML *lp = newLilXML();
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        XMLEle **nodes = parseXMLChunk(lp, buf, n, errmsg);
+        if (nodes == NULL)
+        {
+            fprintf(stderr, "%s: %s\n", filename, errmsg);
+            break;
+        }
+        for (int i = 0; nodes[i]; i++)
+            messages.push_back(nodes[i]);
+        free(nodes);
+    }
+    delLilXML(lp);
+    fclose(fp);
+
+    return messages;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *capture = argc > 1 ? argv[1] : BENCH_CAPTURE;
+    int iterations = argc > 2 ? atoi(argv[2]) : 2000;
+    char errmsg[MAXRBUF];
+    double start, elapsed, sum = 0;
+
+    /* Use the locale of the environment, as a client application would */
+    setlocale(LC_ALL, "");
+
+    std::vector<XMLEle *> messages = loadCapture(capture);
+    if (messages.empty())
+        return 1;
+
+    /* Every number of the capture, element values and attributes, per message */
+    std::vector<std::vector<std::string> > numbers(messages.size());
+    size_t nnumbers = 0;
+    for (size_t i = 0; i < messages.size(); i++)
+    {
+        numbers[i].push_back(findXMLAttValu(messages[i], "timeout"));
+        for (XMLEle *ep = nextXMLEle(messages[i], 1); ep; ep = nextXMLEle(messages[i], 0))
+        {
+            numbers[i].push_back(pcdataXMLEle(ep));
+            for (XMLAtt *ap = nextXMLAtt(ep, 1); ap; ap = nextXMLAtt(ep, 0))
+                if (!strcmp(nameXMLAtt(ap), "min") || !strcmp(nameXMLAtt(ap), "max") || !strcmp(nameXMLAtt(ap), "step"))
+                    numbers[i].push_back(valuXMLAtt(ap));
+        }
+        nnumbers += numbers[i].size();
+    }
+
+    fprintf(stderr, "%s: %zu messages, %zu numbers, LC_NUMERIC=%s\n", capture, messages.size(), nnumbers,
+            setlocale(LC_NUMERIC, NULL));
+
+    /* Client path before: one setlocale pair per message around atof */
+    start = now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < numbers.size(); i++)
+        {
+            char *orig = setlocale(LC_NUMERIC, "C");
+            for (size_t j = 0; j < numbers[i].size(); j++)
+                sum += atof(numbers[i][j].c_str());
+            setlocale(LC_NUMERIC, orig);
+        }
+    elapsed = now() - start;
+    fprintf(stderr, "  setlocale + atof:        %10.0f numbers/s\n", iterations * nnumbers / elapsed);
+    double client = elapsed;
+
+    /* Driver path before: setlocale pairs around the sscanf based f_scansexa */
+    start = now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < numbers.size(); i++)
+        {
+            char *orig = setlocale(LC_NUMERIC, "C");
+            for (size_t j = 0; j < numbers[i].size(); j++)
+            {
+                double v = 0;
+                legacyScansexa(numbers[i][j].c_str(), &v);
+                sum += v;
+            }
+            setlocale(LC_NUMERIC, orig);
+        }
+    elapsed = now() - start;
+    fprintf(stderr, "  setlocale + sscanf:      %10.0f numbers/s\n", iterations * nnumbers / elapsed);
+    double driver = elapsed;
+
+    start = now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < numbers.size(); i++)
+            for (size_t j = 0; j < numbers[i].size(); j++)
+                sum += f_strtod(numbers[i][j].c_str(), NULL);
+    elapsed = now() - start;
+    fprintf(stderr, "  f_strtod:                %10.0f numbers/s (%.2fx atof)\n", iterations * nnumbers / elapsed,
+            client / elapsed);
+
+    start = now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < numbers.size(); i++)
+            for (size_t j = 0; j < numbers[i].size(); j++)
+            {
+                double v = 0;
+                f_scansexa(numbers[i][j].c_str(), &v);
+                sum += v;
+            }
+    elapsed = now() - start;
+    fprintf(stderr, "  f_scansexa:              %10.0f numbers/s (%.2fx sscanf)\n", iterations * nnumbers / elapsed,
+            driver / elapsed);
+
+    /* End to end replay through the client message handlers */
+    ReplayDevice mount, focuser;
+    mount.setDeviceName("Telescope Simulator");
+    focuser.setDeviceName("Focuser Simulator");
+
+    std::vector<XMLEle *> updates;
+    for (size_t i = 0; i < messages.size(); i++)
+    {
+        ReplayDevice *dp = !strcmp(findXMLAttValu(messages[i], "device"), mount.getDeviceName()) ? &mount : &focuser;
+        if (!strncmp(tagXMLEle(messages[i]), "def", 3))
+            dp->buildProp(messages[i], errmsg);
+        else
+            updates.push_back(messages[i]);
+    }
+
+    start = now();
+    for (int it = 0; it < iterations; it++)
+        for (size_t i = 0; i < updates.size(); i++)
+        {
+            ReplayDevice *dp = !strcmp(findXMLAttValu(updates[i], "device"), mount.getDeviceName()) ? &mount : &focuser;
+            if (dp->setValue(updates[i], errmsg) < 0)
+            {
+                fprintf(stderr, "replay: %s\n", errmsg);
+                return 1;
+            }
+        }
+    elapsed = now() - start;
+    fprintf(stderr, "  BaseDevice::setValue:    %10.0f messages/s\n", iterations * updates.size() / elapsed);
+
+    for (size_t i = 0; i < messages.size(); i++)
+        delXMLEle(messages[i]);
+
+    /* Keep the parsed values alive */
+    fprintf(stderr, "  checksum %g\n", sum);
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ V4L2 builtin decoder benchmark.
+
+ Decodes synthetic frames of every format supported by the builtin decoder
+ and builds the colour (BGR32), RGB24 and linear luminance buffers, once
+ with the SIMD kernels and once with the plain C rows. Both passes must
+ produce identical buffers. JPEG formats need real compressed data and are skipped.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include "indidevapi.h"
+#include "lilxml.h"
+#include "indidriver.h"
+
+#include "ccvt.h"
+#include "v4l2_decode/v4l2_builtin_decoder.h"
+
+/* Driver globals and entry points normally provided by indidrivermain and the driver */
+ROSC *roCheck;
+int nroCheck;
+int verbose;
+char *me = (char *) "bench_v4l2decode";
+LilXML *clixml;
+
+void ISGetProperties (const char *) {}
+void ISNewSwitch (const char *, const char *, ISState *, char **, int) {}
+void ISNewText (const char *, const char *, char **, char **, int) {}
+void ISNewNumber (const char *, const char *, double *, char **, int) {}
+void ISNewBLOB (const char *, const char *, int *, int *, char **, char **, char **, int) {}
+void ISSnoopDevice (XMLEle *) {}
+
+static double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* bytes per line of a packed frame, or of the luma plane of planar formats */
+static unsigned int lineBytes(unsigned int format, unsigned int width)
+{
+    switch (format)
+    {
+        case V4L2_PIX_FMT_RGB24:
+            return 3 * width;
+        case V4L2_PIX_FMT_Y16:
+        case V4L2_PIX_FMT_YUYV:
+        case V4L2_PIX_FMT_UYVY:
+        case V4L2_PIX_FMT_VYUY:
+        case V4L2_PIX_FMT_YVYU:
+        case V4L2_PIX_FMT_RGB555:
+        case V4L2_PIX_FMT_RGB565:
+        case V4L2_PIX_FMT_SBGGR16:
+            return 2 * width;
+        default:
+            return width;
+    }
+}
+
+/* decode, convert and keep a copy of what a driver would read */
+static void runFormat(V4L2_Builtin_Decoder &decoder, unsigned int format, unsigned char *frame, struct v4l2_buffer *buf,
+                      unsigned int width, unsigned int height, std::vector<unsigned char> &out)
+{
+    size_t csize = (size_t) width * height * (decoder.getBpp() / 8) * 4;
+    size_t rsize = (size_t) width * height * 3;
+    unsigned char *color;
+
+    decoder.decode(frame, buf);
+    color = decoder.getColorBuffer();
+    out.assign(color, color + csize);
+
+    /* Y16 frames are only recorded from the colour buffer */
+    if (format != V4L2_PIX_FMT_Y16)
+    {
+        unsigned char *rgb = decoder.getRGBBuffer();
+        out.insert(out.end(), rgb, rgb + rsize);
+    }
+
+    /* linear luminance used when stacking */
+    unsigned char *linear = (unsigned char *) decoder.getLinearY();
+    out.insert(out.end(), linear, linear + (size_t) width * height * sizeof(float));
+}
+
+int main(int argc, char *argv[])
+{
+    int iterations      = argc > 1 ? atoi(argv[1]) : 50;
+    unsigned int width  = argc > 2 ? atoi(argv[2]) : 1280;
+    unsigned int height = argc > 3 ? atoi(argv[3]) : 720;
+    V4L2_Builtin_Decoder decoder;
+    std::vector<unsigned char> frame(width * height * 4);
+    std::vector<unsigned char> simd, scalar;
+    struct v4l2_buffer buf;
+    int failures = 0;
+
+    srand(1);
+    for (size_t i = 0; i < frame.size(); i++)
+        frame[i] = rand() & 0xFF;
+
+    decoder.init();
+    memset(&buf, 0, sizeof(buf));
+    buf.bytesused = buf.length = frame.size();
+
+    fprintf(stderr, "V4L2 builtin decoder, %ux%u, %d frames, SIMD kernels: %s\n", width, height, iterations, ccvt_simd_name());
+
+    const std::vector<unsigned int> &formats = decoder.getsupportedformats();
+    for (size_t f = 0; f < formats.size(); f++)
+    {
+        unsigned int format = formats[f];
+        struct v4l2_format fmt;
+        double start, tsimd, tscalar;
+
+        if (format == V4L2_PIX_FMT_JPEG || format == V4L2_PIX_FMT_MJPEG)
+            continue;
+
+        memset(&fmt, 0, sizeof(fmt));
+        fmt.type                 = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        fmt.fmt.pix.width        = width;
+        fmt.fmt.pix.height       = height;
+        fmt.fmt.pix.pixelformat  = format;
+        fmt.fmt.pix.bytesperline = lineBytes(format, width);
+        fmt.fmt.pix.sizeimage    = frame.size();
+        decoder.setformat(fmt, false);
+
+        ccvt_simd_enable(1);
+        runFormat(decoder, format, &frame[0], &buf, width, height, simd);
+        start = now();
+        for (int i = 0; i < iterations; i++)
+            runFormat(decoder, format, &frame[0], &buf, width, height, simd);
+        tsimd = now() - start;
+
+        ccvt_simd_enable(0);
+        runFormat(decoder, format, &frame[0], &buf, width, height, scalar);
+        start = now();
+        for (int i = 0; i < iterations; i++)
+            runFormat(decoder, format, &frame[0], &buf, width, height, scalar);
+        tscalar = now() - start;
+
+        bool same = (simd == scalar);
+        if (!same)
+            failures++;
+
+        fprintf(stderr, "  %c%c%c%c  C: %7.1f frames/s  SIMD: %7.1f frames/s (%.2fx) %s\n", format & 0xFF,
+                (format >> 8) & 0xFF, (format >> 16) & 0xFF, (format >> 24) & 0xFF, iterations / tscalar,
+                iterations / tsimd, tscalar / tsimd, same ? "" : "MISMATCH");
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "indiapi.h"
+#include "indicom.h"
+#include "basedevice.h"
+#include "indiproperty.h"
+
+/* Vector properties registered by hand, as a driver does */
+class BaseDeviceTest : public ::testing::Test
+{
+	protected:
+		BaseDeviceTest()
+		{
+			memset(&number, 0, sizeof(number));
+			memset(&number2, 0, sizeof(number2));
+			memset(&sw, 0, sizeof(sw));
+			memset(&light, 0, sizeof(light));
+			memset(&text, 0, sizeof(text));
+
+			device.setDeviceName("Test Device");
+			vector(number.name, number.device, "FOO");
+			number.s = IPS_OK;
+			number.p = IP_RW;
+			vector(number2.name, number2.device, "FOO");
+			number2.s = IPS_ALERT;
+			number2.p = IP_RO;
+			vector(sw.name, sw.device, "BAR");
+			sw.s = IPS_BUSY;
+			sw.p = IP_WO;
+			vector(light.name, light.device, "BAZ");
+			light.s = IPS_ALERT;
+			vector(text.name, text.device, "BAZ");
+			text.s = IPS_OK;
+			text.p = IP_RW;
+		}
+
+		static void vector(char *name, char *dev, const char *n)
+		{
+			strcpy(name, n);
+			strcpy(dev, "Test Device");
+		}
+
+		INDI::BaseDevice device;
+		INumberVectorProperty number, number2;
+		ISwitchVectorProperty sw;
+		ILightVectorProperty light;
+		ITextVectorProperty text;
+		char errmsg[MAXRBUF];
+};
+
+TEST_F(BaseDeviceTest, Test_typed_lookup)
+{
+	device.registerProperty(&number, INDI_NUMBER);
+	device.registerProperty(&sw, INDI_SWITCH);
+
+	ASSERT_EQ(&number, device.getNumber("FOO"));
+	ASSERT_EQ(&sw, device.getSwitch("BAR"));
+	ASSERT_EQ(&number, device.getRawProperty("FOO"));
+	ASSERT_EQ(INDI_SWITCH, device.getProperty("BAR")->getType());
+
+	// the type filter applies to the property found by name
+	ASSERT_TRUE(device.getSwitch("FOO") == NULL);
+	ASSERT_TRUE(device.getNumber("BAR") == NULL);
+	ASSERT_TRUE(device.getProperty("FOO", INDI_TEXT) == NULL);
+	ASSERT_TRUE(device.getNumber("NONE") == NULL);
+
+	ASSERT_EQ(IPS_OK, device.getPropertyState("FOO"));
+	ASSERT_EQ(IPS_BUSY, device.getPropertyState("BAR"));
+	ASSERT_EQ(IPS_IDLE, device.getPropertyState("NONE"));
+	ASSERT_EQ(IP_RW, device.getPropertyPermission("FOO"));
+	ASSERT_EQ(IP_WO, device.getPropertyPermission("BAR"));
+	ASSERT_EQ(IP_RO, device.getPropertyPermission("NONE"));
+}
+
+TEST_F(BaseDeviceTest, Test_registered_flag)
+{
+	device.registerProperty(&number, INDI_NUMBER);
+
+	INDI::Property *p = device.getProperty("FOO");
+	ASSERT_TRUE(p != NULL);
+
+	// unregistered properties are not returned, their state still is
+	p->setRegistered(false);
+	ASSERT_TRUE(device.getProperty("FOO") == NULL);
+	ASSERT_TRUE(device.getNumber("FOO") == NULL);
+	ASSERT_EQ(IPS_OK, device.getPropertyState("FOO"));
+
+	// registering again while registered keeps the same container
+	p->setRegistered(true);
+	device.registerProperty(&number, INDI_NUMBER);
+	ASSERT_EQ(p, device.getProperty("FOO"));
+	ASSERT_EQ(1u, device.getProperties()->size());
+}
+
+TEST_F(BaseDeviceTest, Test_first_match)
+{
+	device.registerProperty(&number, INDI_NUMBER);
+	device.getProperty("FOO")->setRegistered(false);
+	// a second container is appended while the first is unregistered
+	device.registerProperty(&number2, INDI_NUMBER);
+	ASSERT_EQ(2u, device.getProperties()->size());
+
+	// the first registered property of the name wins, state looks at the first of all
+	ASSERT_EQ(&number2, device.getNumber("FOO"));
+	ASSERT_EQ(IPS_OK, device.getPropertyState("FOO"));
+	ASSERT_EQ(IP_RW, device.getPropertyPermission("FOO"));
+
+	(*device.getProperties())[0]->setRegistered(true);
+	ASSERT_EQ(&number, device.getNumber("FOO"));
+
+	// removing the first makes the next one of the name visible
+	ASSERT_EQ(0, device.removeProperty("FOO", errmsg));
+	ASSERT_EQ(&number2, device.getNumber("FOO"));
+	ASSERT_EQ(IPS_ALERT, device.getPropertyState("FOO"));
+	ASSERT_EQ(IP_RO, device.getPropertyPermission("FOO"));
+
+	ASSERT_EQ(0, device.removeProperty("FOO", errmsg));
+	ASSERT_TRUE(device.getNumber("FOO") == NULL);
+	ASSERT_NE(0, device.removeProperty("FOO", errmsg));
+}
+
+TEST_F(BaseDeviceTest, Test_same_name_other_type)
+{
+	device.registerProperty(&light, INDI_LIGHT);
+	device.registerProperty(&text, INDI_TEXT);
+
+	ASSERT_EQ(&light, device.getLight("BAZ"));
+	ASSERT_EQ(&text, device.getText("BAZ"));
+	ASSERT_EQ(&light, device.getRawProperty("BAZ"));
+
+	// lights have no permission, the text behind it has
+	ASSERT_EQ(IPS_ALERT, device.getPropertyState("BAZ"));
+	ASSERT_EQ(IP_RW, device.getPropertyPermission("BAZ"));
+
+	ASSERT_EQ(0, device.removeProperty("BAZ", errmsg));
+	ASSERT_TRUE(device.getLight("BAZ") == NULL);
+	ASSERT_EQ(&text, device.getRawProperty("BAZ"));
+	ASSERT_EQ(IPS_OK, device.getPropertyState("BAZ"));
+}
+
+TEST_F(BaseDeviceTest, Test_many_properties)
+{
+	std::vector<INumberVectorProperty> nvps(200);
+	char name[MAXINDINAME];
+
+	for (size_t i = 0; i < nvps.size(); i++)
+	{
+		memset(&nvps[i], 0, sizeof(nvps[i]));
+		snprintf(name, sizeof(name), "PROP_%zu", i);
+		vector(nvps[i].name, nvps[i].device, name);
+		device.registerProperty(&nvps[i], INDI_NUMBER);
+	}
+
+	for (size_t i = 0; i < nvps.size(); i += 2)
+	{
+		snprintf(name, sizeof(name), "PROP_%zu", i);
+		ASSERT_EQ(0, device.removeProperty(name, errmsg));
+	}
+
+	for (size_t i = 0; i < nvps.size(); i++)
+	{
+		snprintf(name, sizeof(name), "PROP_%zu", i);
+		ASSERT_EQ(i % 2 ? &nvps[i] : NULL, device.getNumber(name)) << name;
+	}
+}
@@ -0,0 +1,260 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base64.h"
+#include "blobstream.h"
+
+/* Feeds a BLOBStreamParser watching CCD Simulator.CCD1 into a buffer sink */
+class BLOBStreamTest : public ::testing::Test
+{
+	protected:
+		BLOBStreamTest() : parser(
+			[this](const char *device, const char *property, const char *name, IBLOB **bp,
+				INDI::BLOBSink **sink, INDI::BLOBStreamParser::ProgressCallback *progress)
+			{
+				if (strcmp(device, "CCD Simulator") || strcmp(property, "CCD1"))
+					return false;
+				if (name == NULL)
+					return true;
+				if (strcmp(name, "CCD1"))
+					return false;
+				*bp = &blob;
+				if (sink)
+					*sink = &buffer;
+				if (progress)
+					*progress = [this](IBLOB *, size_t received, IPState state)
+					{
+						states.push_back(state);
+						lastReceived = received;
+					};
+				return true;
+			},
+			[this](IBLOB *bp)
+			{
+				empties.push_back(bp->name);
+			})
+		{
+			memset(&blob, 0, sizeof(blob));
+			strcpy(blob.name, "CCD1");
+			lastReceived = 0;
+		}
+
+		virtual void TearDown()
+		{
+			free(blob.blob);
+		}
+
+		/* pass the stream in chunks of the given sizes, cycling through them */
+		std::string feed(const std::string &stream, const std::vector<size_t> &chunks)
+		{
+			std::string xml;
+			size_t pos = 0, c = 0;
+
+			while (pos < stream.size())
+			{
+				size_t len = std::min(chunks[c++ % chunks.size()], stream.size() - pos);
+				size_t off = 0;
+
+				// the parser returns early after a streamed start tag and wants the rest again
+				while (off < len)
+					off += parser.process(stream.data() + pos + off, len - off, xml);
+				pos += len;
+			}
+
+			return xml;
+		}
+
+		static std::string base64(const std::string &data, size_t line = 72)
+		{
+			std::vector<unsigned char> out(4 * data.size() / 3 + 4);
+			int n = to64frombits(&out[0], (const unsigned char *) data.data(), data.size());
+			std::string b64((char *) &out[0], n), lines;
+
+			for (size_t i = 0; i < b64.size(); i += line)
+				lines += b64.substr(i, line) + "\n";
+			return lines;
+		}
+
+		static std::string deflated(const std::string &data)
+		{
+			uLongf len = compressBound(data.size());
+			std::vector<unsigned char> out(len);
+
+			EXPECT_EQ(Z_OK, compress2(&out[0], &len, (const Bytef *) data.data(), data.size(), 6));
+			return std::string((char *) &out[0], len);
+		}
+
+		static std::string vector(const std::string &format, size_t size, const std::string &content,
+						const char *property = "CCD1")
+		{
+			char head[256];
+
+			snprintf(head, sizeof(head), "<setBLOBVector device=\"CCD Simulator\" name=\"%s\" state=\"Ok\">\n"
+				"  <oneBLOB name=\"CCD1\" size=\"%zu\" format=\"%s\">\n", property, size, format.c_str());
+			return std::string(head) + content + "  </oneBLOB>\n</setBLOBVector>\n";
+		}
+
+		static std::string frame(size_t size)
+		{
+			std::string data(size, 0);
+
+			srand(size);
+			for (size_t i = 0; i < size; i++)
+				data[i] = (i % 7 == 0) ? rand() & 0xff : (char) (i / 64);
+			return data;
+		}
+
+		std::string received() const
+		{
+			return std::string((const char *) buffer.getBuffer(), buffer.getLength());
+		}
+
+		IBLOB blob;
+		INDI::BLOBBufferSink buffer;
+		INDI::BLOBStreamParser parser;
+		std::vector<IPState> states;
+		std::vector<std::string> empties;
+		size_t lastReceived;
+};
+
+static const char *NUMBER = "<setNumberVector device=\"CCD Simulator\" name=\"CCD_TEMPERATURE\" state=\"Ok\">\n"
+				"  <oneNumber name=\"CCD_TEMPERATURE_VALUE\">-10</oneNumber>\n</setNumberVector>\n";
+
+TEST_F(BLOBStreamTest, Test_split_base64)
+{
+	std::string data = frame(200000);
+	std::string stream = std::string(NUMBER) + vector(".fits", data.size(), base64(data)) + NUMBER;
+
+	// every split point, including inside tags and base64 quads
+	std::string xml = feed(stream, { 1, 2, 3, 5, 7, 64, 4093, 1 });
+
+	ASSERT_EQ(data.size(), buffer.getLength());
+	ASSERT_TRUE(data == received());
+	ASSERT_STREQ(".fits", blob.format);
+	ASSERT_EQ(data.size(), (size_t) blob.size);
+	ASSERT_EQ(IPS_OK, states.back());
+	ASSERT_EQ(data.size(), lastReceived);
+
+	// the XML parser only sees the tags of the streamed vector
+	ASSERT_EQ(std::string(NUMBER) + "<setBLOBVector device=\"CCD Simulator\" name=\"CCD1\" state=\"Ok\">"
+		"</setBLOBVector>\n\n" + NUMBER, xml);
+}
+
+TEST_F(BLOBStreamTest, Test_single_line_base64)
+{
+	std::string data = frame(100000);
+
+	feed(vector(".raw", data.size(), base64(data, 1 << 30)), { 65536 });
+	ASSERT_TRUE(data == received());
+	ASSERT_EQ(IPS_OK, states.back());
+}
+
+TEST_F(BLOBStreamTest, Test_split_zlib)
+{
+	std::string data = frame(300000);
+	std::string z = deflated(data);
+
+	feed(vector(".fits.z", data.size(), base64(z)), { 1, 3, 11, 997 });
+
+	ASSERT_TRUE(data == received());
+	ASSERT_STREQ(".fits", blob.format);
+	ASSERT_EQ(data.size(), (size_t) blob.size);
+	ASSERT_EQ(IPS_OK, states.back());
+}
+
+TEST_F(BLOBStreamTest, Test_unwatched_passthrough)
+{
+	std::string data = frame(1000);
+	std::string stream = vector(".fits", data.size(), base64(data), "CCD2");
+
+	ASSERT_EQ(stream, feed(stream, { 3 }));
+	ASSERT_EQ(0u, buffer.getLength());
+	ASSERT_TRUE(states.empty());
+}
+
+TEST_F(BLOBStreamTest, Test_truncated_base64)
+{
+	std::string data = frame(3000);
+	std::string b64 = base64(data, 1 << 30);
+
+	b64.erase(b64.size() - 3);
+	feed(vector(".fits", data.size(), b64), { 100 });
+	ASSERT_EQ(IPS_ALERT, states.back());
+}
+
+TEST_F(BLOBStreamTest, Test_truncated_zlib)
+{
+	std::string data = frame(50000);
+	std::string z = deflated(data);
+
+	z.erase(z.size() - z.size() % 3 - 30);
+	feed(vector(".fits.z", data.size(), base64(z)), { 100 });
+	ASSERT_EQ(IPS_ALERT, states.back());
+}
+
+TEST_F(BLOBStreamTest, Test_corrupt_zlib)
+{
+	std::string data = frame(50000);
+	std::string z = deflated(data);
+
+	for (size_t i = 100; i < 400; i++)
+		z[i] = ~z[i];
+	feed(vector(".fits.z", data.size(), base64(z)), { 100 });
+	ASSERT_EQ(IPS_ALERT, states.back());
+
+	// the next BLOB is decoded normally
+	feed(vector(".fits.z", data.size(), base64(deflated(data))), { 100 });
+	ASSERT_EQ(IPS_OK, states.back());
+	ASSERT_TRUE(data == received());
+}
+
+TEST_F(BLOBStreamTest, Test_state_only)
+{
+	feed("<setBLOBVector device=\"CCD Simulator\" name=\"CCD1\" state=\"Busy\">\n"
+		"  <oneBLOB name=\"CCD1\" size=\"0\" format=\".fits\"/>\n</setBLOBVector>\n", { 5 });
+
+	ASSERT_EQ(1u, empties.size());
+	ASSERT_EQ("CCD1", empties[0]);
+	ASSERT_TRUE(states.empty());
+}
+
+TEST_F(BLOBStreamTest, Test_reset)
+{
+	std::string data = frame(10000);
+	std::string stream = vector(".fits", data.size(), base64(data));
+
+	feed(stream.substr(0, stream.size() / 2), { 1000 });
+	ASSERT_FALSE(parser.isIdle());
+
+	parser.reset();
+	ASSERT_TRUE(parser.isIdle());
+	ASSERT_EQ(IPS_ALERT, states.back());
+
+	feed(stream, { 1000 });
+	ASSERT_EQ(IPS_OK, states.back());
+	ASSERT_TRUE(data == received());
+}
@@ -0,0 +1,386 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "base64.h"
+#include "indiframe.h"
+
+#define MAXPLEN (1024*1024)
+
+/* parse the first element of xml, caller must delXMLEle() it */
+static XMLEle *parse(const std::string &xml)
+{
+	char err[1024];
+	std::vector<char> buf(xml.begin(), xml.end());
+	LilXML *lp = newLilXML();
+	XMLEle **nodes = parseXMLChunk(lp, &buf[0], buf.size(), err);
+	XMLEle *root = NULL;
+
+	if (nodes)
+	{
+		root = nodes[0];
+		free(nodes);
+	}
+	delLilXML(lp);
+	return root;
+}
+
+static std::string base64(const std::string &data)
+{
+	std::vector<unsigned char> out(4 * data.size() / 3 + 4);
+	int n = to64frombits(&out[0], (const unsigned char *) data.data(), data.size());
+	std::string b64((char *) &out[0], n), lines;
+
+	// line breaks as written by drivers
+	for (size_t i = 0; i < b64.size(); i += 72)
+		lines += b64.substr(i, 72) + "\n";
+	return lines;
+}
+
+static std::string decoded(XMLEle *ep)
+{
+	std::string b64(pcdataXMLEle(ep)), clean;
+
+	for (size_t i = 0; i < b64.size(); i++)
+		if (!isspace((unsigned char) b64[i]))
+			clean += b64[i];
+	std::vector<char> out(clean.size() * 3 / 4 + 4);
+	int n = from64tobits_fast(&out[0], clean.data(), clean.size());
+	return std::string(&out[0], n < 0 ? 0 : n);
+}
+
+static std::string blobVector(const std::string &a, const std::string &b)
+{
+	return "<setBLOBVector device=\"CCD Simulator\" name=\"CCD1\" state=\"Ok\" timestamp=\"2016-01-01T00:00:00\">\n"
+		"  <oneBLOB name=\"CCD1\" size=\"" + std::to_string(a.size()) + "\" format=\".fits\" enclen=\"123\">\n" +
+		base64(a) + "  </oneBLOB>\n"
+		"  <oneBLOB name=\"CCD2\" size=\"" + std::to_string(b.size()) + "\" format=\".fits.z\">\n" +
+		base64(b) + "  </oneBLOB>\n</setBLOBVector>\n";
+}
+
+static std::string binary(size_t size)
+{
+	std::string data(size, 0);
+
+	for (size_t i = 0; i < size; i++)
+		data[i] = (char) (i * 131 + (i >> 8));
+	return data;
+}
+
+/* a frame built by hand, lengths as given */
+static std::vector<unsigned char> rawFrame(int type, const std::string &header, const std::string &payload,
+					int hlen = -1, long plen = -1)
+{
+	std::vector<unsigned char> f(FRAMEHDR);
+
+	if (hlen < 0)
+		hlen = header.size();
+	if (plen < 0)
+		plen = payload.size();
+	f[0] = FRAMEMAGIC;
+	f[1] = type;
+	f[2] = (hlen >> 8) & 0xff;
+	f[3] = hlen & 0xff;
+	f[4] = (plen >> 24) & 0xff;
+	f[5] = (plen >> 16) & 0xff;
+	f[6] = (plen >> 8) & 0xff;
+	f[7] = plen & 0xff;
+	f.insert(f.end(), header.begin(), header.end());
+	f.insert(f.end(), payload.begin(), payload.end());
+	return f;
+}
+
+static std::string be32(unsigned long v)
+{
+	std::string s(4, 0);
+
+	s[0] = (v >> 24) & 0xff;
+	s[1] = (v >> 16) & 0xff;
+	s[2] = (v >> 8) & 0xff;
+	s[3] = v & 0xff;
+	return s;
+}
+
+static const std::string BLOBHDR("setBLOBVector\0CCD Simulator\0CCD1\0", 33);
+
+/* F_BLOB payload with one BLOB, lengths as given */
+static std::string blobPayload(const std::string &start, const std::string &attrs, const std::string &data,
+				unsigned long startlen, unsigned long n, unsigned long al, unsigned long rl)
+{
+	return be32(startlen) + start + be32(n) + be32(al) + attrs + be32(rl) + data;
+}
+
+/* result of frameNext() on bytes */
+static int next(const std::vector<unsigned char> &bytes)
+{
+	FrameBuf fb;
+	Frame f;
+	unsigned long off = 0;
+
+	memset(&fb, 0, sizeof(fb));
+	if (frameAppend(&fb, (const char *) &bytes[0], bytes.size()) < 0)
+		return -2;
+	int r = frameNext(&fb, &off, &f, MAXPLEN);
+	if (r > 0)
+	{
+		EXPECT_EQ(bytes.size(), off);
+	}
+	frameFree(&fb);
+	return r;
+}
+
+TEST(CORE_FRAME, Test_blob_round_trip)
+{
+	std::string a = binary(100000), b = binary(1);
+	XMLEle *root = parse(blobVector(a, b));
+	char *fcp = NULL;
+	unsigned long fcl = 0;
+
+	ASSERT_TRUE(root);
+	ASSERT_EQ(0, frameBLOB(root, &fcp, &fcl));
+	delXMLEle(root);
+
+	// raw bytes instead of base64
+	ASSERT_LT(fcl, a.size() + b.size() + 512);
+
+	FrameBuf fb;
+	Frame f;
+	unsigned long off = 0;
+
+	memset(&fb, 0, sizeof(fb));
+	ASSERT_EQ(0, frameAppend(&fb, fcp, fcl));
+	free(fcp);
+	ASSERT_EQ(1, frameNext(&fb, &off, &f, MAXPLEN));
+	ASSERT_EQ(fcl, off);
+	ASSERT_EQ(F_BLOB, f.type);
+	ASSERT_STREQ("setBLOBVector", f.tag);
+	ASSERT_STREQ("CCD Simulator", f.dev);
+	ASSERT_STREQ("CCD1", f.name);
+
+	unsigned long cl = 0;
+	char *xml = frameBLOBXML(&f, &cl);
+	ASSERT_EQ(strlen(xml), cl);
+
+	root = parse(std::string(xml, cl));
+	free(xml);
+	ASSERT_TRUE(root);
+	ASSERT_STREQ("Ok", findXMLAttValu(root, "state"));
+	ASSERT_STREQ("2016-01-01T00:00:00", findXMLAttValu(root, "timestamp"));
+
+	XMLEle *ep = nextXMLEle(root, 1);
+	ASSERT_TRUE(ep);
+	ASSERT_STREQ("CCD1", findXMLAttValu(ep, "name"));
+	ASSERT_STREQ(".fits", findXMLAttValu(ep, "format"));
+	// enclen is recomputed from the data
+	ASSERT_EQ(std::to_string(4 * ((a.size() + 2) / 3)), findXMLAttValu(ep, "enclen"));
+	ASSERT_TRUE(a == decoded(ep));
+
+	ep = nextXMLEle(root, 0);
+	ASSERT_TRUE(ep);
+	ASSERT_STREQ("CCD2", findXMLAttValu(ep, "name"));
+	ASSERT_STREQ(".fits.z", findXMLAttValu(ep, "format"));
+	ASSERT_TRUE(b == decoded(ep));
+	ASSERT_FALSE(nextXMLEle(root, 0));
+	delXMLEle(root);
+
+	// local processing sees the vector without its BLOBs
+	root = frameRoot(&f, 1);
+	ASSERT_STREQ("setBLOBVector", tagXMLEle(root));
+	ASSERT_STREQ("CCD1", findXMLAttValu(root, "name"));
+	ASSERT_STREQ("Ok", findXMLAttValu(root, "state"));
+	ASSERT_FALSE(nextXMLEle(root, 1));
+	delXMLEle(root);
+
+	frameFree(&fb);
+}
+
+TEST(CORE_FRAME, Test_empty_blob)
+{
+	XMLEle *root = parse("<setBLOBVector device=\"D\" name=\"B\" state=\"Busy\">"
+		"<oneBLOB name=\"B\" size=\"0\" format=\".fits\"></oneBLOB></setBLOBVector>");
+	char *fcp = NULL;
+	unsigned long fcl = 0, cl = 0, off = 0;
+	FrameBuf fb;
+	Frame f;
+
+	ASSERT_EQ(0, frameBLOB(root, &fcp, &fcl));
+	delXMLEle(root);
+
+	memset(&fb, 0, sizeof(fb));
+	ASSERT_EQ(0, frameAppend(&fb, fcp, fcl));
+	free(fcp);
+	ASSERT_EQ(1, frameNext(&fb, &off, &f, MAXPLEN));
+
+	char *xml = frameBLOBXML(&f, &cl);
+	frameFree(&fb);
+	root = parse(std::string(xml, cl));
+	free(xml);
+	ASSERT_TRUE(root);
+	ASSERT_STREQ("0", findXMLAttValu(nextXMLEle(root, 1), "enclen"));
+	delXMLEle(root);
+}
+
+TEST(CORE_FRAME, Test_bad_base64)
+{
+	XMLEle *root = parse("<setBLOBVector device=\"D\" name=\"B\">"
+		"<oneBLOB name=\"B\" size=\"3\" format=\".fits\">QUJD=</oneBLOB></setBLOBVector>");
+	char *fcp = (char *) 1;
+	unsigned long fcl = 1;
+
+	ASSERT_EQ(-1, frameBLOB(root, &fcp, &fcl));
+	ASSERT_TRUE(fcp == NULL);
+	ASSERT_EQ(0u, fcl);
+	delXMLEle(root);
+}
+
+TEST(CORE_FRAME, Test_xml_split)
+{
+	std::string xml = "<newNumberVector device=\"Mount\" name=\"EQUATORIAL_EOD_COORD\"/>";
+	char *fcp = NULL;
+	unsigned long fcl = 0;
+	unsigned char *p = newFrame(&fcp, &fcl, F_XML, "newNumberVector", "Mount", "EQUATORIAL_EOD_COORD", xml.size());
+
+	memcpy(p, xml.data(), xml.size());
+
+	// two frames in a row, received one byte at a time
+	FrameBuf fb;
+	Frame f;
+	unsigned long off = 0;
+	int frames = 0;
+
+	memset(&fb, 0, sizeof(fb));
+	for (int k = 0; k < 2; k++)
+		for (unsigned long i = 0; i < fcl; i++)
+		{
+			ASSERT_EQ(0, frameAppend(&fb, fcp + i, 1));
+			int r;
+			while ((r = frameNext(&fb, &off, &f, MAXPLEN)) > 0)
+			{
+				ASSERT_EQ(F_XML, f.type);
+				ASSERT_STREQ("Mount", f.dev);
+				ASSERT_STREQ("EQUATORIAL_EOD_COORD", f.name);
+				ASSERT_EQ(xml, std::string((char *) f.payload, f.plen));
+				frames++;
+			}
+			ASSERT_EQ(0, r);
+			frameConsume(&fb, off);
+			off = 0;
+		}
+
+	ASSERT_EQ(2, frames);
+	ASSERT_EQ(0u, fb.len);
+	free(fcp);
+	frameFree(&fb);
+}
+
+TEST(CORE_FRAME, Test_malformed_header)
+{
+	std::string hdr("newTextVector\0Dev\0Prop\0", 23);
+
+	ASSERT_EQ(1, next(rawFrame(F_XML, hdr, "<x/>")));
+
+	std::vector<unsigned char> bad = rawFrame(F_XML, hdr, "<x/>");
+	bad[0] = 0xA4;
+	ASSERT_EQ(-1, next(bad));
+
+	ASSERT_EQ(-1, next(rawFrame(0, hdr, "<x/>")));
+	ASSERT_EQ(-1, next(rawFrame(F_DEVICES + 1, hdr, "<x/>")));
+
+	// too long payloads are refused as soon as the header is in
+	ASSERT_EQ(-1, next(rawFrame(F_XML, hdr, "", -1, MAXPLEN + 1)));
+	ASSERT_EQ(-1, next(rawFrame(F_XML, hdr, "", -1, 0xffffffffL)));
+
+	// header fields
+	ASSERT_EQ(-1, next(rawFrame(F_XML, std::string("\0\0", 2), "")));
+	ASSERT_EQ(-1, next(rawFrame(F_XML, std::string("tag\0dev\0name", 12), "")));
+	ASSERT_EQ(-1, next(rawFrame(F_XML, std::string("tag\0devname\0", 12), "")));
+	ASSERT_EQ(-1, next(rawFrame(F_XML, std::string("\0dev\0name\0", 10), "")));
+	ASSERT_EQ(1, next(rawFrame(F_XML, std::string("tag\0\0\0", 6), "")));
+
+	// incomplete frames wait for more bytes
+	std::vector<unsigned char> part = rawFrame(F_XML, hdr, "<x/>");
+	part.pop_back();
+	ASSERT_EQ(0, next(part));
+	ASSERT_EQ(0, next(rawFrame(F_XML, hdr, "", -1, 10)));
+	ASSERT_EQ(0, next(std::vector<unsigned char>(part.begin(), part.begin() + FRAMEHDR - 1)));
+}
+
+TEST(CORE_FRAME, Test_malformed_blob_lengths)
+{
+	std::string start = "<setBLOBVector device=\"CCD Simulator\" name=\"CCD1\">";
+	std::string attrs = " name=\"CCD1\" size=\"4\" format=\".fits\"";
+	std::string data = "abcd";
+	unsigned long sl = start.size(), al = attrs.size(), rl = data.size();
+
+	ASSERT_EQ(1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 1, al, rl))));
+
+	// payload too short for the fixed fields
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, be32(0))));
+	ASSERT_EQ(1, next(rawFrame(F_BLOB, BLOBHDR, be32(0) + be32(0))));
+
+	// each length beyond the payload
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, 0xfffffff0UL, 1, al, rl))));
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 2, al, rl))));
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 0xffffffffUL, al, rl))));
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 1, 0xfffffffcUL, rl))));
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 1, al, rl + 1))));
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 1, al, 0xffffffffUL))));
+
+	// lengths that do not add up to the payload
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 1, al, rl - 1))));
+	ASSERT_EQ(-1, next(rawFrame(F_BLOB, BLOBHDR, blobPayload(start, attrs, data, sl, 0, al, rl))));
+
+	// only F_BLOB payloads have a layout
+	ASSERT_EQ(1, next(rawFrame(F_XML, BLOBHDR, blobPayload(start, attrs, data, sl, 2, al, rl))));
+}
+
+TEST(CORE_FRAME, Test_read_allocation)
+{
+	std::string hdr("newTextVector\0Dev\0Prop\0", 23);
+	int fds[2];
+	FrameBuf fb;
+
+	ASSERT_EQ(0, pipe(fds));
+	memset(&fb, 0, sizeof(fb));
+
+	// a valid announced length makes room for the whole frame at once
+	std::vector<unsigned char> big = rawFrame(F_XML, hdr, "", -1, 200000);
+	ASSERT_EQ(0, frameAppend(&fb, (const char *) &big[0], big.size()));
+	ASSERT_EQ(1, write(fds[1], "x", 1));
+	ASSERT_EQ(1, frameRead(fds[0], &fb, MAXPLEN));
+	ASSERT_GE(fb.cap, FRAMEHDR + hdr.size() + 200000);
+	frameFree(&fb);
+
+	// an oversized one does not
+	std::vector<unsigned char> huge = rawFrame(F_XML, hdr, "", -1, 0xfffffff0L);
+	ASSERT_EQ(0, frameAppend(&fb, (const char *) &huge[0], huge.size()));
+	ASSERT_EQ(1, write(fds[1], "x", 1));
+	ASSERT_EQ(1, frameRead(fds[0], &fb, MAXPLEN));
+	ASSERT_LT(fb.cap, (unsigned long) MAXPLEN);
+	frameFree(&fb);
+
+	close(fds[0]);
+	close(fds[1]);
+}
@@ -0,0 +1,190 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <locale.h>
+#include <math.h>
+
+#include <string>
+#include <vector>
+
+#include "indidevapi.h"
+#include "indidriver.h"
+
+/* Globals of indidrivermain.c, which this test replaces */
+ROSC *roCheck;
+int nroCheck;
+int verbose;
+char *me = (char *) "test_idmsg";
+LilXML *clixml;
+
+/* Entry points the driver library expects from a driver */
+void ISGetProperties (const char *dev) {}
+void ISNewSwitch (const char *dev, const char *name, ISState *states, char *names[], int n) {}
+void ISNewText (const char *dev, const char *name, char *texts[], char *names[], int n) {}
+void ISNewNumber (const char *dev, const char *name, double *doubles, char *names[], int n) {}
+void ISNewBLOB (const char *dev, const char *name, int sizes[], int blobsizes[], char *blobs[], char *formats[], char *names[], int n) {}
+void ISSnoopDevice (XMLEle *root) {}
+
+/* Run fn and return what it wrote to the standard output */
+template <typename F> static std::string captureStdout(F fn)
+{
+	char path[] = "/tmp/test_idmsgXXXXXX";
+	int fd = mkstemp(path);
+	int saved = dup(STDOUT_FILENO);
+	std::string out;
+	char buf[4096];
+	ssize_t n;
+
+	fflush(stdout);
+	dup2(fd, STDOUT_FILENO);
+	fn();
+	fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	lseek(fd, 0, SEEK_SET);
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		out.append(buf, n);
+	close(fd);
+	unlink(path);
+	return out;
+}
+
+/* The values of the oneNumber elements of a setNumberVector, as sent */
+static std::vector<std::string> numberValues(const std::string &xml)
+{
+	std::vector<std::string> values;
+	size_t pos = 0;
+
+	while ((pos = xml.find("<oneNumber", pos)) != std::string::npos)
+	{
+		size_t start = xml.find('>', pos) + 1;
+		size_t end = xml.find("</oneNumber>", start);
+		std::string v = xml.substr(start, end - start);
+		v.erase(0, v.find_first_not_of(" \n"));
+		v.erase(v.find_last_not_of(" \n") + 1);
+		values.push_back(v);
+		pos = end;
+	}
+	return values;
+}
+
+static std::string setNumbers(const double *values, int n)
+{
+	std::vector<INumber> np(n);
+	INumberVectorProperty nvp;
+
+	for (int i = 0; i < n; i++)
+		IUFillNumber(&np[i], "N", "N", "%g", -1e300, 1e300, 0, values[i]);
+	IUFillNumberVector(&nvp, &np[0], n, "Device", "NUMBERS", "Numbers", "Main", IP_RO, 0, IPS_OK);
+
+	return captureStdout([&]() { IDSetNumber(&nvp, NULL); });
+}
+
+TEST(CORE_IDMSG, Test_PutXMLEscapes)
+{
+	IText tp;
+	ITextVectorProperty tvp;
+
+	IUFillText(&tp, "T", "T", "a&b<c>'d\"e &amp; &#38;");
+	IUFillTextVector(&tvp, &tp, 1, "Dev&ice", "TEXT", "Text", "Main", IP_RO, 0, IPS_OK);
+
+	std::string xml = captureStdout([&]() { IDSetText(&tvp, NULL); });
+
+	// Every special character is escaped, including & that already starts an entity
+	ASSERT_NE(std::string::npos, xml.find("device='Dev&amp;ice'")) << xml;
+	ASSERT_NE(std::string::npos, xml.find("a&amp;b&lt;c&gt;&apos;d&quot;e &amp;amp; &amp;#38;")) << xml;
+
+	IUSaveText(&tp, "");
+	xml = captureStdout([&]() { IDSetText(&tvp, NULL); });
+	ASSERT_NE(std::string::npos, xml.find("<oneText name='T'>")) << xml;
+}
+
+TEST(CORE_IDMSG, Test_NumberShortest)
+{
+	const double values[] = { 0, 1, -0.5, 0.1, 123.456, 42.25, 1e20, -2.5e-7, 1.0/3, 299792458, 1e-300 };
+	const char *expected[] = { "0", "1", "-0.5", "0.1", "123.456", "42.25", "1e+20", "-0.00000025", "0.33333333333333331", "299792458", "1e-300" };
+	int n = sizeof(values) / sizeof(values[0]);
+
+	std::vector<std::string> out = numberValues(setNumbers(values, n));
+	ASSERT_EQ((size_t) n, out.size());
+
+	for (int i = 0; i < n; i++)
+		EXPECT_EQ(expected[i], out[i]) << "value " << i;
+}
+
+TEST(CORE_IDMSG, Test_NumberRoundTrip)
+{
+	std::vector<double> values;
+	unsigned long long x = 88172645463325252ULL;
+
+	for (int i = 0; i < 2000; i++)
+	{
+		double v;
+
+		x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+		memcpy(&v, &x, sizeof(v));
+		if (!isfinite(v))
+			continue;
+		values.push_back(v);
+		values.push_back((double) (long long) (x % 2000000) / 1000.0);
+	}
+
+	std::vector<std::string> out = numberValues(setNumbers(&values[0], values.size()));
+	ASSERT_EQ(values.size(), out.size());
+
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		char *end;
+
+		// The whole value is a number which reads back to the same double
+		ASSERT_EQ(values[i], strtod(out[i].c_str(), &end)) << out[i];
+		ASSERT_EQ('\0', *end) << out[i];
+	}
+}
+
+TEST(CORE_IDMSG, Test_NumberLocale)
+{
+	const char *locales[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", NULL };
+	const double values[] = { 0.5, 1.0/3, 1e20 };
+	char *orig = strdup(setlocale(LC_NUMERIC, NULL));
+	bool found = false;
+
+	for (int i = 0; locales[i] && !found; i++)
+		found = setlocale(LC_NUMERIC, locales[i]) != NULL;
+
+	if (!found)
+	{
+		free(orig);
+		printf("No locale with a decimal comma installed, skipped\n");
+		return;
+	}
+
+	std::vector<std::string> out = numberValues(setNumbers(values, 3));
+	setlocale(LC_NUMERIC, orig);
+	free(orig);
+
+	ASSERT_EQ(3u, out.size());
+	EXPECT_EQ("0.5", out[0]);
+	EXPECT_EQ("0.33333333333333331", out[1]);
+	EXPECT_EQ("1e+20", out[2]);
+}
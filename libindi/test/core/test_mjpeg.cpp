@@ -0,0 +1,225 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "jpegutils.h"
+
+typedef std::vector<unsigned char> Bytes;
+
+/* a test pattern encoded with the standard Huffman tables */
+static Bytes encoded(unsigned int width, unsigned int height, int components)
+{
+	std::vector<unsigned char> image(width * height * components);
+	Bytes jpeg(encode_jpeg_bound(width, height));
+
+	for (unsigned int y = 0; y < height; y++)
+		for (unsigned int x = 0; x < width * components; x++)
+			image[y * width * components + x] = (x * 7 + y * 3 + (x * y) % 31) & 0xff;
+
+	int len = encode_jpeg_image(&jpeg[0], jpeg.size(), 80, width, height, components, &image[0], width * components);
+	EXPECT_GT(len, 0);
+	jpeg.resize(len > 0 ? len : 0);
+	return jpeg;
+}
+
+/* offset of the first marker m, or -1 */
+static long findMarker(const Bytes &jpeg, unsigned char m)
+{
+	size_t pos = 2;
+
+	while (pos + 4 <= jpeg.size() && jpeg[pos] == 0xFF)
+	{
+		if (jpeg[pos + 1] == m)
+			return pos;
+		if (jpeg[pos + 1] == 0xDA)
+			break;
+		pos += 2 + ((jpeg[pos + 2] << 8) | jpeg[pos + 3]);
+	}
+	return -1;
+}
+
+/* the frame as sent by a UVC camera, without DHT segments */
+static Bytes stripDHT(const Bytes &jpeg)
+{
+	Bytes out(jpeg.begin(), jpeg.begin() + 2);
+	size_t pos = 2;
+
+	while (pos + 4 <= jpeg.size())
+	{
+		size_t seglen = 2 + ((jpeg[pos + 2] << 8) | jpeg[pos + 3]);
+		if (jpeg[pos + 1] == 0xDA)
+			break;
+		if (jpeg[pos + 1] != 0xC4)
+			out.insert(out.end(), jpeg.begin() + pos, jpeg.begin() + pos + seglen);
+		pos += seglen;
+	}
+	out.insert(out.end(), jpeg.begin() + pos, jpeg.end());
+	return out;
+}
+
+static int convert(const Bytes &in, Bytes &out)
+{
+	out.assign(in.size() + MJPEG_DHT_SIZE, 0);
+	int len = mjpeg_to_jpeg(in.empty() ? NULL : &in[0], in.size(), &out[0]);
+	if (len >= 0)
+		out.resize(len);
+	return len;
+}
+
+struct decodeError
+{
+	struct jpeg_error_mgr pub;
+	jmp_buf jump;
+};
+
+static void errorExit(j_common_ptr cinfo)
+{
+	longjmp(((struct decodeError *) cinfo->err)->jump, 1);
+}
+
+/* decode with plain libjpeg, which requires Huffman tables in the stream */
+static bool decode(const Bytes &jpeg, Bytes &pixels, bool &tables)
+{
+	struct jpeg_decompress_struct dinfo;
+	struct decodeError err;
+
+	dinfo.err = jpeg_std_error(&err.pub);
+	err.pub.error_exit = errorExit;
+	if (setjmp(err.jump))
+	{
+		jpeg_destroy_decompress(&dinfo);
+		return false;
+	}
+
+	jpeg_create_decompress(&dinfo);
+	jpeg_mem_src(&dinfo, (unsigned char *) &jpeg[0], jpeg.size());
+	jpeg_read_header(&dinfo, TRUE);
+	tables = dinfo.dc_huff_tbl_ptrs[0] && dinfo.ac_huff_tbl_ptrs[0];
+	jpeg_start_decompress(&dinfo);
+
+	size_t row = dinfo.output_width * dinfo.output_components;
+	pixels.resize(row * dinfo.output_height);
+	while (dinfo.output_scanline < dinfo.output_height)
+	{
+		JSAMPROW p = &pixels[dinfo.output_scanline * row];
+		jpeg_read_scanlines(&dinfo, &p, 1);
+	}
+	jpeg_finish_decompress(&dinfo);
+	jpeg_destroy_decompress(&dinfo);
+	return true;
+}
+
+TEST(CORE_MJPEG, Test_with_dht)
+{
+	Bytes jpeg = encoded(64, 48, 3), out;
+
+	ASSERT_GE(findMarker(jpeg, 0xC4), 0);
+
+	// frames with their own tables are copied as they are
+	ASSERT_EQ((int) jpeg.size(), convert(jpeg, out));
+	ASSERT_TRUE(jpeg == out);
+}
+
+TEST(CORE_MJPEG, Test_without_dht)
+{
+	for (int components = 1; components <= 3; components += 2)
+	{
+		Bytes jpeg = encoded(160, 120, components), out, ref, pix;
+		Bytes mjpeg = stripDHT(jpeg);
+		bool tables = false;
+
+		ASSERT_LT(findMarker(mjpeg, 0xC4), 0);
+		ASSERT_EQ((int) (mjpeg.size() + MJPEG_DHT_SIZE), convert(mjpeg, out));
+
+		// the tables go right before the scan, the rest is unchanged
+		long sos = findMarker(mjpeg, 0xDA);
+		ASSERT_GT(sos, 0);
+		ASSERT_EQ(sos, findMarker(out, 0xC4));
+		ASSERT_EQ(MJPEG_DHT_SIZE - 2, (out[sos + 2] << 8) | out[sos + 3]);
+		ASSERT_TRUE(std::equal(mjpeg.begin(), mjpeg.begin() + sos, out.begin()));
+		ASSERT_TRUE(std::equal(mjpeg.begin() + sos, mjpeg.end(), out.begin() + sos + MJPEG_DHT_SIZE));
+
+		// and decode to the same image as the original
+		ASSERT_TRUE(decode(jpeg, ref, tables));
+		ASSERT_TRUE(decode(out, pix, tables));
+		ASSERT_TRUE(tables);
+		ASSERT_TRUE(ref == pix);
+
+		// converting again keeps the added tables
+		Bytes again;
+		ASSERT_EQ((int) out.size(), convert(out, again));
+		ASSERT_TRUE(out == again);
+	}
+}
+
+TEST(CORE_MJPEG, Test_fill_bytes)
+{
+	Bytes mjpeg = stripDHT(encoded(32, 32, 1)), out;
+	long sos = findMarker(mjpeg, 0xDA);
+
+	// fill bytes before a marker are allowed
+	mjpeg.insert(mjpeg.begin() + sos, 3, 0xFF);
+	ASSERT_EQ((int) (mjpeg.size() + MJPEG_DHT_SIZE), convert(mjpeg, out));
+}
+
+TEST(CORE_MJPEG, Test_invalid)
+{
+	Bytes mjpeg = stripDHT(encoded(32, 32, 1)), out;
+
+	ASSERT_EQ(-1, convert(Bytes(), out));
+	ASSERT_EQ(-1, convert(Bytes(mjpeg.begin(), mjpeg.begin() + 3), out));
+
+	// not a JPEG image
+	Bytes png = mjpeg;
+	png[0] = 0x89;
+	png[1] = 'P';
+	ASSERT_EQ(-1, convert(png, out));
+
+	// garbage where a marker is expected
+	Bytes bad = mjpeg;
+	bad[2] = 0x00;
+	ASSERT_EQ(-1, convert(bad, out));
+
+	// a segment length running past the end
+	bad = mjpeg;
+	bad[4] = 0xFF;
+	bad[5] = 0xFF;
+	ASSERT_EQ(-1, convert(bad, out));
+}
+
+TEST(CORE_MJPEG, Test_truncated)
+{
+	Bytes mjpeg = stripDHT(encoded(32, 32, 1)), out;
+	long sos = findMarker(mjpeg, 0xDA);
+
+	// cut anywhere before the scan: no complete scan header to insert before
+	for (long n = 0; n < sos + 4; n++)
+		ASSERT_EQ(-1, convert(Bytes(mjpeg.begin(), mjpeg.begin() + n), out)) << "length " << n;
+
+	// cut inside the scan: the frame is still completed with tables
+	Bytes cut(mjpeg.begin(), mjpeg.begin() + sos + 20);
+	ASSERT_EQ((int) (cut.size() + MJPEG_DHT_SIZE), convert(cut, out));
+}
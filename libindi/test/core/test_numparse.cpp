@@ -0,0 +1,193 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <math.h>
+#include <float.h>
+
+#include "indicom.h"
+
+/* f_scansexa as it was before f_strtod, used as the reference */
+static int old_scansexa(const char *str0, double *dp)
+{
+	char *orig = setlocale(LC_NUMERIC, "C");
+	double a = 0, b = 0, c = 0;
+	char str[128];
+	char *neg;
+	int r;
+
+	strncpy(str, str0, sizeof(str)-1);
+	str[sizeof(str)-1] = '\0';
+	neg = strchr(str, '-');
+	if (neg)
+		*neg = ' ';
+
+	r = sscanf(str, "%lf%*[^0-9]%lf%*[^0-9]%lf", &a, &b, &c);
+	setlocale(LC_NUMERIC, orig);
+	if (r < 1)
+		return -1;
+	*dp = a + b/60 + c/3600;
+	if (neg)
+		*dp *= -1;
+	return 0;
+}
+
+/* f_strtod must give the same value and end position as strtod in the C locale */
+static void expect_like_strtod(const char *str)
+{
+	char *end, *ref_end;
+	double ref = strtod(str, &ref_end);
+	double val = f_strtod(str, &end);
+
+	EXPECT_EQ(ref_end - str, end - str) << "input \"" << str << "\"";
+	if (isnan(ref))
+		EXPECT_TRUE(isnan(val)) << "input \"" << str << "\"";
+	else
+		EXPECT_EQ(0, memcmp(&ref, &val, sizeof(double))) << "input \"" << str << "\": " << ref << " != " << val;
+}
+
+static const char *decimal_inputs[] =
+{
+	"0", "-0", "+1", "0.1", "0.3", "1.5", "-2.25", "   42", "\t-7.125",
+	"5.", ".5", "-.5e+2", "1e5", "1E-5", "2.5e-7", "123.456e2",
+	"3.141592653589793", "2.718281828459045235360287", "0.1000000000000000055511151231257827",
+	"9007199254740993", "123456789012345678901234", "12345678901234567890",
+	"1e22", "1e23", "1e-22", "1e-23", "1e308", "1e-300", "1e400", "1e-400", "4.9e-324",
+	"1e", "1e+", "1e-x", "12abc", "12:30:45", "1.2.3",
+	"inf", "-INF", "nan", "infinity", "0x1p3", "-0x10",
+	"", ".", "-", "+.", "abc"
+};
+
+TEST(CORE_NUMPARSE, Test_f_strtod_decimal)
+{
+	for (size_t i = 0; i < sizeof(decimal_inputs)/sizeof(decimal_inputs[0]); i++)
+		expect_like_strtod(decimal_inputs[i]);
+}
+
+TEST(CORE_NUMPARSE, Test_f_strtod_random)
+{
+	static const char *formats[] = { "%.17g", "%.6f", "%g", "%.3e", "%.10f" };
+	char buf[64];
+
+	srand(20161019);
+	for (int i = 0; i < 20000; i++)
+	{
+		double v = ((double) rand() / RAND_MAX - 0.5) * pow(10, rand() % 40 - 20);
+		snprintf(buf, sizeof(buf), formats[i % 5], v);
+		expect_like_strtod(buf);
+	}
+}
+
+TEST(CORE_NUMPARSE, Test_f_strtod_null_endptr)
+{
+	ASSERT_EQ(1.5, f_strtod("1.5", NULL));
+	ASSERT_EQ(1e-30, f_strtod("1e-30", NULL));
+}
+
+/* separators, signs and missing components are handled like the sscanf version */
+TEST(CORE_NUMPARSE, Test_f_scansexa_like_old)
+{
+	static const char *inputs[] =
+	{
+		"12:30:45", "-12:30:45", "+5 30", "12.5", " 23h59m59.9s", "-0:30",
+		"1:2:3:4", "45*30'15\"", "12:", "12:30:", "-00:00:01", "359:59:59.999",
+		"10 20 30", "7,5", "1.5e3:30"
+	};
+
+	for (size_t i = 0; i < sizeof(inputs)/sizeof(inputs[0]); i++)
+	{
+		double ref = 0, val = 0;
+		int rref = old_scansexa(inputs[i], &ref);
+		int rval = f_scansexa(inputs[i], &val);
+
+		EXPECT_EQ(rref, rval) << "input \"" << inputs[i] << "\"";
+		EXPECT_DOUBLE_EQ(ref, val) << "input \"" << inputs[i] << "\"";
+	}
+}
+
+TEST(CORE_NUMPARSE, Test_f_scansexa_bad_input)
+{
+	static const char *inputs[] = { "", "   ", "-", "abc", ":30:00", "- +" };
+	double val = 123;
+
+	for (size_t i = 0; i < sizeof(inputs)/sizeof(inputs[0]); i++)
+	{
+		EXPECT_EQ(-1, f_scansexa(inputs[i], &val)) << "input \"" << inputs[i] << "\"";
+		EXPECT_EQ(123, val);
+	}
+}
+
+TEST(CORE_NUMPARSE, Test_f_scansexa_exponent)
+{
+	double val = 0;
+
+	// the old version took the exponent sign as the sign of the value
+	ASSERT_EQ(0, f_scansexa("1e-5", &val));
+	ASSERT_DOUBLE_EQ(1e-5, val);
+	ASSERT_EQ(0, f_scansexa("-2.5E-3", &val));
+	ASSERT_DOUBLE_EQ(-2.5e-3, val);
+}
+
+/* '.' stays the decimal point whatever LC_NUMERIC says */
+TEST(CORE_NUMPARSE, Test_comma_locale)
+{
+	static const char *locales[] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "fr_FR.utf8", "de_DE", "fr_FR" };
+	char *orig = strdup(setlocale(LC_NUMERIC, NULL));
+	const char *loc = NULL;
+
+	for (size_t i = 0; i < sizeof(locales)/sizeof(locales[0]) && !loc; i++)
+		if (setlocale(LC_NUMERIC, locales[i]) && localeconv()->decimal_point[0] == ',')
+			loc = locales[i];
+
+	if (!loc)
+	{
+		printf("No locale with a decimal comma installed, skipping.\n");
+		setlocale(LC_NUMERIC, orig);
+		free(orig);
+		return;
+	}
+
+	char *end;
+	double val = 0;
+
+	// fast path
+	EXPECT_EQ(1.5, f_strtod("1.5", &end));
+	EXPECT_STREQ("", end);
+	EXPECT_EQ(1.0, f_strtod("1,5", &end));
+	EXPECT_STREQ(",5", end);
+
+	// strtod fallback with the decimal point swapped
+	EXPECT_EQ(1.2345678901234567890123, f_strtod("1.2345678901234567890123", &end));
+	EXPECT_STREQ("", end);
+	EXPECT_EQ(DBL_MIN, f_strtod("2.2250738585072014e-308", &end));
+	EXPECT_STREQ("", end);
+	EXPECT_EQ(DBL_MIN / 4, f_strtod("5.562684646268003e-309", &end));
+	EXPECT_EQ(0.0, f_strtod("1.0e-400", &end));
+	EXPECT_STREQ("", end);
+	EXPECT_EQ(1.0, f_strtod("1,0e-400", &end));
+	EXPECT_STREQ(",0e-400", end);
+
+	EXPECT_EQ(0, f_scansexa("-12:30:45.5", &val));
+	EXPECT_DOUBLE_EQ(-(12 + 30/60.0 + 45.5/3600), val);
+
+	setlocale(LC_NUMERIC, orig);
+	free(orig);
+}
@@ -0,0 +1,189 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "indibase.h"
+#include "drivers/ccd/star_catalog.h"
+
+static std::string tempCatalog()
+{
+	char name[] = "/tmp/test_star_catalogXXXXXX";
+	int fd = mkstemp(name);
+	close(fd);
+	return name;
+}
+
+static void writeText(const std::string &path, const char *text)
+{
+	FILE *fp = fopen(path.c_str(), "w");
+	ASSERT_TRUE(fp != NULL);
+	fputs(text, fp);
+	fclose(fp);
+}
+
+static void setMTime(const std::string &path, time_t when)
+{
+	struct utimbuf times = { when, when };
+	ASSERT_EQ(0, utime(path.c_str(), &times));
+}
+
+TEST(CORE_STAR_CATALOG, Test_CacheRoundTrip)
+{
+	char errmsg[MAXRBUF];
+	std::string text = tempCatalog();
+	std::string bin  = text + ".bin";
+
+	writeText(text, "# ra dec mag\n10.5 20.25 5.5\n10.6 20.30 7.0\n200 -45 9.0\n");
+
+	StarCatalog first;
+	ASSERT_TRUE(first.load(text.c_str(), errmsg)) << errmsg;
+	ASSERT_EQ(3u, first.size());
+	ASSERT_EQ(0, access(bin.c_str(), R_OK));
+
+	// The cache is newer than the source, so the next load reads it even if the text is now invalid
+	writeText(text, "not a catalog\n");
+	setMTime(text, 1000);
+	setMTime(bin, 2000);
+
+	StarCatalog second;
+	ASSERT_TRUE(second.load(text.c_str(), errmsg)) << errmsg;
+	ASSERT_EQ(3u, second.size());
+
+	const std::vector<CatalogStar> &a = first.query(10.55, 20.25, 1, 20);
+	const std::vector<CatalogStar> &b = second.query(10.55, 20.25, 1, 20);
+	ASSERT_EQ(2u, a.size());
+	ASSERT_EQ(a.size(), b.size());
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		ASSERT_FLOAT_EQ(a[i].ra, b[i].ra);
+		ASSERT_FLOAT_EQ(a[i].dec, b[i].dec);
+		ASSERT_FLOAT_EQ(a[i].mag, b[i].mag);
+	}
+
+	// A stale cache is ignored and the text is parsed again
+	setMTime(bin, 500);
+
+	StarCatalog third;
+	ASSERT_FALSE(third.load(text.c_str(), errmsg));
+
+	unlink(text.c_str());
+	unlink(bin.c_str());
+}
+
+TEST(CORE_STAR_CATALOG, Test_TruncatedBinary)
+{
+	char errmsg[MAXRBUF];
+	std::string path = tempCatalog();
+
+	// Header claims far more stars than the file holds
+	FILE *fp = fopen(path.c_str(), "wb");
+	ASSERT_TRUE(fp != NULL);
+	uint32_t header[2] = { 1, 0x40000000 };
+	float star[3] = { 1, 2, 3 };
+	fwrite("INDISCAT", 1, 8, fp);
+	fwrite(header, sizeof(uint32_t), 2, fp);
+	fwrite(star, sizeof(float), 3, fp);
+	fclose(fp);
+
+	StarCatalog catalog;
+	ASSERT_FALSE(catalog.load(path.c_str(), errmsg));
+	ASSERT_TRUE(strstr(errmsg, "truncated") != NULL);
+	ASSERT_FALSE(catalog.isLoaded());
+
+	unlink(path.c_str());
+}
+
+/* stars of the result as sorted "ra dec" strings */
+static std::vector<std::string> found(const std::vector<CatalogStar> &result)
+{
+	std::vector<std::string> names;
+	char name[64];
+
+	for (size_t i = 0; i < result.size(); i++)
+	{
+		snprintf(name, sizeof(name), "%g %g", result[i].ra, result[i].dec);
+		names.push_back(name);
+	}
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+static std::vector<std::string> expected(const char **names, size_t n)
+{
+	std::vector<std::string> v(names, names + n);
+	std::sort(v.begin(), v.end());
+	return v;
+}
+
+TEST(CORE_STAR_CATALOG, Test_ConeSearch)
+{
+	char errmsg[MAXRBUF];
+	std::string text = tempCatalog();
+	std::string bin  = text + ".bin";
+
+	// Stars inside a cone are well within the radius, stars outside well beyond the cache margin
+	writeText(text,
+		"# around 0h\n"
+		"359.6 0 5\n0 0.5 5\n0.9 -0.4 5\n358.5 0 5\n2 0 5\n359.9 0.2 12\n"
+		"# on declination band edges\n"
+		"100 10 5\n100 9.9999 5\n100.3 11 5\n100 11.9 5\n100 9 5\n"
+		"# around the poles\n"
+		"180 89.8 5\n90 89.9 5\n45 88 5\n0 -90 5\n123 -88 5\n");
+
+	StarCatalog catalog;
+	ASSERT_TRUE(catalog.load(text.c_str(), errmsg)) << errmsg;
+	ASSERT_EQ(16u, catalog.size());
+
+	// Cones crossing 0h from either side, the faint star is below the magnitude limit
+	const char *wrap[] = { "359.6 0", "0 0.5", "0.9 -0.4" };
+	ASSERT_EQ(expected(wrap, 3), found(catalog.query(0.3, 0, 1, 10)));
+	ASSERT_EQ(expected(wrap, 3), found(catalog.query(359.8, 0, 1, 10.5)));
+	ASSERT_EQ(expected(wrap, 3), found(catalog.query(-0.2, 0, 1, 11)));
+
+	const char *faint[] = { "359.6 0", "0 0.5", "0.9 -0.4", "359.9 0.2" };
+	ASSERT_EQ(expected(faint, 4), found(catalog.query(0.3, 0, 1, 12)));
+
+	// Stars at the first declination of a band and just below it
+	const char *edges[] = { "100 10", "100 9.9999", "100.3 11" };
+	ASSERT_EQ(expected(edges, 3), found(catalog.query(100, 10.5, 1, 10)));
+
+	const char *upper[] = { "100.3 11", "100 11.9" };
+	ASSERT_EQ(expected(upper, 2), found(catalog.query(100.3, 11.5, 0.6, 10)));
+
+	// Cones containing a pole cover every RA
+	const char *north[] = { "180 89.8", "90 89.9" };
+	ASSERT_EQ(expected(north, 2), found(catalog.query(0, 89.6, 1, 10)));
+
+	const char *south[] = { "0 -90" };
+	ASSERT_EQ(expected(south, 1), found(catalog.query(123, -89.5, 1, 10)));
+
+	ASSERT_TRUE(catalog.query(250, -40, 1, 20).empty());
+
+	unlink(text.c_str());
+	unlink(bin.c_str());
+}
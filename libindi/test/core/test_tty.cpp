@@ -0,0 +1,293 @@
+/*******************************************************************************
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "indicom.h"
+
+/* A socket pair stands in for the serial port: fds[0] is the driver side, fds[1] the device */
+class TTYTest : public ::testing::Test
+{
+	protected:
+		virtual void SetUp()
+		{
+			ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+		}
+
+		virtual void TearDown()
+		{
+			if (fds[0] != -1)
+				tty_disconnect(fds[0]);
+			if (fds[1] != -1)
+				close(fds[1]);
+		}
+
+		void device(const std::string &data)
+		{
+			ASSERT_EQ((ssize_t) data.size(), write(fds[1], data.data(), data.size()));
+		}
+
+		std::string section(char stop = '#', int expected = TTY_OK)
+		{
+			char buf[8192];
+			int nr = 0;
+
+			EXPECT_EQ(expected, tty_read_section(fds[0], buf, stop, 0, &nr));
+			return std::string(buf, nr);
+		}
+
+		int fds[2];
+};
+
+TEST_F(TTYTest, Test_readahead)
+{
+	device("AB#CD#EF");
+
+	// the whole reply is read at once and later sections come from the ring
+	ASSERT_EQ("AB#", section());
+	ASSERT_EQ("CD#", section());
+	section('#', TTY_TIME_OUT);
+
+	device("G#");
+	ASSERT_EQ("EFG#", section());
+}
+
+TEST_F(TTYTest, Test_read_then_section)
+{
+	char buf[8];
+	int nr = 0;
+
+	device("12345#");
+	ASSERT_EQ(TTY_OK, tty_read(fds[0], buf, 2, 0, &nr));
+	ASSERT_EQ(2, nr);
+	ASSERT_EQ(0, memcmp(buf, "12", 2));
+	ASSERT_EQ("345#", section());
+
+	device("ab");
+	ASSERT_EQ(TTY_TIME_OUT, tty_read(fds[0], buf, 3, 0, &nr));
+}
+
+TEST_F(TTYTest, Test_ring_wrap)
+{
+	std::vector<std::string> frames;
+	std::string all;
+
+	// frames of varying length that cross the end of the ring several times
+	for (int i = 0; all.size() < 3 * 4096; i++)
+	{
+		std::string f(1 + (i * 37) % 300, 'a' + i % 26);
+		f += '#';
+		frames.push_back(f);
+		all += f;
+	}
+
+	size_t sent = 0;
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		// keep the device at most a few frames ahead
+		while (sent < all.size() && sent < (i + 4) * 300)
+		{
+			size_t n = std::min((size_t) 1000, all.size() - sent);
+			device(all.substr(sent, n));
+			sent += n;
+		}
+		ASSERT_EQ(frames[i], section()) << "frame " << i;
+	}
+}
+
+TEST_F(TTYTest, Test_section_longer_than_ring)
+{
+	std::string big(5000, 'x');
+
+	device(big + "#");
+	ASSERT_EQ(big + "#", section());
+}
+
+TEST_F(TTYTest, Test_write_keeps_readahead)
+{
+	int nw = 0;
+
+	// replies to pipelined commands arrive in one read
+	device("ONE#TWO#");
+	ASSERT_EQ("ONE#", section());
+
+	// a write between two reads must not lose the second reply
+	ASSERT_EQ(TTY_OK, tty_write_string(fds[0], "cmd", &nw));
+	ASSERT_EQ(TTY_OK, tty_write(fds[0], "cmd", 3, &nw));
+	device("THREE#");
+	ASSERT_EQ("TWO#", section());
+	ASSERT_EQ("THREE#", section());
+}
+
+TEST_F(TTYTest, Test_flush)
+{
+	device("A#B#");
+	ASSERT_EQ("A#", section());
+
+	// tcflush fails on a socket, the readahead must be gone anyway
+	tty_flush(fds[0]);
+	device("C#");
+	ASSERT_EQ("C#", section());
+}
+
+TEST_F(TTYTest, Test_tcflush)
+{
+	device("A#B#");
+	ASSERT_EQ("A#", section());
+
+	// drivers flushing the port directly drop the readahead too
+	tcflush(fds[0], TCIOFLUSH);
+	device("C#");
+	ASSERT_EQ("C#", section());
+
+	device("D#E#");
+	ASSERT_EQ("D#", section());
+	tcflush(fds[0], TCIFLUSH);
+	device("F#");
+	ASSERT_EQ("F#", section());
+
+	// flushing output only keeps it
+	device("G#H#");
+	ASSERT_EQ("G#", section());
+	tcflush(fds[0], TCOFLUSH);
+	ASSERT_EQ("H#", section());
+}
+
+TEST_F(TTYTest, Test_nread_section)
+{
+	char buf[8];
+	int nr = 0;
+
+	device("12345#ABCDEFGHIJK#");
+	ASSERT_EQ(TTY_OK, tty_nread_section(fds[0], buf, sizeof(buf), '#', 0, &nr));
+	ASSERT_EQ("12345#", std::string(buf, nr));
+
+	// a reply longer than buf fills it and leaves the rest for the next read
+	ASSERT_EQ(TTY_OVERFLOW, tty_nread_section(fds[0], buf, sizeof(buf), '#', 0, &nr));
+	ASSERT_EQ("ABCDEFGH", std::string(buf, nr));
+	ASSERT_EQ(TTY_OK, tty_nread_section(fds[0], buf, sizeof(buf), '#', 0, &nr));
+	ASSERT_EQ("IJK#", std::string(buf, nr));
+
+	// also when the delimiter has not arrived yet
+	device("0123456789");
+	ASSERT_EQ(TTY_OVERFLOW, tty_nread_section(fds[0], buf, sizeof(buf), '#', 0, &nr));
+	ASSERT_EQ(8, nr);
+	device("#");
+	ASSERT_EQ("89#", section());
+
+	// exactly filling buf is fine
+	device("abcdefg#");
+	ASSERT_EQ(TTY_OK, tty_nread_section(fds[0], buf, sizeof(buf), '#', 0, &nr));
+	ASSERT_EQ("abcdefg#", std::string(buf, nr));
+
+	ASSERT_EQ(TTY_PARAM_ERROR, tty_nread_section(fds[0], buf, 0, '#', 0, &nr));
+}
+
+TEST_F(TTYTest, Test_close_and_fd_reuse)
+{
+	int old = fds[0];
+
+	device("A#B#");
+	ASSERT_EQ("A#", section());
+
+	// closed without tty_disconnect(), the next file on this fd must not see B#
+	close(fds[0]);
+	close(fds[1]);
+	ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+	ASSERT_EQ(old, fds[0]);
+
+	device("C#");
+	ASSERT_EQ("C#", section());
+	section('#', TTY_TIME_OUT);
+}
+
+TEST_F(TTYTest, Test_disconnect_and_fd_reuse)
+{
+	int old = fds[0];
+
+	device("A#B#");
+	ASSERT_EQ("A#", section());
+
+	ASSERT_EQ(TTY_OK, tty_disconnect(fds[0]));
+	close(fds[1]);
+
+	// the lowest free descriptor is the one just closed
+	ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+	ASSERT_EQ(old, fds[0]);
+
+	device("C#");
+	ASSERT_EQ("C#", section());
+	section('#', TTY_TIME_OUT);
+}
+
+TEST_F(TTYTest, Test_read_error)
+{
+	close(fds[1]);
+	fds[1] = -1;
+
+	section('#', TTY_READ_ERROR);
+}
+
+static std::vector<std::string> frames_seen;
+static int frame_errors;
+
+static void frame_cb(int, const char *frame, int len, void *userdata)
+{
+	ASSERT_EQ((void *) &frames_seen, userdata);
+	if (frame == NULL)
+		frame_errors++;
+	else
+		frames_seen.push_back(std::string(frame, len));
+}
+
+TEST_F(TTYTest, Test_frame_callback)
+{
+	int nw = 0;
+
+	frames_seen.clear();
+	frame_errors = 0;
+	ASSERT_EQ(TTY_OK, tty_set_frame_callback(fds[0], '\n', frame_cb, &frames_seen));
+
+	device("X\nY\nZ");
+	tty_frame_handler(fds[0], NULL);
+	ASSERT_EQ(2u, frames_seen.size());
+	ASSERT_EQ("X\n", frames_seen[0]);
+	ASSERT_EQ("Y\n", frames_seen[1]);
+
+	// the partial frame survives writes in frame mode
+	ASSERT_EQ(TTY_OK, tty_write_string(fds[0], "cmd", &nw));
+	device("\n");
+	tty_frame_handler(fds[0], NULL);
+	ASSERT_EQ(3u, frames_seen.size());
+	ASSERT_EQ("Z\n", frames_seen[2]);
+
+	close(fds[1]);
+	fds[1] = -1;
+	tty_frame_handler(fds[0], NULL);
+	ASSERT_EQ(1, frame_errors);
+
+	ASSERT_EQ(TTY_OK, tty_set_frame_callback(fds[0], '\n', NULL, NULL));
+}
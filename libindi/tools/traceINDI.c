@@ -0,0 +1,459 @@
+/* report the BLOB latency traces written by drivers, indiserver and clients
+ *   running with INDI_TRACE set to a directory, see inditrace.h.
+ * per-hop histograms of all processes are merged from the *.hist files and
+ *   the frames logged by clients in *.log files are broken down hop by hop.
+ * exit status: 0 if a report was printed, 1 if nothing was found, 2 trouble.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+
+#include "inditrace.h"
+
+#define MAXHOPS		32		/* distinct histograms in a report */
+#define DEFSLOWEST	10		/* default number of slowest frames shown */
+
+/* one merged histogram */
+typedef struct {
+    char hop[32];
+    unsigned long count;
+    unsigned long long sum;
+    unsigned long long max;
+    unsigned long bucket[INDI_TRACE_BUCKETS];
+} Hist;
+
+/* one traced frame of a client log, latencies in us, -1 if unknown */
+typedef struct {
+    char dev[64];
+    char name[64];
+    long long hop[5];
+    long long total;
+} Frame;
+
+/* frame breakdown: name and the two stamps bounding each hop */
+static const char *frhops[5][3] = {
+    {"prepare",	"exp", "set"},
+    {"queue",	"set", "drv"},
+    {"transfer",	"drv", "srv"},
+    {"send",	"srv", "cli"},
+    {"decode",	"cli", "done"},
+};
+
+/* histograms in the order a BLOB goes through them */
+static const char *order[] = {
+    "driver_prepare", "driver_encode", "driver_write", "server_read",
+    "server_send", "client_receive", "client_decode", "total", NULL
+};
+
+static void usage (void);
+static int readHists (const char *dir);
+static void readHist (const char *path);
+static Hist *findHist (const char *hop);
+static void printHist (Hist *hp);
+static void printHists (void);
+static unsigned long long percentile (Hist *hp, double p);
+static int readLogs (const char *dir);
+static void readLog (const char *path);
+static void addFrame (const char *dev, const char *name, const char *trace);
+static void printFrames (void);
+static int cmpFrames (const void *a, const void *b);
+static int hasSuffix (const char *name, const char *suffix);
+
+static char *me;			/* our name for usage() message */
+static int slowest = DEFSLOWEST;	/* slowest frames shown */
+static int verbose;			/* report extra info */
+static Hist hists[MAXHOPS];		/* merged histograms */
+static int nhists;
+static Frame *frames;			/* frames of all client logs */
+static int nframes;
+
+int
+main (int ac, char *av[])
+{
+	const char *dir;
+
+	/* save our name */
+	me = av[0];
+
+	/* crack args */
+	while (--ac && **++av == '-') {
+	    char *s = *av;
+	    while (*++s) {
+		switch (*s) {
+		case 'n':
+		    if (ac < 2) {
+			fprintf (stderr, "-n requires number of frames\n");
+			usage();
+		    }
+		    slowest = atoi(*++av);
+		    ac--;
+		    break;
+		case 'v':
+		    verbose++;
+		    break;
+		default:
+		    usage();
+		}
+	    }
+	}
+
+	/* trace directory from the argument or the environment */
+	if (ac > 1)
+	    usage();
+	dir = ac == 1 ? av[0] : getenv (INDI_TRACE_ENV);
+	if (!dir || !dir[0]) {
+	    fprintf (stderr, "No trace directory given and %s is not set\n",
+							    INDI_TRACE_ENV);
+	    usage();
+	}
+
+	if (readHists (dir) < 0 || readLogs (dir) < 0)
+	    return (2);
+
+	if (nhists == 0 && nframes == 0) {
+	    fprintf (stderr, "%s: no traces found\n", dir);
+	    return (1);
+	}
+
+	printHists();
+	printFrames();
+
+	return (0);
+}
+
+static void
+usage()
+{
+	fprintf(stderr, "Purpose: report BLOB latency traces of INDI processes\n");
+	fprintf(stderr, "Usage: %s [options] [directory]\n", me);
+	fprintf(stderr, "  directory defaults to $%s\n", INDI_TRACE_ENV);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "  -n n : show the n slowest frames, default %d\n",
+								DEFSLOWEST);
+	fprintf(stderr, "  -v   : list the files read\n");
+
+	exit (2);
+}
+
+/* merge every *.hist file of dir.
+ * return 0 if ok else -1.
+ */
+static int
+readHists (const char *dir)
+{
+	char path[1024];
+	struct dirent *de;
+	DIR *dp;
+
+	dp = opendir (dir);
+	if (!dp) {
+	    fprintf (stderr, "%s: %s\n", dir, strerror(errno));
+	    return (-1);
+	}
+
+	while ((de = readdir (dp)) != NULL) {
+	    if (!hasSuffix (de->d_name, ".hist"))
+		continue;
+	    snprintf (path, sizeof(path), "%s/%s", dir, de->d_name);
+	    readHist (path);
+	}
+
+	closedir (dp);
+	return (0);
+}
+
+/* add the histograms of one file */
+static void
+readHist (const char *path)
+{
+	char line[2048];
+	FILE *fp;
+
+	fp = fopen (path, "r");
+	if (!fp) {
+	    fprintf (stderr, "%s: %s\n", path, strerror(errno));
+	    return;
+	}
+
+	if (verbose)
+	    fprintf (stderr, "reading %s\n", path);
+
+	while (fgets (line, sizeof(line), fp)) {
+	    char hop[32], *p;
+	    unsigned long count;
+	    unsigned long long sum, max;
+	    Hist *hp;
+	    int n, i;
+
+	    if (line[0] == '#')
+		continue;
+	    if (sscanf (line, "%31s %lu %llu %llu%n", hop, &count, &sum, &max,
+								    &n) != 4)
+		continue;
+
+	    hp = findHist (hop);
+	    if (!hp)
+		continue;
+
+	    hp->count += count;
+	    hp->sum += sum;
+	    if (max > hp->max)
+		hp->max = max;
+
+	    p = line + n;
+	    for (i = 0; i < INDI_TRACE_BUCKETS; i++)
+		hp->bucket[i] += strtoul (p, &p, 10);
+	}
+
+	fclose (fp);
+}
+
+/* return the merged histogram of hop, adding it if new, NULL if full */
+static Hist *
+findHist (const char *hop)
+{
+	int i;
+
+	for (i = 0; i < nhists; i++)
+	    if (!strcmp (hists[i].hop, hop))
+		return (&hists[i]);
+
+	if (nhists == MAXHOPS)
+	    return (NULL);
+
+	strncpy (hists[nhists].hop, hop, sizeof(hists[nhists].hop)-1);
+	return (&hists[nhists++]);
+}
+
+/* return the upper bound, in us, of the bucket holding fraction p of the
+ * latencies of hp, never more than the maximum seen.
+ */
+static unsigned long long
+percentile (Hist *hp, double p)
+{
+	unsigned long long bound;
+	unsigned long sum = 0;
+	int i;
+
+	for (i = 0; i < INDI_TRACE_BUCKETS; i++) {
+	    sum += hp->bucket[i];
+	    if (sum >= p * hp->count)
+		break;
+	}
+
+	bound = 1ULL << (i < INDI_TRACE_BUCKETS ? i : INDI_TRACE_BUCKETS-1);
+	return (bound < hp->max ? bound : hp->max);
+}
+
+/* print one histogram */
+static void
+printHist (Hist *hp)
+{
+	printf ("%-16s %8lu %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+	    hp->hop, hp->count,
+	    hp->count ? hp->sum / 1e3 / hp->count : 0.0,
+	    percentile (hp, 0.50) / 1e3,
+	    percentile (hp, 0.90) / 1e3,
+	    percentile (hp, 0.99) / 1e3,
+	    hp->max / 1e3);
+}
+
+/* print one line per histogram, pipeline hops first */
+static void
+printHists (void)
+{
+	int printed[MAXHOPS];
+	int i, j;
+
+	if (nhists == 0)
+	    return;
+
+	memset (printed, 0, sizeof(printed));
+
+	printf ("%-16s %8s %10s %10s %10s %10s %10s\n", "hop (ms)", "count",
+				"mean", "p50", "p90", "p99", "max");
+
+	for (j = 0; order[j]; j++)
+	    for (i = 0; i < nhists; i++)
+		if (!strcmp (hists[i].hop, order[j])) {
+		    printHist (&hists[i]);
+		    printed[i] = 1;
+		}
+
+	/* then whatever else was recorded */
+	for (i = 0; i < nhists; i++)
+	    if (!printed[i])
+		printHist (&hists[i]);
+}
+
+/* read the frames of every *.log file of dir.
+ * return 0 if ok else -1.
+ */
+static int
+readLogs (const char *dir)
+{
+	char path[1024];
+	struct dirent *de;
+	DIR *dp;
+
+	dp = opendir (dir);
+	if (!dp) {
+	    fprintf (stderr, "%s: %s\n", dir, strerror(errno));
+	    return (-1);
+	}
+
+	while ((de = readdir (dp)) != NULL) {
+	    if (!hasSuffix (de->d_name, ".log"))
+		continue;
+	    snprintf (path, sizeof(path), "%s/%s", dir, de->d_name);
+	    readLog (path);
+	}
+
+	closedir (dp);
+	return (0);
+}
+
+/* add the frames of one client log, lines are device TAB name TAB trace */
+static void
+readLog (const char *path)
+{
+	char line[1024];
+	FILE *fp;
+
+	fp = fopen (path, "r");
+	if (!fp) {
+	    fprintf (stderr, "%s: %s\n", path, strerror(errno));
+	    return;
+	}
+
+	if (verbose)
+	    fprintf (stderr, "reading %s\n", path);
+
+	while (fgets (line, sizeof(line), fp)) {
+	    char *name, *trace;
+
+	    line[strcspn (line, "\n")] = '\0';
+	    name = strchr (line, '\t');
+	    if (!name)
+		continue;
+	    *name++ = '\0';
+	    trace = strchr (name, '\t');
+	    if (!trace)
+		continue;
+	    *trace++ = '\0';
+
+	    addFrame (line, name, trace);
+	}
+
+	fclose (fp);
+}
+
+/* break down one traced frame */
+static void
+addFrame (const char *dev, const char *name, const char *trace)
+{
+	unsigned long long first, done;
+	Frame *fp;
+	int i;
+
+	if (indi_trace_find (trace, "done", &done) < 0)
+	    return;
+	if (indi_trace_find (trace, "exp", &first) < 0 &&
+				indi_trace_find (trace, "set", &first) < 0)
+	    return;
+
+	frames = (Frame *) realloc (frames, (nframes+1) * sizeof(Frame));
+	fp = &frames[nframes++];
+
+	strncpy (fp->dev, dev, sizeof(fp->dev)-1);
+	fp->dev[sizeof(fp->dev)-1] = '\0';
+	strncpy (fp->name, name, sizeof(fp->name)-1);
+	fp->name[sizeof(fp->name)-1] = '\0';
+	fp->total = done - first;
+
+	for (i = 0; i < 5; i++) {
+	    unsigned long long t0, t1;
+
+	    if (indi_trace_find (trace, frhops[i][1], &t0) == 0 &&
+		indi_trace_find (trace, frhops[i][2], &t1) == 0 && t1 >= t0)
+		fp->hop[i] = t1 - t0;
+	    else
+		fp->hop[i] = -1;
+	}
+}
+
+/* print the mean breakdown and the slowest frames */
+static void
+printFrames (void)
+{
+	double mean[5];
+	int n[5];
+	int i, j;
+
+	if (nframes == 0)
+	    return;
+
+	for (j = 0; j < 5; j++) {
+	    mean[j] = 0;
+	    n[j] = 0;
+	    for (i = 0; i < nframes; i++)
+		if (frames[i].hop[j] >= 0) {
+		    mean[j] += frames[i].hop[j];
+		    n[j]++;
+		}
+	    if (n[j])
+		mean[j] /= n[j];
+	}
+
+	printf ("\n%d frames, mean ms:", nframes);
+	for (j = 0; j < 5; j++)
+	    if (n[j])
+		printf (" %s %.3f", frhops[j][0], mean[j] / 1e3);
+	printf ("\n");
+
+	if (slowest <= 0)
+	    return;
+
+	qsort (frames, nframes, sizeof(Frame), cmpFrames);
+
+	printf ("\n%-32s %10s", "slowest frames (ms)", "total");
+	for (j = 0; j < 5; j++)
+	    printf (" %10s", frhops[j][0]);
+	printf ("\n");
+
+	for (i = 0; i < nframes && i < slowest; i++) {
+	    Frame *fp = &frames[i];
+	    char label[sizeof(fp->dev) + sizeof(fp->name)];
+
+	    snprintf (label, sizeof(label), "%s.%s", fp->dev, fp->name);
+	    printf ("%-32.32s %10.3f", label, fp->total / 1e3);
+	    for (j = 0; j < 5; j++)
+		if (fp->hop[j] >= 0)
+		    printf (" %10.3f", fp->hop[j] / 1e3);
+		else
+		    printf (" %10s", "-");
+	    printf ("\n");
+	}
+}
+
+/* qsort compare function, slowest frame first */
+static int
+cmpFrames (const void *a, const void *b)
+{
+	long long ta = ((const Frame *)a)->total;
+	long long tb = ((const Frame *)b)->total;
+
+	return (ta < tb ? 1 : ta > tb ? -1 : 0);
+}
+
+/* return 1 if name ends with suffix else 0 */
+static int
+hasSuffix (const char *name, const char *suffix)
+{
+	size_t nl = strlen (name), sl = strlen (suffix);
+
+	return (nl > sl && !strcmp (name + nl - sl, suffix));
+}